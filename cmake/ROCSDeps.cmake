@@ -69,6 +69,7 @@ if(ROCS_BUILD_MODULE_CORE)
   set(ROCS_FIND_BOOST_PROGRAM_OPTIONS yes)
   set(ROCS_FIND_BOOST_SYSTEM yes)
   set(ROCS_FIND_BOOST_FILESYSTEM yes)
+  set(ROCS_FIND_BOOST_THREAD yes)
   set(ROCS_FIND_BOOST_HEADERS yes)
 endif(ROCS_BUILD_MODULE_CORE)
 
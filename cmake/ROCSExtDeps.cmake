@@ -97,6 +97,19 @@ if(ROCS_FIND_BOOST_FILESYSTEM)
 endif(ROCS_FIND_BOOST_FILESYSTEM)
 
 
+if(ROCS_FIND_BOOST_THREAD)
+  find_package(Boost 1.40.0 COMPONENTS thread)
+  if(NOT Boost_FOUND)
+    message(FATAL_ERROR "Boost thread version >=1.40.0 not found.")
+  endif(NOT Boost_FOUND)
+  message(STATUS "-> Boost thread version ${Boost_MAJOR_VERSION}.${Boost_MINOR_VERSION}.${Boost_SUBMINOR_VERSION}.")
+  # Set includes/libraries
+  include_directories(${Boost_INCLUDE_DIRS})
+  link_directories(${Boost_LIBRARY_DIRS})
+  set(BOOST_THREAD_LIBRARIES ${Boost_LIBRARIES})
+endif(ROCS_FIND_BOOST_THREAD)
+
+
 if(ROCS_FIND_BOOST_UNIT_TEST_FRAMEWORK)
   find_package(Boost 1.40.0 COMPONENTS unit_test_framework)
   if(NOT Boost_FOUND)
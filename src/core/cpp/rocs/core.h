@@ -35,6 +35,7 @@
 
 #include "rocs/core/Configuration.h"
 #include "rocs/core/FileInfo.h"
+#include "rocs/core/ThreadPool.h"
 #include "rocs/core/Timer.h"
 #include "rocs/core/debug.h"
 #include "rocs/core/error.h"
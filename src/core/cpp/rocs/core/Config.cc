@@ -35,7 +35,8 @@ using namespace std;
 
 
 // ---------------------------------------------
-Config::Config()
+Config::Config() :
+  _generation(0)
 {
   clear();
 }
@@ -124,6 +125,8 @@ void Config::addCommandLineArgs(int argc, char const **argv)
     _tree.add(variable_name, value);
     //printConfiguration();
   } // end loop words
+
+  buildIndex();
 }
 
 
@@ -142,6 +145,7 @@ void rocs::core::Config::addConfigFile(string filename)
   readFileAndCheckIncludes(filename, &new_tree, true);
   // add it to the root of our tree
   _tree.insert(_tree.end(), new_tree.begin(), new_tree.end());
+  buildIndex();
 }
 
 
@@ -434,7 +438,7 @@ void Config::printPtreeRec(const ptree* tree, int depth)
          != tree->end(); ++son_iter)
   {
     string son_node_name = son_iter->first;
-    const ptree son_tree = son_iter->second;
+    const ptree &son_tree = son_iter->second;
     string son_node_value = son_tree.get_value("");
     //cout << "second:" << typeid(i->second).name() << endl;
     for (int var = 0; var < depth; ++var)
@@ -497,11 +501,8 @@ std::string Config::getValueAsString(const ptree* tree,
   for (ptree::const_reverse_iterator son_iter = tree->rbegin(); son_iter
          != tree->rend(); ++son_iter)
   {
-    std::string son_node_name = son_iter->first;
-    ptree son_tree = son_iter->second;
-    std::string son_node_value = son_tree.get_value("");
-    rocsDebug3("Node:'%s' = '%s'", son_node_name.c_str(),
-               son_node_value.c_str());
+    const std::string &son_node_name = son_iter->first;
+    const ptree &son_tree = son_iter->second;
 
     if (son_node_name == key_to_search)
     {
@@ -509,7 +510,7 @@ std::string Config::getValueAsString(const ptree* tree,
       if (search_for_son_value)
       {
         was_found = true;
-        return son_node_value;
+        return son_tree.get_value("");
       }
       else
         return getValueAsString(&son_tree, son_key_to_search, was_found);
@@ -525,7 +526,7 @@ std::string Config::getValueAsString(const ptree* tree,
 
 // ---------------------------------------------
 void Config::getChildren(const ptree* tree,
-                                     const std::string path, int& nb_found, std::vector<ptree>* answer)
+                                     const std::string path, int& nb_found, std::vector<const ptree*>* answer)
 {
   nb_found = 0;
   rocsDebug3("get_children(path:'%s')", path.c_str());
@@ -541,10 +542,9 @@ void Config::getChildren(const ptree* tree,
     for (ptree::const_iterator son_iter = tree->begin(); son_iter
            != tree->end(); ++son_iter)
     {
-      ptree sonTree = son_iter->second;
       //rocsDebug3("pushing back :");
-      //printTree(&sonTree);
-      answer->push_back(sonTree);
+      //printTree(&son_iter->second);
+      answer->push_back(&son_iter->second);
       ++nb_found;
     } // end loop sons
     return;
@@ -571,15 +571,9 @@ void Config::getChildren(const ptree* tree,
   for (ptree::const_reverse_iterator son_iter = tree->rbegin(); son_iter
          != tree->rend(); ++son_iter)
   {
-    std::string son_node_name = son_iter->first;
-    ptree son_tree = son_iter->second;
-    std::string son_node_value = son_tree.get_value("");
-    rocsDebug3("Node:'%s' = '%s'", son_node_name.c_str(),
-               son_node_value.c_str());
-
-    if (son_node_name == key_to_search)
+    if (son_iter->first == key_to_search)
     {
-      getChildren(&son_tree, son_key_to_search, nb_found, answer);
+      getChildren(&son_iter->second, son_key_to_search, nb_found, answer);
       return;
     }
   } // end loop sons
@@ -590,6 +584,68 @@ void Config::getChildren(const ptree* tree,
 }
 
 
+// ---------------------------------------------
+void Config::IndexEntry::set(const string& new_value)
+{
+  value = new_value;
+  intValue = atoi(value.c_str());
+  doubleValue = atof(value.c_str());
+  boolValue = (boost::iequals(value, "true") || boost::iequals(value, "yes")
+               || boost::iequals(value, "on") || intValue != 0);
+}
+
+
+// ---------------------------------------------
+void Config::buildIndex()
+{
+  _index.clear();
+  _rootEntry.set(_tree.get_value(""));
+  indexTree(_tree, "", &_index);
+  ++_generation;
+  rocsDebug3("buildIndex(): %i paths", (int) _index.size());
+}
+
+
+// ---------------------------------------------
+void Config::indexTree(const ptree& tree, const string& prefix, Index* index)
+{
+  // Walk the sons backwards so that only the last son of each name
+  // is indexed, like the backward search of getValueAsString().
+  set<string> seen;
+  for (ptree::const_reverse_iterator son_iter = tree.rbegin(); son_iter
+         != tree.rend(); ++son_iter)
+  {
+    const string& son_node_name = son_iter->first;
+    // a name containing a dot can not be reached with a dotted path
+    if (son_node_name.empty() || son_node_name.find('.') != string::npos)
+      continue;
+    if (!seen.insert(son_node_name).second)
+      continue;
+
+    string path = prefix + son_node_name;
+    (*index)[path].set(son_iter->second.get_value(""));
+    if (!son_iter->second.empty())
+      indexTree(son_iter->second, path + ".", index);
+  } // end loop sons
+}
+
+
+// ---------------------------------------------
+const Config::IndexEntry* Config::findEntry(const char* path,
+                                            size_t length) const
+{
+  if (length == 0)
+    return &_rootEntry;
+
+  // "a.b." is the value of "a.b", as in getValueAsString()
+  if (path[length - 1] == '.')
+    --length;
+  Index::const_iterator it = _index.find(PathRange(path, length), PathHash(),
+                                         PathEqual());
+  return (it == _index.end() ? 0 : &it->second);
+}
+
+
 // ---------------------------------------------
 // Template specifications 
 // ---------------------------------------------
@@ -632,3 +688,69 @@ const char* Config::getValue<const char*>(const ptree* tree,
   string return_value = getValueAsString(tree, path, was_found);
   return (was_found ? return_value.c_str() : default_value);
 }
+
+// bool
+template<>
+bool Config::getValue<bool>(const ptree* tree,
+                            const string path, const bool default_value, bool& was_found)
+{
+  rocsDebug3("getValue<bool>('%s')", path.c_str());
+  IndexEntry entry;
+  entry.set(getValueAsString(tree, path, was_found));
+  return (was_found ? entry.boolValue : default_value);
+}
+
+
+// ---------------------------------------------
+// Indexed template specifications
+// ---------------------------------------------
+// string
+template<>
+string Config::getIndexedValue<string>(const char* path, size_t length,
+                                       const string default_value, bool& was_found) const
+{
+  const IndexEntry* entry = findEntry(path, length);
+  was_found = (entry != 0);
+  return (was_found ? entry->value : default_value);
+}
+
+// int
+template<>
+int Config::getIndexedValue<int>(const char* path, size_t length,
+                                 const int default_value, bool& was_found) const
+{
+  const IndexEntry* entry = findEntry(path, length);
+  was_found = (entry != 0);
+  return (was_found ? entry->intValue : default_value);
+}
+
+// double
+template<>
+double Config::getIndexedValue<double>(const char* path, size_t length,
+                                       const double default_value, bool& was_found) const
+{
+  const IndexEntry* entry = findEntry(path, length);
+  was_found = (entry != 0);
+  return (was_found ? entry->doubleValue : default_value);
+}
+
+// const char*
+template<>
+const char* Config::getIndexedValue<const char*>(const char* path, size_t length,
+                                                 const char* default_value, bool& was_found) const
+{
+  // points into the index, valid until the configuration is modified
+  const IndexEntry* entry = findEntry(path, length);
+  was_found = (entry != 0);
+  return (was_found ? entry->value.c_str() : default_value);
+}
+
+// bool
+template<>
+bool Config::getIndexedValue<bool>(const char* path, size_t length,
+                                   const bool default_value, bool& was_found) const
+{
+  const IndexEntry* entry = findEntry(path, length);
+  was_found = (entry != 0);
+  return (was_found ? entry->boolValue : default_value);
+}
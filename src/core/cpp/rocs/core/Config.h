@@ -37,7 +37,10 @@
 #include <boost/property_tree/info_parser.hpp>
 #include <boost/foreach.hpp>
 #include <boost/utility/value_init.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/functional/hash.hpp>
 // STL includes
+#include <cstring>
 #include <vector>
 #include <iostream>
 
@@ -76,6 +79,12 @@ using boost::property_tree::ptree;
  * For INFO, the include tag is :<br>
  * <code>include { href "toInsert.info" }</code>
  *
+ * After each file or set of command line arguments is added, the tree
+ * is flattened into an index from the dotted path of each parameter to
+ * its value, parsed once as int, double and bool. getValue() is then a
+ * single hash lookup. When a key appears several times under the same
+ * node, the last one is used, as when following the path in the tree.
+ *
  * \author Andrzej Pronobis, Arnaud Ramey 
  */
 class Config
@@ -86,7 +95,8 @@ public:
   Config();
 
   /*! Constructor, processes command line arguments. */
-  Config(int argc, char const **argv)
+  Config(int argc, char const **argv) :
+    _generation(0)
   {
     addCommandLineArgs(argc, argv);
   }
@@ -133,9 +143,29 @@ public:
    *         the default value otherwise
    */
   template<class _T>
-  _T getValue(const std::string path, const _T default_value, bool& was_found) const
+  _T getValue(const std::string &path, const _T default_value, bool& was_found) const
+  {
+    return getIndexedValue<_T> (path.data(), path.size(), default_value,
+                                was_found);
+  }
+
+  /*!
+   * get the value of a given parameter, without copying the path
+   * \param path
+   *          the path of the parameter in the configuration tree
+   * \param default_value
+   *          the value to return if the path was impossible to follow
+   *          (non existing variable)
+   * \param was_found
+   *          is changed to <code>true</code>
+   *          if the parameter was found in the configuration tree
+   * \return the value of the parameter in the config tree if found,
+   *         the default value otherwise
+   */
+  template<class _T>
+  _T getValue(const char* path, const _T default_value, bool& was_found) const
   {
-    return getValue<_T> (&_tree, path, default_value, was_found);
+    return getIndexedValue<_T> (path, strlen(path), default_value, was_found);
   }
 
   /*!
@@ -149,7 +179,24 @@ public:
    *         the default value otherwise
    */
   template<class _T>
-  _T getValue(const std::string path, const _T default_value) const
+  _T getValue(const std::string &path, const _T default_value) const
+  {
+    bool wasFound;
+    return getValue<_T> (path, default_value, wasFound);
+  }
+
+  /*!
+   * get the value of a given parameter, without copying the path
+   * \param path
+   *          the path of the parameter in the configuration tree
+   * \param default_value
+   *          the value to return if the path was impossible to follow
+   *          (non existing variable)
+   * \return the value of the parameter in the config tree if found,
+   *         the default value otherwise
+   */
+  template<class _T>
+  _T getValue(const char* path, const _T default_value) const
   {
     bool wasFound;
     return getValue<_T> (path, default_value, wasFound);
@@ -200,6 +247,16 @@ public:
     getValueList<_T> (&_tree, path, key, ans);
   }
 
+  /*!
+   * Returns the generation of the configuration, incremented each time
+   * values are added or the configuration is cleared. A ConfigParam
+   * compares it with the generation it was resolved at to refresh.
+   */
+  unsigned int getGeneration() const
+  {
+    return _generation;
+  }
+
   /*!
    * Prints the the whole configuration loaded to std::cout
    */
@@ -217,11 +274,124 @@ private:
   /** The property tree. */
   ptree _tree;
 
+  /*! Value of a parameter in the index, parsed once for each type. */
+  struct IndexEntry
+  {
+    IndexEntry() :
+      intValue(0), doubleValue(0), boolValue(false)
+    { }
+
+    /*! Sets the value and parses it. */
+    void set(const std::string &value);
+
+    std::string value;
+    int intValue;
+    double doubleValue;
+    bool boolValue;
+  };
+
+  /*! Characters of a path, looked up in the index without a copy. */
+  struct PathRange
+  {
+    PathRange(const char *begin, size_t size) :
+      begin(begin), size(size)
+    { }
+
+    const char *begin;
+    size_t size;
+  };
+
+  /*! Hash of a path, equal for a string and a range of the same characters. */
+  struct PathHash
+  {
+    size_t operator()(const std::string &path) const
+    {
+      return boost::hash_range(path.data(), path.data() + path.size());
+    }
+    size_t operator()(const PathRange &path) const
+    {
+      return boost::hash_range(path.begin, path.begin + path.size);
+    }
+  };
+
+  /*! Compares a range with a path of the index. */
+  struct PathEqual
+  {
+    bool operator()(const PathRange &a, const std::string &b) const
+    {
+      return (a.size == b.size()) && (memcmp(a.begin, b.data(), a.size) == 0);
+    }
+    bool operator()(const std::string &a, const PathRange &b) const
+    {
+      return operator()(b, a);
+    }
+  };
+
+  /*! Index from the dotted path of a parameter to its value. */
+  typedef boost::unordered_map<std::string, IndexEntry, PathHash> Index;
+
+  /** The flattened tree, rebuilt each time the tree changes. */
+  Index _index;
+
+  /** The value of the root of the tree, for the empty path. */
+  IndexEntry _rootEntry;
+
+  /** Incremented each time the index is rebuilt. */
+  unsigned int _generation;
+
   /*! Clear all the info parsed till now */
   void clear()
   {
     _tree.clear();
+    buildIndex();
   }
+
+  /*! Rebuilds the index from the tree. */
+  void buildIndex();
+
+  /*!
+   * Adds the nodes of a tree to the index, following only the last
+   * son of each name as getValueAsString() does.
+   * \param tree
+   *          the tree to index
+   * \param prefix
+   *          the path of the tree followed by a dot, or empty for the root
+   * \param index
+   *          the index to populate
+   */
+  static void indexTree(const ptree &tree, const std::string &prefix,
+                        Index *index);
+
+  /*!
+   * Returns the index entry of a path, or 0 if the path cannot be
+   * followed in the tree.
+   * \param path
+   *          the characters of the path, not necessarily null-terminated
+   * \param length
+   *          the number of characters of the path
+   */
+  const IndexEntry *findEntry(const char *path, size_t length) const;
+
+  /*!
+   * get the value of a given parameter from the index
+   * \param path
+   *          the path of the parameter in the configuration tree
+   * \param length
+   *          the number of characters of the path
+   * \param default_value
+   *          the value to return if the path was impossible to follow
+   * \param was_found
+   *          is changed to true if we found the wanted value
+   * \return the value of the parameter if found,
+   *         the default value otherwise
+   */
+  template<class _T>
+  _T getIndexedValue(const char *path, size_t length, const _T default_value,
+                     bool& was_found) const
+    {
+      rocsDebug3("getIndexedValue<_T>(%.*s)", (int) length, path);
+      rocsError("Templated function non implemented");
+    }
   
   /*!
    * guess the type of file according to the extension
@@ -354,7 +524,7 @@ private:
    *          the vector to populate with the answers
    */
   static void getChildren(const ptree* tree, const std::string path,
-                          int& nb_found, std::vector<ptree>* answer);
+                          int& nb_found, std::vector<const ptree*>* answer);
 
   /*!
    * Returns a list of values.
@@ -397,7 +567,7 @@ private:
 
     // get the wanted sons
     int nb_sons;
-    std::vector<ptree> sons;
+    std::vector<const ptree*> sons;
     getChildren(tree, path, nb_sons, &sons);
     rocsDebug3("children obtained, nb:%i", nb_sons);
     //for (std::vector<ptree>::iterator it = sons.begin(); it < sons.end(); ++it)
@@ -413,19 +583,18 @@ private:
                              dot_pos + 1));
     rocsDebug3("We remove the first path, keyHead, '%s', keyTail:'%s'",
                keyHead.c_str(), keyTail.c_str());
-    for (std::vector<ptree>::iterator son_it = sons.begin(); son_it
+    for (std::vector<const ptree*>::iterator son_it = sons.begin(); son_it
            < sons.end(); ++son_it)
     {
       //rocsDebug3("Current son:");
-      //printTree(&(*son_it));
-      for (ptree::iterator sonson_it = (*son_it).begin(); sonson_it
-             != (*son_it).end(); ++sonson_it)
+      //printTree(*son_it);
+      for (ptree::const_iterator sonson_it = (*son_it)->begin(); sonson_it
+             != (*son_it)->end(); ++sonson_it)
       {
         if (sonson_it->first != keyHead)
           continue;
         bool was_found = false;
-        ptree sonson = sonson_it->second;
-        _T value = getValue<_T> (&sonson, keyTail, _T(), was_found);
+        _T value = getValue<_T> (&sonson_it->second, keyTail, _T(), was_found);
         if (was_found)
         {
           ans.push_back(value);
@@ -451,6 +620,25 @@ double Config::getValue(const ptree* tree, const std::string path,
 template<> // const char*
 const char* Config::getValue(const ptree* tree, const std::string path,
                              const char* default_value, bool& was_found);
+template<> // bool
+bool Config::getValue(const ptree* tree, const std::string path,
+                      const bool default_value, bool& was_found);
+
+template<> // string
+std::string Config::getIndexedValue(const char *path, size_t length,
+                                    const std::string default_value, bool& was_found) const;
+template<> // int
+int Config::getIndexedValue(const char *path, size_t length,
+                            const int default_value, bool& was_found) const;
+template<> // double
+double Config::getIndexedValue(const char *path, size_t length,
+                               const double default_value, bool& was_found) const;
+template<> // const char*
+const char* Config::getIndexedValue(const char *path, size_t length,
+                                    const char* default_value, bool& was_found) const;
+template<> // bool
+bool Config::getIndexedValue(const char *path, size_t length,
+                             const bool default_value, bool& was_found) const;
 
 } // namespace core
 } // namespace rocs
@@ -0,0 +1,209 @@
+// ===============================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (c) 2010-2012, the ROCS authors. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer. 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution. 
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// ===============================================================================
+
+#ifndef _ROCS_CORE_CONFIGPARAM_H_
+#define _ROCS_CORE_CONFIGPARAM_H_
+
+// ROCS includes
+#include "rocs/core/Config.h"
+// STL includes
+#include <string>
+#include <vector>
+
+namespace rocs {
+namespace core {
+
+/*!
+ * Handle on a parameter of a Config, storing its value converted to _T.
+ *
+ * The path is looked up when the handle is created, typically when a
+ * component starts. get() then returns the stored value and only looks
+ * the path up again if the configuration was modified in the meantime,
+ * which is detected by comparing the generation of the configuration
+ * (see Config::getGeneration()).
+ *
+ * <code>
+ * ConfigParam<int> nbThreads(config, "surf.threads", 1);
+ * ...
+ * ThreadPool pool(nbThreads.get());
+ * </code>
+ *
+ * The supported types are std::string, int, double, const char* and
+ * bool. A const char* value points into the configuration and is valid
+ * until the configuration is modified. Lists are handled by
+ * ConfigParam<std::vector<_T> >.
+ *
+ * The handle must not outlive the configuration. As the configuration
+ * itself, it must not be read while the configuration is modified.
+ *
+ * \author Andrzej Pronobis
+ */
+template<class _T>
+class ConfigParam
+{
+public:
+
+  /*!
+   * Constructor, resolves the parameter.
+   * \param config
+   *          the configuration
+   * \param path
+   *          the path of the parameter in the configuration tree
+   * \param default_value
+   *          the value to use if the path was impossible to follow
+   */
+  ConfigParam(const Config &config, const std::string &path,
+              const _T default_value) :
+    _config(&config), _path(path), _defaultValue(default_value)
+  {
+    resolve();
+  }
+
+  /*! Returns the value, refreshed if the configuration was modified. */
+  const _T &get() const
+  {
+    if (_generation != _config->getGeneration())
+      resolve();
+    return _value;
+  }
+
+  /*! Returns true if the parameter was found in the configuration. */
+  bool wasFound() const
+  {
+    get();
+    return _wasFound;
+  }
+
+  /*! Returns the path of the parameter. */
+  const std::string &getPath() const
+  {
+    return _path;
+  }
+
+  /*! Looks the parameter up again in the configuration. */
+  void resolve() const
+  {
+    _value = _config->getValue<_T> (_path, _defaultValue, _wasFound);
+    _generation = _config->getGeneration();
+  }
+
+private:
+
+  /** The configuration. */
+  const Config *_config;
+
+  /** The path of the parameter. */
+  std::string _path;
+
+  /** The value used if the parameter is not found. */
+  _T _defaultValue;
+
+  /** The value resolved at _generation. */
+  mutable _T _value;
+
+  /** True if the parameter was found at _generation. */
+  mutable bool _wasFound;
+
+  /** The generation of the configuration the value was resolved at. */
+  mutable unsigned int _generation;
+};
+
+
+/*!
+ * Handle on a list of values in a Config, as returned by
+ * Config::getValueList(). The list is empty if no value was found.
+ * The supported element types are std::string, int, double and bool.
+ */
+template<class _T>
+class ConfigParam<std::vector<_T> >
+{
+public:
+
+  /*!
+   * Constructor, resolves the list.
+   * \param config
+   *          the configuration
+   * \param path
+   *          the path to follow from the root of the tree
+   * \param key
+   *          the tag to find in the sons of the path
+   */
+  ConfigParam(const Config &config, const std::string &path,
+              const std::string &key) :
+    _config(&config), _path(path), _key(key)
+  {
+    resolve();
+  }
+
+  /*! Returns the list, refreshed if the configuration was modified. */
+  const std::vector<_T> &get() const
+  {
+    if (_generation != _config->getGeneration())
+      resolve();
+    return _value;
+  }
+
+  /*! Returns true if at least one value was found in the configuration. */
+  bool wasFound() const
+  {
+    return !get().empty();
+  }
+
+  /*! Returns the path of the list. */
+  const std::string &getPath() const
+  {
+    return _path;
+  }
+
+  /*! Looks the list up again in the configuration. */
+  void resolve() const
+  {
+    _value.clear();
+    _config->getValueList<_T> (_path, _key, _value);
+    _generation = _config->getGeneration();
+  }
+
+private:
+
+  /** The configuration. */
+  const Config *_config;
+
+  /** The path of the list. */
+  std::string _path;
+
+  /** The tag of the values. */
+  std::string _key;
+
+  /** The list resolved at _generation. */
+  mutable std::vector<_T> _value;
+
+  /** The generation of the configuration the list was resolved at. */
+  mutable unsigned int _generation;
+};
+
+}
+}
+
+#endif /* _ROCS_CORE_CONFIGPARAM_H_ */
@@ -0,0 +1,131 @@
+// ===============================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (c) 2010-2012, the ROCS authors. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer. 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution. 
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// ===============================================================================
+
+#include "rocs/core/ThreadPool.h"
+// Boost includes
+#include <boost/bind.hpp>
+
+namespace rocs {
+namespace core {
+
+
+// -----------------------------------------
+ThreadPool::ThreadPool(int nbThreads) :
+	_nbThreads(nbThreads), _nbActive(0), _stop(false)
+{
+	rocsDebug3("ThreadPool(%i)", nbThreads);
+	if (_nbThreads < 1)
+		_nbThreads = 1;
+	for (int i = 0; i < _nbThreads; ++i)
+		_threads.create_thread(boost::bind(&ThreadPool::workerLoop, this));
+}
+
+
+// -----------------------------------------
+ThreadPool::~ThreadPool()
+{
+	{
+		boost::mutex::scoped_lock lock(_mutex);
+		while (!_tasks.empty() || _nbActive)
+			_tasksFinished.wait(lock);
+		_stop = true;
+	}
+	_taskScheduled.notify_all();
+	_threads.join_all();
+}
+
+
+// -----------------------------------------
+void ThreadPool::schedule(const Task &task)
+{
+	{
+		boost::mutex::scoped_lock lock(_mutex);
+		_tasks.push_back(task);
+	}
+	_taskScheduled.notify_one();
+}
+
+
+// -----------------------------------------
+void ThreadPool::wait()
+{
+	std::string error;
+	{
+		boost::mutex::scoped_lock lock(_mutex);
+		while (!_tasks.empty() || _nbActive)
+			_tasksFinished.wait(lock);
+		error.swap(_error);
+	}
+
+	if (!error.empty())
+		throw Exception("ThreadPool::wait", error);
+}
+
+
+// -----------------------------------------
+void ThreadPool::workerLoop()
+{
+	for (;;)
+	{
+		Task task;
+		{
+			boost::mutex::scoped_lock lock(_mutex);
+			while (_tasks.empty() && !_stop)
+				_taskScheduled.wait(lock);
+			if (_tasks.empty())
+				return;
+			task = _tasks.front();
+			_tasks.pop_front();
+			++_nbActive;
+		}
+
+		std::string error;
+		try
+		{
+			task();
+		}
+		catch (std::exception &e)
+		{
+			error = e.what();
+		}
+		catch (...)
+		{
+			error = "Unknown exception thrown by a task.";
+		}
+
+		{
+			boost::mutex::scoped_lock lock(_mutex);
+			--_nbActive;
+			if (_error.empty())
+				_error = error;
+			if (_tasks.empty() && !_nbActive)
+				_tasksFinished.notify_all();
+		}
+	}
+}
+
+
+}
+}
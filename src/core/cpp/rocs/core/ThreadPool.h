@@ -0,0 +1,120 @@
+// ===============================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (c) 2010-2012, the ROCS authors. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer. 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution. 
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// ===============================================================================
+
+#ifndef _ROCS_CORE_THREADPOOL_H_
+#define _ROCS_CORE_THREADPOOL_H_
+
+// ROCS includes
+#include "rocs/core/error.h"
+// Boost includes
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+// STL includes
+#include <deque>
+#include <string>
+
+namespace rocs {
+namespace core {
+
+/*!
+ * A fixed-size pool of worker threads executing scheduled tasks.
+ *
+ * Tasks are executed in the order in which they were scheduled.
+ * The pool is meant to be used by one owner at a time: wait()
+ * returns once all the tasks scheduled so far have finished.
+ *
+ * \author Andrzej Pronobis
+ */
+class ThreadPool
+{
+public:
+
+	/*! Type of a task executed by the pool. */
+	typedef boost::function<void ()> Task;
+
+public:
+
+	/*! Constructor. Starts a given number of worker threads. */
+	ThreadPool(int nbThreads);
+
+	/*! Destructor. Waits for the scheduled tasks and stops the threads. */
+	~ThreadPool();
+
+public:
+
+	/*! Schedules a task for execution. */
+	void schedule(const Task &task);
+
+	/*! Blocks until all the scheduled tasks are finished. If any of the
+	 * tasks threw an exception, an Exception is thrown with the
+	 * message of the first one. */
+	void wait();
+
+	/*! Returns the number of worker threads. */
+	int getNbThreads() const
+	{ return _nbThreads; }
+
+
+private:
+
+	/*! Main loop of a worker thread. */
+	void workerLoop();
+
+
+private:
+
+	/*! Number of worker threads. */
+	int _nbThreads;
+
+	/*! Worker threads. */
+	boost::thread_group _threads;
+
+	/*! Tasks waiting for execution. */
+	std::deque<Task> _tasks;
+
+	/*! Number of tasks being executed. */
+	int _nbActive;
+
+	/*! Set to true when the threads should finish. */
+	bool _stop;
+
+	/*! Message of the first exception thrown by a task since the last wait(). */
+	std::string _error;
+
+	/*! Mutex protecting the queue and the counters. */
+	boost::mutex _mutex;
+
+	/*! Signaled when a new task is scheduled or the pool is stopped. */
+	boost::condition_variable _taskScheduled;
+
+	/*! Signaled when all tasks are finished. */
+	boost::condition_variable _tasksFinished;
+
+};
+
+}
+}
+
+#endif /* _ROCS_CORE_THREADPOOL_H_ */
@@ -31,6 +31,7 @@
 
 // ROCS inludes
 #include <rocs/core/Config.h>
+#include <rocs/core/ConfigParam.h>
 // Boost & STL includes
 #include <vector>
 #include <boost/assign/list_of.hpp>
@@ -365,3 +366,92 @@ TEST(config, listChilds)
   testListChildren(config, "one4", list_of("one4.two4_1")("one4.two4_2"));
   testListChildren(config, "list2.item", list_of("list2.item.key2")("list2.item.key2X"));
 }
+
+
+// ------------------------------------------------------------
+// Testing the indexed lookups against the tree.
+// ------------------------------------------------------------
+TEST(config, indexedValues)
+{
+  // Define some arguments
+  int argc = 12;
+  char const *argv[] =
+    { "test", "--a.b", "1", "--a.b", "2", "--a.c", "2.5",
+      "--flags.on", "yes", "--flags.off", "0", "--name", "rocs" };
+
+  // Let configuration parse the arguments
+  Config config(argc, argv);
+
+  // The last value given wins
+  bool wasFound;
+  ASSERT_EQ(config.getValue("a.b", -1, wasFound), 2);
+  ASSERT_TRUE(wasFound);
+  ASSERT_EQ(config.getValue("a.b.", -1), 2);
+  ASSERT_EQ(config.getValue(string("a.b."), -1), 2);
+  ASSERT_EQ(config.getValue("a.c", 0.0), 2.5);
+  ASSERT_EQ(config.getValue("a.c", string()), string("2.5"));
+  ASSERT_EQ(string(config.getValue("name", "")), string("rocs"));
+  ASSERT_TRUE(config.getValue("flags.on", false));
+  ASSERT_FALSE(config.getValue("flags.off", true));
+
+  // Missing paths return the default value
+  ASSERT_EQ(config.getValue("a.d", -1, wasFound), -1);
+  ASSERT_FALSE(wasFound);
+  ASSERT_EQ(config.getValue("a.b.c", -1, wasFound), -1);
+  ASSERT_FALSE(wasFound);
+
+  // Values added later override the index
+  char const *argv2[] = { "test", "--a.b", "3" };
+  config.addCommandLineArgs(2, argv2);
+  ASSERT_EQ(config.getValue("a.b", -1), 3);
+}
+
+
+// ------------------------------------------------------------
+// Testing parameter handles and their refresh.
+// ------------------------------------------------------------
+TEST(config, params)
+{
+  // Define some arguments
+  int argc = 12;
+  char const *argv[] =
+    { "test", "--a.i", "1", "--a.d", "2.5", "--a.b", "true", "--name", "rocs",
+      "--list.item1.key", "1", "--list.item2.key", "2" };
+
+  // Let configuration parse the arguments
+  Config config(argc, argv);
+
+  // Resolve the handles
+  ConfigParam<int> paramInt(config, "a.i", -1);
+  ConfigParam<double> paramDouble(config, "a.d", -1.0);
+  ConfigParam<bool> paramBool(config, "a.b", false);
+  ConfigParam<string> paramString(config, "name", "");
+  ConfigParam<const char*> paramChars(config, "name", "");
+  ConfigParam<int> paramMissing(config, "a.missing", -1);
+  ConfigParam<vector<int> > paramList(config, "list", "key");
+
+  // Check the values
+  ASSERT_EQ(paramInt.get(), 1);
+  ASSERT_EQ(paramDouble.get(), 2.5);
+  ASSERT_TRUE(paramBool.get());
+  ASSERT_EQ(paramString.get(), string("rocs"));
+  ASSERT_EQ(string(paramChars.get()), string("rocs"));
+  ASSERT_TRUE(paramInt.wasFound());
+  ASSERT_FALSE(paramMissing.wasFound());
+  ASSERT_EQ(paramMissing.get(), -1);
+  ASSERT_EQ(paramList.get().size(), 2U);
+  ASSERT_EQ(paramList.get()[1], 2);
+
+  // Modify the configuration, the handles are refreshed
+  unsigned int generation = config.getGeneration();
+  char const *argv2[] =
+    { "test", "--a.i", "3", "--a.missing", "4", "--list.item3.key", "5" };
+  config.addCommandLineArgs(6, argv2);
+  ASSERT_NE(config.getGeneration(), generation);
+  ASSERT_EQ(paramInt.get(), 3);
+  ASSERT_TRUE(paramMissing.wasFound());
+  ASSERT_EQ(paramMissing.get(), 4);
+  ASSERT_EQ(paramList.get().size(), 3U);
+  ASSERT_EQ(paramList.get()[2], 5);
+  ASSERT_EQ(string(paramChars.get()), string("rocs"));
+}
@@ -0,0 +1,92 @@
+// ===============================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (c) 2010-2012, the ROCS authors. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer. 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution. 
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// ===============================================================================
+
+/*!
+ * ThreadPool test case.
+ * \author Andrzej Pronobis
+ * \file test_threadPool.cc
+ */
+
+// ROCS inludes
+#include <rocs/core/ThreadPool.h>
+// Boost & STL includes
+#include <vector>
+#include <boost/bind.hpp>
+// Google Test
+#include "gtest/gtest.h"
+
+using namespace rocs::core;
+using namespace std;
+
+/*! Task writing its index to a slot of the output. */
+static void writeIndex(vector<int> *output, int index)
+{
+  (*output)[index] = index;
+}
+
+/*! Task throwing an exception. */
+static void throwError()
+{
+  throw Exception("throwError", "task failed");
+}
+
+// ------------------------------------------------------------
+// All scheduled tasks are executed before wait() returns.
+// ------------------------------------------------------------
+TEST(threadPool, executes_all_tasks)
+{
+  ThreadPool pool(4);
+  ASSERT_EQ(4, pool.getNbThreads());
+
+  // The pool must be reusable after wait()
+  for (int pass = 0; pass < 3; ++pass)
+  {
+    vector<int> output(1000, -1);
+    for (int i = 0; i < 1000; ++i)
+      pool.schedule(boost::bind(&writeIndex, &output, i));
+    pool.wait();
+
+    for (int i = 0; i < 1000; ++i)
+      EXPECT_EQ(i, output[i]);
+  }
+}
+
+// ------------------------------------------------------------
+// Exceptions thrown by tasks are reported by wait().
+// ------------------------------------------------------------
+TEST(threadPool, reports_exceptions)
+{
+  ThreadPool pool(2);
+  vector<int> output(10, -1);
+  pool.schedule(&throwError);
+  for (int i = 0; i < 10; ++i)
+    pool.schedule(boost::bind(&writeIndex, &output, i));
+  EXPECT_THROW(pool.wait(), Exception);
+
+  // Other tasks are still executed and the error is cleared
+  for (int i = 0; i < 10; ++i)
+    EXPECT_EQ(i, output[i]);
+  EXPECT_NO_THROW(pool.wait());
+}
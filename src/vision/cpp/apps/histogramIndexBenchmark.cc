@@ -0,0 +1,130 @@
+// ==================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (C) 2010  Arnaud Ramey, Andrzej Pronobis
+//
+// This file is part of ROCS.
+//
+// ROCS is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation, either version 3
+// of the License, or (at your option) any later version.
+//
+// ROCS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ROCS. If not, see <http://www.gnu.org/licenses/>.
+// ==================================================================
+
+
+/*!
+ * \file histogramIndexBenchmark.cc
+ *
+ * Measures the recall and the latency of the queries of HistogramIndex
+ * on stored histograms, e.g. produced by CrfhInterface and converted
+ * with HistogramFile::convertFromText().
+ *
+ * Usage: rocs_histogramIndexBenchmark <histograms.bin> [k] [measure]
+ *
+ * Every 10th histogram is used as a query, the others are indexed.
+ * measure is "chi2" (default) or "intersection".
+ *
+ * \author Andrzej Pronobis
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "rocs/cv/HistogramFile.h"
+#include "rocs/cv/HistogramIndex.h"
+#include "rocs/core/Timer.h"
+
+using namespace rocs::cv;
+
+/*! Runs all the queries and returns the average time in milliseconds
+ and the recall of the k best matches with respect to the exact ones. */
+static void runQueries(const HistogramIndex &index,
+		const std::vector<SparseHistogram> &queries, int k,
+		const std::vector<std::vector<HistogramIndex::Match> > &exact,
+		double &time, double &recall) {
+	std::vector<std::vector<HistogramIndex::Match> > results(queries.size());
+	Timer timer;
+	for (unsigned int q = 0; q < queries.size(); ++q)
+		index.query(queries[q], k, results[q]);
+	time = (double) timer.getTimeMilliseconds() / queries.size();
+
+	long found = 0;
+	long total = 0;
+	for (unsigned int q = 0; q < queries.size(); ++q) {
+		for (unsigned int i = 0; i < exact[q].size(); ++i)
+			for (unsigned int j = 0; j < results[q].size(); ++j)
+				if (exact[q][i].id == results[q][j].id) {
+					++found;
+					break;
+				}
+		total += exact[q].size();
+	}
+	recall = (total) ? (double) found / total : 1;
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		printf("Usage: %s <histograms.bin> [k] [chi2|intersection]\n", argv[0]);
+		return 1;
+	}
+	int k = (argc > 2) ? atoi(argv[2]) : 10;
+	HistogramMeasure measure = ((argc > 3) && (strcmp(argv[3],
+			"intersection") == 0)) ? HM_INTERSECTION : HM_CHI2;
+
+	// Load the histograms
+	HistogramFile file(argv[1]);
+	HistogramIndex index(measure);
+	std::vector<SparseHistogram> queries;
+	Timer timer;
+	for (long i = 0; i < file.size(); ++i) {
+		SparseHistogram histogram(file[i]);
+		if (i % 10 == 9)
+			queries.push_back(histogram);
+		else
+			index.add(histogram);
+	}
+	printf("Indexed %i histograms in %li ms, %i queries, k=%i\n",
+			index.size(), timer.getTimeMilliseconds(), (int) queries.size(), k);
+	if (queries.empty())
+		return 0;
+
+	// Exact results of the linear scan
+	std::vector<std::vector<HistogramIndex::Match> > exact(queries.size());
+	timer.reset();
+	for (unsigned int q = 0; q < queries.size(); ++q)
+		index.queryLinear(queries[q], k, exact[q]);
+	printf("%-24s %10.3f ms/query\n", "linear scan",
+			(double) timer.getTimeMilliseconds() / queries.size());
+
+	// Inverted file, exact and approximated
+	const int maxQueryBins[] = { 0, 200, 100, 50, 20, 10 };
+	const int rerankSizes[] = { 4 * k, 10 * k };
+	for (unsigned int b = 0; b < sizeof(maxQueryBins) / sizeof(int); ++b)
+		for (unsigned int r = 0; r < sizeof(rerankSizes) / sizeof(int); ++r) {
+			if ((maxQueryBins[b] == 0) && (r > 0))
+				continue;
+			index.setMaxQueryBins(maxQueryBins[b]);
+			index.setRerankSize(rerankSizes[r]);
+			double time, recall;
+			runQueries(index, queries, k, exact, time, recall);
+			char name[64];
+			if (maxQueryBins[b] == 0)
+				sprintf(name, "inverted file");
+			else
+				sprintf(name, "bins=%i rerank=%i", maxQueryBins[b],
+						rerankSizes[r]);
+			printf("%-24s %10.3f ms/query  recall@%i %.4f\n", name, time, k,
+					recall);
+		}
+
+	return 0;
+}
@@ -0,0 +1,144 @@
+// ==================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (C) 2010  Arnaud Ramey, Andrzej Pronobis
+//
+// This file is part of ROCS.
+//
+// ROCS is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation, either version 3
+// of the License, or (at your option) any later version.
+//
+// ROCS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ROCS. If not, see <http://www.gnu.org/licenses/>.
+// ==================================================================
+
+
+/*!
+ * \file surfMatcherBenchmark.cc
+ *
+ * Compares the indexed matching of SURF descriptors (SurfMatcher) with
+ * the exhaustive scan of the same index on a pair of images: time per
+ * frame and precision/recall of the pairs. Both search the nearest
+ * object descriptor of each scene descriptor. The naive matcher of
+ * SurfExtractor searches in the other direction and is only timed.
+ *
+ * Usage: rocs_surfMatcherBenchmark <object image> <scene image> [repetitions]
+ *
+ * \author Andrzej Pronobis
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include "rocs/cv/Surf/SurfExtractor.h"
+#include "rocs/core/Timer.h"
+
+using namespace rocs::cv;
+
+/*! Returns the pairs (object, image) as a sorted list. */
+static std::vector<std::pair<int, int> > sortedPairs(
+		const std::vector<int> &ptpairs) {
+	std::vector<std::pair<int, int> > pairs;
+	for (unsigned int i = 0; i < ptpairs.size(); i += 2)
+		pairs.push_back(std::make_pair(ptpairs[i], ptpairs[i + 1]));
+	std::sort(pairs.begin(), pairs.end());
+	return pairs;
+}
+
+/*! Computes the precision and the recall of the pairs with respect to
+ the reference ones. */
+static void comparePairs(const std::vector<int> &ptpairs,
+		const std::vector<int> &reference, double &precision, double &recall) {
+	std::vector<std::pair<int, int> > pairs = sortedPairs(ptpairs);
+	std::vector<std::pair<int, int> > ref = sortedPairs(reference);
+	std::vector<std::pair<int, int> > common;
+	std::set_intersection(pairs.begin(), pairs.end(), ref.begin(), ref.end(),
+			std::back_inserter(common));
+	precision = (pairs.empty()) ? 1 : (double) common.size() / pairs.size();
+	recall = (ref.empty()) ? 1 : (double) common.size() / ref.size();
+}
+
+int main(int argc, char **argv) {
+	if (argc < 3) {
+		printf("Usage: %s <object image> <scene image> [repetitions]\n",
+				argv[0]);
+		return 1;
+	}
+	int repetitions = (argc > 3) ? atoi(argv[3]) : 10;
+
+	// Extract the descriptors of both images
+	IplImage *object = cvLoadImage(argv[1], CV_LOAD_IMAGE_GRAYSCALE);
+	IplImage *scene = cvLoadImage(argv[2], CV_LOAD_IMAGE_GRAYSCALE);
+	if (!object || !scene) {
+		printf("Cannot load the images.\n");
+		return 1;
+	}
+	CvMemStorage *storage = cvCreateMemStorage(0);
+	CvSURFParams params = cvSURFParams(300, 1);
+	CvSeq *objectKeypoints = 0, *objectDescriptors = 0;
+	CvSeq *sceneKeypoints = 0, *sceneDescriptors = 0;
+	cvExtractSURF(object, 0, &objectKeypoints, &objectDescriptors, storage,
+			params);
+	cvExtractSURF(scene, 0, &sceneKeypoints, &sceneDescriptors, storage,
+			params);
+	printf("Object descriptors: %i, scene descriptors: %i\n",
+			objectDescriptors->total, sceneDescriptors->total);
+
+	// Naive matcher, object to scene
+	std::vector<int> naive;
+	Timer timer;
+	for (int r = 0; r < repetitions; ++r)
+		SurfExtractor::surf_findPairs(objectKeypoints, objectDescriptors,
+				sceneKeypoints, sceneDescriptors, naive);
+	printf("%-20s %10.3f ms/frame  pairs %i\n", "naive",
+			(double) timer.getTimeMilliseconds() / repetitions,
+			(int) naive.size() / 2);
+
+	// Index built once, scene to object
+	SurfMatcher matcher;
+	timer.reset();
+	matcher.build(objectKeypoints, objectDescriptors);
+	printf("%-20s %10.3f ms\n", "index built in",
+			(double) timer.getTimeMilliseconds());
+	std::vector<int> exhaustive;
+	matcher.setMaxChecks(0);
+	timer.reset();
+	for (int r = 0; r < repetitions; ++r)
+		matcher.findPairs(sceneKeypoints, sceneDescriptors, exhaustive);
+	printf("%-20s %10.3f ms/frame  pairs %i\n", "exhaustive",
+			(double) timer.getTimeMilliseconds() / repetitions,
+			(int) exhaustive.size() / 2);
+
+	const int maxChecks[] = { 512, 256, 128, 64, 32 };
+	for (unsigned int c = 0; c < sizeof(maxChecks) / sizeof(int); ++c) {
+		matcher.setMaxChecks(maxChecks[c]);
+		std::vector<int> indexed;
+		timer.reset();
+		for (int r = 0; r < repetitions; ++r)
+			matcher.findPairs(sceneKeypoints, sceneDescriptors, indexed);
+		double time = (double) timer.getTimeMilliseconds() / repetitions;
+
+		double precision, recall;
+		comparePairs(indexed, exhaustive, precision, recall);
+		char name[64];
+		sprintf(name, "checks=%i", maxChecks[c]);
+		printf("%-20s %10.3f ms/frame  pairs %i  precision %.4f  recall %.4f\n",
+				name, time, (int) indexed.size() / 2, precision, recall);
+	}
+
+	cvReleaseMemStorage(&storage);
+	cvReleaseImage(&object);
+	cvReleaseImage(&scene);
+	return 0;
+}
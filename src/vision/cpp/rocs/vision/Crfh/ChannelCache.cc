@@ -26,6 +26,7 @@
  */
 
 #include "rocs/cv/Img.h"
+#include "rocs/cv/Crfh/CrfhWorkspace.h"
 
 #include "rocs/cv/Crfh/ChannelCache.h"
 
@@ -34,32 +35,53 @@ namespace cv {
 
 // -----------------------------------------
 ChannelCache::~ChannelCache() {
-	for (unsigned int i = 0; i < _channelList.size(); ++i)
-		delete _channelList[i];
+	if (_workspace)
+		return;
+	for (int i = 0; i < CHANNEL_TYPE_COUNT; ++i) {
+		delete _channels[i];
+		delete _floatChannels[i];
+	}
 }
 
 // -----------------------------------------
 void ChannelCache::createChannel(ChannelType channelType) {
 	// Check if we don't have the channel in the cache
-	for (unsigned int i = 0; i < _channelTypeList.size(); ++i)
-		if (_channelTypeList[i] == channelType)
-			return;
+	if ((_channels[channelType]) || (_floatChannels[channelType]))
+		return;
 
 	// Create a new channel
-	math::Matrix_<double> *channel = _image->getL();
+	if ((_workspace) && (_precision == PT_FLOAT))
+		_floatChannels[channelType] = _image->getL(_workspace->getMatrix<
+				float> (CrfhWorkspace::BT_CHANNEL, channelType,
+				_image->nbRows(), _image->nbCols()));
+	else if (_workspace)
+		_channels[channelType] = _image->getL(_workspace->getMatrix<double> (
+				CrfhWorkspace::BT_CHANNEL, channelType, _image->nbRows(),
+				_image->nbCols()));
+	else if (_precision == PT_FLOAT)
+		_floatChannels[channelType] = _image->getL(
+				static_cast<math::Matrix_<float> *> (0));
+	else
+		_channels[channelType] = _image->getL();
+}
 
-	if (channel) {
-		_channelList.push_back(channel);
-		_channelTypeList.push_back(channelType);
-	}
+// -----------------------------------------
+template<>
+const math::Matrix_<double> *ChannelCache::getChannel<double>(
+		ChannelType channelType) const {
+	if (_channels[channelType])
+		return _channels[channelType];
+
+	rocsDebug1("ERROR: No such channel!");
+	return 0;
 }
 
 // -----------------------------------------
-const math::Matrix_<double> *ChannelCache::getChannel(ChannelType channelType) const {
-	// Find the channel
-	for (unsigned int i = 0; i < _channelTypeList.size(); ++i)
-		if (_channelTypeList[i] == channelType)
-			return _channelList[i];
+template<>
+const math::Matrix_<float> *ChannelCache::getChannel<float>(
+		ChannelType channelType) const {
+	if (_floatChannels[channelType])
+		return _floatChannels[channelType];
 
 	rocsDebug1("ERROR: No such channel!");
 	return 0;
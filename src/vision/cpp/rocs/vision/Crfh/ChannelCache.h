@@ -42,25 +42,43 @@ namespace cv {
 //using rocs::math::Matrix_;
 //template<class _T> class Matrix_;
 class Img;
+class CrfhWorkspace;
 
 enum ChannelType {
 	CT_UNKNOWN = 0, CT_L, CT_C1, CT_C2
 };
 
+/*! Number of channel types. */
+#define CHANNEL_TYPE_COUNT (CT_C2 + 1)
+
+/*! Precision of the matrices used in the pipeline. */
+enum PrecisionType {
+	PT_DOUBLE = 0, PT_FLOAT
+};
+
 /*!
  * Class storing a cache of channels.
+ * Channels are stored in arrays indexed by the channel type. Once all
+ * the channels are created, the const methods only read the arrays
+ * and can be called concurrently.
  */
 class ChannelCache {
 
 public:
 
-	/*! Default constructor. */
-	inline ChannelCache(const Img &image) :
-		_image(&image) {
+	/*! Default constructor. If a workspace is given, the channels
+	 are stored in its buffers instead of being allocated. */
+	inline ChannelCache(const Img &image, PrecisionType precision = PT_DOUBLE,
+			CrfhWorkspace *workspace = 0) :
+		_image(&image), _precision(precision), _workspace(workspace) {
+		for (int i = 0; i < CHANNEL_TYPE_COUNT; ++i) {
+			_channels[i] = 0;
+			_floatChannels[i] = 0;
+		}
 	}
 	;
 
-	/*! Destructor. Deletes all the channels. */
+	/*! Destructor. Deletes all the channels not owned by the workspace. */
 	~ChannelCache();
 
 public:
@@ -70,21 +88,42 @@ public:
 	 not be created. */
 	void createChannel(ChannelType channelType);
 
-	/*! Returns a pointer to a matrix containing pixels of the channel. */
-	const math::Matrix_<double> *getChannel(ChannelType channelType) const;
+	/*! Returns a pointer to a matrix containing pixels of the channel.
+	 _T must match the precision of the cache. */
+	template<typename _T>
+	const math::Matrix_<_T> *getChannel(ChannelType channelType) const;
+
+	/*! Returns the precision of the channels. */
+	inline PrecisionType getPrecision() const {
+		return _precision;
+	}
 
 private:
 
 	/*! Pointer to the input image. */
 	const Img* _image;
 
-	/*! List storing pointers to channels. */
-	std::vector<math::Matrix_<double> *> _channelList;
+	/*! Precision of the channels. */
+	PrecisionType _precision;
 
-	/*! List of types of channels in the _channelList. */
-	std::vector<ChannelType> _channelTypeList;
+	/*! Workspace owning the channels or null. */
+	CrfhWorkspace *_workspace;
+
+	/*! Channels indexed by the type (PT_DOUBLE), null if not created. */
+	math::Matrix_<double> *_channels[CHANNEL_TYPE_COUNT];
+
+	/*! Channels indexed by the type (PT_FLOAT), null if not created. */
+	math::Matrix_<float> *_floatChannels[CHANNEL_TYPE_COUNT];
 };
 
+template<>
+const math::Matrix_<double> *ChannelCache::getChannel<double>(
+		ChannelType channelType) const;
+
+template<>
+const math::Matrix_<float> *ChannelCache::getChannel<float>(
+		ChannelType channelType) const;
+
 } // end namespace cv
 } // end namespace rocs
 
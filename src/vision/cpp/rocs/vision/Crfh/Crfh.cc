@@ -27,9 +27,9 @@
  * \author Arnaud Ramey, Andrzej Pronobis
  */
 
-#include <limits>
-
 #include "rocs/cv/Crfh/DescriptorList.h"
+#include "rocs/cv/Crfh/Quantizer.h"
+#include "rocs/cv/Crfh/CrfhWorkspace.h"
 #include "rocs/math/Matrix_.h"
 
 #include "rocs/cv/Crfh/Crfh.h"
@@ -39,71 +39,265 @@ namespace cv {
 
 using rocs::math::Matrix_;
 
-Crfh::Crfh(vector<Matrix_<double> *> outputs,
-		const DescriptorList &descrList, int skipBorderPixels) {
+// -----------------------------------------
+template<typename _T>
+Crfh::Crfh(const vector<Matrix_<_T> *> &outputs,
+		const DescriptorList &descrList, int skipBorderPixels,
+		AccumulatorType accumulatorType, CrfhWorkspace *workspace) {
+	assign(outputs, descrList, skipBorderPixels, accumulatorType, workspace);
+}
+
+// -----------------------------------------
+template<typename _T>
+Crfh::Crfh(const vector<Matrix_<_T> *> &outputs,
+		const DescriptorList &descrList, const opencv::Rect &region,
+		AccumulatorType accumulatorType, CrfhWorkspace *workspace) {
+	countRegion(outputs, descrList, region, accumulatorType, workspace);
+}
+
+// -----------------------------------------
+template<typename _T>
+void Crfh::assign(const vector<Matrix_<_T> *> &outputs,
+		const DescriptorList &descrList, int skipBorderPixels,
+		AccumulatorType accumulatorType, CrfhWorkspace *workspace) {
+	clear();
+	_sum = 0;
+	_max = -1;
+	if (outputs.empty())
+		return;
+	opencv::Rect region(skipBorderPixels, skipBorderPixels,
+			outputs[0]->nbCols() - 2 * skipBorderPixels,
+			outputs[0]->nbRows() - 2 * skipBorderPixels);
+	countRegion(outputs, descrList, region, accumulatorType, workspace);
+}
+
+// -----------------------------------------
+template<typename _T>
+void Crfh::countRegion(const vector<Matrix_<_T> *> &outputs,
+		const DescriptorList &descrList, const opencv::Rect &requestedRegion,
+		AccumulatorType accumulatorType, CrfhWorkspace *workspace) {
 	// Check whether the descriptor list matches the output list
-	if (outputs.size() != descrList.size()) {
+	if ((outputs.size() != descrList.size()) || (outputs.empty())) {
 		rocsError("The size of the descriptor list does not match the size of the outputs list. ");
 		return;
 	}
 
-	// Read all the necessary information and store it in the vectors
-	vector<math::Matrix_<double> *> dataVect;
-	vector<double> minVect;
-	vector<double> maxVect;
-	vector<int> binsVect;
-
 	int rows = outputs[0]->nbRows();
 	int cols = outputs[0]->nbCols();
 	int ndims = outputs.size();
 
 	for (int i = 0; i < ndims; ++i) {
-		dataVect.push_back(outputs[i]);
-		binsVect.push_back(descrList[i]->getBins());
-		minVect.push_back(descrList[i]->getMin());
-		maxVect.push_back(descrList[i]->getMax());
 		if ((rows != outputs[i]->nbRows()) || (cols != outputs[i]->nbCols())) {
 			rocsError("The filter outputs have different dimensions. ");
 			return;
 		}
 	}
 
-	// Direct access to vectors' arrays
-	Matrix_<double> **data = dataVect.data();
-	double *min = minVect.data();
-	double *max = maxVect.data();
-	int *bins = binsVect.data();
+	// Count only the pixels inside the outputs
+	opencv::Rect region = requestedRegion & opencv::Rect(0, 0, cols, rows);
 
-	// Calculate scaling factors
-	vector<double> factorsVect;
-	for (int i = 0; i < ndims; ++i) {
-		factorsVect.push_back(((double) bins[i]
-				- std::numeric_limits<double>::epsilon()) / (max[i] - min[i]));
+	// Quantization factors
+	Quantizer ownQuantizer;
+	if (!workspace)
+		ownQuantizer.assign(descrList);
+	const Quantizer &quantizer = (workspace) ? workspace->getQuantizer(
+			descrList) : ownQuantizer;
+
+	// Create the accumulator
+	double binSpace = quantizer.getBinSpace();
+	long samples = (long) region.width * region.height;
+	HistogramAccumulator *ownAccumulator = 0;
+	HistogramAccumulator *accumulator;
+	if (workspace)
+		accumulator = &workspace->getAccumulator(accumulatorType, binSpace,
+				samples);
+	else
+		accumulator = ownAccumulator = new HistogramAccumulator(
+				accumulatorType, binSpace, samples);
+
+	// Buffers reused for every row
+	vector<const _T *> ownRowPtrs;
+	vector<int> ownBinRow;
+	vector<long> ownIndexRow;
+	vector<const _T *> &rowPtrs = (workspace) ? workspace->getRowPointers<
+			_T> (ndims) : ownRowPtrs;
+	vector<int> &binRow = (workspace) ? workspace->getBinRow(cols)
+			: ownBinRow;
+	vector<long> &indexRow = (workspace) ? workspace->getIndexRow(cols)
+			: ownIndexRow;
+	if (!workspace) {
+		rowPtrs.resize(ndims);
+		binRow.resize(cols);
+		indexRow.resize(cols);
 	}
-	double *factors = factorsVect.data();
+	int colBegin = region.x;
+	int colEnd = region.x + region.width;
 
 	// Create the histogram
-	//_max = -1;
-	for (int i = rows - 1 - skipBorderPixels; i >= skipBorderPixels; --i) // Iterate through all pixels
-		for (int j = cols - 1 - skipBorderPixels; j >= skipBorderPixels; --j) // without borders
-		{
-			// Number of bin for dimension k:
-			// (int)((data[k][i]-min[k])*factors[k])
-
-			int k = ndims - 1;
-			long index = (int) ((data[k]->get(i, j) - min[k]) * factors[k]);
-			for (k = ndims - 2; k >= 0; --k)
-				index = index * bins[k] + (int) ((data[k]->get(i, j) - min[k])
-						* factors[k]);
-
-			increase_if_found(index);
-		}
+	for (int i = region.y; i < region.y + region.height; ++i) // Iterate through all rows
+	{
+		for (int k = 0; k < ndims; ++k)
+			rowPtrs[k] = outputs[k]->asConstOpenCvMat().template ptr<_T> (i);
+
+		// Bin indices of all the pixels of the region
+		quantizer.quantizeRow(&rowPtrs[0], colBegin, colEnd, &binRow[0],
+				&indexRow[0]);
+
+		for (int j = colBegin; j < colEnd; ++j)
+			accumulator->increase(indexRow[j]);
+	}
+	accumulator->flushTo(*this);
+	delete ownAccumulator;
 
 	// Store sum of all bins
 	rocsDebug3("max:%f", _max);
 	//serialize(std::cout, true);
-	_sum = (rows - 2 * skipBorderPixels) * (cols - 2 * skipBorderPixels);
+	_sum = samples;
+}
+
+// -----------------------------------------
+template<typename _T>
+void Crfh::createGrid(const vector<Matrix_<_T> *> &outputs,
+		const DescriptorList &descrList, const opencv::Rect &requestedRegion,
+		int gridRows, int gridCols, vector<Crfh *> &histograms,
+		AccumulatorType accumulatorType, CrfhWorkspace *workspace) {
+	if ((outputs.size() != descrList.size()) || (outputs.empty())) {
+		rocsError("The size of the descriptor list does not match the size of the outputs list. ");
+		return;
+	}
+	if ((gridRows < 1) || (gridCols < 1))
+		return;
+	int cols = outputs[0]->nbCols();
+	int ndims = outputs.size();
+
+	// Divide only the part of the region inside the outputs
+	opencv::Rect region = requestedRegion & opencv::Rect(0, 0, cols,
+			outputs[0]->nbRows());
+
+	// Boundaries of the cells
+	vector<int> rowBounds(gridRows + 1);
+	vector<int> colBounds(gridCols + 1);
+	for (int r = 0; r <= gridRows; ++r)
+		rowBounds[r] = region.y + (int) ((long) r * region.height / gridRows);
+	for (int c = 0; c <= gridCols; ++c)
+		colBounds[c] = region.x + (int) ((long) c * region.width / gridCols);
+
+	// Quantization factors
+	Quantizer ownQuantizer;
+	if (!workspace)
+		ownQuantizer.assign(descrList);
+	const Quantizer &quantizer = (workspace) ? workspace->getQuantizer(
+			descrList) : ownQuantizer;
+
+	// One accumulator per cell, sized for the samples of the cell
+	double binSpace = quantizer.getBinSpace();
+	vector<long> samples(gridRows * gridCols);
+	for (int r = 0; r < gridRows; ++r)
+		for (int c = 0; c < gridCols; ++c)
+			samples[r * gridCols + c] = (long) (rowBounds[r + 1]
+					- rowBounds[r]) * (colBounds[c + 1] - colBounds[c]);
+	vector<HistogramAccumulator *> ownAccumulators;
+	if (!workspace)
+		for (unsigned int k = 0; k < samples.size(); ++k)
+			ownAccumulators.push_back(new HistogramAccumulator(
+					accumulatorType, binSpace, samples[k]));
+	vector<HistogramAccumulator *> &accumulators = (workspace)
+			? workspace->getGridAccumulators(accumulatorType, binSpace,
+					samples) : ownAccumulators;
+
+	// Buffers reused for every row
+	vector<const _T *> ownRowPtrs;
+	vector<int> ownBinRow;
+	vector<long> ownIndexRow;
+	vector<const _T *> &rowPtrs = (workspace) ? workspace->getRowPointers<
+			_T> (ndims) : ownRowPtrs;
+	vector<int> &binRow = (workspace) ? workspace->getBinRow(cols)
+			: ownBinRow;
+	vector<long> &indexRow = (workspace) ? workspace->getIndexRow(cols)
+			: ownIndexRow;
+	if (!workspace) {
+		rowPtrs.resize(ndims);
+		binRow.resize(cols);
+		indexRow.resize(cols);
+	}
+
+	// Quantize each row once and distribute the bin indices to the cells
+	for (int r = 0; r < gridRows; ++r)
+		for (int i = rowBounds[r]; i < rowBounds[r + 1]; ++i) {
+			for (int k = 0; k < ndims; ++k)
+				rowPtrs[k] = outputs[k]->asConstOpenCvMat().template ptr<_T> (
+						i);
+			quantizer.quantizeRow(&rowPtrs[0], region.x, region.x
+					+ region.width, &binRow[0], &indexRow[0]);
+
+			for (int c = 0; c < gridCols; ++c) {
+				HistogramAccumulator *accumulator = accumulators[r * gridCols
+						+ c];
+				for (int j = colBounds[c]; j < colBounds[c + 1]; ++j)
+					accumulator->increase(indexRow[j]);
+			}
+		}
+
+	for (unsigned int k = 0; k < accumulators.size(); ++k) {
+		Crfh *crfh = new Crfh();
+		accumulators[k]->flushTo(*crfh);
+		histograms.push_back(crfh);
+	}
+	for (unsigned int k = 0; k < ownAccumulators.size(); ++k)
+		delete ownAccumulators[k];
 }
 
+// -----------------------------------------
+void Crfh::add(const Crfh &other) {
+	Crfh sum;
+	sum.reserve(size() + other.size());
+	const_iterator a = begin();
+	const_iterator b = other.begin();
+	while ((a != end()) || (b != other.end())) {
+		int key;
+		double value;
+		if ((b == other.end()) || ((a != end()) && (a->first < b->first))) {
+			key = a->first;
+			value = (a++)->second;
+		} else if ((a == end()) || (b->first < a->first)) {
+			key = b->first;
+			value = (b++)->second;
+		} else {
+			key = a->first;
+			value = (a++)->second + (b++)->second;
+		}
+		sum.append(key, value);
+	}
+	sum._sum = _sum + other._sum;
+	swap(sum);
+}
+
+template Crfh::Crfh(const vector<Matrix_<double> *> &outputs,
+		const DescriptorList &descrList, int skipBorderPixels,
+		AccumulatorType accumulatorType, CrfhWorkspace *workspace);
+template Crfh::Crfh(const vector<Matrix_<float> *> &outputs,
+		const DescriptorList &descrList, int skipBorderPixels,
+		AccumulatorType accumulatorType, CrfhWorkspace *workspace);
+template void Crfh::assign(const vector<Matrix_<double> *> &outputs,
+		const DescriptorList &descrList, int skipBorderPixels,
+		AccumulatorType accumulatorType, CrfhWorkspace *workspace);
+template void Crfh::assign(const vector<Matrix_<float> *> &outputs,
+		const DescriptorList &descrList, int skipBorderPixels,
+		AccumulatorType accumulatorType, CrfhWorkspace *workspace);
+template Crfh::Crfh(const vector<Matrix_<double> *> &outputs,
+		const DescriptorList &descrList, const opencv::Rect &region,
+		AccumulatorType accumulatorType, CrfhWorkspace *workspace);
+template Crfh::Crfh(const vector<Matrix_<float> *> &outputs,
+		const DescriptorList &descrList, const opencv::Rect &region,
+		AccumulatorType accumulatorType, CrfhWorkspace *workspace);
+template void Crfh::createGrid(const vector<Matrix_<double> *> &outputs,
+		const DescriptorList &descrList, const opencv::Rect &region,
+		int gridRows, int gridCols, vector<Crfh *> &histograms,
+		AccumulatorType accumulatorType, CrfhWorkspace *workspace);
+template void Crfh::createGrid(const vector<Matrix_<float> *> &outputs,
+		const DescriptorList &descrList, const opencv::Rect &region,
+		int gridRows, int gridCols, vector<Crfh *> &histograms,
+		AccumulatorType accumulatorType, CrfhWorkspace *workspace);
+
 } // end namespace cv
 } // end namespace rocs
@@ -30,6 +30,8 @@
 
 // rocs includes
 #include "rocs/cv/FeatureList.h"
+#include "rocs/cv/Crfh/HistogramAccumulator.h"
+#include "rocs/math/Matrix_.h"
 
 // STD includes
 #include <vector>
@@ -51,6 +53,7 @@ template<typename _T> class Matrix_;
 namespace cv {
 
 class DescriptorList;
+class CrfhWorkspace;
 
 /*!
  * Node of a libsvm sparse vector.
@@ -68,10 +71,54 @@ class Crfh: public FeatureList<int, double> {
 
 public:
 
+	/*! Constructor. Creates an empty histogram. */
+	Crfh() {
+	}
+
 	/*! Constructor. Creates a histogram from a set of
-	 outputs of descriptors. */
-	Crfh(vector<math::Matrix_<double> *> outputs, const DescriptorList &descrList,
-			int skipBorderPixels);
+	 outputs of descriptors. The bins are counted using
+	 an accumulator of a given type. If a workspace is given,
+	 the accumulator and the row buffers are taken from it.
+	 Instantiated for double and float outputs. */
+	template<typename _T>
+	Crfh(const vector<math::Matrix_<_T> *> &outputs,
+			const DescriptorList &descrList, int skipBorderPixels,
+			AccumulatorType accumulatorType = AT_AUTO,
+			CrfhWorkspace *workspace = 0);
+
+	/*! Constructor. Creates a histogram of the pixels inside a region
+	 of the outputs, which must be valid there. The region is clipped
+	 to the outputs. Instantiated for double and float outputs. */
+	template<typename _T>
+	Crfh(const vector<math::Matrix_<_T> *> &outputs,
+			const DescriptorList &descrList, const opencv::Rect &region,
+			AccumulatorType accumulatorType = AT_AUTO,
+			CrfhWorkspace *workspace = 0);
+
+	/*! Replaces the bins by the histogram of a set of outputs of
+	 descriptors, as the constructor does. The memory of the bins is
+	 reused, so that with a workspace recounting outputs of the same
+	 size does not allocate memory. */
+	template<typename _T>
+	void assign(const vector<math::Matrix_<_T> *> &outputs,
+			const DescriptorList &descrList, int skipBorderPixels,
+			AccumulatorType accumulatorType = AT_AUTO,
+			CrfhWorkspace *workspace = 0);
+
+	/*! Creates the histograms of the cells of a grid dividing a region
+	 of the outputs in one pass over the pixels and appends them to the
+	 list, row after row. The region is first clipped to the outputs,
+	 then the cell (r, c) spans the rows from
+	 region.y + r * region.height / gridRows to the next cell. */
+	template<typename _T>
+	static void createGrid(const vector<math::Matrix_<_T> *> &outputs,
+			const DescriptorList &descrList, const opencv::Rect &region,
+			int gridRows, int gridCols, vector<Crfh *> &histograms,
+			AccumulatorType accumulatorType = AT_AUTO,
+			CrfhWorkspace *workspace = 0);
+
+	/*! Adds the counts of another (not normalized) histogram. */
+	void add(const Crfh &other);
 
 //	/*! Zeroes small values in the histogram. The function removes those
 //	 values that divided by maximum value are smaller than min_val. */
@@ -88,6 +135,13 @@ public:
 
 private:
 
+	/*! Counts the pixels inside a region of the outputs, clipped
+	 to the outputs. */
+	template<typename _T>
+	void countRegion(const vector<math::Matrix_<_T> *> &outputs,
+			const DescriptorList &descrList, const opencv::Rect &requestedRegion,
+			AccumulatorType accumulatorType, CrfhWorkspace *workspace);
+
 //	/*! Sum of all values before normalization. */
 //	double _sum;
 //
@@ -32,6 +32,7 @@
 #include "rocs/cv/FeatureExtractor.h"
 #include "rocs/cv/Crfh/System.h"
 #include "rocs/cv/Crfh/Crfh.h"
+#include "rocs/cv/Crfh/TemporalCrfh.h"
 
 // STD includes
 #include <iostream>
@@ -94,12 +95,136 @@ public:
 		_skipBorderPixels = skipBorderPixels;
 	}
 
+	/*!
+	 * set the type of the accumulator used to count the histogram bins
+	 * \param accumulatorType
+	 */
+	void setAccumulatorType(AccumulatorType accumulatorType)
+	{
+		rocsDebug3("setAccumulatorType(%i)", accumulatorType);
+		_syst.setAccumulatorType(accumulatorType);
+	}
+
+	/*!
+	 * set the precision of the filtering pipeline
+	 * \param precision
+	 */
+	void setPrecision(PrecisionType precision)
+	{
+		rocsDebug3("setPrecision(%i)", precision);
+		_syst.setPrecision(precision);
+	}
+
+	/*!
+	 * set the sigma from which the Gaussian filters are recursive,
+	 * must be called before defineSystem(), see
+	 * System::setRecursiveGaussianSigma() for the accuracy cost
+	 * \param sigma 0 (default) disables the recursive filters
+	 */
+	void setRecursiveGaussianSigma(double sigma)
+	{
+		rocsDebug3("setRecursiveGaussianSigma(%f)", sigma);
+		_syst.setRecursiveGaussianSigma(sigma);
+	}
+
+	/*!
+	 * set whether the scale-space is computed incrementally, see
+	 * System::setIncrementalScaleSpace() for the accuracy cost
+	 * \param incremental
+	 */
+	void setIncrementalScaleSpace(bool incremental)
+	{
+		rocsDebug3("setIncrementalScaleSpace(%i)", incremental);
+		_syst.setIncrementalScaleSpace(incremental);
+	}
+
+	/*!
+	 * set the number of threads used to process a single image
+	 * \param numThreads
+	 */
+	void setNumThreads(int numThreads)
+	{
+		rocsDebug3("setNumThreads(%i)", numThreads);
+		_syst.setNumThreads(numThreads);
+	}
+
+	/*!
+	 * set whether consecutive images are frames of a video stream whose
+	 * histograms are computed incrementally, see TemporalCrfh
+	 * \param temporal
+	 */
+	void setTemporalMode(bool temporal)
+	{
+		rocsDebug3("setTemporalMode(%i)", temporal);
+		_temporalMode = temporal;
+		_temporal.reset();
+	}
+
+	/*!
+	 * set the size of the tiles recomputed in the temporal mode
+	 * \param tileSize
+	 */
+	void setTemporalTileSize(int tileSize)
+	{
+		rocsDebug3("setTemporalTileSize(%i)", tileSize);
+		_temporal.setTileSize(tileSize);
+	}
+
+	/*!
+	 * set the mean pixel difference above which a tile is recomputed
+	 * in the temporal mode, 0 gives the same histograms as without it
+	 * \param changeThreshold
+	 */
+	void setTemporalChangeThreshold(double changeThreshold)
+	{
+		rocsDebug3("setTemporalChangeThreshold(%f)", changeThreshold);
+		_temporal.setChangeThreshold(changeThreshold);
+	}
+
+	/*!
+	 * set the step of the grid of pixels compared in the temporal mode
+	 * \param changeStep 1 compares all the pixels
+	 */
+	void setTemporalChangeStep(int changeStep)
+	{
+		rocsDebug3("setTemporalChangeStep(%i)", changeStep);
+		_temporal.setChangeStep(changeStep);
+	}
+
+	/*!
+	 * the state of the temporal mode (tiles recomputed per frame...)
+	 */
+	const TemporalCrfh &getTemporalState() const
+	{
+		return _temporal;
+	}
+
+	/*!
+	 * create an independent extractor with the same system and parameters,
+	 * the frames seen in the temporal mode are not shared
+	 */
+	virtual FeatureExtractor<Crfh>* createWorker() const
+	{
+		CrfhInterface *worker = new CrfhInterface(*this);
+		worker->_temporal.reset();
+		return worker;
+	}
+
+	/*!
+	 * the images are loaded as lightness if the system uses only L
+	 */
+	virtual ImageLoadMode getImageLoadMode() const
+	{
+		return _syst.getImageLoadMode();
+	}
+
 	void setDefaultParams()
 	{
 		rocsDebug3("setDefaultParams()");
 		/* default params */
 		_minHistValue = 0;
 		_skipBorderPixels = 15;
+		_temporalMode = false;
 	}
 
 	void start()
@@ -108,6 +233,7 @@ public:
 		/* reset timer */
 		_totalTime = 0;
 		_nbImagesTreated = 0;
+		_temporal.reset();
 	}
 
 	void end()
@@ -122,7 +248,9 @@ public:
 		_t.reset();
 
 		// make the actual computation
-		Crfh *crfh = _syst.computeHistogram(*image, _skipBorderPixels);
+		Crfh *crfh = (_temporalMode) ? _temporal.computeHistogram(_syst,
+				*image, _skipBorderPixels) : _syst.computeHistogram(*image,
+				_skipBorderPixels);
 		if (_minHistValue > 0)
 			crfh->filter(_minHistValue);
 		crfh->normalize();
@@ -132,10 +260,38 @@ public:
 		return crfh;
 	}
 
+	/*!
+	 * computes the spatial pyramid of histograms of an image in one
+	 * pass, see System::computeSpatialPyramid()
+	 * \param image
+	 * \param levels the number of levels, the finest one has
+	 * 2^(levels-1) x 2^(levels-1) cells
+	 * \param pyramid the normalized histograms, ordered by level
+	 */
+	void processImagePyramid(const Img* image, int levels,
+			vector<Crfh*> &pyramid)
+	{
+		rocsDebug1("processImagePyramid(%s, %i)", image->infoString().c_str(), levels);
+		_t.reset();
+
+		_syst.computeSpatialPyramid(*image, _skipBorderPixels, levels, pyramid);
+		for (unsigned int i = 0; i < pyramid.size(); ++i)
+		{
+			if (_minHistValue > 0)
+				pyramid[i]->filter(_minHistValue);
+			pyramid[i]->normalize();
+		}
+		// update timer
+		_totalTime += _t.getTimeMilliseconds();
+		_nbImagesTreated++;
+	}
+
 private:
 	System _syst;
 	double _minHistValue;
 	int _skipBorderPixels;
+	bool _temporalMode;
+	TemporalCrfh _temporal;
 };
 
 } // end namespace cv
@@ -0,0 +1,193 @@
+// ==================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (C) 2010  Arnaud Ramey, Andrzej Pronobis
+//
+// This file is part of ROCS.
+//
+// ROCS is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation, either version 3
+// of the License, or (at your option) any later version.
+//
+// ROCS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ROCS. If not, see <http://www.gnu.org/licenses/>.
+// ==================================================================
+
+
+/*!
+ * \file CrfhWorkspace.cc
+ *
+ * Contains implementation of the CrfhWorkspace class.
+ *
+ * \author Andrzej Pronobis
+ */
+
+#include "rocs/cv/Crfh/ScaleSpaceCache.h"
+#include "rocs/cv/Crfh/CrfhWorkspace.h"
+
+namespace rocs {
+namespace cv {
+
+// -----------------------------------------
+CrfhWorkspace::CrfhWorkspace() :
+	_scaleSpaceSamples(0), _nbAllocations(0) {
+}
+
+// -----------------------------------------
+CrfhWorkspace::~CrfhWorkspace() {
+	for (std::map<MatrixKey, math::Matrix_<double> *>::iterator it =
+			_matrices.begin(); it != _matrices.end(); ++it)
+		delete it->second;
+	for (std::map<MatrixKey, math::Matrix_<float> *>::iterator it =
+			_floatMatrices.begin(); it != _floatMatrices.end(); ++it)
+		delete it->second;
+	for (unsigned int i = 0; i < _accumulators.size(); ++i)
+		delete _accumulators[i].accumulator;
+	delete _scaleSpaceSamples;
+}
+
+// -----------------------------------------
+template<>
+std::map<CrfhWorkspace::MatrixKey, math::Matrix_<double> *> &CrfhWorkspace::matrices<
+		double>() {
+	return _matrices;
+}
+
+// -----------------------------------------
+template<>
+std::map<CrfhWorkspace::MatrixKey, math::Matrix_<float> *> &CrfhWorkspace::matrices<
+		float>() {
+	return _floatMatrices;
+}
+
+// -----------------------------------------
+template<typename _T>
+math::Matrix_<_T> *CrfhWorkspace::getMatrix(BufferType type, int index,
+		int rows, int cols) {
+	math::Matrix_<_T> *&matrix = matrices<_T> ()[MatrixKey(type, index)];
+	if (!matrix) {
+		rocsDebug3("CrfhWorkspace::getMatrix(%i, %i): allocating %ix%i", type, index, rows, cols);
+		matrix = new math::Matrix_<_T>(rows, cols);
+		++_nbAllocations;
+	} else if ((matrix->nbRows() != rows) || (matrix->nbCols() != cols)) {
+		rocsDebug3("CrfhWorkspace::getMatrix(%i, %i): resizing to %ix%i", type, index, rows, cols);
+		matrix->resize(rows, cols);
+		++_nbAllocations;
+	}
+	return matrix;
+}
+
+template math::Matrix_<double> *CrfhWorkspace::getMatrix<double>(
+		BufferType type, int index, int rows, int cols);
+template math::Matrix_<float> *CrfhWorkspace::getMatrix<float>(
+		BufferType type, int index, int rows, int cols);
+
+// -----------------------------------------
+HistogramAccumulator &CrfhWorkspace::getAccumulator(AccumulatorType type,
+		double binSpace, long samples, int index) {
+	if (static_cast<unsigned int> (index) >= _accumulators.size()) {
+		AccumulatorSlot empty = { 0, AT_AUTO, 0, 0 };
+		resizeBuffer(_accumulators, index + 1);
+		for (unsigned int i = 0; i < _accumulators.size(); ++i)
+			if (!_accumulators[i].accumulator)
+				_accumulators[i] = empty;
+	}
+	AccumulatorSlot &slot = _accumulators[index];
+	if ((!slot.accumulator) || (type != slot.type) || (binSpace
+			!= slot.binSpace) || (samples != slot.samples)) {
+		delete slot.accumulator;
+		slot.accumulator = new HistogramAccumulator(type, binSpace, samples);
+		slot.type = type;
+		slot.binSpace = binSpace;
+		slot.samples = samples;
+		++_nbAllocations;
+	}
+	return *slot.accumulator;
+}
+
+// -----------------------------------------
+std::vector<HistogramAccumulator *> &CrfhWorkspace::getGridAccumulators(
+		AccumulatorType type, double binSpace,
+		const std::vector<long> &samples) {
+	resizeBuffer(_gridAccumulators, samples.size());
+	for (unsigned int k = 0; k < samples.size(); ++k)
+		_gridAccumulators[k] = &getAccumulator(type, binSpace, samples[k], k
+				+ 1);
+	return _gridAccumulators;
+}
+
+// -----------------------------------------
+const Quantizer &CrfhWorkspace::getQuantizer(const DescriptorList &descrList) {
+	if (!_quantizer.matches(descrList)) {
+		_quantizer.assign(descrList);
+		++_nbAllocations;
+	}
+	return _quantizer;
+}
+
+// -----------------------------------------
+void CrfhWorkspace::swapScaleSpaceLists(
+		std::vector<ScaleSpaceSampleInfo> &samples, std::vector<int> &order) {
+	if (!_scaleSpaceSamples)
+		_scaleSpaceSamples = new std::vector<ScaleSpaceSampleInfo>();
+	_scaleSpaceSamples->swap(samples);
+	_scaleSpaceOrder.swap(order);
+}
+
+// -----------------------------------------
+template<typename _V>
+void CrfhWorkspace::resizeBuffer(_V &buffer, int size) {
+	if (static_cast<unsigned int> (size) > buffer.capacity())
+		++_nbAllocations;
+	buffer.resize(size);
+}
+
+// -----------------------------------------
+template<>
+std::vector<math::Matrix_<double> *> &CrfhWorkspace::getOutputList<double>(
+		int size) {
+	resizeBuffer(_outputList, size);
+	return _outputList;
+}
+
+// -----------------------------------------
+template<>
+std::vector<math::Matrix_<float> *> &CrfhWorkspace::getOutputList<float>(
+		int size) {
+	resizeBuffer(_floatOutputList, size);
+	return _floatOutputList;
+}
+
+// -----------------------------------------
+template<>
+std::vector<const double *> &CrfhWorkspace::getRowPointers<double>(int size) {
+	resizeBuffer(_rowPointers, size);
+	return _rowPointers;
+}
+
+// -----------------------------------------
+template<>
+std::vector<const float *> &CrfhWorkspace::getRowPointers<float>(int size) {
+	resizeBuffer(_floatRowPointers, size);
+	return _floatRowPointers;
+}
+
+// -----------------------------------------
+std::vector<int> &CrfhWorkspace::getBinRow(int size) {
+	resizeBuffer(_binRow, size);
+	return _binRow;
+}
+
+// -----------------------------------------
+std::vector<long> &CrfhWorkspace::getIndexRow(int size) {
+	resizeBuffer(_indexRow, size);
+	return _indexRow;
+}
+
+} // end namespace cv
+} // end namespace rocs
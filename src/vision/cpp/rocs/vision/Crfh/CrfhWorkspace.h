@@ -0,0 +1,221 @@
+// ==================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (C) 2010  Arnaud Ramey, Andrzej Pronobis
+//
+// This file is part of ROCS.
+//
+// ROCS is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation, either version 3
+// of the License, or (at your option) any later version.
+//
+// ROCS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ROCS. If not, see <http://www.gnu.org/licenses/>.
+// ==================================================================
+
+
+/*!
+ * \file CrfhWorkspace.h
+ *
+ * \author Andrzej Pronobis
+ *
+ * Contains declaration of the CrfhWorkspace class.
+ */
+
+#ifndef CCRFHWORKSPACE_H_
+#define CCRFHWORKSPACE_H_
+
+#include "rocs/math/Matrix_.h"
+#include "rocs/cv/Crfh/HistogramAccumulator.h"
+#include "rocs/cv/Crfh/Quantizer.h"
+
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace rocs {
+namespace cv {
+
+struct ScaleSpaceSampleInfo;
+
+/*!
+ * Buffers reused by the CRFH pipeline across frames. All the
+ * channels, scale-space samples, descriptor outputs, the temporary
+ * matrices of the channel extraction, the histogram accumulator,
+ * the quantizer, the lists of samples of the scale-space cache
+ * and the row buffers are allocated on first use and reallocated
+ * only when the size of the image or the system changes. Processing
+ * further frames of the same resolution does not allocate any of them.
+ *
+ * The memory not owned by the workspace (a returned histogram and
+ * the temporaries of the convolutions and of the OpenCV functions)
+ * is still allocated for every frame.
+ *
+ * A workspace must not be used by two computations at the same time.
+ * Concurrent computations need one workspace each.
+ */
+class CrfhWorkspace {
+
+public:
+
+	/*! Types of the matrices stored in the workspace. */
+	enum BufferType {
+		/*! Channels, indexed by the channel type. */
+		BT_CHANNEL = 0,
+
+		/*! Scale-space samples, indexed by the position in the cache. */
+		BT_SCALE_SPACE,
+
+		/*! Descriptor outputs, indexed by the position in the list. */
+		BT_OUTPUT
+	};
+
+public:
+
+	/*! Constructor. Nothing is allocated until first use. */
+	CrfhWorkspace();
+
+	/*! Destructor. Deletes all the buffers. */
+	~CrfhWorkspace();
+
+public:
+
+	/*! Returns the matrix of a given type and index, allocating
+	 it or changing its size if necessary. The matrix remains
+	 owned by the workspace. Instantiated for double and float. */
+	template<typename _T>
+	math::Matrix_<_T> *getMatrix(BufferType type, int index, int rows,
+			int cols);
+
+	/*! Returns the accumulator with a given index for given parameters
+	 (see HistogramAccumulator), creating a new one only if the parameters
+	 differ from the previous call with the same index. A histogram of
+	 a whole region uses the index 0, the cells of a grid the following
+	 ones. */
+	HistogramAccumulator &getAccumulator(AccumulatorType type,
+			double binSpace, long samples, int index = 0);
+
+	/*! Returns the accumulators of the cells of a grid, one for each
+	 given number of samples, reused as by getAccumulator(). */
+	std::vector<HistogramAccumulator *> &getGridAccumulators(
+			AccumulatorType type, double binSpace,
+			const std::vector<long> &samples);
+
+	/*! Returns the quantizer of a descriptor list, precomputing
+	 the factors only if the list differs from the previous call. */
+	const Quantizer &getQuantizer(const DescriptorList &descrList);
+
+	/*! Exchanges the list of samples and their order with those kept
+	 by the workspace. A scale-space cache takes them when it is
+	 created and gives them back when it is destroyed, so that their
+	 memory is kept between frames. */
+	void swapScaleSpaceLists(std::vector<ScaleSpaceSampleInfo> &samples,
+			std::vector<int> &order);
+
+	/*! Returns the list of pointers to the descriptor outputs
+	 resized to a given size. */
+	template<typename _T>
+	std::vector<math::Matrix_<_T> *> &getOutputList(int size);
+
+	/*! Returns the buffer of row pointers resized to a given size. */
+	template<typename _T>
+	std::vector<const _T *> &getRowPointers(int size);
+
+	/*! Returns the buffer of bins of a row resized to a given size. */
+	std::vector<int> &getBinRow(int size);
+
+	/*! Returns the buffer of indices of a row resized to a given size. */
+	std::vector<long> &getIndexRow(int size);
+
+	/*! Returns the number of times a buffer of the workspace has been
+	 allocated or reallocated since the creation of the workspace. The
+	 memory not owned by the workspace is not counted. */
+	inline long getNbAllocations() const {
+		return _nbAllocations;
+	}
+
+private:
+
+	/*! Not implemented, the buffers cannot be shared. */
+	CrfhWorkspace(const CrfhWorkspace &);
+
+	/*! Not implemented, the buffers cannot be shared. */
+	CrfhWorkspace &operator=(const CrfhWorkspace &);
+
+	/*! Key of a matrix: its type and index. */
+	typedef std::pair<int, int> MatrixKey;
+
+	/*! Returns the matrices of a given precision. */
+	template<typename _T>
+	std::map<MatrixKey, math::Matrix_<_T> *> &matrices();
+
+	/*! Resizes a vector, counting the reallocations. */
+	template<typename _V>
+	void resizeBuffer(_V &buffer, int size);
+
+private:
+
+	/*! Matrices of double precision. */
+	std::map<MatrixKey, math::Matrix_<double> *> _matrices;
+
+	/*! Matrices of single precision. */
+	std::map<MatrixKey, math::Matrix_<float> *> _floatMatrices;
+
+	/*! An accumulator and the parameters it was created for. */
+	struct AccumulatorSlot {
+		HistogramAccumulator *accumulator;
+		AccumulatorType type;
+		double binSpace;
+		long samples;
+	};
+
+	/*! Accumulators, by index. */
+	std::vector<AccumulatorSlot> _accumulators;
+
+	/*! Accumulators of the cells of the last grid. */
+	std::vector<HistogramAccumulator *> _gridAccumulators;
+
+	/*! Quantizer of the last descriptor list. */
+	Quantizer _quantizer;
+
+	/*! Lists of the scale-space cache, the samples created on first use. */
+	std::vector<ScaleSpaceSampleInfo> *_scaleSpaceSamples;
+	std::vector<int> _scaleSpaceOrder;
+
+	/*! Lists of the descriptor outputs. */
+	std::vector<math::Matrix_<double> *> _outputList;
+	std::vector<math::Matrix_<float> *> _floatOutputList;
+
+	/*! Row buffers. */
+	std::vector<const double *> _rowPointers;
+	std::vector<const float *> _floatRowPointers;
+	std::vector<int> _binRow;
+	std::vector<long> _indexRow;
+
+	/*! Number of allocations of buffers. */
+	long _nbAllocations;
+};
+
+template<>
+std::vector<math::Matrix_<double> *> &CrfhWorkspace::getOutputList<double>(
+		int size);
+
+template<>
+std::vector<math::Matrix_<float> *> &CrfhWorkspace::getOutputList<float>(
+		int size);
+
+template<>
+std::vector<const double *> &CrfhWorkspace::getRowPointers<double>(int size);
+
+template<>
+std::vector<const float *> &CrfhWorkspace::getRowPointers<float>(int size);
+
+} // end namespace cv
+} // end namespace rocs
+
+#endif /* CCRFHWORKSPACE_H_ */
@@ -35,6 +35,40 @@
 namespace rocs {
 namespace cv {
 
+/*! Copies the scale-space sample to the result. */
+template<typename _T>
+static Matrix_<_T> *applyScaleSpaceSample(
+		const ScaleSpaceCache &scaleSpaceCache, int sampleHandle,
+		Matrix_<_T> *result) {
+	const Matrix_<_T> *scaleSpaceSample =
+			scaleSpaceCache.template getScaleSpaceSample<_T> (sampleHandle);
+	if (!result)
+		result = new Matrix_<_T> (scaleSpaceSample->nbRows(),
+				scaleSpaceSample->nbCols());
+	scaleSpaceSample->copyTo(*result);
+	return result;
+}
+
+/*! Filters the scale-space sample with a derivative filter
+ and normalizes the result with a given factor. */
+template<typename _T>
+static Matrix_<_T> *applyDerivative(const ScaleSpaceCache &scaleSpaceCache,
+		const FilterCache &filterCache, int sampleHandle, int filterHandle,
+		double factor, Matrix_<_T> *result) {
+	// Get scale space sample
+	const Matrix_<_T> *scaleSpaceSample =
+			scaleSpaceCache.template getScaleSpaceSample<_T> (sampleHandle);
+
+	// Filter with derivative filter
+	result = filterCache.applyFilter(filterHandle, *scaleSpaceSample, result);
+
+	// Normalize
+	(*(result->asOpenCvMat())) *= factor;
+
+	// Return the result
+	return result;
+}
+
 // -----------------------------------------
 Descriptor *Descriptor::createDescriptor(DescriptorType descriptorType,
 		double scale, int bins) {
@@ -76,6 +110,38 @@ Descriptor *Descriptor::createDescriptor(string descriptorName,
 		return 0;
 }
 
+// -----------------------------------------
+bool Descriptor::getDerivative(int &dx, int &dy, double &factor) const {
+	switch (_descriptorType) {
+	case DT_Lx:
+		dx = 1;
+		dy = 0;
+		break;
+	case DT_Ly:
+		dx = 0;
+		dy = 1;
+		break;
+	case DT_Lxx:
+		dx = 2;
+		dy = 0;
+		break;
+	case DT_Lyy:
+		dx = 0;
+		dy = 2;
+		break;
+	case DT_Lxy:
+		dx = 1;
+		dy = 1;
+		break;
+	default:
+		return false;
+	}
+
+	// scale^(1/2) for the first and scale^(2/2) for the second order
+	factor = (dx + dy == 1) ? sqrt(_scale) : _scale;
+	return true;
+}
+
 // -----------------------------------------
 void CLDescriptor::createRequiredFilters(FilterCache &filterCache) {
 	CGaussianFilterInfo gfi(_scale);
@@ -89,19 +155,21 @@ void CLDescriptor::createRequiredChannels(ChannelCache &channelCache) {
 
 // -----------------------------------------
 void CLDescriptor::createRequiredScales(ScaleSpaceCache &scaleSpaceCache) {
-	scaleSpaceCache.createScaleSpaceSample(CT_L, _scale);
+	_sampleHandle = scaleSpaceCache.createScaleSpaceSample(CT_L, _scale);
 }
 
 // -----------------------------------------
 Matrix_<double> *CLDescriptor::apply(const ChannelCache &channelCache,
 		const ScaleSpaceCache &scaleSpaceCache,
 		const FilterCache &filterCache, Matrix_<double> *result) {
-	const Matrix_<double> *scaleSpaceSample = scaleSpaceCache.getScaleSpaceSample(CT_L,
-			_scale);
-	//result = scaleSpaceSample->getDeepCopy(result);
-	scaleSpaceSample->copyTo(*result);
-	// TODO check it works
-	return result;
+	return applyScaleSpaceSample(scaleSpaceCache, _sampleHandle, result);
+}
+
+// -----------------------------------------
+Matrix_<float> *CLDescriptor::apply(const ChannelCache &channelCache,
+		const ScaleSpaceCache &scaleSpaceCache,
+		const FilterCache &filterCache, Matrix_<float> *result) {
+	return applyScaleSpaceSample(scaleSpaceCache, _sampleHandle, result);
 }
 
 // -----------------------------------------
@@ -110,7 +178,7 @@ void CLxxDescriptor::createRequiredFilters(FilterCache &filterCache) {
 	CCartesianFilterInfo cfi(2, 0);
 
 	filterCache.createFilter(gfi);
-	filterCache.createFilter(cfi);
+	_filterHandle = filterCache.createFilter(cfi);
 }
 
 // -----------------------------------------
@@ -120,28 +188,23 @@ void CLxxDescriptor::createRequiredChannels(ChannelCache &channelCache) {
 
 // -----------------------------------------
 void CLxxDescriptor::createRequiredScales(ScaleSpaceCache &scaleSpaceCache) {
-	scaleSpaceCache.createScaleSpaceSample(CT_L, _scale);
+	_sampleHandle = scaleSpaceCache.createScaleSpaceSample(CT_L, _scale);
 }
 
 // -----------------------------------------
 Matrix_<double> *CLxxDescriptor::apply(const ChannelCache &channelCache,
 		const ScaleSpaceCache &scaleSpaceCache,
 		const FilterCache &filterCache, Matrix_<double> *result) {
-	// Get scale space sample
-	const Matrix_<double> *scaleSpaceSample = scaleSpaceCache.getScaleSpaceSample(CT_L,
-			_scale);
-
-	// Filter with second-derivative filter
-	CCartesianFilterInfo cfi(2, 0);
-	result = filterCache.applyFilter(cfi, *scaleSpaceSample, result);
-
-	// Normalize
-	double factor = _scale;
-	//(*result) *= factor; // scale^(2/2)=sqrt(scale)^2 = scale
-	(*(result->asOpenCvMat())) *= factor; // scale^(2/2)=sqrt(scale)^2 = scale
+	return applyDerivative(scaleSpaceCache, filterCache, _sampleHandle,
+			_filterHandle, _scale, result); // scale^(2/2)=sqrt(scale)^2 = scale
+}
 
-	// Return the result
-	return result;
+// -----------------------------------------
+Matrix_<float> *CLxxDescriptor::apply(const ChannelCache &channelCache,
+		const ScaleSpaceCache &scaleSpaceCache,
+		const FilterCache &filterCache, Matrix_<float> *result) {
+	return applyDerivative(scaleSpaceCache, filterCache, _sampleHandle,
+			_filterHandle, _scale, result); // scale^(2/2)=sqrt(scale)^2 = scale
 }
 
 // -----------------------------------------
@@ -150,7 +213,7 @@ void CLxDescriptor::createRequiredFilters(FilterCache &filterCache) {
 	CCartesianFilterInfo cfi(1, 0);
 
 	filterCache.createFilter(gfi);
-	filterCache.createFilter(cfi);
+	_filterHandle = filterCache.createFilter(cfi);
 }
 
 // -----------------------------------------
@@ -160,27 +223,23 @@ void CLxDescriptor::createRequiredChannels(ChannelCache &channelCache) {
 
 // -----------------------------------------
 void CLxDescriptor::createRequiredScales(ScaleSpaceCache &scaleSpaceCache) {
-	scaleSpaceCache.createScaleSpaceSample(CT_L, _scale);
+	_sampleHandle = scaleSpaceCache.createScaleSpaceSample(CT_L, _scale);
 }
 
 // -----------------------------------------
 Matrix_<double> *CLxDescriptor::apply(const ChannelCache &channelCache,
 		const ScaleSpaceCache &scaleSpaceCache,
 		const FilterCache &filterCache, Matrix_<double> *result) {
-	// Get scale space sample
-	const Matrix_<double> *scaleSpaceSample = scaleSpaceCache.getScaleSpaceSample(CT_L,
-			_scale);
-
-	// Filter with second-derivative filter
-	CCartesianFilterInfo cfi(1, 0);
-	result = filterCache.applyFilter(cfi, *scaleSpaceSample, result);
-
-	// Normalize
-	double factor = sqrt(_scale);
-	(*(result->asOpenCvMat())) *= factor; // scale^(1/2)=sqrt(scale)
+	return applyDerivative(scaleSpaceCache, filterCache, _sampleHandle,
+			_filterHandle, sqrt(_scale), result); // scale^(1/2)=sqrt(scale)
+}
 
-	// Return the result
-	return result;
+// -----------------------------------------
+Matrix_<float> *CLxDescriptor::apply(const ChannelCache &channelCache,
+		const ScaleSpaceCache &scaleSpaceCache,
+		const FilterCache &filterCache, Matrix_<float> *result) {
+	return applyDerivative(scaleSpaceCache, filterCache, _sampleHandle,
+			_filterHandle, sqrt(_scale), result); // scale^(1/2)=sqrt(scale)
 }
 
 // -----------------------------------------
@@ -189,7 +248,7 @@ void CLyDescriptor::createRequiredFilters(FilterCache &filterCache) {
 	CCartesianFilterInfo cfi(0, 1);
 
 	filterCache.createFilter(gfi);
-	filterCache.createFilter(cfi);
+	_filterHandle = filterCache.createFilter(cfi);
 }
 
 // -----------------------------------------
@@ -199,27 +258,23 @@ void CLyDescriptor::createRequiredChannels(ChannelCache &channelCache) {
 
 // -----------------------------------------
 void CLyDescriptor::createRequiredScales(ScaleSpaceCache &scaleSpaceCache) {
-	scaleSpaceCache.createScaleSpaceSample(CT_L, _scale);
+	_sampleHandle = scaleSpaceCache.createScaleSpaceSample(CT_L, _scale);
 }
 
 // -----------------------------------------
 Matrix_<double> *CLyDescriptor::apply(const ChannelCache &channelCache,
 		const ScaleSpaceCache &scaleSpaceCache,
 		const FilterCache &filterCache, Matrix_<double> *result) {
-	// Get scale space sample
-	const Matrix_<double> *scaleSpaceSample = scaleSpaceCache.getScaleSpaceSample(CT_L,
-			_scale);
-
-	// Filter with second-derivative filter
-	CCartesianFilterInfo cfi(0, 1);
-	result = filterCache.applyFilter(cfi, *scaleSpaceSample, result);
-
-	// Normalize
-	double factor = sqrt(_scale);
-	(*(result->asOpenCvMat())) *= factor; // scale^(1/2)=sqrt(scale)
+	return applyDerivative(scaleSpaceCache, filterCache, _sampleHandle,
+			_filterHandle, sqrt(_scale), result); // scale^(1/2)=sqrt(scale)
+}
 
-	// Return the result
-	return result;
+// -----------------------------------------
+Matrix_<float> *CLyDescriptor::apply(const ChannelCache &channelCache,
+		const ScaleSpaceCache &scaleSpaceCache,
+		const FilterCache &filterCache, Matrix_<float> *result) {
+	return applyDerivative(scaleSpaceCache, filterCache, _sampleHandle,
+			_filterHandle, sqrt(_scale), result); // scale^(1/2)=sqrt(scale)
 }
 
 // -----------------------------------------
@@ -228,7 +283,7 @@ void CLyyDescriptor::createRequiredFilters(FilterCache &filterCache) {
 	CCartesianFilterInfo cfi(0, 2);
 
 	filterCache.createFilter(gfi);
-	filterCache.createFilter(cfi);
+	_filterHandle = filterCache.createFilter(cfi);
 }
 
 // -----------------------------------------
@@ -238,27 +293,23 @@ void CLyyDescriptor::createRequiredChannels(ChannelCache &channelCache) {
 
 // -----------------------------------------
 void CLyyDescriptor::createRequiredScales(ScaleSpaceCache &scaleSpaceCache) {
-	scaleSpaceCache.createScaleSpaceSample(CT_L, _scale);
+	_sampleHandle = scaleSpaceCache.createScaleSpaceSample(CT_L, _scale);
 }
 
 // -----------------------------------------
 Matrix_<double> *CLyyDescriptor::apply(const ChannelCache &channelCache,
 		const ScaleSpaceCache &scaleSpaceCache,
 		const FilterCache &filterCache, Matrix_<double> *result) {
-	// Get scale space sample
-	const Matrix_<double> *scaleSpaceSample = scaleSpaceCache.getScaleSpaceSample(CT_L,
-			_scale);
-
-	// Filter with second-derivative filter
-	CCartesianFilterInfo cfi(0, 2);
-	result = filterCache.applyFilter(cfi, *scaleSpaceSample, result);
-
-	// Normalize
-	double factor = _scale;
-	(*(result->asOpenCvMat())) *= factor; // scale^(1/2)=sqrt(scale)
+	return applyDerivative(scaleSpaceCache, filterCache, _sampleHandle,
+			_filterHandle, _scale, result); // scale^(2/2)=sqrt(scale)^2 = scale
+}
 
-	// Return the result
-	return result;
+// -----------------------------------------
+Matrix_<float> *CLyyDescriptor::apply(const ChannelCache &channelCache,
+		const ScaleSpaceCache &scaleSpaceCache,
+		const FilterCache &filterCache, Matrix_<float> *result) {
+	return applyDerivative(scaleSpaceCache, filterCache, _sampleHandle,
+			_filterHandle, _scale, result); // scale^(2/2)=sqrt(scale)^2 = scale
 }
 
 // -----------------------------------------
@@ -267,7 +318,7 @@ void CLxyDescriptor::createRequiredFilters(FilterCache &filterCache) {
 	CCartesianFilterInfo cfi(1, 1);
 
 	filterCache.createFilter(gfi);
-	filterCache.createFilter(cfi);
+	_filterHandle = filterCache.createFilter(cfi);
 }
 
 // -----------------------------------------
@@ -277,27 +328,23 @@ void CLxyDescriptor::createRequiredChannels(ChannelCache &channelCache) {
 
 // -----------------------------------------
 void CLxyDescriptor::createRequiredScales(ScaleSpaceCache &scaleSpaceCache) {
-	scaleSpaceCache.createScaleSpaceSample(CT_L, _scale);
+	_sampleHandle = scaleSpaceCache.createScaleSpaceSample(CT_L, _scale);
 }
 
 // -----------------------------------------
 Matrix_<double> *CLxyDescriptor::apply(const ChannelCache &channelCache,
 		const ScaleSpaceCache &scaleSpaceCache,
 		const FilterCache &filterCache, Matrix_<double> *result) {
-	// Get scale space sample
-	const Matrix_<double> *scaleSpaceSample = scaleSpaceCache.getScaleSpaceSample(CT_L,
-			_scale);
-
-	// Filter with second-derivative filter
-	CCartesianFilterInfo cfi(1, 1);
-	result = filterCache.applyFilter(cfi, *scaleSpaceSample, result);
-
-	// Normalize
-	double factor = _scale;
-	(*(result->asOpenCvMat())) *= factor; // scale^(1/2)=sqrt(scale)
+	return applyDerivative(scaleSpaceCache, filterCache, _sampleHandle,
+			_filterHandle, _scale, result); // scale^(2/2)=sqrt(scale)^2 = scale
+}
 
-	// Return the result
-	return result;
+// -----------------------------------------
+Matrix_<float> *CLxyDescriptor::apply(const ChannelCache &channelCache,
+		const ScaleSpaceCache &scaleSpaceCache,
+		const FilterCache &filterCache, Matrix_<float> *result) {
+	return applyDerivative(scaleSpaceCache, filterCache, _sampleHandle,
+			_filterHandle, _scale, result); // scale^(2/2)=sqrt(scale)^2 = scale
 }
 
 } // end namespace cv
@@ -28,6 +28,7 @@
 #ifndef CDESCRIPTOR_H_
 #define CDESCRIPTOR_H_
 
+#include "rocs/cv/Crfh/ChannelCache.h"
 #include <string>
 using std::string;
 
@@ -63,17 +64,31 @@ public:
 	/*! Creates all the required filters in the filter cache. */
 	virtual void createRequiredFilters(FilterCache &filterCache) = 0;
 
-	/*! Creates all the samples of the scale-space in the scale-space cache. */
+	/*! Creates all the samples of the scale-space in the scale-space
+	 cache and stores their handles. The handles are valid for
+	 the caches created from the same layout. */
 	virtual void createRequiredScales(ScaleSpaceCache &scaleSpaceCache) = 0;
 
 	/*! Creates all the required channels in the channel cache. */
 	virtual void createRequiredChannels(ChannelCache &channelCache) = 0;
 
+	/*! Returns the channel the descriptor is applied to. All the
+	 descriptors implemented so far use the intensity channel. */
+	virtual ChannelType getChannelType() const {
+		return CT_L;
+	}
+
 	/*! Applies the descriptor to the proper channel using proper filters. */
 	virtual math::Matrix_<double> *apply(const ChannelCache &channelCache,
 			const ScaleSpaceCache &scaleSpaceCache,
 			const FilterCache &filterCache, math::Matrix_<double> *result = 0) = 0;
 
+	/*! Applies the descriptor to the proper channel using proper filters
+	 in single precision. */
+	virtual math::Matrix_<float> *apply(const ChannelCache &channelCache,
+			const ScaleSpaceCache &scaleSpaceCache,
+			const FilterCache &filterCache, math::Matrix_<float> *result) = 0;
+
 public:
 
 	/*! Creates a descriptor characterized by type. */
@@ -99,13 +114,28 @@ public:
 		return _bins;
 	}
 
+	/*! Returns scale. */
+	double getScale() {
+		return _scale;
+	}
+
+	/*! Returns the handle of the scale-space sample. */
+	int getSampleHandle() const {
+		return _sampleHandle;
+	}
+
+	/*! Returns true if the descriptor is a normalized derivative of
+	 the scale-space sample and sets the orders of differentiation
+	 and the normalization factor. */
+	bool getDerivative(int &dx, int &dy, double &factor) const;
+
 protected:
 
 	/*! Constructor. */
 	inline Descriptor(DescriptorType descriptorType, double min, double max,
 			double scale, int bins) :
 		_descriptorType(descriptorType), _min(min), _max(max), _scale(scale),
-				_bins(bins) {
+				_bins(bins), _filterHandle(-1), _sampleHandle(-1) {
 	}
 
 protected:
@@ -124,6 +154,14 @@ protected:
 
 	/*! Number of quantization levels for this descriptor. */
 	int _bins;
+
+	/*! Handle of the filter applied to the scale-space sample
+	 (-1 if none), resolved by createRequiredFilters(). */
+	int _filterHandle;
+
+	/*! Handle of the scale-space sample, resolved by
+	 createRequiredScales() when the system is built. */
+	int _sampleHandle;
 };
 
 /*!
@@ -154,6 +192,12 @@ public:
 			const ScaleSpaceCache &scaleSpaceCache,
 			const FilterCache &filterCache, math::Matrix_<double> *result = 0);
 
+	/*! Applies the descriptor to the proper channel using proper filters
+	 in single precision. */
+	virtual math::Matrix_<float> *apply(const ChannelCache &channelCache,
+			const ScaleSpaceCache &scaleSpaceCache,
+			const FilterCache &filterCache, math::Matrix_<float> *result);
+
 };
 
 /*!
@@ -183,6 +227,12 @@ public:
 	virtual math::Matrix_<double> *apply(const ChannelCache &channelCache,
 			const ScaleSpaceCache &scaleSpaceCache,
 			const FilterCache &filterCache, math::Matrix_<double> *result = 0);
+
+	/*! Applies the descriptor to the proper channel using proper filters
+	 in single precision. */
+	virtual math::Matrix_<float> *apply(const ChannelCache &channelCache,
+			const ScaleSpaceCache &scaleSpaceCache,
+			const FilterCache &filterCache, math::Matrix_<float> *result);
 };
 
 /*!
@@ -212,6 +262,12 @@ public:
 	virtual math::Matrix_<double> *apply(const ChannelCache &channelCache,
 			const ScaleSpaceCache &scaleSpaceCache,
 			const FilterCache &filterCache, math::Matrix_<double> *result = 0);
+
+	/*! Applies the descriptor to the proper channel using proper filters
+	 in single precision. */
+	virtual math::Matrix_<float> *apply(const ChannelCache &channelCache,
+			const ScaleSpaceCache &scaleSpaceCache,
+			const FilterCache &filterCache, math::Matrix_<float> *result);
 };
 
 /*!
@@ -241,6 +297,12 @@ public:
 	virtual math::Matrix_<double> *apply(const ChannelCache &channelCache,
 			const ScaleSpaceCache &scaleSpaceCache,
 			const FilterCache &filterCache, math::Matrix_<double> *result = 0);
+
+	/*! Applies the descriptor to the proper channel using proper filters
+	 in single precision. */
+	virtual math::Matrix_<float> *apply(const ChannelCache &channelCache,
+			const ScaleSpaceCache &scaleSpaceCache,
+			const FilterCache &filterCache, math::Matrix_<float> *result);
 };
 
 /*!
@@ -270,6 +332,12 @@ public:
 	virtual math::Matrix_<double> *apply(const ChannelCache &channelCache,
 			const ScaleSpaceCache &scaleSpaceCache,
 			const FilterCache &filterCache, math::Matrix_<double> *result = 0);
+
+	/*! Applies the descriptor to the proper channel using proper filters
+	 in single precision. */
+	virtual math::Matrix_<float> *apply(const ChannelCache &channelCache,
+			const ScaleSpaceCache &scaleSpaceCache,
+			const FilterCache &filterCache, math::Matrix_<float> *result);
 };
 
 /*!
@@ -299,6 +367,12 @@ public:
 	virtual math::Matrix_<double> *apply(const ChannelCache &channelCache,
 			const ScaleSpaceCache &scaleSpaceCache,
 			const FilterCache &filterCache, math::Matrix_<double> *result = 0);
+
+	/*! Applies the descriptor to the proper channel using proper filters
+	 in single precision. */
+	virtual math::Matrix_<float> *apply(const ChannelCache &channelCache,
+			const ScaleSpaceCache &scaleSpaceCache,
+			const FilterCache &filterCache, math::Matrix_<float> *result);
 };
 
 } // end namespace cv
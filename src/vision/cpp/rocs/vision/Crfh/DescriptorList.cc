@@ -28,8 +28,15 @@
  */
 
 #include "rocs/math/Matrix_.h"
+#include "rocs/core/ThreadPool.h"
+#include "rocs/cv/Crfh/Filter.h"
+#include "rocs/cv/Crfh/ScaleSpaceCache.h"
 #include "rocs/cv/Crfh/DescriptorList.h"
 
+#include <boost/bind.hpp>
+
+#include <algorithm>
+
 namespace rocs
 {
 namespace cv
@@ -69,6 +76,43 @@ void DescriptorList::createAllRequiredScales(ScaleSpaceCache &scaleSpaceCache) c
 		at(i)->createRequiredScales(scaleSpaceCache);
 }
 
+// -----------------------------------------
+void DescriptorList::requireAllRegions(ScaleSpaceCache &scaleSpaceCache,
+		const opencv::Rect &region) const
+{
+	for (unsigned int i = 0; i < size(); ++i)
+	{
+		int dx, dy;
+		double factor;
+		int halo = (at(i)->getDerivative(dx, dy, factor)) ? 1 : 0;
+		scaleSpaceCache.requireRegion(at(i)->getSampleHandle(), expandRegion(
+				region, halo));
+	}
+}
+
+// -----------------------------------------
+int DescriptorList::getSupportRadius(const ScaleSpaceCache &layout,
+		bool incremental) const
+{
+	vector<int> radii;
+	layout.getSupportRadii(incremental, radii);
+
+	int radius = 0;
+	for (unsigned int i = 0; i < size(); ++i)
+	{
+		if (at(i)->getSampleHandle() < 0)
+			continue;
+		int dx, dy;
+		double factor;
+		int halo = (at(i)->getDerivative(dx, dy, factor)) ? 1 : 0;
+		int sampleRadius = radii[at(i)->getSampleHandle()];
+		if (sampleRadius < 0)
+			return -1;
+		radius = std::max(radius, sampleRadius + halo);
+	}
+	return radius;
+}
+
 // -----------------------------------------
 void DescriptorList::createAllRequiredChannels(ChannelCache &channelCache) const
 {
@@ -76,19 +120,173 @@ void DescriptorList::createAllRequiredChannels(ChannelCache &channelCache) const
 		at(i)->createRequiredChannels(channelCache);
 }
 
+// -----------------------------------------
+bool DescriptorList::requiresOnlyL() const
+{
+	for (unsigned int i = 0; i < size(); ++i)
+		if (at(i)->getChannelType() != CT_L)
+			return false;
+	return true;
+}
+
+// -----------------------------------------
+void DescriptorList::createDerivativeGroups(bool fused)
+{
+	_derivativeGroups.clear();
+	_derivativeGroupOf.assign(size(), -1);
+	if (!fused)
+		return;
+
+	for (unsigned int i = 0; i < size(); ++i)
+	{
+		int dx, dy;
+		double factor;
+		if (!at(i)->getDerivative(dx, dy, factor))
+			continue;
+
+		// Join a group of the same sample, if there is room
+		for (unsigned int g = 0; g < _derivativeGroups.size(); ++g)
+		{
+			int first = _derivativeGroups[g][0];
+			if ((at(first)->getSampleHandle() == at(i)->getSampleHandle())
+					&& (_derivativeGroups[g].size()
+							< CARTESIAN_FUSED_MAX_OUTPUTS))
+			{
+				_derivativeGroups[g].push_back(i);
+				_derivativeGroupOf[i] = g;
+				break;
+			}
+		}
+		if (_derivativeGroupOf[i] < 0)
+		{
+			_derivativeGroupOf[i] = _derivativeGroups.size();
+			_derivativeGroups.push_back(vector<int> (1, i));
+		}
+	}
+}
+
+/*! Computes the outputs of a group of derivative descriptors
+ sharing a sample in one sweep. Existing outputs are reused. */
+template<typename _T>
+static void applyDerivativeGroup(const DescriptorList *descriptorList,
+		const vector<int> *group, const ScaleSpaceCache *scaleSpaceCache,
+		math::Matrix_<_T> **outputs, const opencv::Rect *region)
+{
+	const math::Matrix_<_T> *input =
+			scaleSpaceCache->template getScaleSpaceSample<_T> (
+					(*descriptorList)[(*group)[0]]->getSampleHandle());
+	int rows = input->nbRows();
+	int cols = input->nbCols();
+
+	int dx[CARTESIAN_FUSED_MAX_OUTPUTS];
+	int dy[CARTESIAN_FUSED_MAX_OUTPUTS];
+	double factors[CARTESIAN_FUSED_MAX_OUTPUTS];
+	math::Matrix_<_T> *groupOutputs[CARTESIAN_FUSED_MAX_OUTPUTS];
+	int count = group->size();
+	for (int k = 0; k < count; ++k)
+	{
+		int i = (*group)[k];
+		(*descriptorList)[i]->getDerivative(dx[k], dy[k], factors[k]);
+		if (!outputs[i])
+			outputs[i] = new math::Matrix_<_T>(rows, cols);
+		else if ((outputs[i]->nbRows() != rows) || (outputs[i]->nbCols()
+				!= cols))
+			outputs[i]->resize(rows, cols);
+		groupOutputs[k] = outputs[i];
+	}
+
+	CCartesianFilter::applyFused(*input, count, dx, dy, factors,
+			groupOutputs, (region) ? *region : opencv::Rect(0, 0, cols, rows));
+}
+
+/*! Applies a descriptor and stores the pointer to the output.
+ An existing output is reused. */
+template<typename _T>
+static void applyDescriptor(Descriptor *descriptor,
+		const ChannelCache *channelCache,
+		const ScaleSpaceCache *scaleSpaceCache,
+		const FilterCache *filterCache, math::Matrix_<_T> **output)
+{
+	*output = descriptor->apply(*channelCache, *scaleSpaceCache, *filterCache,
+			*output);
+}
+
+// -----------------------------------------
+template<typename _T>
+void DescriptorList::applyAllTo(const ChannelCache &channelCache,
+		const ScaleSpaceCache &scaleSpaceCache,
+		const FilterCache &filterCache, math::Matrix_<_T> **outputs,
+		core::ThreadPool *threadPool, const opencv::Rect *region) const
+{
+	// Fused groups of derivatives, if still valid for the list
+	bool grouped = (_derivativeGroupOf.size() == size());
+	for (unsigned int g = 0; (grouped) && (g < _derivativeGroups.size()); ++g)
+	{
+		if (threadPool)
+			threadPool->schedule(boost::bind(&applyDerivativeGroup<_T>, this,
+					&_derivativeGroups[g], &scaleSpaceCache, outputs, region));
+		else
+			applyDerivativeGroup<_T>(this, &_derivativeGroups[g],
+					&scaleSpaceCache, outputs, region);
+	}
+
+	// Remaining descriptors
+	for (unsigned int i = 0; i < size(); ++i)
+	{
+		if ((grouped) && (_derivativeGroupOf[i] >= 0))
+			continue;
+		if (threadPool)
+			threadPool->schedule(boost::bind(&applyDescriptor<_T>, at(i),
+					&channelCache, &scaleSpaceCache, &filterCache, outputs + i));
+		else
+			applyDescriptor<_T>(at(i), &channelCache, &scaleSpaceCache,
+					&filterCache, outputs + i);
+	}
+
+	if (threadPool)
+		threadPool->wait();
+}
+
+template void DescriptorList::applyAllTo<double>(
+		const ChannelCache &channelCache,
+		const ScaleSpaceCache &scaleSpaceCache,
+		const FilterCache &filterCache, math::Matrix_<double> **outputs,
+		core::ThreadPool *threadPool, const opencv::Rect *region) const;
+template void DescriptorList::applyAllTo<float>(
+		const ChannelCache &channelCache,
+		const ScaleSpaceCache &scaleSpaceCache,
+		const FilterCache &filterCache, math::Matrix_<float> **outputs,
+		core::ThreadPool *threadPool, const opencv::Rect *region) const;
+
 // -----------------------------------------
 vector<math::Matrix_<double> *> DescriptorList::applyAll(
 		const ChannelCache &channelCache,
 		const ScaleSpaceCache &scaleSpaceCache,
-		const FilterCache &filterCache) const
+		const FilterCache &filterCache, core::ThreadPool *threadPool) const
 {
-	vector<math::Matrix_<double> *> list;
+	vector<math::Matrix_<double> *> list(size(), 0);
 
-	for (unsigned int i = 0; i < size(); ++i)
-		list.push_back(at(i)->apply(channelCache, scaleSpaceCache, filterCache));
+	if (!empty())
+		applyAllTo(channelCache, scaleSpaceCache, filterCache, &list[0],
+				threadPool);
 
 	return list;
 }
 
+// -----------------------------------------
+void DescriptorList::applyAll(const ChannelCache &channelCache,
+		const ScaleSpaceCache &scaleSpaceCache,
+		const FilterCache &filterCache,
+		vector<math::Matrix_<float> *> &outputs,
+		core::ThreadPool *threadPool) const
+{
+	unsigned int first = outputs.size();
+	outputs.resize(first + size(), 0);
+
+	if (!empty())
+		applyAllTo(channelCache, scaleSpaceCache, filterCache, &outputs[first],
+				threadPool);
+}
+
 } // end namespace cv
 } // end namespace rocs
@@ -29,6 +29,7 @@
 #define CDESCRIPTORLIST_H_
 
 #include "rocs/cv/Crfh/Descriptor.h"
+#include "rocs/math/Matrix_.h"
 #include <vector>
 using std::vector;
 
@@ -44,6 +45,11 @@ namespace math
 template<typename _T> class Matrix_;
 }
 
+namespace core
+{
+class ThreadPool;
+}
+
 namespace cv
 {
 
@@ -70,17 +76,73 @@ public:
 	/*! Creates filters requierd by all descriptors. */
 	void createAllRequiredFilters(FilterCache &filterCache) const;
 
-	/*! Creates samples of the scale-space requierd by all descriptors. */
+	/*! Requests samples of the scale-space requierd by all descriptors
+	 and stores their handles in the descriptors. Called once, when
+	 the system is built, on a layout cache (see ScaleSpaceCache). */
 	void createAllRequiredScales(ScaleSpaceCache &scaleSpaceCache) const;
 
+	/*! Requests the samples used by all descriptors to be valid in
+	 a given region of the outputs, extended by the halo of the
+	 derivative filters. */
+	void requireAllRegions(ScaleSpaceCache &scaleSpaceCache,
+			const opencv::Rect &region) const;
+
+	/*! Returns the distance in pixels from which the pixels of the
+	 image influence the outputs of the descriptors, -1 if the outputs
+	 depend on the whole image. The samples are those of a layout
+	 cache computed incrementally or not. */
+	int getSupportRadius(const ScaleSpaceCache &layout, bool incremental) const;
+
 	/*! Creates channels required by all descriptors. */
 	void createAllRequiredChannels(ChannelCache &channelCache) const;
 
+	/*! Returns true if all the descriptors use only the intensity
+	 channel L and the images can be loaded as lightness. */
+	bool requiresOnlyL() const;
+
+	/*! Groups the derivative descriptors sharing a scale-space sample.
+	 applyAll() computes each group in one sweep over the sample with
+	 the normalization folded in. Must be called after the handles of
+	 the samples are resolved. If fused is false, the groups are removed
+	 and every descriptor is applied separately. */
+	void createDerivativeGroups(bool fused = true);
+
 	/*! Applies all the descriptors in the list and returns a list of
-	 pointers to the output matrices. */
+	 pointers to the output matrices. If a thread pool is given,
+	 the descriptors are applied concurrently. */
 	vector<math::Matrix_<double>*> applyAll(const ChannelCache &channelCache,
 			const ScaleSpaceCache &scaleSpaceCache,
-			const FilterCache &filterCache) const;
+			const FilterCache &filterCache,
+			core::ThreadPool *threadPool = 0) const;
+
+	/*! Applies all the descriptors in the list in single precision and
+	 appends pointers to the output matrices to the outputs. If a thread
+	 pool is given, the descriptors are applied concurrently. */
+	void applyAll(const ChannelCache &channelCache,
+			const ScaleSpaceCache &scaleSpaceCache,
+			const FilterCache &filterCache,
+			vector<math::Matrix_<float>*> &outputs,
+			core::ThreadPool *threadPool = 0) const;
+
+	/*! Applies all the descriptors writing the output of the i-th
+	 descriptor to outputs[i]. Non-null outputs are reused,
+	 null ones are allocated. If a region is given, the fused
+	 derivatives are valid only inside it. Instantiated for double
+	 and float. */
+	template<typename _T>
+	void applyAllTo(const ChannelCache &channelCache,
+			const ScaleSpaceCache &scaleSpaceCache,
+			const FilterCache &filterCache, math::Matrix_<_T> **outputs,
+			core::ThreadPool *threadPool = 0,
+			const opencv::Rect *region = 0) const;
+
+private:
+
+	/*! Groups of indices of derivative descriptors sharing a sample. */
+	vector<vector<int> > _derivativeGroups;
+
+	/*! Group of each descriptor or -1 if applied separately. */
+	vector<int> _derivativeGroupOf;
 
 };
 
@@ -29,6 +29,8 @@
 
 #define PI 3.141592653589793
 #include <math.h>
+#include <algorithm>
+#include <vector>
 
 #include "rocs/cv/Crfh/Filter.h"
 //#include "global.h"
@@ -133,6 +135,250 @@ Matrix_<double> *CGaussianFilter::apply(const Matrix_<double> &input, Matrix_<
 	return result;
 }
 
+// -----------------------------------------
+Matrix_<float> *CGaussianFilter::apply(const Matrix_<float> &input, Matrix_<
+		float> *result) const {
+	rocsDebug3("CGaussianFilter::apply(float '%s', result non null:%i", input.infoString().c_str(), (result ? 1 : 0));
+	result = Matrix_<float>::convolve(input, _floatVerticalKernel, result);
+	result->convolveWith(_floatHorizontalKernel);
+	return result;
+}
+
+// -----------------------------------------
+Matrix_<double> *CGaussianFilter::applyToRegion(const Matrix_<double> &input,
+		Matrix_<double> *result, const opencv::Rect &region) const {
+	return applyToRegion(input, result, region, _verticalKernel,
+			_horizontalKernel);
+}
+
+// -----------------------------------------
+Matrix_<float> *CGaussianFilter::applyToRegion(const Matrix_<float> &input,
+		Matrix_<float> *result, const opencv::Rect &region) const {
+	return applyToRegion(input, result, region, _floatVerticalKernel,
+			_floatHorizontalKernel);
+}
+
+// -----------------------------------------
+template<typename _T>
+Matrix_<_T> *CGaussianFilter::applyToRegion(const Matrix_<_T> &input,
+		Matrix_<_T> *result, const opencv::Rect &region,
+		const Matrix_<_T> &verticalKernel, const Matrix_<_T> &horizontalKernel) {
+	int rows = input.nbRows();
+	int cols = input.nbCols();
+	opencv::Rect whole(0, 0, cols, rows);
+	rocsDebug3("CGaussianFilter::applyToRegion(%i, %i, %i, %i)", region.x, region.y, region.width, region.height);
+
+	if (!result)
+		result = new Matrix_<_T> (rows, cols);
+	else if ((result->nbRows() != rows) || (result->nbCols() != cols))
+		result->resize(rows, cols);
+
+	// The filtering of a submatrix reads the pixels around it from the
+	// whole matrix and extrapolates only at the borders of the whole
+	// matrix, the region is therefore filtered as if the whole matrix
+	// was. The vertical pass must also cover the columns read by the
+	// horizontal one.
+	const opencv::Mat &in = input.asConstOpenCvMat();
+	opencv::Mat &out = *result->asOpenCvMat();
+	int halo = horizontalKernel.nbCols() / 2;
+	opencv::Rect verticalRegion = opencv::Rect(region.x - halo, region.y,
+			region.width + 2 * halo, region.height) & whole;
+	opencv::Mat verticalOut = out(verticalRegion);
+	opencv::filter2D(in(verticalRegion), verticalOut, -1,
+			verticalKernel.asConstOpenCvMat());
+	opencv::Mat horizontalOut = out(region & whole);
+	opencv::filter2D(horizontalOut, horizontalOut, -1,
+			horizontalKernel.asConstOpenCvMat());
+
+	return result;
+}
+
+// -----------------------------------------
+CRecursiveGaussianFilter::CRecursiveGaussianFilter(double sigma2) :
+	Filter(new CGaussianFilterInfo(sigma2)) {
+	rocsDebug3("CRecursiveGaussianFilter(%f)", sigma2);
+
+	// Deriche, "Recursively implementing the Gaussian and its
+	// derivatives", INRIA RR-1893 (1993), 4th order
+	double sigma = rocs::math::aMax<double>(sqrt(sigma2),
+			RECURSIVE_GAUSSIAN_MIN_SIGMA);
+	const double a0 = 1.68, a1 = 3.735, b0 = 1.783, b1 = 1.723;
+	const double c0 = -0.6803, c1 = -0.2598, w0 = 0.6318, w1 = 1.997;
+
+	double cos0 = cos(w0 / sigma), sin0 = sin(w0 / sigma);
+	double cos1 = cos(w1 / sigma), sin1 = sin(w1 / sigma);
+	double e0 = exp(-b0 / sigma), e1 = exp(-b1 / sigma);
+
+	double n[4];
+	n[0] = a0 + c0;
+	n[1] = e1 * (c1 * sin1 - (c0 + 2 * a0) * cos1) + e0 * (a1 * sin0 - (2
+			* c0 + a0) * cos0);
+	n[2] = 2 * e0 * e1 * ((a0 + c0) * cos1 * cos0 - a1 * cos1 * sin0 - c1
+			* cos0 * sin1) + c0 * e0 * e0 + a0 * e1 * e1;
+	n[3] = e1 * e0 * e0 * (c1 * sin1 - c0 * cos1) + e0 * e1 * e1 * (a1
+			* sin0 - a0 * cos0);
+
+	_d[0] = -2 * e1 * cos1 - 2 * e0 * cos0;
+	_d[1] = 4 * cos1 * cos0 * e0 * e1 + e1 * e1 + e0 * e0;
+	_d[2] = -2 * cos0 * e0 * e1 * e1 - 2 * cos1 * e1 * e0 * e0;
+	_d[3] = e0 * e0 * e1 * e1;
+
+	// The anti-causal part mirrors the causal one without the center
+	double m[4];
+	m[0] = n[1] - _d[0] * n[0];
+	m[1] = n[2] - _d[1] * n[0];
+	m[2] = n[3] - _d[2] * n[0];
+	m[3] = -_d[3] * n[0];
+
+	// Normalize the kernel to a unit sum
+	double sumD = 1 + _d[0] + _d[1] + _d[2] + _d[3];
+	double sum = (n[0] + n[1] + n[2] + n[3] + m[0] + m[1] + m[2] + m[3])
+			/ sumD;
+	double sumN = 0, sumM = 0;
+	for (int k = 0; k < 4; ++k) {
+		_n[k] = n[k] / sum;
+		_m[k] = m[k] / sum;
+		sumN += _n[k];
+		sumM += _m[k];
+	}
+	_causalGain = sumN / sumD;
+	_antiCausalGain = sumM / sumD;
+	_margin = (int) ceil(4 * sigma);
+}
+
+/*! Returns the index of a neighbor, reflecting it at the border
+ without repeating the border pixel (as opencv::BORDER_REFLECT_101,
+ used by the convolutions of the matrices). */
+static inline int reflect101(int i, int size) {
+	if (size == 1)
+		return 0;
+	while ((i < 0) || (i >= size)) {
+		if (i < 0)
+			i = -i;
+		if (i >= size)
+			i = 2 * size - 2 - i;
+	}
+	return i;
+}
+
+// -----------------------------------------
+void CRecursiveGaussianFilter::filterLines(const double *in, double *causal,
+		double *out, int length, int width) const {
+	// Samples beyond the ends repeat the end samples, the recursions
+	// start from their response to such constant signals
+	const double *first = in;
+	const double *last = in + (size_t) (length - 1) * width;
+
+	// Causal part
+	for (int i = 0; i < length; ++i) {
+		double *y = causal + (size_t) i * width;
+		const double *x[4];
+		const double *yPrev[4];
+		for (int k = 0; k < 4; ++k) {
+			x[k] = (i - k >= 0) ? in + (size_t) (i - k) * width : first;
+			yPrev[k] = (i - k - 1 >= 0) ? causal + (size_t) (i - k - 1)
+					* width : 0;
+		}
+		for (int j = 0; j < width; ++j) {
+			double v = _n[0] * x[0][j] + _n[1] * x[1][j] + _n[2] * x[2][j]
+					+ _n[3] * x[3][j];
+			for (int k = 0; k < 4; ++k)
+				v -= _d[k] * ((yPrev[k]) ? yPrev[k][j] : _causalGain
+						* first[j]);
+			y[j] = v;
+		}
+	}
+
+	// Anti-causal part, written to out before the causal one is added
+	for (int i = length - 1; i >= 0; --i) {
+		double *y = out + (size_t) i * width;
+		const double *x[4];
+		const double *yNext[4];
+		for (int k = 0; k < 4; ++k) {
+			int p = i + k + 1;
+			x[k] = (p < length) ? in + (size_t) p * width : last;
+			yNext[k] = (p < length) ? out + (size_t) p * width : 0;
+		}
+		for (int j = 0; j < width; ++j) {
+			double v = _m[0] * x[0][j] + _m[1] * x[1][j] + _m[2] * x[2][j]
+					+ _m[3] * x[3][j];
+			for (int k = 0; k < 4; ++k)
+				v -= _d[k] * ((yNext[k]) ? yNext[k][j] : _antiCausalGain
+						* last[j]);
+			y[j] = v;
+		}
+	}
+
+	size_t size = (size_t) length * width;
+	for (size_t k = 0; k < size; ++k)
+		out[k] += causal[k];
+}
+
+// -----------------------------------------
+template<typename _T>
+Matrix_<_T> *CRecursiveGaussianFilter::applyRecursive(
+		const Matrix_<_T> &input, Matrix_<_T> *result) const {
+	int rows = input.nbRows();
+	int cols = input.nbCols();
+	if (!result)
+		result = new Matrix_<_T> (rows, cols);
+	else
+		result->resize(rows, cols);
+	const opencv::Mat &in = input.asConstOpenCvMat();
+	opencv::Mat &out = *result->asOpenCvMat();
+
+	// Each line is extended by _margin mirrored samples at both ends, so
+	// that the borders match those of the FIR filter and the
+	// initialization of the recursions has decayed inside the image.
+	int m = _margin;
+
+	// Horizontal pass, one row at a time
+	int extCols = cols + 2 * m;
+	std::vector<double> line(extCols), causal(extCols), filtered(extCols);
+	for (int i = 0; i < rows; ++i) {
+		const _T *inRow = in.ptr<_T> (i);
+		_T *outRow = out.ptr<_T> (i);
+		for (int k = 0; k < extCols; ++k)
+			line[k] = inRow[reflect101(k - m, cols)];
+		filterLines(&line[0], &causal[0], &filtered[0], extCols, 1);
+		for (int j = 0; j < cols; ++j)
+			outRow[j] = static_cast<_T> (filtered[m + j]);
+	}
+
+	// Vertical pass over whole rows to keep the memory access
+	// sequential, the rows being extended in the same way
+	int extRows = rows + 2 * m;
+	size_t size = (size_t) extRows * cols;
+	std::vector<double> block(size), blockCausal(size), blockFiltered(size);
+	for (int r = 0; r < extRows; ++r) {
+		const _T *src = out.ptr<_T> (reflect101(r - m, rows));
+		std::copy(src, src + cols, &block[(size_t) r * cols]);
+	}
+	filterLines(&block[0], &blockCausal[0], &blockFiltered[0], extRows, cols);
+	for (int i = 0; i < rows; ++i) {
+		const double *src = &blockFiltered[(size_t) (i + m) * cols];
+		_T *outRow = out.ptr<_T> (i);
+		for (int j = 0; j < cols; ++j)
+			outRow[j] = static_cast<_T> (src[j]);
+	}
+
+	return result;
+}
+
+// -----------------------------------------
+Matrix_<double> *CRecursiveGaussianFilter::apply(const Matrix_<double> &input,
+		Matrix_<double> *result) const {
+	rocsDebug3("CRecursiveGaussianFilter::apply('%s', result non null:%i", input.infoString().c_str(), (result ? 1 : 0));
+	return applyRecursive(input, result);
+}
+
+// -----------------------------------------
+Matrix_<float> *CRecursiveGaussianFilter::apply(const Matrix_<float> &input,
+		Matrix_<float> *result) const {
+	rocsDebug3("CRecursiveGaussianFilter::apply(float '%s', result non null:%i", input.infoString().c_str(), (result ? 1 : 0));
+	return applyRecursive(input, result);
+}
+
 // -----------------------------------------
 void CCartesianFilter::createXKernel(int dx) {
 	rocsDebug3("createXKernel(%i)", dx);
@@ -196,5 +442,85 @@ Matrix_<double> *CCartesianFilter::apply(const Matrix_<double> &input, Matrix_<
 	return result;
 }
 
+// -----------------------------------------
+Matrix_<float> *CCartesianFilter::apply(const Matrix_<float> &input, Matrix_<
+		float> *result) const {
+	rocsDebug3("CCartesianFilter::apply(float '%s', result non null:%i", input.infoString().c_str(), (result ? 1 : 0));
+
+	if (_floatXKernel.nbCols()) {
+		result = Matrix_<float>::convolve(input, _floatXKernel, result);
+		if (_floatYKernel.nbRows()) {
+			result->convolveWith(_floatYKernel);
+		}
+	} else if (_floatYKernel.nbRows()) {
+		result = Matrix_<float>::convolve(input, _floatYKernel, result);
+	}
+
+	return result;
+}
+
+/*! Applies a 3-tap derivative kernel of a given order to three values.
+ The taps are accumulated in the same order as by the convolution,
+ zero taps are skipped. */
+template<typename _T>
+static inline _T derivativeTaps(_T prev, _T cur, _T next, int order) {
+	if (order == 1)
+		return static_cast<_T> (-0.5) * prev + static_cast<_T> (0.5) * next;
+	return prev + static_cast<_T> (-2) * cur + next;
+}
+
+// -----------------------------------------
+template<typename _T>
+void CCartesianFilter::applyFused(const Matrix_<_T> &input, int count,
+		const int *dx, const int *dy, const double *factors,
+		Matrix_<_T> **outputs, const opencv::Rect &region) {
+	rocsDebug3("CCartesianFilter::applyFused('%s', %i)", input.infoString().c_str(), count);
+	int rows = input.nbRows();
+	int cols = input.nbCols();
+	const opencv::Mat &in = input.asConstOpenCvMat();
+	opencv::Rect valid = region & opencv::Rect(0, 0, cols, rows);
+
+	_T *outRows[CARTESIAN_FUSED_MAX_OUTPUTS];
+	for (int i = valid.y; i < valid.y + valid.height; ++i) {
+		const _T *prevRow = in.ptr<_T> (reflect101(i - 1, rows));
+		const _T *curRow = in.ptr<_T> (i);
+		const _T *nextRow = in.ptr<_T> (reflect101(i + 1, rows));
+		for (int k = 0; k < count; ++k)
+			outRows[k] = outputs[k]->asOpenCvMat()->template ptr<_T> (i);
+
+		for (int j = valid.x; j < valid.x + valid.width; ++j) {
+			int jPrev = reflect101(j - 1, cols);
+			int jNext = reflect101(j + 1, cols);
+
+			for (int k = 0; k < count; ++k) {
+				_T value;
+				if (dy[k] == 0)
+					value = derivativeTaps(curRow[jPrev], curRow[j],
+							curRow[jNext], dx[k]);
+				else if (dx[k] == 0)
+					value = derivativeTaps(prevRow[j], curRow[j], nextRow[j],
+							dy[k]);
+				else
+					// The horizontal kernel is applied first, as in apply()
+					value = derivativeTaps(derivativeTaps(prevRow[jPrev],
+							prevRow[j], prevRow[jNext], dx[k]), derivativeTaps(
+							curRow[jPrev], curRow[j], curRow[jNext], dx[k]),
+							derivativeTaps(nextRow[jPrev], nextRow[j],
+									nextRow[jNext], dx[k]), dy[k]);
+				outRows[k][j] = static_cast<_T> (value * factors[k]);
+			}
+		}
+	}
+}
+
+template void CCartesianFilter::applyFused<double>(
+		const Matrix_<double> &input, int count, const int *dx,
+		const int *dy, const double *factors, Matrix_<double> **outputs,
+		const opencv::Rect &region);
+template void CCartesianFilter::applyFused<float>(
+		const Matrix_<float> &input, int count, const int *dx, const int *dy,
+		const double *factors, Matrix_<float> **outputs,
+		const opencv::Rect &region);
+
 } // end namespace cv
 } // end namespace rocs
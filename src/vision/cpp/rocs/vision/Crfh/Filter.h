@@ -28,6 +28,8 @@
 
 #include "rocs/math/Matrix_.h"
 
+#include <algorithm>
+
 namespace rocs {
 namespace cv {
 
@@ -37,6 +39,18 @@ using rocs::math::Matrix_;
 /*! How many sigmas should the gaussian filter contain. */
 #define GAUSSIAN_SIGMAS 3
 
+/*! Smallest sigma for which the recursive Gaussian approximation is valid. */
+#define RECURSIVE_GAUSSIAN_MIN_SIGMA 0.5
+
+/*! Maximal number of outputs of a single fused derivative sweep. */
+#define CARTESIAN_FUSED_MAX_OUTPUTS 8
+
+/*! Extends a region by a given number of pixels on each side. */
+inline opencv::Rect expandRegion(const opencv::Rect &region, int halo) {
+	return opencv::Rect(region.x - halo, region.y - halo, region.width + 2
+			* halo, region.height + 2 * halo);
+}
+
 enum FilterType {
 	/*! Unknown type. */
 	FT_UNKNOWN = 0,
@@ -95,6 +109,31 @@ public:
 	virtual Matrix_<double> *apply(const Matrix_<double> &input,
 			Matrix_<double> *result) const = 0;
 
+	/*! Applies the filter to the input matrix of floats. */
+	virtual Matrix_<float> *apply(const Matrix_<float> &input,
+			Matrix_<float> *result) const = 0;
+
+	/*! Returns the number of pixels on each side of an output pixel
+	 read from the input or -1 if the output depends on the whole input. */
+	virtual int getHalo() const {
+		return -1;
+	}
+
+	/*! Applies the filter computing the output only inside a region.
+	 The input must be valid in the region extended by getHalo() and
+	 clipped to the matrix, the output outside the region is undefined.
+	 By default, the whole output is computed. */
+	virtual Matrix_<double> *applyToRegion(const Matrix_<double> &input,
+			Matrix_<double> *result, const opencv::Rect &region) const {
+		return apply(input, result);
+	}
+
+	/*! Applies the filter to a region of the input matrix of floats. */
+	virtual Matrix_<float> *applyToRegion(const Matrix_<float> &input,
+			Matrix_<float> *result, const opencv::Rect &region) const {
+		return apply(input, result);
+	}
+
 	/*! Returns the filter info. */
 	inline const FilterInfo &getFilterInfo() const {
 		return *_filterInfo;
@@ -165,12 +204,32 @@ public:
 		Filter(new CGaussianFilterInfo(sigma2)) {
 		createGaussHorizontalKernel(sigma2);
 		createGaussVerticalKernel(sigma2);
+		_horizontalKernel.copyTo_<double, float> (_floatHorizontalKernel);
+		_verticalKernel.copyTo_<double, float> (_floatVerticalKernel);
 	}
 
 	/*! Applies the filter to the input matrix. */
 	virtual Matrix_<double> *apply(const Matrix_<double> &input,
 			Matrix_<double> *result) const;
 
+	/*! Applies the filter to the input matrix of floats. */
+	virtual Matrix_<float> *apply(const Matrix_<float> &input,
+			Matrix_<float> *result) const;
+
+	/*! Returns the radius of the kernels. */
+	virtual int getHalo() const {
+		return std::max(_horizontalKernel.nbCols(), _verticalKernel.nbRows())
+				/ 2;
+	}
+
+	/*! Applies the filter to a region of the input matrix. */
+	virtual Matrix_<double> *applyToRegion(const Matrix_<double> &input,
+			Matrix_<double> *result, const opencv::Rect &region) const;
+
+	/*! Applies the filter to a region of the input matrix of floats. */
+	virtual Matrix_<float> *applyToRegion(const Matrix_<float> &input,
+			Matrix_<float> *result, const opencv::Rect &region) const;
+
 	/*! Returns the filter info. */
 	const CGaussianFilterInfo *getFilterInfo() {
 		return reinterpret_cast<CGaussianFilterInfo *> (_filterInfo);
@@ -178,6 +237,13 @@ public:
 
 private:
 
+	/*! Applies the separable kernels to a region of a matrix of any precision. */
+	template<typename _T>
+	static Matrix_<_T> *applyToRegion(const Matrix_<_T> &input,
+			Matrix_<_T> *result, const opencv::Rect &region,
+			const Matrix_<_T> &verticalKernel,
+			const Matrix_<_T> &horizontalKernel);
+
 	/*! Creates vertical component of a separable Gaussian filter. */
 	void createGaussVerticalKernel(double sigma2);
 
@@ -192,6 +258,64 @@ private:
 	/*! Horizontal component of a separable Gaussian filter. */
 	Matrix_<double> _horizontalKernel;
 
+	/*! Vertical component of a separable Gaussian filter (floats). */
+	Matrix_<float> _floatVerticalKernel;
+
+	/*! Horizontal component of a separable Gaussian filter (floats). */
+	Matrix_<float> _floatHorizontalKernel;
+
+};
+
+/*!
+ * Gaussian filter implemented as a recursive (IIR) filter
+ * using the 4th order Deriche approximation. The cost per pixel
+ * does not depend on sigma. The borders are mirrored as those of
+ * CGaussianFilter.
+ */
+class CRecursiveGaussianFilter: public Filter {
+
+public:
+
+	/*! Constructor. */
+	CRecursiveGaussianFilter(double sigma2);
+
+	/*! Applies the filter to the input matrix. */
+	virtual Matrix_<double> *apply(const Matrix_<double> &input,
+			Matrix_<double> *result) const;
+
+	/*! Applies the filter to the input matrix of floats. */
+	virtual Matrix_<float> *apply(const Matrix_<float> &input,
+			Matrix_<float> *result) const;
+
+private:
+
+	/*! Applies the filter to a matrix of any precision. */
+	template<typename _T>
+	Matrix_<_T> *applyRecursive(const Matrix_<_T> &input,
+			Matrix_<_T> *result) const;
+
+	/*! Filters length samples of width values each into out, the sum
+	 of the causal and anti-causal parts. causal is a buffer of the
+	 same size. */
+	void filterLines(const double *in, double *causal, double *out,
+			int length, int width) const;
+
+private:
+
+	/*! Normalized coefficients of the inputs of the causal part. */
+	double _n[4];
+
+	/*! Normalized coefficients of the inputs of the anti-causal part. */
+	double _m[4];
+
+	/*! Feedback coefficients of both parts. */
+	double _d[4];
+
+	/*! Responses of the causal and anti-causal parts to a unit constant. */
+	double _causalGain, _antiCausalGain;
+
+	/*! Number of mirrored samples added at each end of a line. */
+	int _margin;
 };
 
 /*!
@@ -246,17 +370,44 @@ public:
 		Filter(new CCartesianFilterInfo(dx, dy)) {
 		createXKernel(dx);
 		createYKernel(dy);
+		if (_xKernel.nbCols())
+			_xKernel.copyTo_<double, float> (_floatXKernel);
+		if (_yKernel.nbRows())
+			_yKernel.copyTo_<double, float> (_floatYKernel);
 	}
 
 	/*! Applies the filter to the input matrix. */
 	virtual Matrix_<double> *apply(const Matrix_<double> &input,
 			Matrix_<double> *result) const;
 
+	/*! Applies the filter to the input matrix of floats. */
+	virtual Matrix_<float> *apply(const Matrix_<float> &input,
+			Matrix_<float> *result) const;
+
+	/*! The kernels have 3 taps. */
+	virtual int getHalo() const {
+		return 1;
+	}
+
 	/*! Returns the filter info. */
 	const CCartesianFilterInfo *getFilterInfo() {
 		return reinterpret_cast<CCartesianFilterInfo *> (_filterInfo);
 	}
 
+public:
+
+	/*! Computes several derivatives of the same input in a single sweep
+	 over the rows. The i-th output receives the derivative of order
+	 (dx[i], dy[i]) multiplied by factors[i], exactly as if the Cartesian
+	 filter was applied and the result scaled afterwards. Only the pixels
+	 inside the region are computed, the input must be valid in the region
+	 extended by one pixel. The outputs must have the size of the input.
+	 Orders of 1 and 2 are supported. Instantiated for double and float. */
+	template<typename _T>
+	static void applyFused(const Matrix_<_T> &input, int count,
+			const int *dx, const int *dy, const double *factors,
+			Matrix_<_T> **outputs, const opencv::Rect &region);
+
 private:
 
 	/*! Creates horizontal kernel. */
@@ -273,6 +424,12 @@ private:
 	/*! Vertical kernel. */
 	Matrix_<double> _yKernel;
 
+	/*! Horizontal kernel (floats). */
+	Matrix_<float> _floatXKernel;
+
+	/*! Vertical kernel (floats). */
+	Matrix_<float> _floatYKernel;
+
 };
 
 } // end namespace cv
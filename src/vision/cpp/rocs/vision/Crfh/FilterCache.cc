@@ -30,6 +30,7 @@
 //#include "global.h"
 #include "rocs/cv/Crfh/Filter.h"
 #include "rocs/cv/Crfh/FilterCache.h"
+#include "rocs/math/ElemMath.h"
 
 namespace rocs {
 namespace cv {
@@ -41,19 +42,52 @@ FilterCache::~FilterCache() {
 }
 
 // -----------------------------------------
-bool FilterCache::createFilter(const FilterInfo &filterInfo) {
+int FilterCache::createFilter(const FilterInfo &filterInfo) {
 	// Check if we don't have an identical filter in the cache
-	for (unsigned int i = 0; i < _filterList.size(); ++i)
-		if (_filterList[i]->getFilterInfo() == filterInfo)
-			return true;
+	int handle = getFilterHandle(filterInfo);
+	if (handle >= 0)
+		return handle;
 
-	// Create a new filter
-	Filter *filter = Filter::createFilter(filterInfo);
+	// Create a new filter, large Gaussians are recursive
+	Filter *filter = 0;
+	if ((filterInfo.getFilterType() == FT_GAUSSIAN)
+			&& (_recursiveGaussianSigma > 0)) {
+		double sigma2 =
+				static_cast<const CGaussianFilterInfo &> (filterInfo).getSigma2();
+		double minSigma = rocs::math::aMax<double>(_recursiveGaussianSigma,
+				RECURSIVE_GAUSSIAN_MIN_SIGMA);
+		if (sigma2 >= minSigma * minSigma)
+			filter = new CRecursiveGaussianFilter(sigma2);
+	}
+	if (!filter)
+		filter = Filter::createFilter(filterInfo);
 	if (filter) {
 		_filterList.push_back(filter);
-		return true;
+		return _filterList.size() - 1;
 	} else
-		return false;
+		return -1;
+}
+
+// -----------------------------------------
+int FilterCache::getFilterHandle(const FilterInfo &filterInfo) const {
+	for (unsigned int i = 0; i < _filterList.size(); ++i)
+		if (_filterList[i]->getFilterInfo() == filterInfo)
+			return i;
+	return -1;
+}
+
+// -----------------------------------------
+const Filter *FilterCache::findFilter(const FilterInfo &filterInfo) const {
+	/* Find the filter */
+	int handle = getFilterHandle(filterInfo);
+	if (handle >= 0) {
+		rocsDebug3("Filter found:%i", filterInfo.getFilterType());
+		return _filterList[handle];
+	}
+
+	/* Filter not found */
+	rocsDebug1("ERROR: filter not found");
+	return 0;
 }
 
 // -----------------------------------------
@@ -61,27 +95,56 @@ Matrix_<double> *FilterCache::applyFilter(const FilterInfo &filterInfo,
 		const Matrix_<double> &input, Matrix_<double> *result /* =0 */) const {
 	rocsDebug3("CFilterCache::applyFilter(%i, input:'%s')", filterInfo.getFilterType(), input.infoString().c_str());
 
-	/* Find the filter */
-	Filter *filter = 0;
-	for (unsigned int i = 0; (i < _filterList.size()) && (!filter); ++i) {
-		if (_filterList[i]->getFilterInfo() == filterInfo)
-			filter = _filterList[i];
-	}
+	const Filter *filter = findFilter(filterInfo);
+	if (!filter)
+		return result;
+
+	/* Apply the filter */
+	return filter->apply(input, result);
+}
+
+// -----------------------------------------
+Matrix_<float> *FilterCache::applyFilter(const FilterInfo &filterInfo,
+		const Matrix_<float> &input, Matrix_<float> *result) const {
+	rocsDebug3("CFilterCache::applyFilter(%i, float input:'%s')", filterInfo.getFilterType(), input.infoString().c_str());
 
-	/* Filter not found? */
-	if (!filter) {
-		rocsDebug1("ERROR: filter not found");
+	const Filter *filter = findFilter(filterInfo);
+	if (!filter)
 		return result;
-	}
-	else {
-		rocsDebug3("Filter found:%i", filter->getFilterInfo().getFilterType());
-	}
 
 	/* Apply the filter */
-	//debugPrintf_lvl3("result:%s", result->infoString().c_str());
-	result = filter->apply(input, result);
+	return filter->apply(input, result);
+}
+
+// -----------------------------------------
+Matrix_<double> *FilterCache::applyFilter(int handle,
+		const Matrix_<double> &input, Matrix_<double> *result /* =0 */) const {
+	return _filterList[handle]->apply(input, result);
+}
 
-	return result;
+// -----------------------------------------
+Matrix_<float> *FilterCache::applyFilter(int handle,
+		const Matrix_<float> &input, Matrix_<float> *result) const {
+	return _filterList[handle]->apply(input, result);
+}
+
+// -----------------------------------------
+Matrix_<double> *FilterCache::applyFilter(int handle,
+		const Matrix_<double> &input, Matrix_<double> *result,
+		const opencv::Rect &region) const {
+	return _filterList[handle]->applyToRegion(input, result, region);
+}
+
+// -----------------------------------------
+Matrix_<float> *FilterCache::applyFilter(int handle,
+		const Matrix_<float> &input, Matrix_<float> *result,
+		const opencv::Rect &region) const {
+	return _filterList[handle]->applyToRegion(input, result, region);
+}
+
+// -----------------------------------------
+int FilterCache::getFilterHalo(int handle) const {
+	return _filterList[handle]->getHalo();
 }
 
 } // end namespace cv
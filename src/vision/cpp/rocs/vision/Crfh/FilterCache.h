@@ -30,6 +30,8 @@
 #ifndef CFILTERCACHE_H_
 #define CFILTERCACHE_H_
 
+#include "rocs/math/Matrix_.h"
+
 #include <vector>
 
 namespace rocs {
@@ -37,19 +39,26 @@ namespace cv {
 
 //#include <QtCore/QList>
 
+/*! Default sigma above which Gaussian filters are implemented recursively,
+ 0 - never, the recursive filters are opt-in. */
+#define RECURSIVE_GAUSSIAN_DEFAULT_SIGMA 0
+
 class Filter;
 class FilterInfo;
 template<typename _T> class Matrix_;
 
 /*!
  * Class storing a cache of filters.
+ * Filters are created before any image is processed, the const
+ * methods only read the list and can be called concurrently.
  */
 class FilterCache {
 
 public:
 
 	/*! Default constructor. */
-	inline FilterCache() {
+	inline FilterCache() :
+		_recursiveGaussianSigma(RECURSIVE_GAUSSIAN_DEFAULT_SIGMA) {
 	}
 	;
 
@@ -58,19 +67,75 @@ public:
 
 public:
 
+	/*! Sets the sigma from which Gaussian filters created afterwards
+	 are implemented recursively instead of with an FIR kernel.
+	 The cost of a recursive filter does not depend on sigma.
+	 0 (the default) disables the recursive filters. */
+	inline void setRecursiveGaussianSigma(double sigma) {
+		_recursiveGaussianSigma = sigma;
+	}
+
+	/*! Returns the sigma from which Gaussian filters are recursive. */
+	inline double getRecursiveGaussianSigma() const {
+		return _recursiveGaussianSigma;
+	}
+
 	/*! Creates a new filter. If an identical filter already exists
-	 a new one will not be created. */
-	bool createFilter(const FilterInfo &filterInfo);
+	 a new one will not be created. Returns the handle of the filter
+	 or -1 if it could not be created. */
+	int createFilter(const FilterInfo &filterInfo);
+
+	/*! Returns the handle of the filter identified by the filterInfo
+	 or -1 if not found. The handle is valid for the lifetime of the cache. */
+	int getFilterHandle(const FilterInfo &filterInfo) const;
+
+	/*! Returns true if a filter identified by the filterInfo is in the cache. */
+	inline bool hasFilter(const FilterInfo &filterInfo) const {
+		return getFilterHandle(filterInfo) >= 0;
+	}
 
 	/*! Applies a filter identified by the filterInfo to the given matrix. */
 	Matrix_<double> *applyFilter(const FilterInfo &filterInfo, const Matrix_<
 			double> &input, Matrix_<double> *result = 0) const;
 
+	/*! Applies a filter identified by the filterInfo to the given matrix of floats. */
+	Matrix_<float> *applyFilter(const FilterInfo &filterInfo, const Matrix_<
+			float> &input, Matrix_<float> *result) const;
+
+	/*! Applies a filter with a given handle to the given matrix. */
+	Matrix_<double> *applyFilter(int handle,
+			const Matrix_<double> &input, Matrix_<double> *result = 0) const;
+
+	/*! Applies a filter with a given handle to the given matrix of floats. */
+	Matrix_<float> *applyFilter(int handle, const Matrix_<float> &input,
+			Matrix_<float> *result) const;
+
+	/*! Applies a filter with a given handle computing the output only
+	 inside a region (see Filter::applyToRegion()). */
+	Matrix_<double> *applyFilter(int handle, const Matrix_<double> &input,
+			Matrix_<double> *result, const opencv::Rect &region) const;
+
+	/*! Applies a filter with a given handle to a region of the given
+	 matrix of floats. */
+	Matrix_<float> *applyFilter(int handle, const Matrix_<float> &input,
+			Matrix_<float> *result, const opencv::Rect &region) const;
+
+	/*! Returns the halo of the filter with a given handle (see Filter::getHalo()). */
+	int getFilterHalo(int handle) const;
+
+private:
+
+	/*! Returns the filter identified by the filterInfo or 0 if not found. */
+	const Filter *findFilter(const FilterInfo &filterInfo) const;
+
 private:
 
 	/*! List storing pointers to filters. */
 	std::vector<Filter *> _filterList;
 
+	/*! Sigma from which Gaussian filters are recursive (0 - never). */
+	double _recursiveGaussianSigma;
+
 };
 
 } // end namespace cv
@@ -0,0 +1,184 @@
+// ==================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (C) 2010  Arnaud Ramey, Andrzej Pronobis
+//
+// This file is part of ROCS.
+//
+// ROCS is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation, either version 3
+// of the License, or (at your option) any later version.
+//
+// ROCS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ROCS. If not, see <http://www.gnu.org/licenses/>.
+// ==================================================================
+
+/*!
+ * \file HistogramAccumulator.cc
+ *
+ * Contains implementation of the HistogramAccumulator class.
+ *
+ * \author Andrzej Pronobis
+ */
+
+#include "rocs/cv/Crfh/HistogramAccumulator.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace rocs {
+namespace cv {
+
+/*! Returns the initial slot of a key in a hash table of a given size. */
+static inline unsigned long hashSlot(int key, unsigned long size) {
+	unsigned int h = static_cast<unsigned int> (key) * 2654435761u;
+	h ^= h >> 15;
+	return h & (size - 1);
+}
+
+// -----------------------------------------
+HistogramAccumulator::HistogramAccumulator(AccumulatorType type,
+		double binSpace, long samples) :
+	_type(type), _denseSize(0), _hashUsed(0) {
+	rocsDebug3("HistogramAccumulator(%i, %f, %li)", type, binSpace, samples);
+
+	// Choose the type. Scanning the dense array during flushing
+	// should not cost more than counting the samples.
+	if (_type == AT_AUTO) {
+		if ((binSpace <= CRFH_DENSE_ACCUMULATOR_MAX_BINS) && (binSpace <= 4.0
+				* samples))
+			_type = AT_DENSE;
+		else
+			_type = AT_HASH;
+	}
+	if ((_type == AT_DENSE) && (binSpace > CRFH_DENSE_ACCUMULATOR_MAX_BINS)) {
+		rocsDebug1("Bin space too large for a dense accumulator, using a hash table.");
+		_type = AT_HASH;
+	}
+
+	// Allocate memory
+	if (_type == AT_DENSE) {
+		_denseSize = static_cast<unsigned long> (binSpace);
+		_dense.assign(_denseSize, 0);
+	} else if (_type == AT_HASH) {
+		_hashKeys.resize(CRFH_HASH_ACCUMULATOR_INIT_SIZE);
+		_hashCounts.assign(CRFH_HASH_ACCUMULATOR_INIT_SIZE, 0);
+	}
+}
+
+// -----------------------------------------
+void HistogramAccumulator::increaseSparse(long index) {
+	// Key exactly as it would be stored in the FeatureList
+	int key = static_cast<int> (index);
+
+	if (_type == AT_MAP) {
+		_map.increase_if_found(key);
+		return;
+	}
+
+	// Samples outside of the dense array are rare, allocate lazily
+	if (_hashCounts.empty()) {
+		_hashKeys.resize(CRFH_HASH_ACCUMULATOR_INIT_SIZE);
+		_hashCounts.assign(CRFH_HASH_ACCUMULATOR_INIT_SIZE, 0);
+	}
+
+	// Linear probing
+	unsigned long size = _hashCounts.size();
+	unsigned long slot = hashSlot(key, size);
+	while (_hashCounts[slot] && (_hashKeys[slot] != key))
+		slot = (slot + 1) & (size - 1);
+
+	// New key, keep the load factor below 0.5
+	if (!_hashCounts[slot]) {
+		if (2 * (_hashUsed + 1) > size) {
+			growHash();
+			size = _hashCounts.size();
+			slot = hashSlot(key, size);
+			while (_hashCounts[slot])
+				slot = (slot + 1) & (size - 1);
+		}
+		_hashKeys[slot] = key;
+		++_hashUsed;
+	}
+
+	++_hashCounts[slot];
+}
+
+// -----------------------------------------
+void HistogramAccumulator::growHash() {
+	std::vector<int> oldKeys;
+	std::vector<unsigned int> oldCounts;
+	oldKeys.swap(_hashKeys);
+	oldCounts.swap(_hashCounts);
+
+	unsigned long size = 2 * oldCounts.size();
+	rocsDebug3("growHash(%lu)", size);
+	_hashKeys.resize(size);
+	_hashCounts.assign(size, 0);
+
+	for (unsigned long i = 0; i < oldCounts.size(); ++i)
+		if (oldCounts[i]) {
+			unsigned long slot = hashSlot(oldKeys[i], size);
+			while (_hashCounts[slot])
+				slot = (slot + 1) & (size - 1);
+			_hashKeys[slot] = oldKeys[i];
+			_hashCounts[slot] = oldCounts[i];
+		}
+}
+
+// -----------------------------------------
+void HistogramAccumulator::flushTo(FeatureList<int, double> &list) {
+	rocsDebug3("flushTo()");
+
+	if (_type == AT_MAP) {
+		list.swap(_map);
+		_map.clear();
+		_map._sum = 0;
+		_map._max = -1;
+		return;
+	}
+
+	// Move the hash table entries that fall into the dense range
+	// back to the dense array, collect the rest and sort it.
+	// The buffer keeps its memory between flushes.
+	std::vector<std::pair<int, unsigned int> > &sparse = _sparse;
+	sparse.clear();
+	sparse.reserve(_hashUsed);
+	for (unsigned long i = 0; i < _hashCounts.size(); ++i)
+		if (_hashCounts[i]) {
+			int key = _hashKeys[i];
+			if ((key >= 0) && (static_cast<unsigned long> (key) < _denseSize))
+				_dense[key] += _hashCounts[i];
+			else
+				sparse.push_back(std::make_pair(key, _hashCounts[i]));
+			_hashCounts[i] = 0;
+		}
+	_hashUsed = 0;
+	std::sort(sparse.begin(), sparse.end());
+
+	// Append the bins in the increasing order of keys:
+	// negative keys, dense range, keys above the dense range
+	unsigned long s = 0;
+	unsigned long used = sparse.size();
+	for (unsigned long i = 0; i < _denseSize; ++i)
+		if (_dense[i])
+			++used;
+	list.reserve(list.size() + used);
+	for (; (s < sparse.size()) && (sparse[s].first < 0); ++s)
+		list.append(sparse[s].first, sparse[s].second);
+	for (unsigned long i = 0; i < _denseSize; ++i)
+		if (_dense[i]) {
+			list.append(static_cast<int> (i), _dense[i]);
+			_dense[i] = 0;
+		}
+	for (; s < sparse.size(); ++s)
+		list.append(sparse[s].first, sparse[s].second);
+}
+
+} // end namespace cv
+} // end namespace rocs
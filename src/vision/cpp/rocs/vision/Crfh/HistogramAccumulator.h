@@ -0,0 +1,136 @@
+// ==================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (C) 2010  Arnaud Ramey, Andrzej Pronobis
+//
+// This file is part of ROCS.
+//
+// ROCS is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation, either version 3
+// of the License, or (at your option) any later version.
+//
+// ROCS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ROCS. If not, see <http://www.gnu.org/licenses/>.
+// ==================================================================
+
+/*!
+ * \file HistogramAccumulator.h
+ *
+ * \author Andrzej Pronobis
+ *
+ * Contains declaration of the HistogramAccumulator class.
+ */
+
+#ifndef CHISTOGRAMACCUMULATOR_H_
+#define CHISTOGRAMACCUMULATOR_H_
+
+#include "rocs/cv/FeatureList.h"
+
+#include <utility>
+#include <vector>
+
+namespace rocs {
+namespace cv {
+
+/*! Maximal size of the bin space for which a dense accumulator is used. */
+#define CRFH_DENSE_ACCUMULATOR_MAX_BINS (1 << 24)
+
+/*! Initial number of slots of the hash accumulator. Must be a power of 2. */
+#define CRFH_HASH_ACCUMULATOR_INIT_SIZE 4096
+
+enum AccumulatorType {
+	/*! Bins are counted directly in the sparse FeatureList. */
+	AT_MAP = 0,
+
+	/*! Bins are counted in a flat array indexed by the bin number. */
+	AT_DENSE,
+
+	/*! Bins are counted in an open-addressing hash table. */
+	AT_HASH,
+
+	/*! Dense or hash, depending on the size of the bin space. */
+	AT_AUTO
+};
+
+/*!
+ * Counts the number of samples falling into each bin of a histogram
+ * and converts the counts into a sparse FeatureList once all
+ * the samples were added.
+ */
+class HistogramAccumulator {
+
+public:
+
+	/*! Constructor.
+	 * \param type Type of the accumulator.
+	 * \param binSpace Number of bins in the histogram (product of the
+	 *        number of bins of all dimensions).
+	 * \param samples Expected number of samples, used by AT_AUTO.
+	 */
+	HistogramAccumulator(AccumulatorType type, double binSpace, long samples);
+
+public:
+
+	/*! Increases the counter of the bin with a given index. */
+	inline void increase(long index) {
+		if ((_type == AT_DENSE)
+				&& (static_cast<unsigned long> (index) < _denseSize))
+			++_dense[index];
+		else
+			increaseSparse(index);
+	}
+
+	/*! Moves the counts to the (empty) list and resets the accumulator.
+	 * The resulting list is identical to the one obtained by calling
+	 * FeatureList::increase_if_found() for every sample. */
+	void flushTo(FeatureList<int, double> &list);
+
+	/*! Returns the type of the accumulator actually used. */
+	inline AccumulatorType getType() const {
+		return _type;
+	}
+
+private:
+
+	/*! Counts a sample that does not fall into the dense array. */
+	void increaseSparse(long index);
+
+	/*! Doubles the size of the hash table. */
+	void growHash();
+
+private:
+
+	/*! Type of the accumulator (never AT_AUTO). */
+	AccumulatorType _type;
+
+	/*! Counters used by AT_MAP. */
+	FeatureList<int, double> _map;
+
+	/*! Counters used by AT_DENSE. */
+	std::vector<unsigned int> _dense;
+
+	/*! Size of the dense array. */
+	unsigned long _denseSize;
+
+	/*! Keys stored in the hash table (AT_HASH or AT_DENSE overflow). */
+	std::vector<int> _hashKeys;
+
+	/*! Counters stored in the hash table, 0 marks an empty slot. */
+	std::vector<unsigned int> _hashCounts;
+
+	/*! Number of used slots in the hash table. */
+	unsigned long _hashUsed;
+
+	/*! Buffer for the entries moved out of the hash table when flushing. */
+	std::vector<std::pair<int, unsigned int> > _sparse;
+};
+
+} // end namespace cv
+} // end namespace rocs
+
+#endif /* CHISTOGRAMACCUMULATOR_H_ */
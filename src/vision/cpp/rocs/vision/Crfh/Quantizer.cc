@@ -0,0 +1,243 @@
+// ==================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (C) 2010  Arnaud Ramey, Andrzej Pronobis
+//
+// This file is part of ROCS.
+//
+// ROCS is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation, either version 3
+// of the License, or (at your option) any later version.
+//
+// ROCS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ROCS. If not, see <http://www.gnu.org/licenses/>.
+// ==================================================================
+
+/*!
+ * \file Quantizer.cc
+ *
+ * Contains implementation of the Quantizer class.
+ *
+ * \author Andrzej Pronobis
+ */
+
+#include <limits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// The AVX kernel is compiled for its own target and chosen at runtime
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+	&& ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9)))
+#define QUANTIZER_AVX_DISPATCH
+#include <immintrin.h>
+#endif
+
+#include "rocs/cv/Crfh/DescriptorList.h"
+
+#include "rocs/cv/Crfh/Quantizer.h"
+
+namespace rocs {
+namespace cv {
+
+/*! Computes the bins (int)((row[j]-min)*factor) of one dimension
+ for the columns [begin, end). */
+template<typename _T>
+struct BinRowFunction {
+	typedef void (*Type)(const _T *row, int begin, int end, double min,
+			double factor, int *binRow);
+};
+
+/*! Portable kernel. */
+template<typename _T>
+static void binRowScalar(const _T *row, int begin, int end, double min,
+		double factor, int *binRow) {
+	for (int j = begin; j < end; ++j)
+		binRow[j] = (int) (((double) row[j] - min) * factor);
+}
+
+#if defined(__SSE2__)
+/*! Loads 2 values as doubles. */
+static inline __m128d loadPd(const double *p) {
+	return _mm_loadu_pd(p);
+}
+
+/*! Loads 2 values as doubles. */
+static inline __m128d loadPd(const float *p) {
+	return _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64(
+			reinterpret_cast<const __m128i *> (p))));
+}
+
+/*! SSE2 kernel, 2 values per iteration. The conversion truncates
+ towards zero exactly as the (int) cast does. */
+template<typename _T>
+static void binRowSse2(const _T *row, int begin, int end, double min,
+		double factor, int *binRow) {
+	const __m128d minVec = _mm_set1_pd(min);
+	const __m128d factorVec = _mm_set1_pd(factor);
+	int j = begin;
+	for (; j + 2 <= end; j += 2) {
+		__m128d v = loadPd(row + j);
+		__m128i bin = _mm_cvttpd_epi32(_mm_mul_pd(_mm_sub_pd(v, minVec),
+				factorVec));
+		_mm_storel_epi64(reinterpret_cast<__m128i *> (binRow + j), bin);
+	}
+	binRowScalar(row, j, end, min, factor, binRow);
+}
+#endif
+
+#if defined(QUANTIZER_AVX_DISPATCH)
+/*! Loads 4 values as doubles. */
+__attribute__((target("avx")))
+static inline __m256d loadPd4(const double *p) {
+	return _mm256_loadu_pd(p);
+}
+
+/*! Loads 4 values as doubles. */
+__attribute__((target("avx")))
+static inline __m256d loadPd4(const float *p) {
+	return _mm256_cvtps_pd(_mm_loadu_ps(p));
+}
+
+/*! AVX kernel, 4 values per iteration. */
+template<typename _T>
+__attribute__((target("avx")))
+static void binRowAvx(const _T *row, int begin, int end, double min,
+		double factor, int *binRow) {
+	const __m256d minVec = _mm256_set1_pd(min);
+	const __m256d factorVec = _mm256_set1_pd(factor);
+	int j = begin;
+	for (; j + 4 <= end; j += 4) {
+		__m256d v = loadPd4(row + j);
+		__m128i bin = _mm256_cvttpd_epi32(_mm256_mul_pd(_mm256_sub_pd(v,
+				minVec), factorVec));
+		_mm_storeu_si128(reinterpret_cast<__m128i *> (binRow + j), bin);
+	}
+	binRowScalar(row, j, end, min, factor, binRow);
+}
+#endif
+
+/*! Returns the fastest kernel supported by the processor. */
+template<typename _T>
+static typename BinRowFunction<_T>::Type selectBinRow() {
+#if defined(QUANTIZER_AVX_DISPATCH)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx"))
+		return binRowAvx<_T>;
+#endif
+#if defined(__SSE2__)
+	return binRowSse2<_T>;
+#else
+	return binRowScalar<_T>;
+#endif
+}
+
+/*! Returns the kernel selected on the first call. */
+template<typename _T>
+static typename BinRowFunction<_T>::Type binRowKernel() {
+	static const typename BinRowFunction<_T>::Type kernel =
+			selectBinRow<_T> ();
+	return kernel;
+}
+
+// -----------------------------------------
+Quantizer::Quantizer(const DescriptorList &descrList) {
+	assign(descrList);
+}
+
+// -----------------------------------------
+void Quantizer::assign(const DescriptorList &descrList) {
+	_min.clear();
+	_bins.clear();
+	_factors.clear();
+	for (unsigned int i = 0; i < descrList.size(); ++i) {
+		double min = descrList[i]->getMin();
+		double max = descrList[i]->getMax();
+		int bins = descrList[i]->getBins();
+		_min.push_back(min);
+		_bins.push_back(bins);
+		_factors.push_back(((double) bins
+				- std::numeric_limits<double>::epsilon()) / (max - min));
+	}
+}
+
+// -----------------------------------------
+bool Quantizer::matches(const DescriptorList &descrList) const {
+	if (descrList.size() != _bins.size())
+		return false;
+	for (unsigned int i = 0; i < descrList.size(); ++i) {
+		double min = descrList[i]->getMin();
+		double max = descrList[i]->getMax();
+		int bins = descrList[i]->getBins();
+		if ((min != _min[i]) || (bins != _bins[i]) || (_factors[i]
+				!= ((double) bins - std::numeric_limits<double>::epsilon())
+						/ (max - min)))
+			return false;
+	}
+	return true;
+}
+
+// -----------------------------------------
+double Quantizer::getBinSpace() const {
+	double binSpace = 1;
+	for (unsigned int i = 0; i < _bins.size(); ++i)
+		binSpace *= _bins[i];
+	return binSpace;
+}
+
+// -----------------------------------------
+void Quantizer::quantizeRow(const double * const *rows, int begin, int end,
+		int *binRow, long *indices) const {
+	quantizeRowImpl(binRowKernel<double> (), rows, begin, end, binRow,
+			indices);
+}
+
+// -----------------------------------------
+void Quantizer::quantizeRow(const float * const *rows, int begin, int end,
+		int *binRow, long *indices) const {
+	quantizeRowImpl(binRowKernel<float> (), rows, begin, end, binRow, indices);
+}
+
+// -----------------------------------------
+void Quantizer::quantizeRowScalar(const double * const *rows, int begin,
+		int end, int *binRow, long *indices) const {
+	quantizeRowImpl(binRowScalar<double>, rows, begin, end, binRow, indices);
+}
+
+// -----------------------------------------
+void Quantizer::quantizeRowScalar(const float * const *rows, int begin,
+		int end, int *binRow, long *indices) const {
+	quantizeRowImpl(binRowScalar<float>, rows, begin, end, binRow, indices);
+}
+
+// -----------------------------------------
+template<typename _T>
+void Quantizer::quantizeRowImpl(typename BinRowFunction<_T>::Type binRowFn,
+		const _T * const *rows, int begin, int end, int *binRow,
+		long *indices) const {
+	int ndims = _bins.size();
+
+	for (int k = ndims - 1; k >= 0; --k) {
+		// Bins of dimension k
+		binRowFn(rows[k], begin, end, _min[k], _factors[k], binRow);
+
+		// Combine with the bins of the previous dimensions
+		if (k == ndims - 1) {
+			for (int j = begin; j < end; ++j)
+				indices[j] = binRow[j];
+		} else {
+			const long bins = _bins[k];
+			for (int j = begin; j < end; ++j)
+				indices[j] = indices[j] * bins + binRow[j];
+		}
+	}
+}
+
+} // end namespace cv
+} // end namespace rocs
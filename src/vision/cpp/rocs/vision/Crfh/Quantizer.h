@@ -0,0 +1,128 @@
+// ==================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (C) 2010  Arnaud Ramey, Andrzej Pronobis
+//
+// This file is part of ROCS.
+//
+// ROCS is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation, either version 3
+// of the License, or (at your option) any later version.
+//
+// ROCS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ROCS. If not, see <http://www.gnu.org/licenses/>.
+// ==================================================================
+
+/*!
+ * \file Quantizer.h
+ *
+ * \author Andrzej Pronobis
+ *
+ * Contains declaration of the Quantizer class.
+ */
+
+#ifndef CQUANTIZER_H_
+#define CQUANTIZER_H_
+
+#include <vector>
+
+namespace rocs {
+namespace cv {
+
+class DescriptorList;
+template<typename _T> struct BinRowFunction;
+
+/*!
+ * Maps the outputs of all the descriptors of a system
+ * to the indices of the multi-dimensional histogram bins.
+ * The bin of dimension k is (int)((value-min[k])*factor[k]) and
+ * the index is obtained by combining the bins of all dimensions
+ * starting from the last one.
+ */
+class Quantizer {
+
+public:
+
+	/*! Constructor. Creates a quantizer without any dimension. */
+	Quantizer() {
+	}
+
+	/*! Constructor. Precomputes the quantization factors. */
+	Quantizer(const DescriptorList &descrList);
+
+public:
+
+	/*! Precomputes the quantization factors of another descriptor
+	 list, reusing the memory of the previous ones. */
+	void assign(const DescriptorList &descrList);
+
+	/*! Returns true if the quantizer was created for a descriptor
+	 list with the same ranges and numbers of bins. */
+	bool matches(const DescriptorList &descrList) const;
+
+	/*! Computes the bin indices of the pixels [begin, end) of a row.
+	 * \param rows Pointers to the row of each descriptor output.
+	 * \param begin First column.
+	 * \param end Column after the last one.
+	 * \param binRow Buffer of at least end ints used for the bins
+	 *        of a single dimension.
+	 * \param indices Buffer of at least end longs receiving the indices.
+	 */
+	void quantizeRow(const double * const *rows, int begin, int end,
+			int *binRow, long *indices) const;
+
+	/*! Computes the bin indices of the pixels [begin, end) of a row
+	 of single precision outputs. The values are converted to double
+	 before quantization. */
+	void quantizeRow(const float * const *rows, int begin, int end,
+			int *binRow, long *indices) const;
+
+	/*! Same as quantizeRow() using only the portable kernel. The
+	 vectorized kernel is chosen at runtime depending on the processor
+	 and must give exactly the same indices. */
+	void quantizeRowScalar(const double * const *rows, int begin, int end,
+			int *binRow, long *indices) const;
+
+	/*! Same as quantizeRow() using only the portable kernel. */
+	void quantizeRowScalar(const float * const *rows, int begin, int end,
+			int *binRow, long *indices) const;
+
+	/*! Returns the number of dimensions. */
+	inline int getDimensions() const {
+		return _bins.size();
+	}
+
+	/*! Returns the number of bins in the histogram (product
+	 of the number of bins of all the dimensions). */
+	double getBinSpace() const;
+
+private:
+
+	/*! Implementation of quantizeRow() for both precisions, computing
+	 the bins of each dimension with a given kernel. */
+	template<typename _T>
+	void quantizeRowImpl(typename BinRowFunction<_T>::Type binRowFn,
+			const _T * const *rows, int begin, int end, int *binRow,
+			long *indices) const;
+
+private:
+
+	/*! Minimal values of all dimensions. */
+	std::vector<double> _min;
+
+	/*! Scaling factors of all dimensions. */
+	std::vector<double> _factors;
+
+	/*! Number of bins of all dimensions. */
+	std::vector<int> _bins;
+};
+
+} // end namespace cv
+} // end namespace rocs
+
+#endif /* CQUANTIZER_H_ */
@@ -28,53 +28,351 @@
 #include "rocs/cv/Crfh/Filter.h"
 #include "rocs/cv/Crfh/ChannelCache.h"
 #include "rocs/cv/Crfh/FilterCache.h"
+#include "rocs/cv/Crfh/CrfhWorkspace.h"
 
 #include "rocs/cv/Crfh/ScaleSpaceCache.h"
 
+#include "rocs/core/ThreadPool.h"
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+#include <utility>
+
 namespace rocs {
 namespace cv {
 
+// -----------------------------------------
+ScaleSpaceCache::ScaleSpaceCache(const ChannelCache &channelCache,
+		const FilterCache &filterCache, bool incremental,
+		CrfhWorkspace *workspace) :
+	_channelCache(&channelCache), _filterCache(&filterCache),
+			_incremental(incremental), _workspace(workspace),
+			_regionsRequired(false) {
+	if (_workspace) {
+		_workspace->swapScaleSpaceLists(_scaleSpaceSamplesList, _order);
+		_scaleSpaceSamplesList.clear();
+		_order.clear();
+	}
+}
+
 // -----------------------------------------
 ScaleSpaceCache::~ScaleSpaceCache() {
-	for (unsigned int i = 0; i < _scaleSpaceSamplesList.size(); ++i)
+	if (_workspace) {
+		_workspace->swapScaleSpaceLists(_scaleSpaceSamplesList, _order);
+		return;
+	}
+	for (unsigned int i = 0; i < _scaleSpaceSamplesList.size(); ++i) {
 		delete _scaleSpaceSamplesList[i].matrix;
+		delete _scaleSpaceSamplesList[i].floatMatrix;
+	}
 }
 
 // -----------------------------------------
-void ScaleSpaceCache::createScaleSpaceSample(ChannelType channelType,
+int ScaleSpaceCache::createScaleSpaceSample(ChannelType channelType,
 		double scale) {
 	rocsDebug3("createScaleSpaceSample(%i, %f)", channelType, scale);
 
 	// Check if we don't have the sample in the cache
-	for (unsigned int i = 0; i < _scaleSpaceSamplesList.size(); ++i)
-		if ((_scaleSpaceSamplesList[i].channelType == channelType)
-				&& (_scaleSpaceSamplesList[i].scale == scale))
-			return;
+	int handle = findScaleSpaceSample(channelType, scale);
+	if (handle >= 0)
+		return handle;
 
-	// Create a new sample
+	// Register a new sample
 	ScaleSpaceSampleInfo sssi;
 	sssi.channelType = channelType;
 	sssi.scale = scale;
+	sssi.matrix = 0;
+	sssi.floatMatrix = 0;
+	sssi.computed = false;
+	sssi.base = -1;
+	sssi.filterHandle = -1;
+	sssi.incrementalBase = -1;
+	sssi.incrementalFilterHandle = -1;
+	sssi.directFilterHandle = -1;
 
-	CGaussianFilterInfo gfi(scale);
-	rocsDebug3("in:(%s)", (_channelCache->getChannel(
-							channelType))->infoString().c_str());
-	sssi.matrix = _filterCache->applyFilter(gfi, *(_channelCache->getChannel(
-			channelType)));
-
-	// Append sample to the list
+	// Append sample to the list, the order must be resolved again
 	_scaleSpaceSamplesList.push_back(sssi);
+	_order.clear();
+	return _scaleSpaceSamplesList.size() - 1;
 }
 
 // -----------------------------------------
-const Matrix_<double> *ScaleSpaceCache::getScaleSpaceSample(
-		ChannelType channelType, double scale) const {
+void ScaleSpaceCache::createScaleSpaceSamples(const ScaleSpaceCache &layout) {
+	_scaleSpaceSamplesList.reserve(layout._scaleSpaceSamplesList.size());
+	for (unsigned int i = 0; i < layout._scaleSpaceSamplesList.size(); ++i) {
+		ScaleSpaceSampleInfo sssi = layout._scaleSpaceSamplesList[i];
+		sssi.matrix = 0;
+		sssi.floatMatrix = 0;
+		sssi.computed = false;
+		sssi.region = opencv::Rect();
+		sssi.base = (_incremental) ? sssi.incrementalBase : -1;
+		sssi.filterHandle = (_incremental) ? sssi.incrementalFilterHandle
+				: sssi.directFilterHandle;
+		_scaleSpaceSamplesList.push_back(sssi);
+	}
+	_order = layout._order;
+}
+
+// -----------------------------------------
+void ScaleSpaceCache::resolveScaleSpaceSamples() {
+	// Order the samples by scale
+	vector<std::pair<double, int> > order;
+	for (unsigned int i = 0; i < _scaleSpaceSamplesList.size(); ++i)
+		order.push_back(std::make_pair(_scaleSpaceSamplesList[i].scale, i));
+	std::sort(order.begin(), order.end());
+
+	_order.clear();
+	for (unsigned int k = 0; k < order.size(); ++k)
+		_order.push_back(order[k].second);
+
+	for (unsigned int k = 0; k < _order.size(); ++k) {
+		ScaleSpaceSampleInfo &sssi = _scaleSpaceSamplesList[_order[k]];
+		sssi.directFilterHandle = _filterCache->getFilterHandle(
+				CGaussianFilterInfo(sssi.scale));
+
+		// Incrementally, start from the largest smaller scale of
+		// the same channel for which the residual filter exists
+		sssi.incrementalBase = -1;
+		sssi.incrementalFilterHandle = -1;
+		for (int l = k - 1; l >= 0; --l) {
+			const ScaleSpaceSampleInfo &prev = _scaleSpaceSamplesList[_order[l]];
+			if ((prev.channelType != sssi.channelType)
+					|| (prev.incrementalFilterHandle < 0))
+				continue;
+			sssi.incrementalFilterHandle = _filterCache->getFilterHandle(
+					CGaussianFilterInfo(sssi.scale - prev.scale));
+			if (sssi.incrementalFilterHandle >= 0) {
+				sssi.incrementalBase = _order[l];
+				break;
+			}
+		}
+		if (sssi.incrementalFilterHandle < 0)
+			sssi.incrementalFilterHandle = sssi.directFilterHandle;
+
+		sssi.base = (_incremental) ? sssi.incrementalBase : -1;
+		sssi.filterHandle = (_incremental) ? sssi.incrementalFilterHandle
+				: sssi.directFilterHandle;
+	}
+}
+
+// -----------------------------------------
+void ScaleSpaceCache::requireRegion(int handle, const opencv::Rect &region) {
+	opencv::Rect &sampleRegion = _scaleSpaceSamplesList[handle].region;
+	if (sampleRegion.area() > 0)
+		sampleRegion |= region;
+	else
+		sampleRegion = region;
+	_regionsRequired = true;
+}
+
+// -----------------------------------------
+void ScaleSpaceCache::getSupportRadii(bool incremental, vector<int> &radii) const {
+	// Add up the halos of the filters along the resolved bases
+	radii.assign(_scaleSpaceSamplesList.size(), 0);
+	for (unsigned int k = 0; k < _order.size(); ++k) {
+		const ScaleSpaceSampleInfo &sssi = _scaleSpaceSamplesList[_order[k]];
+		int base = (incremental) ? sssi.incrementalBase : -1;
+		int filterHandle = (incremental) ? sssi.incrementalFilterHandle
+				: sssi.directFilterHandle;
+		if (filterHandle < 0)
+			continue;
+
+		int halo = _filterCache->getFilterHalo(filterHandle);
+		int baseRadius = (base >= 0) ? radii[base] : 0;
+		radii[_order[k]] = ((halo < 0) || (baseRadius < 0)) ? -1 : halo
+				+ baseRadius;
+	}
+}
+
+/*! Returns the matrix of a sample of a given precision. */
+static inline Matrix_<double> *&sampleMatrix(ScaleSpaceSampleInfo &sssi,
+		double) {
+	return sssi.matrix;
+}
+
+/*! Returns the matrix of a sample of a given precision. */
+static inline Matrix_<float> *&sampleMatrix(ScaleSpaceSampleInfo &sssi,
+		float) {
+	return sssi.floatMatrix;
+}
+
+// -----------------------------------------
+void ScaleSpaceCache::computeScaleSpaceSamples(core::ThreadPool *threadPool) {
+	if (_channelCache->getPrecision() == PT_FLOAT)
+		computeScaleSpaceSamples<float> (threadPool);
+	else
+		computeScaleSpaceSamples<double> (threadPool);
+}
+
+// -----------------------------------------
+template<typename _T>
+void ScaleSpaceCache::computeScaleSpaceSamples(core::ThreadPool *threadPool) {
+	// Take the matrices from the workspace before the tasks start
+	if (_workspace)
+		for (unsigned int i = 0; i < _scaleSpaceSamplesList.size(); ++i) {
+			ScaleSpaceSampleInfo &sssi = _scaleSpaceSamplesList[i];
+			if (sssi.computed)
+				continue;
+			const Matrix_<_T> *channel = _channelCache->getChannel<_T> (
+					sssi.channelType);
+			sampleMatrix(sssi, _T()) = _workspace->getMatrix<_T> (
+					CrfhWorkspace::BT_SCALE_SPACE, i, channel->nbRows(),
+					channel->nbCols());
+		}
+
+	// Samples registered without a layout are resolved here
+	if (_order.size() != _scaleSpaceSamplesList.size())
+		resolveScaleSpaceSamples();
+	const vector<int> &indices = _order;
+
+	// Restrict the bases to what the required regions need
+	const Matrix_<_T> *channel = _channelCache->getChannel<_T> (
+			_scaleSpaceSamplesList.empty() ? CT_L
+					: _scaleSpaceSamplesList[0].channelType);
+	if ((_regionsRequired) && (channel))
+		propagateRegions(channel->nbRows(), channel->nbCols());
+
+	if (!threadPool) {
+		computeScaleSpaceChain<_T> (indices);
+		return;
+	}
+
+	// The list is not modified from now on, the tasks only write
+	// the matrices of their own samples. Incremental samples of
+	// one channel depend on each other and are computed by one task.
+	if (_incremental) {
+		vector<ChannelType> channels;
+		for (unsigned int k = 0; k < indices.size(); ++k) {
+			ChannelType channelType =
+					_scaleSpaceSamplesList[indices[k]].channelType;
+			if (std::find(channels.begin(), channels.end(), channelType)
+					!= channels.end())
+				continue;
+			channels.push_back(channelType);
+
+			vector<int> chain;
+			for (unsigned int l = k; l < indices.size(); ++l)
+				if (_scaleSpaceSamplesList[indices[l]].channelType
+						== channelType)
+					chain.push_back(indices[l]);
+			threadPool->schedule(boost::bind(
+					&ScaleSpaceCache::computeScaleSpaceChain<_T>, this, chain));
+		}
+	} else {
+		for (unsigned int k = 0; k < indices.size(); ++k)
+			threadPool->schedule(boost::bind(
+					&ScaleSpaceCache::computeScaleSpaceChain<_T>, this,
+					vector<int> (1, indices[k])));
+	}
+	threadPool->wait();
+}
+
+// -----------------------------------------
+void ScaleSpaceCache::propagateRegions(int rows, int cols) {
+	opencv::Rect whole(0, 0, cols, rows);
+
+	// Propagate the regions from the largest scales down to
+	// the bases, extended by the halos of the filters
+	for (int k = _order.size() - 1; k >= 0; --k) {
+		ScaleSpaceSampleInfo &sssi = _scaleSpaceSamplesList[_order[k]];
+		sssi.region &= whole;
+		if ((sssi.computed) || (sssi.base < 0) || (sssi.region.area() == 0))
+			continue;
+
+		int halo = _filterCache->getFilterHalo(sssi.filterHandle);
+		opencv::Rect baseRegion = (halo < 0) ? whole : (expandRegion(
+				sssi.region, halo) & whole);
+		opencv::Rect &region = _scaleSpaceSamplesList[sssi.base].region;
+		if (region.area() > 0)
+			region |= baseRegion;
+		else
+			region = baseRegion;
+	}
+}
+
+// -----------------------------------------
+template<typename _T>
+void ScaleSpaceCache::computeScaleSpaceChain(const vector<int> &indices) {
+	for (unsigned int k = 0; k < indices.size(); ++k) {
+		ScaleSpaceSampleInfo &sssi = _scaleSpaceSamplesList[indices[k]];
+		if (sssi.computed)
+			continue;
+		if (sssi.filterHandle < 0) {
+			rocsDebug1("ERROR: filter not found");
+			continue;
+		}
+
+		// Smooth the base sample or the channel
+		const Matrix_<_T> *input = (sssi.base >= 0) ? sampleMatrix(
+				_scaleSpaceSamplesList[sssi.base], _T())
+				: _channelCache->getChannel<_T> (sssi.channelType);
+		opencv::Rect whole(0, 0, input->nbCols(), input->nbRows());
+
+		rocsDebug3("computeScaleSpaceSample(%i, %f), base:%i", sssi.channelType, sssi.scale, sssi.base);
+		if ((!_regionsRequired) || (sssi.region == whole))
+			sampleMatrix(sssi, _T()) = _filterCache->applyFilter(
+					sssi.filterHandle, *input, sampleMatrix(sssi, _T()));
+		else if (sssi.region.area() > 0)
+			sampleMatrix(sssi, _T()) = _filterCache->applyFilter(
+					sssi.filterHandle, *input, sampleMatrix(sssi, _T()),
+					sssi.region);
+		else
+			continue;
+		sssi.computed = true;
+	}
+}
+
+// -----------------------------------------
+void ScaleSpaceCache::createResidualFilters(vector<double> scales,
+		FilterCache &filterCache) {
+	std::sort(scales.begin(), scales.end());
+	for (unsigned int i = 1; i < scales.size(); ++i)
+		if (scales[i] != scales[i - 1]) {
+			CGaussianFilterInfo gfi(scales[i] - scales[i - 1]);
+			filterCache.createFilter(gfi);
+		}
+}
+
+// -----------------------------------------
+int ScaleSpaceCache::findScaleSpaceSample(ChannelType channelType,
+		double scale) const {
 	for (unsigned int i = 0; i < _scaleSpaceSamplesList.size(); ++i)
 		if ((_scaleSpaceSamplesList[i].channelType == channelType)
 				&& (_scaleSpaceSamplesList[i].scale == scale))
-			return _scaleSpaceSamplesList[i].matrix;
+			return i;
+
+	return -1;
+}
+
+// -----------------------------------------
+template<>
+const Matrix_<double> *ScaleSpaceCache::getScaleSpaceSample<double>(
+		ChannelType channelType, double scale) const {
+	int i = findScaleSpaceSample(channelType, scale);
+	return (i >= 0) ? _scaleSpaceSamplesList[i].matrix : 0;
+}
+
+// -----------------------------------------
+template<>
+const Matrix_<float> *ScaleSpaceCache::getScaleSpaceSample<float>(
+		ChannelType channelType, double scale) const {
+	int i = findScaleSpaceSample(channelType, scale);
+	return (i >= 0) ? _scaleSpaceSamplesList[i].floatMatrix : 0;
+}
 
-	return 0;
+// -----------------------------------------
+template<>
+const Matrix_<double> *ScaleSpaceCache::getScaleSpaceSample<double>(
+		int handle) const {
+	return _scaleSpaceSamplesList[handle].matrix;
+}
+
+// -----------------------------------------
+template<>
+const Matrix_<float> *ScaleSpaceCache::getScaleSpaceSample<float>(
+		int handle) const {
+	return _scaleSpaceSamplesList[handle].floatMatrix;
 }
 
 } // end namespace cv
@@ -31,13 +31,20 @@
 #define CSCALESPACECACHE_H_
 
 #include "rocs/cv/Crfh/ChannelCache.h"
+#include "rocs/math/Matrix_.h"
 #include <vector>
 using std::vector;
 
 namespace rocs {
+
+namespace core {
+class ThreadPool;
+}
+
 namespace cv {
 
 class FilterCache;
+class CrfhWorkspace;
 template<typename _T> class Matrix_;
 
 /*!
@@ -47,6 +54,23 @@ struct ScaleSpaceSampleInfo {
 	ChannelType channelType;
 	double scale;
 	Matrix_<double> *matrix;
+	Matrix_<float> *floatMatrix;
+	bool computed;
+
+	/*! Sample from which this one is computed (-1 - the channel) and
+	 the handle of the filter (-1 - not found). */
+	int base;
+	int filterHandle;
+
+	/*! Base and filter used when the sample is computed incrementally
+	 and the filter smoothing the channel, resolved once for a layout. */
+	int incrementalBase;
+	int incrementalFilterHandle;
+	int directFilterHandle;
+
+	/*! Region that must be computed, empty if the sample is not needed.
+	 Used only if regions were requested. */
+	opencv::Rect region;
 };
 
 /*!
@@ -56,27 +80,101 @@ class ScaleSpaceCache {
 
 public:
 
-	/*! Default constructor. */
-	inline ScaleSpaceCache(const ChannelCache &channelCache,
-			const FilterCache &filterCache) :
-		_channelCache(&channelCache), _filterCache(&filterCache) {
+	/*! Default constructor. If incremental is true, each sample is
+	 obtained by smoothing the sample of the next smaller scale with
+	 the residual Gaussian (the variances add up) instead of smoothing
+	 the channel from scratch. If a workspace is given, the samples
+	 and the lists describing them are stored in its buffers instead
+	 of being allocated. */
+	ScaleSpaceCache(const ChannelCache &channelCache,
+			const FilterCache &filterCache, bool incremental = false,
+			CrfhWorkspace *workspace = 0);
+
+	/*! Constructor of a cache only registering the samples, used to
+	 resolve the handles of the samples when a system is built. The
+	 samples of such a cache cannot be computed. */
+	inline ScaleSpaceCache(const FilterCache &filterCache) :
+		_channelCache(0), _filterCache(&filterCache), _incremental(false),
+				_workspace(0), _regionsRequired(false) {
 	}
 	;
 
-	/*! Destructor. Deletes all the scale-space samples. */
+	/*! Destructor. Deletes all the scale-space samples not owned
+	 by the workspace and gives the lists back to the workspace. */
 	~ScaleSpaceCache();
 
 public:
 
-	/*! Creates a sample of the scale-space obtained from a given
+	/*! Requests a sample of the scale-space obtained from a given
 	 channel. If an identical sample already exists a new one will
-	 not be created. */
-	void createScaleSpaceSample(ChannelType channelType, double scale);
-
-	/*! Returns a pointer to a matrix containing pixels of the scale-space sample. */
-	const Matrix_<double>
+	 not be created. The sample is computed by computeScaleSpaceSamples().
+	 Returns the handle of the sample, i.e. its position in the cache. */
+	int createScaleSpaceSample(ChannelType channelType, double scale);
+
+	/*! Requests the same samples, with the same handles, as those
+	 registered in another cache and takes their resolved base samples
+	 and filters. Must be called on an empty cache. */
+	void createScaleSpaceSamples(const ScaleSpaceCache &layout);
+
+	/*! Orders the registered samples by scale and resolves for each
+	 of them the base sample and the filter, both for the direct and
+	 the incremental computation. Must be called on a layout cache
+	 once all the filters are created, so that the caches created
+	 from the layout do not look the filters up for each image. */
+	void resolveScaleSpaceSamples();
+
+	/*! Requests that the sample with a given handle is valid at least
+	 in a given region. Once a region was requested for any sample,
+	 the samples are computed only inside the regions needed by
+	 the requests, including the halos of the filters computing
+	 the samples from each other. */
+	void requireRegion(int handle, const opencv::Rect &region);
+
+	/*! Returns for each registered sample the distance in pixels from
+	 which the pixels of the channel influence it, the sum of the halos
+	 of the filters computing the sample, -1 if it depends on the whole
+	 channel (recursive filter). The samples must be resolved. */
+	void getSupportRadii(bool incremental, vector<int> &radii) const;
+
+	/*! Computes all the requested samples in the increasing order of scale.
+	 If a thread pool is given, independent samples are computed
+	 concurrently. */
+	void computeScaleSpaceSamples(core::ThreadPool *threadPool = 0);
+
+	/*! Creates in the filter cache the Gaussian filters required to
+	 compute the samples of given scales incrementally. */
+	static void createResidualFilters(vector<double> scales,
+			FilterCache &filterCache);
+
+	/*! Returns a pointer to a matrix containing pixels of the scale-space sample.
+	 _T must match the precision of the channel cache. The sample is
+	 searched for, the descriptors use the handles instead. */
+	template<typename _T>
+	const Matrix_<_T>
 			*getScaleSpaceSample(ChannelType channelType, double scale) const;
 
+	/*! Returns a pointer to a matrix containing pixels of the sample
+	 with a given handle. _T must match the precision of the channel cache. */
+	template<typename _T>
+	const Matrix_<_T> *getScaleSpaceSample(int handle) const;
+
+private:
+
+	/*! Returns the index of the sample in the list or -1. */
+	int findScaleSpaceSample(ChannelType channelType, double scale) const;
+
+	/*! Computes all the requested samples of a given precision. */
+	template<typename _T>
+	void computeScaleSpaceSamples(core::ThreadPool *threadPool);
+
+	/*! Propagates the required regions from each sample to its base. */
+	void propagateRegions(int rows, int cols);
+
+	/*! Computes the samples with given indices one after another.
+	 The indices must be ordered by scale. */
+	template<typename _T>
+	void computeScaleSpaceChain(const vector<int> &indices);
+
 private:
 
 	/*! Pointer to the channel cache. */
@@ -85,11 +183,39 @@ private:
 	/*! Pointer to the filter cache. */
 	const FilterCache *_filterCache;
 
+	/*! If true, samples are computed from samples of smaller scales. */
+	bool _incremental;
+
+	/*! Workspace owning the samples or null. */
+	CrfhWorkspace *_workspace;
+
+	/*! Are the samples computed only inside the required regions. */
+	bool _regionsRequired;
+
 	/*! List storing information about samples. */
 	vector<ScaleSpaceSampleInfo> _scaleSpaceSamplesList;
 
+	/*! Handles of the samples ordered by scale, empty until resolved. */
+	vector<int> _order;
+
 };
 
+template<>
+const Matrix_<double> *ScaleSpaceCache::getScaleSpaceSample<double>(
+		ChannelType channelType, double scale) const;
+
+template<>
+const Matrix_<float> *ScaleSpaceCache::getScaleSpaceSample<float>(
+		ChannelType channelType, double scale) const;
+
+template<>
+const Matrix_<double> *ScaleSpaceCache::getScaleSpaceSample<double>(
+		int handle) const;
+
+template<>
+const Matrix_<float> *ScaleSpaceCache::getScaleSpaceSample<float>(
+		int handle) const;
+
 } // end namespace cv
 } // end namespace rocs
 
@@ -33,20 +33,49 @@
 
 #include "rocs/cv/Crfh/System.h"
 #include "rocs/core/utils.h"
+#include "rocs/core/ThreadPool.h"
+
+#include <boost/thread/mutex.hpp>
 
 namespace rocs {
 namespace cv {
 
 //using rocs::math::Matrix_;
 
+/*! Identifier of the last created system and its lock. */
+static long lastSystemId = 0;
+static boost::mutex lastSystemIdMutex;
+
 // -----------------------------------------
-System::System(string sysDef) {
+System::System(string sysDef) :
+	_scaleSpaceLayout(_filterCache), _accumulatorType(AT_AUTO),
+			_precision(PT_DOUBLE), _incrementalScaleSpace(false),
+			_fusedDerivatives(true), _restrictToRegion(true), _id(newId()) {
 	rocsDebug3("System::System('%s')", sysDef.c_str());
 	build(sysDef);
 }
 
+// -----------------------------------------
+System::System(const System &system) :
+	_scaleSpaceLayout(_filterCache),
+			_accumulatorType(system._accumulatorType),
+			_precision(system._precision),
+			_incrementalScaleSpace(system._incrementalScaleSpace),
+			_fusedDerivatives(system._fusedDerivatives),
+			_restrictToRegion(system._restrictToRegion), _id(newId()) {
+	rocsDebug3("System::System(copy of '%s')", system._sysDef.c_str());
+	_filterCache.setRecursiveGaussianSigma(
+			system._filterCache.getRecursiveGaussianSigma());
+	if (!system._sysDef.empty())
+		build(system._sysDef);
+	if (system._threadPool)
+		setNumThreads(system._threadPool->getNbThreads());
+}
+
+// -----------------------------------------
 void System::build(string sysDef) {
 	rocsDebug3("System::build('%s')", sysDef.c_str());
+	_sysDef += (_sysDef.empty() ? "" : "+") + sysDef;
 
 	// Extract tokens
 	//stringList tokens = sysDef.split('+');
@@ -78,9 +107,31 @@ void System::build(string sysDef) {
 	// Create filters
 	_descriptorList.createAllRequiredFilters(_filterCache);
 
+	// Resolve the handles of the scale-space samples
+	_descriptorList.createAllRequiredScales(_scaleSpaceLayout);
+	_descriptorList.createDerivativeGroups(_fusedDerivatives);
+
+	// Create filters smoothing between consecutive scales
+	vector<double> scales;
+	for (unsigned int i = 0; i < _descriptorList.size(); ++i)
+		scales.push_back(_descriptorList[i]->getScale());
+	ScaleSpaceCache::createResidualFilters(scales, _filterCache);
+
+	// Resolve the bases and the filters of the samples once for all images
+	_scaleSpaceLayout.resolveScaleSpaceSamples();
+
 	rocsDebug3("System now initialized.");
 }
 
+// -----------------------------------------
+void System::setNumThreads(int numThreads) {
+	rocsDebug3("System::setNumThreads(%i)", numThreads);
+	if (numThreads > 1)
+		_threadPool.reset(new core::ThreadPool(numThreads));
+	else
+		_threadPool.reset();
+}
+
 // -----------------------------------------
 vector<math::Matrix_<double> *> System::computeDescriptorOutputs(const Img &image) const {
 	// Create channel cache
@@ -88,21 +139,252 @@ vector<math::Matrix_<double> *> System::computeDescriptorOutputs(const Img &imag
 	_descriptorList.createAllRequiredChannels(channelCache);
 
 	// Create scale-space cache
-	ScaleSpaceCache scaleSpaceCache(channelCache, _filterCache);
-	_descriptorList.createAllRequiredScales(scaleSpaceCache);
+	ScaleSpaceCache scaleSpaceCache(channelCache, _filterCache,
+			_incrementalScaleSpace);
+	scaleSpaceCache.createScaleSpaceSamples(_scaleSpaceLayout);
+	scaleSpaceCache.computeScaleSpaceSamples(_threadPool.get());
+
+	// Apply the descriptors
+	return _descriptorList.applyAll(channelCache, scaleSpaceCache, _filterCache,
+			_threadPool.get());
+}
+
+// -----------------------------------------
+void System::computeDescriptorOutputs(const Img &image,
+		vector<math::Matrix_<float> *> &outputs) const {
+	// Create channel cache
+	ChannelCache channelCache(image, PT_FLOAT);
+	_descriptorList.createAllRequiredChannels(channelCache);
+
+	// Create scale-space cache
+	ScaleSpaceCache scaleSpaceCache(channelCache, _filterCache,
+			_incrementalScaleSpace);
+	scaleSpaceCache.createScaleSpaceSamples(_scaleSpaceLayout);
+	scaleSpaceCache.computeScaleSpaceSamples(_threadPool.get());
 
 	// Apply the descriptors
-	return _descriptorList.applyAll(channelCache, scaleSpaceCache, _filterCache);
+	_descriptorList.applyAll(channelCache, scaleSpaceCache, _filterCache,
+			outputs, _threadPool.get());
+}
+
+// -----------------------------------------
+long System::newId() {
+	boost::mutex::scoped_lock lock(lastSystemIdMutex);
+	return ++lastSystemId;
+}
+
+// -----------------------------------------
+CrfhWorkspace &System::threadWorkspace() const {
+	// A workspace left by a system destroyed at the same address
+	// belongs to another system and is replaced
+	ThreadWorkspace *current = _workspaces.get();
+	if ((!current) || (current->owner != _id)) {
+		current = new ThreadWorkspace();
+		current->owner = _id;
+		_workspaces.reset(current);
+	}
+	return current->workspace;
 }
 
 // -----------------------------------------
 Crfh *System::computeHistogram(const Img &image, int skipBorderPixels) const {
+	return computeHistogram(image, skipBorderPixels, threadWorkspace());
+}
+
+// -----------------------------------------
+Crfh *System::computeHistogram(const Img &image, int skipBorderPixels,
+		CrfhWorkspace &workspace) const {
 	rocsDebug3("computeHistogram('%s', %i)", image.infoString().c_str(), skipBorderPixels);
-	vector<math::Matrix_<double> *> outputs = computeDescriptorOutputs(image);
-	Crfh *crfh = new Crfh(outputs, _descriptorList, skipBorderPixels);
+	Crfh *histogram = new Crfh();
+	computeHistogram(image, skipBorderPixels, *histogram, workspace);
+	return histogram;
+}
+
+// -----------------------------------------
+void System::computeHistogram(const Img &image, int skipBorderPixels,
+		Crfh &histogram) const {
+	computeHistogram(image, skipBorderPixels, histogram, threadWorkspace());
+}
+
+// -----------------------------------------
+void System::computeHistogram(const Img &image, int skipBorderPixels,
+		Crfh &histogram, CrfhWorkspace &workspace) const {
+	if (_precision == PT_FLOAT)
+		computeHistogramWith<float> (image, skipBorderPixels, histogram,
+				workspace);
+	else
+		computeHistogramWith<double> (image, skipBorderPixels, histogram,
+				workspace);
+}
+
+// -----------------------------------------
+template<typename _T>
+void System::computeHistogramWith(const Img &image, int skipBorderPixels,
+		Crfh &histogram, CrfhWorkspace &workspace) const {
+	vector<math::Matrix_<_T> *> &outputs = computeOutputsWith<_T> (image,
+			skipBorderPixels, workspace);
+	histogram.assign(outputs, _descriptorList, skipBorderPixels,
+			_accumulatorType, &workspace);
+}
+
+// -----------------------------------------
+template<typename _T>
+vector<math::Matrix_<_T> *> &System::computeOutputsWith(const Img &image,
+		int skipBorderPixels, CrfhWorkspace &workspace) const {
+	// Create channel cache
+	ChannelCache channelCache(image, _precision, &workspace);
+	_descriptorList.createAllRequiredChannels(channelCache);
+
+	// Create scale-space cache
+	ScaleSpaceCache scaleSpaceCache(channelCache, _filterCache,
+			_incrementalScaleSpace, &workspace);
+	scaleSpaceCache.createScaleSpaceSamples(_scaleSpaceLayout);
+
+	// Only the pixels outside of the skipped border are counted,
+	// compute the samples there and in the halos of the filters
+	int rows = image.nbRows();
+	int cols = image.nbCols();
+	opencv::Rect region(skipBorderPixels, skipBorderPixels, cols - 2
+			* skipBorderPixels, rows - 2 * skipBorderPixels);
+	bool restricted = (_restrictToRegion) && (skipBorderPixels > 0)
+			&& (region.width > 0) && (region.height > 0);
+	if (restricted)
+		_descriptorList.requireAllRegions(scaleSpaceCache, region);
+	scaleSpaceCache.computeScaleSpaceSamples(_threadPool.get());
+
+	// Apply the descriptors, writing to the outputs of the workspace
+	vector<math::Matrix_<_T> *> &outputs = workspace.getOutputList<_T> (
+			_descriptorList.size());
 	for (unsigned int i = 0; i < outputs.size(); ++i)
-		delete outputs[i];
-	return crfh;
+		outputs[i] = workspace.getMatrix<_T> (CrfhWorkspace::BT_OUTPUT, i,
+				rows, cols);
+	if (!outputs.empty())
+		_descriptorList.applyAllTo(channelCache, scaleSpaceCache,
+				_filterCache, &outputs[0], _threadPool.get(),
+				(restricted) ? &region : 0);
+	return outputs;
+}
+
+// -----------------------------------------
+void System::computeGridHistograms(const Img &image, int skipBorderPixels,
+		int gridRows, int gridCols, vector<Crfh *> &histograms) const {
+	rocsDebug3("computeGridHistograms('%s', %i, %ix%i)", image.infoString().c_str(), skipBorderPixels, gridRows, gridCols);
+	if (_precision == PT_FLOAT)
+		computeGridHistogramsWith<float> (image, skipBorderPixels, gridRows,
+				gridCols, histograms);
+	else
+		computeGridHistogramsWith<double> (image, skipBorderPixels,
+				gridRows, gridCols, histograms);
+}
+
+// -----------------------------------------
+template<typename _T>
+void System::computeGridHistogramsWith(const Img &image,
+		int skipBorderPixels, int gridRows, int gridCols,
+		vector<Crfh *> &histograms) const {
+	CrfhWorkspace &workspace = threadWorkspace();
+	vector<math::Matrix_<_T> *> &outputs = computeOutputsWith<_T> (image,
+			skipBorderPixels, workspace);
+	opencv::Rect region(skipBorderPixels, skipBorderPixels, image.nbCols()
+			- 2 * skipBorderPixels, image.nbRows() - 2 * skipBorderPixels);
+	Crfh::createGrid(outputs, _descriptorList, region, gridRows, gridCols,
+			histograms, _accumulatorType, &workspace);
+}
+
+// -----------------------------------------
+void System::computeSpatialPyramid(const Img &image, int skipBorderPixels,
+		int levels, vector<Crfh *> &histograms) const {
+	histograms.clear();
+	if (levels < 1)
+		return;
+
+	// Count the cells of the finest level
+	int cells = 1 << (levels - 1);
+	vector<Crfh *> finest;
+	computeGridHistograms(image, skipBorderPixels, cells, cells, finest);
+	if (finest.size() != (unsigned int) (cells * cells)) {
+		for (unsigned int i = 0; i < finest.size(); ++i)
+			delete finest[i];
+		return;
+	}
+
+	// Each cell of a coarser level is the sum of the cells it covers
+	// at the finest level, the boundaries of the levels coincide
+	for (int l = 0; l < levels - 1; ++l) {
+		int n = 1 << l;
+		int span = cells / n;
+		for (int r = 0; r < n; ++r)
+			for (int c = 0; c < n; ++c) {
+				Crfh *crfh = new Crfh();
+				for (int fr = r * span; fr < (r + 1) * span; ++fr)
+					for (int fc = c * span; fc < (c + 1) * span; ++fc)
+						crfh->add(*finest[fr * cells + fc]);
+				histograms.push_back(crfh);
+			}
+	}
+	histograms.insert(histograms.end(), finest.begin(), finest.end());
+}
+
+// -----------------------------------------
+void System::computeHistograms(const Img &image,
+		const vector<opencv::Rect> &regions, vector<Crfh *> &histograms) const {
+	rocsDebug3("computeHistograms('%s', %i regions)", image.infoString().c_str(), (int) regions.size());
+	if (_precision == PT_FLOAT)
+		computeHistogramsWith<float> (image, regions, histograms);
+	else
+		computeHistogramsWith<double> (image, regions, histograms);
+}
+
+// -----------------------------------------
+template<typename _T>
+void System::computeHistogramsWith(const Img &image,
+		const vector<opencv::Rect> &regions, vector<Crfh *> &histograms) const {
+	histograms.clear();
+
+	// Clip the regions to the image
+	int rows = image.nbRows();
+	int cols = image.nbCols();
+	opencv::Rect whole(0, 0, cols, rows);
+	vector<opencv::Rect> clipped(regions.size());
+	opencv::Rect bounds;
+	for (unsigned int i = 0; i < regions.size(); ++i) {
+		clipped[i] = regions[i] & whole;
+		if (clipped[i].area() > 0)
+			bounds = (bounds.area() > 0) ? (bounds | clipped[i]) : clipped[i];
+	}
+	if ((bounds.area() == 0) || (_descriptorList.size() == 0)) {
+		for (unsigned int i = 0; i < regions.size(); ++i)
+			histograms.push_back(new Crfh());
+		return;
+	}
+
+	// Create channel cache
+	CrfhWorkspace &workspace = threadWorkspace();
+	ChannelCache channelCache(image, _precision, &workspace);
+	_descriptorList.createAllRequiredChannels(channelCache);
+
+	// Create scale-space cache, valid around the regions
+	ScaleSpaceCache scaleSpaceCache(channelCache, _filterCache,
+			_incrementalScaleSpace, &workspace);
+	scaleSpaceCache.createScaleSpaceSamples(_scaleSpaceLayout);
+	if (_restrictToRegion)
+		_descriptorList.requireAllRegions(scaleSpaceCache, bounds);
+	scaleSpaceCache.computeScaleSpaceSamples(_threadPool.get());
+
+	// Apply the descriptors
+	vector<math::Matrix_<_T> *> &outputs = workspace.getOutputList<_T> (
+			_descriptorList.size());
+	for (unsigned int i = 0; i < outputs.size(); ++i)
+		outputs[i] = workspace.getMatrix<_T> (CrfhWorkspace::BT_OUTPUT, i,
+				rows, cols);
+	_descriptorList.applyAllTo(channelCache, scaleSpaceCache, _filterCache,
+			&outputs[0], _threadPool.get(), (_restrictToRegion) ? &bounds : 0);
+
+	// Count the pixels of each region
+	for (unsigned int i = 0; i < regions.size(); ++i)
+		histograms.push_back((clipped[i].area() == 0) ? new Crfh() : new Crfh(
+				outputs, _descriptorList, clipped[i], _accumulatorType,
+				&workspace));
 }
 
 } // end namespace cv
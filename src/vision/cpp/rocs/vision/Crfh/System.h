@@ -28,8 +28,16 @@
 #ifndef CSYSTEM_H_
 #define CSYSTEM_H_
 
+#include "rocs/cv/Crfh/ChannelCache.h"
 #include "rocs/cv/Crfh/FilterCache.h"
+#include "rocs/cv/Crfh/ScaleSpaceCache.h"
 #include "rocs/cv/Crfh/DescriptorList.h"
+#include "rocs/cv/Crfh/HistogramAccumulator.h"
+#include "rocs/cv/Crfh/CrfhWorkspace.h"
+#include "rocs/cv/ImageIO.h"
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/tss.hpp>
 
 #include <string>
 #include <vector>
@@ -43,6 +51,11 @@ namespace math
 template<typename _T> class Matrix_;
 }
 
+namespace core
+{
+class ThreadPool;
+}
+
 namespace cv
 {
 
@@ -63,9 +76,17 @@ public:
 	 */
 	System(string sysDef);
 	/*! empty constructor */
-	System()
+	System() :
+		_scaleSpaceLayout(_filterCache), _accumulatorType(AT_AUTO),
+				_precision(PT_DOUBLE), _incrementalScaleSpace(false),
+				_fusedDerivatives(true), _restrictToRegion(true),
+				_id(newId())
 	{
 	}
+	/*! Copy constructor. Builds an independent system with
+	 the same definition and parameters. */
+	System(const System &system);
+
 	/*!
 	 * Initializes the system (creates descriptors and filters).
 	 * \param sysDef Exemple string:
@@ -74,22 +95,231 @@ public:
 	 */
 	void build(string sysDef);
 
+	/*! Returns the content of the images the system needs: the
+	 lightness if all the descriptors use only the channel L. */
+	ImageLoadMode getImageLoadMode() const
+	{
+		return (_descriptorList.requiresOnlyL()) ? ILM_LIGHTNESS : ILM_COLOR;
+	}
+
+	/*! Sets the type of the accumulator used to count the histogram bins. */
+	void setAccumulatorType(AccumulatorType accumulatorType)
+	{
+		_accumulatorType = accumulatorType;
+	}
+
+	/*! Sets the number of threads used to compute the samples of the
+	 scale-space and the outputs of the descriptors of a single image.
+	 1 (default) computes everything in the calling thread. */
+	void setNumThreads(int numThreads);
+
+	/*! If true, samples of the scale-space are computed from the
+	 samples of smaller scales instead of from the channel. This is
+	 faster but the histograms differ from the reference ones, so it
+	 is false by default. The variances of the residual Gaussians add
+	 up exactly, but each kernel is truncated at GAUSSIAN_SIGMAS and
+	 the truncations do not compose: the second derivatives of the
+	 samples differ by about 0.5-0.8% and the normalized histograms
+	 by an L1 distance of about 0.13 (Coffee_nb.ppm,
+	 Lxx(2,28)+Lxy(4,28)+Lyy(8,28)+Lxx(8,28)). */
+	void setIncrementalScaleSpace(bool incremental)
+	{
+		_incrementalScaleSpace = incremental;
+	}
+
+	/*! If true (default), the derivative descriptors sharing a scale
+	 are computed together in one sweep over the scale-space sample. */
+	void setFusedDerivatives(bool fused)
+	{
+		_fusedDerivatives = fused;
+		_descriptorList.createDerivativeGroups(fused);
+	}
+
+	/*! If true (default), computeHistogram() filters only the pixels
+	 outside of the skipped border and the halos of the filters
+	 needed to compute them. */
+	void setRestrictToRegion(bool restrictToRegion)
+	{
+		_restrictToRegion = restrictToRegion;
+	}
+
+	/*! Sets the sigma from which the Gaussian filters are implemented
+	 recursively (0 - never, the default). Must be called before build().
+	 The recursive filters do not truncate the kernel at GAUSSIAN_SIGMAS
+	 as the FIR ones do, the normalized histograms therefore differ from
+	 the FIR ones by an L1 distance of about 0.09 (Coffee_nb.ppm,
+	 Lxx(32,28)+Lyy(32,28)+Lxy(16,28)). */
+	void setRecursiveGaussianSigma(double sigma)
+	{
+		_filterCache.setRecursiveGaussianSigma(sigma);
+	}
+
+	/*! Sets the precision of the channels, scale-space samples and
+	 descriptor outputs used to compute the histogram. */
+	void setPrecision(PrecisionType precision)
+	{
+		_precision = precision;
+	}
+
 public:
 
 	/*! Computes outputs of all the descriptors. */
 	vector<math::Matrix_<double>*>
 	computeDescriptorOutputs(const Img &image) const;
 
-	/*! Computes the histogram for a given image. */
+	/*! Computes outputs of all the descriptors in single precision
+	 and appends them to the outputs. */
+	void computeDescriptorOutputs(const Img &image,
+			vector<math::Matrix_<float>*> &outputs) const;
+
+	/*! Computes the histogram for a given image. The buffers are kept
+	 in a workspace owned by the system, one per calling thread, and
+	 reused for the following images computed by the same thread. */
 	Crfh *computeHistogram(const Img &image, int skipBorderPixels) const;
 
+	/*! Computes the histogram for a given image using the buffers
+	 of a given workspace. Can be called concurrently as long as each
+	 call uses a different workspace. */
+	Crfh *computeHistogram(const Img &image, int skipBorderPixels,
+			CrfhWorkspace &workspace) const;
+
+	/*! Computes the histogram for a given image into an existing one,
+	 replacing its bins, using the workspace of the calling thread. */
+	void computeHistogram(const Img &image, int skipBorderPixels,
+			Crfh &histogram) const;
+
+	/*! Computes the histogram for a given image into an existing one,
+	 replacing its bins, using the buffers of a given workspace. The
+	 memory of the bins is reused, so that once the workspace and the
+	 histogram have been used for an image of the same size, the only
+	 heap allocations left are the temporaries of the convolutions. */
+	void computeHistogram(const Img &image, int skipBorderPixels,
+			Crfh &histogram, CrfhWorkspace &workspace) const;
+
+	/*! Computes the histograms of the cells of a grid dividing the
+	 image without the skipped border, appended row after row. The image
+	 is filtered once and the cells are counted in one pass over the bin
+	 indices, so the cells see the same filter outputs as the whole image.
+	 Uses the workspace of the calling thread. The histograms are not
+	 normalized. */
+	void computeGridHistograms(const Img &image, int skipBorderPixels,
+			int gridRows, int gridCols, vector<Crfh *> &histograms) const;
+
+	/*! Computes a spatial pyramid of histograms: at level l the image
+	 without the skipped border is divided into 2^l x 2^l cells. The
+	 histograms are ordered by level and then row after row, level 0
+	 being the histogram of the whole image. Only the finest level is
+	 counted, the others are sums of its cells. The histograms are
+	 not normalized. */
+	void computeSpatialPyramid(const Img &image, int skipBorderPixels,
+			int levels, vector<Crfh *> &histograms) const;
+
+	/*! Computes the histograms of the pixels inside given regions of
+	 an image, one per region, using the buffers of the workspace of
+	 the calling thread. The image is filtered once, only where the regions
+	 need it. The regions are clipped to the image, a region outside of
+	 it gives an empty histogram. The histograms are not normalized. */
+	void computeHistograms(const Img &image,
+			const vector<opencv::Rect> &regions, vector<Crfh *> &histograms) const;
+
+	/*! Returns the distance in pixels from which the pixels of an image
+	 influence the bins of a pixel, -1 if they depend on the whole image. */
+	int getSupportRadius() const
+	{
+		return _descriptorList.getSupportRadius(_scaleSpaceLayout,
+				_incrementalScaleSpace);
+	}
+
+	/*! Returns the workspace used by computeHistogram() in the
+	 calling thread. */
+	const CrfhWorkspace &getWorkspace() const
+	{
+		return threadWorkspace();
+	}
+
+private:
+
+	/*! Returns the workspace of the calling thread, creating it
+	 on first use. */
+	CrfhWorkspace &threadWorkspace() const;
+
+	/*! Returns a new identifier of a system. */
+	static long newId();
+
+	/*! Computes the histogram in a given precision using the buffers
+	 of a workspace. */
+	template<typename _T>
+	void computeHistogramWith(const Img &image, int skipBorderPixels,
+			Crfh &histogram, CrfhWorkspace &workspace) const;
+
+	/*! Computes the outputs of all the descriptors in a given precision
+	 in the buffers of a workspace, valid outside of the skipped border. */
+	template<typename _T>
+	vector<math::Matrix_<_T> *> &computeOutputsWith(const Img &image,
+			int skipBorderPixels, CrfhWorkspace &workspace) const;
+
+	/*! Computes the histograms of the cells of a grid in a given precision. */
+	template<typename _T>
+	void computeGridHistogramsWith(const Img &image, int skipBorderPixels,
+			int gridRows, int gridCols, vector<Crfh *> &histograms) const;
+
+	/*! Computes the histograms of regions in a given precision. */
+	template<typename _T>
+	void computeHistogramsWith(const Img &image,
+			const vector<opencv::Rect> &regions, vector<Crfh *> &histograms) const;
+
+	/*! Not implemented, the caches cannot be shared. */
+	System &operator=(const System &);
+
+	/*! Workspace of a thread and the system it was created for. */
+	struct ThreadWorkspace
+	{
+		long owner;
+		CrfhWorkspace workspace;
+	};
+
 private:
 
+	/*! Definition of the system, descriptors joined with '+'. */
+	string _sysDef;
+
 	/*! List of descriptors to be computed. */
 	DescriptorList _descriptorList;
 
 	/*! Filter cache. */
 	FilterCache _filterCache;
+
+	/*! Samples of the scale-space requested by the descriptors,
+	 registered when the system is built. */
+	ScaleSpaceCache _scaleSpaceLayout;
+
+	/*! Type of the accumulator used to count the histogram bins. */
+	AccumulatorType _accumulatorType;
+
+	/*! Precision of the pipeline. */
+	PrecisionType _precision;
+
+	/*! Is the scale-space computed incrementally. */
+	bool _incrementalScaleSpace;
+
+	/*! Are the derivatives sharing a scale computed in one sweep. */
+	bool _fusedDerivatives;
+
+	/*! Are only the pixels counted in the histogram computed. */
+	bool _restrictToRegion;
+
+	/*! Worker threads, null if everything is computed in the calling thread. */
+	boost::shared_ptr<core::ThreadPool> _threadPool;
+
+	/*! Identifier of the system, unique in the process. */
+	long _id;
+
+	/*! Buffers reused by computeHistogram(), one workspace per thread.
+	 Destroying the system releases only the workspace of the destroying
+	 thread, the other ones remain stored under the address of the member
+	 until their thread ends or reuses it. A system created later at the
+	 same address has a different identifier and replaces them. */
+	mutable boost::thread_specific_ptr<ThreadWorkspace> _workspaces;
 };
 
 } // end namespace cv
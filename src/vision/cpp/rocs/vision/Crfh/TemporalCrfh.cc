@@ -0,0 +1,250 @@
+// ==================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (C) 2010  Arnaud Ramey, Andrzej Pronobis
+//
+// This file is part of ROCS.
+//
+// ROCS is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation, either version 3
+// of the License, or (at your option) any later version.
+//
+// ROCS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ROCS. If not, see <http://www.gnu.org/licenses/>.
+// ==================================================================
+
+
+/*!
+ * \file TemporalCrfh.cc
+ *
+ * Contains implementation of the TemporalCrfh class.
+ *
+ * \author Andrzej Pronobis
+ */
+
+#include "rocs/cv/Crfh/Filter.h"
+#include "rocs/cv/Crfh/System.h"
+#include "rocs/cv/Img.h"
+
+#include "rocs/cv/Crfh/TemporalCrfh.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+namespace rocs {
+namespace cv {
+
+// -----------------------------------------
+TemporalCrfh::TemporalCrfh() :
+	_tileSize(CRFH_TEMPORAL_TILE_SIZE), _changeThreshold(0), _changeStep(1) {
+	reset();
+}
+
+// -----------------------------------------
+void TemporalCrfh::setTileSize(int tileSize) {
+	_tileSize = std::max(tileSize, 1);
+	reset();
+}
+
+// -----------------------------------------
+void TemporalCrfh::setChangeStep(int changeStep) {
+	_changeStep = std::max(changeStep, 1);
+}
+
+// -----------------------------------------
+void TemporalCrfh::reset() {
+	_rows = _cols = _channels = _skipBorderPixels = 0;
+	_tiles.clear();
+	_tileHistograms.clear();
+	_total = FeatureList<int, double> ();
+	_reference.clear();
+	_nbTilesRecomputed = 0;
+	_nbFrames = 0;
+	_nbFramesSkipped = 0;
+}
+
+// -----------------------------------------
+Crfh *TemporalCrfh::computeHistogram(const System &system, const Img &image,
+		int skipBorderPixels) {
+	const opencv::Mat &mat = image.asConstOpenCvMat();
+	int rows = image.nbRows();
+	int cols = image.nbCols();
+	int channels = mat.channels();
+
+	// Start from scratch if the geometry of the stream changed
+	vector<int> changed;
+	int supportRadius = system.getSupportRadius();
+	if ((rows != _rows) || (cols != _cols) || (channels != _channels)
+			|| (skipBorderPixels != _skipBorderPixels)) {
+		long nbFrames = _nbFrames;
+		reset();
+		_nbFrames = nbFrames;
+		_rows = rows;
+		_cols = cols;
+		_channels = channels;
+		_skipBorderPixels = skipBorderPixels;
+		createTiles(rows, cols, skipBorderPixels);
+		_reference.resize((size_t) rows * cols * channels);
+		for (unsigned int i = 0; i < _tiles.size(); ++i)
+			changed.push_back(i);
+	} else
+		findChangedTiles(mat, supportRadius, changed);
+
+	++_nbFrames;
+	_nbTilesRecomputed = changed.size();
+	if (changed.empty())
+		++_nbFramesSkipped;
+	else {
+		// Compute the changed tiles in one pass over the image
+		vector<opencv::Rect> regions;
+		for (unsigned int i = 0; i < changed.size(); ++i)
+			regions.push_back(_tiles[changed[i]]);
+		vector<Crfh *> histograms;
+		system.computeHistograms(image, regions, histograms);
+		replaceTileHistograms(changed, histograms);
+
+		// The changed tiles were computed from the pixels of this frame
+		opencv::Rect whole(0, 0, cols, rows);
+		if (supportRadius < 0)
+			updateReference(mat, whole);
+		else
+			for (unsigned int i = 0; i < regions.size(); ++i)
+				updateReference(mat, expandRegion(regions[i], supportRadius)
+						& whole);
+	}
+
+	Crfh *crfh = new Crfh();
+	static_cast<FeatureList<int, double> &> (*crfh) = _total;
+	return crfh;
+}
+
+// -----------------------------------------
+void TemporalCrfh::createTiles(int rows, int cols, int skipBorderPixels) {
+	_tiles.clear();
+	int rowEnd = rows - skipBorderPixels;
+	int colEnd = cols - skipBorderPixels;
+	for (int y = skipBorderPixels; y < rowEnd; y += _tileSize)
+		for (int x = skipBorderPixels; x < colEnd; x += _tileSize)
+			_tiles.push_back(opencv::Rect(x, y, std::min(_tileSize, colEnd
+					- x), std::min(_tileSize, rowEnd - y)));
+	_tileHistograms.assign(_tiles.size(), FeatureList<int, double> ());
+	_total._sum = 0;
+	_total._max = 0;
+}
+
+// -----------------------------------------
+void TemporalCrfh::findChangedTiles(const opencv::Mat &image,
+		int supportRadius, vector<int> &changed) {
+	// Integral image of the absolute differences summed over the
+	// channels of the pixels on the grid
+	int gridRows = (_rows + _changeStep - 1) / _changeStep;
+	int gridCols = (_cols + _changeStep - 1) / _changeStep;
+	int width = gridCols + 1;
+	_differences.assign((size_t) (gridRows + 1) * width, 0);
+	size_t rowBytes = (size_t) _cols * _channels;
+	for (int gi = 0; gi < gridRows; ++gi) {
+		int i = gi * _changeStep;
+		const unsigned char *src = image.ptr<unsigned char> (i);
+		const unsigned char *ref = &_reference[i * rowBytes];
+		long *above = &_differences[(size_t) gi * width];
+		long *current = above + width;
+		long rowSum = 0;
+
+		// Rows of identical pixels are frequent in static scenes
+		if ((_changeStep == 1) && (memcmp(src, ref, rowBytes) == 0))
+			memcpy(current + 1, above + 1, gridCols * sizeof(long));
+		else
+			for (int gj = 0; gj < gridCols; ++gj) {
+				size_t offset = (size_t) gj * _changeStep * _channels;
+				for (int c = 0; c < _channels; ++c)
+					rowSum += std::abs(src[offset + c] - ref[offset + c]);
+				current[gj + 1] = above[gj + 1] + rowSum;
+			}
+	}
+
+	// Compare the mean difference around each tile with the threshold
+	opencv::Rect whole(0, 0, _cols, _rows);
+	for (unsigned int t = 0; t < _tiles.size(); ++t) {
+		opencv::Rect window = (supportRadius < 0) ? whole : (expandRegion(
+				_tiles[t], supportRadius) & whole);
+		int gi0 = (window.y + _changeStep - 1) / _changeStep;
+		int gi1 = (window.y + window.height + _changeStep - 1) / _changeStep;
+		int gj0 = (window.x + _changeStep - 1) / _changeStep;
+		int gj1 = (window.x + window.width + _changeStep - 1) / _changeStep;
+		long samples = (long) (gi1 - gi0) * (gj1 - gj0) * _channels;
+		long sum = _differences[(size_t) gi1 * width + gj1]
+				- _differences[(size_t) gi0 * width + gj1]
+				- _differences[(size_t) gi1 * width + gj0]
+				+ _differences[(size_t) gi0 * width + gj0];
+
+		// A window without compared pixels is always recomputed
+		if ((samples == 0) || (sum > _changeThreshold * samples))
+			changed.push_back(t);
+	}
+}
+
+// -----------------------------------------
+void TemporalCrfh::updateReference(const opencv::Mat &image,
+		const opencv::Rect &region) {
+	size_t rowBytes = (size_t) _cols * _channels;
+	size_t offset = (size_t) region.x * _channels;
+	size_t bytes = (size_t) region.width * _channels;
+	for (int i = region.y; i < region.y + region.height; ++i)
+		memcpy(&_reference[i * rowBytes + offset], image.ptr<unsigned char> (
+				i) + offset, bytes);
+}
+
+// -----------------------------------------
+void TemporalCrfh::replaceTileHistograms(const vector<int> &changed,
+		const vector<Crfh *> &histograms) {
+	// Differences of the counts, the old ones subtracted
+	vector<std::pair<int, double> > delta;
+	for (unsigned int i = 0; i < changed.size(); ++i) {
+		FeatureList<int, double> &tile = _tileHistograms[changed[i]];
+		for (FeatureList<int, double>::const_iterator it = tile.begin(); it
+				!= tile.end(); ++it)
+			delta.push_back(std::make_pair(it->first, -it->second));
+		for (FeatureList<int, double>::const_iterator it =
+				histograms[i]->begin(); it != histograms[i]->end(); ++it)
+			delta.push_back(std::make_pair(it->first, it->second));
+		_total._sum += histograms[i]->_sum - tile._sum;
+		tile.swap(*histograms[i]);
+		delete histograms[i];
+	}
+	std::sort(delta.begin(), delta.end());
+
+	// Merge the sorted differences with the counts, the counts are
+	// integers so the emptied bins are exactly 0
+	FeatureList<int, double> total;
+	total.reserve(_total.size() + delta.size());
+	total._max = 0;
+	FeatureList<int, double>::const_iterator it = _total.begin();
+	size_t d = 0;
+	while ((it != _total.end()) || (d < delta.size())) {
+		int key;
+		double value = 0;
+		if ((d == delta.size()) || ((it != _total.end()) && (it->first
+				<= delta[d].first))) {
+			key = it->first;
+			value = it->second;
+			++it;
+		} else
+			key = delta[d].first;
+		for (; (d < delta.size()) && (delta[d].first == key); ++d)
+			value += delta[d].second;
+		if (value != 0)
+			total.append(key, value);
+	}
+	total._sum = _total._sum;
+	_total.swap(total);
+}
+
+} // end namespace cv
+} // end namespace rocs
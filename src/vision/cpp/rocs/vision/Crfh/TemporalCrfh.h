@@ -0,0 +1,176 @@
+// ==================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (C) 2010  Arnaud Ramey, Andrzej Pronobis
+//
+// This file is part of ROCS.
+//
+// ROCS is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation, either version 3
+// of the License, or (at your option) any later version.
+//
+// ROCS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ROCS. If not, see <http://www.gnu.org/licenses/>.
+// ==================================================================
+
+
+/*!
+ * \file TemporalCrfh.h
+ *
+ * \author Andrzej Pronobis
+ *
+ * Contains declaration of the TemporalCrfh class.
+ */
+
+#ifndef CTEMPORALCRFH_H_
+#define CTEMPORALCRFH_H_
+
+#include "rocs/cv/Crfh/Crfh.h"
+#include "rocs/math/Matrix_.h"
+
+#include <vector>
+
+namespace rocs {
+namespace cv {
+
+class Img;
+class System;
+
+/*! Default size in pixels of the tiles. */
+#define CRFH_TEMPORAL_TILE_SIZE 64
+
+/*!
+ * Computes the histograms of consecutive frames of a video stream
+ * incrementally. The counted part of the image is divided into tiles
+ * and the histogram of each tile is kept. For each new frame, only
+ * the tiles around which the pixels changed are recomputed and their
+ * histograms replace the old ones in the histogram of the frame. If no
+ * tile changed, the frame is skipped and the previous histogram is
+ * returned.
+ *
+ * A tile is recomputed if the mean absolute difference of the pixels
+ * of the frame and of the reference (the frame from which the tile
+ * was last computed), in the tile extended by the support of the
+ * filters, exceeds the change threshold. With a threshold of 0 and a
+ * change step of 1, the histograms are identical to those computed
+ * from scratch.
+ */
+class TemporalCrfh {
+
+public:
+
+	/*! Constructor. */
+	TemporalCrfh();
+
+public:
+
+	/*! Sets the size in pixels of the tiles. Resets the state. */
+	void setTileSize(int tileSize);
+
+	/*! Sets the mean absolute difference of the pixel values (0-255)
+	 above which a tile is recomputed. 0 (default) recomputes the tiles
+	 influenced by any changed pixel. */
+	void setChangeThreshold(double changeThreshold) {
+		_changeThreshold = changeThreshold;
+	}
+
+	/*! Sets the step of the grid of pixels compared to detect the
+	 changes. 1 (default) compares all the pixels, larger steps trade
+	 the exactness for speed. */
+	void setChangeStep(int changeStep);
+
+	/*! Forgets the previous frames, the next one is computed
+	 from scratch. */
+	void reset();
+
+	/*! Computes the (not normalized) histogram of the next frame using
+	 a given system. The system, its parameters and skipBorderPixels
+	 must be the same as for the previous frames, or reset() must be
+	 called. */
+	Crfh *computeHistogram(const System &system, const Img &image,
+			int skipBorderPixels);
+
+	/*! Returns the number of tiles. */
+	int getNbTiles() const {
+		return _tiles.size();
+	}
+
+	/*! Returns the number of tiles recomputed for the last frame. */
+	int getNbTilesRecomputed() const {
+		return _nbTilesRecomputed;
+	}
+
+	/*! Returns the number of frames processed since the last reset. */
+	long getNbFrames() const {
+		return _nbFrames;
+	}
+
+	/*! Returns the number of frames for which no tile was recomputed. */
+	long getNbFramesSkipped() const {
+		return _nbFramesSkipped;
+	}
+
+private:
+
+	/*! Divides the counted part of an image into tiles. */
+	void createTiles(int rows, int cols, int skipBorderPixels);
+
+	/*! Finds the tiles around which the image differs from the reference. */
+	void findChangedTiles(const opencv::Mat &image, int supportRadius,
+			std::vector<int> &changed);
+
+	/*! Copies a region of the image to the reference. */
+	void updateReference(const opencv::Mat &image, const opencv::Rect &region);
+
+	/*! Replaces the histograms of the tiles by the new ones and updates
+	 the histogram of the frame. Deletes the new histograms. */
+	void replaceTileHistograms(const std::vector<int> &changed,
+			const std::vector<Crfh *> &histograms);
+
+private:
+
+	/*! Size of the tiles. */
+	int _tileSize;
+
+	/*! Mean difference above which a tile is recomputed. */
+	double _changeThreshold;
+
+	/*! Step of the grid of compared pixels. */
+	int _changeStep;
+
+	/*! Geometry of the frames of the stream, 0 rows before the first. */
+	int _rows;
+	int _cols;
+	int _channels;
+	int _skipBorderPixels;
+
+	/*! Tiles covering the counted part of the frames. */
+	std::vector<opencv::Rect> _tiles;
+
+	/*! Histogram (counts) of each tile. */
+	std::vector<FeatureList<int, double> > _tileHistograms;
+
+	/*! Histogram (counts) of the frame, sum of those of the tiles. */
+	FeatureList<int, double> _total;
+
+	/*! Pixels of the reference, rows*cols*channels bytes. */
+	std::vector<unsigned char> _reference;
+
+	/*! Integral image of the differences on the grid of compared pixels. */
+	std::vector<long> _differences;
+
+	/*! Statistics. */
+	int _nbTilesRecomputed;
+	long _nbFrames;
+	long _nbFramesSkipped;
+};
+
+} // end namespace cv
+} // end namespace rocs
+
+#endif /* CTEMPORALCRFH_H_ */
@@ -32,9 +32,16 @@
 #include "rocs/core/Timer.h"
 #include "rocs/core/utils.h"
 
+// Boost includes
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
 // STD includes
 #include <vector>
 #include <string>
+#include <deque>
+#include <map>
+#include <utility>
 using std::string;
 
 /*!
@@ -77,15 +84,39 @@ public:
 	 */
 	virtual featureType* processImage(const Img* frame) = 0;
 
+	/*!
+	 * content of the images loaded by process()
+	 * \return ILM_COLOR unless the extractor needs only the lightness
+	 */
+	virtual ImageLoadMode getImageLoadMode() const
+	{
+		return ILM_COLOR;
+	}
+
+	/*!
+	 * create an independent copy of the extractor with the same
+	 * parameters, used by the worker threads of process()
+	 * \return the copy or 0 if the extractor cannot be copied
+	 */
+	virtual FeatureExtractor<featureType>* createWorker() const
+	{
+		return 0;
+	}
+
 	/*!
 	 * process a bunch of pictures
 	 * \param inputFileName
 	 * \param outputFileName where to save the results
+	 * \param numThreads number of extraction threads. If larger than 1,
+	 * the images are loaded by a separate thread and extracted by
+	 * workers created with createWorker(). The results are written
+	 * in the input order.
 	 */
-	void process(const string inputFileName, const string outputFileName)
+	void process(const string inputFileName, const string outputFileName,
+			int numThreads = 1)
 	{
-		rocsDebug1("inputFileName:%s, outputFileName:%s",
-				inputFileName.c_str(), outputFileName.c_str());
+		rocsDebug1("inputFileName:%s, outputFileName:%s, numThreads:%i",
+				inputFileName.c_str(), outputFileName.c_str(), numThreads);
 
 		/* load input files */
 		vector<string> imageFileList;
@@ -101,6 +132,38 @@ public:
 		/* Extract features from each file */
 		rocsDebug3("\n\n* Processing files:");
 
+		if (numThreads > 1)
+			processBatch(imageFileList, outputFileStream, numThreads);
+		else
+			processSequential(imageFileList, outputFileStream);
+
+		/* Display average time */
+		rocsDebug1("\n\n* Finished! Average processing time per image: %f ms",
+				averageTime());
+
+		/* Close the output file */
+		outputFileStream.close();
+
+		//return EXIT_SUCCESS;
+	} // end process
+
+	//private:
+	Timer _t;
+	long _totalTime;
+	int _nbImagesTreated;
+	double averageTime()
+	{
+		return _totalTime / _nbImagesTreated;
+	}
+
+private:
+
+	/*!
+	 * process the images one after another in the calling thread
+	 */
+	void processSequential(const vector<string> &imageFileList,
+			ostream &outputFileStream)
+	{
 		for (unsigned int i = 0; i < imageFileList.size(); ++i)
 		{
 			rocsDebug1("\n\n(%f percent) : %s", (((double) i + 1)
@@ -108,11 +171,12 @@ public:
 					imageFileList[i].c_str());
 
 			/* Load an image */
-			Img* image = ImageIO::load(imageFileList[i]);
+			Img* image = ImageIO::load(imageFileList[i], getImageLoadMode());
 
 			/* Perform histogram extraction */
 			featureType* crfh = processImage(image);
 			rocsDebug3("\n\nComputing finished for this image !");
+			delete image;
 
 			/* Save the histogram to the output file */
 			//			if (classLabelList[i] != "")
@@ -125,24 +189,226 @@ public:
 			/* Delete the histogram */
 			delete crfh;
 		} // end loop image
+	}
 
-		/* Display average time */
-		rocsDebug1("\n\n* Finished! Average processing time per image: %f ms",
-				averageTime());
+	/*!
+	 * state shared by the threads of processBatch()
+	 */
+	struct BatchState
+	{
+		BatchState(const vector<string> &fileList, unsigned int capacity,
+				ImageLoadMode loadMode) :
+			fileList(fileList), capacity(capacity), loadMode(loadMode),
+					loadingFinished(false),
+					nextToWrite(0), abort(false)
+		{
+		}
 
-		/* Close the output file */
-		outputFileStream.close();
+		/*! files to process */
+		const vector<string> &fileList;
 
-		//return EXIT_SUCCESS;
-	} // end process
+		/*! maximal number of loaded images and of results waiting to be written */
+		unsigned int capacity;
 
-	//private:
-	Timer _t;
-	long _totalTime;
-	int _nbImagesTreated;
-	double averageTime()
+		/*! content of the loaded images */
+		ImageLoadMode loadMode;
+
+		/*! protects all the fields below */
+		boost::mutex mutex;
+
+		/*! signaled whenever any of the fields below changes */
+		boost::condition_variable changed;
+
+		/*! loaded images with their indices, in the input order */
+		std::deque<std::pair<unsigned int, Img*> > loaded;
+
+		/*! true when the loader thread has finished */
+		bool loadingFinished;
+
+		/*! index of the next result to be written */
+		unsigned int nextToWrite;
+
+		/*! results waiting to be written (reorder buffer) */
+		std::map<unsigned int, featureType*> results;
+
+		/*! message of the first error */
+		string error;
+
+		/*! true if the processing should stop because of an error */
+		bool abort;
+
+		/*! stops the processing after an error */
+		void fail(const string &message)
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			if (error.empty())
+				error = message;
+			abort = true;
+			changed.notify_all();
+		}
+	};
+
+	/*!
+	 * process the images with a loader thread and several workers
+	 */
+	void processBatch(const vector<string> &imageFileList,
+			ostream &outputFileStream, int numThreads)
 	{
-		return _totalTime / _nbImagesTreated;
+		/* Create workers, each with its own caches */
+		vector<FeatureExtractor<featureType>*> workers;
+		for (int i = 0; i < numThreads; ++i)
+		{
+			FeatureExtractor<featureType>* worker = createWorker();
+			if (!worker)
+				break;
+			worker->start();
+			workers.push_back(worker);
+		}
+		if (workers.size() < (unsigned int) numThreads)
+		{
+			rocsDebug1("The extractor cannot be copied, processing sequentially.");
+			for (unsigned int i = 0; i < workers.size(); ++i)
+				delete workers[i];
+			processSequential(imageFileList, outputFileStream);
+			return;
+		}
+
+		BatchState state(imageFileList, 2 * numThreads, getImageLoadMode());
+		boost::thread_group threads;
+		threads.create_thread(boost::bind(&FeatureExtractor::loaderLoop,
+				&state));
+		for (unsigned int i = 0; i < workers.size(); ++i)
+			threads.create_thread(boost::bind(&FeatureExtractor::workerLoop,
+					workers[i], &state));
+
+		/* Write the results in the input order */
+		for (unsigned int i = 0; i < imageFileList.size(); ++i)
+		{
+			featureType* feature;
+			{
+				boost::mutex::scoped_lock lock(state.mutex);
+				while ((state.results.find(i) == state.results.end())
+						&& !state.abort)
+					state.changed.wait(lock);
+				if (state.abort)
+					break;
+				feature = state.results[i];
+				state.results.erase(i);
+				++state.nextToWrite;
+				state.changed.notify_all();
+			}
+
+			rocsDebug1("\n\n(%f percent) : %s", (((double) i + 1)
+							/ ((double) imageFileList.size())) * 100.0,
+					imageFileList[i].c_str());
+			feature->serialize(outputFileStream);
+			if (i < imageFileList.size() - 1)
+				outputFileStream << endl;
+			delete feature;
+		}
+		threads.join_all();
+
+		/* Collect statistics and clean */
+		for (unsigned int i = 0; i < workers.size(); ++i)
+		{
+			_totalTime += workers[i]->_totalTime;
+			_nbImagesTreated += workers[i]->_nbImagesTreated;
+			workers[i]->end();
+			delete workers[i];
+		}
+		for (unsigned int i = 0; i < state.loaded.size(); ++i)
+			delete state.loaded[i].second;
+		for (typename std::map<unsigned int, featureType*>::iterator it =
+				state.results.begin(); it != state.results.end(); ++it)
+			delete it->second;
+
+		if (!state.error.empty())
+			throw core::Exception("FeatureExtractor::process", state.error);
+	}
+
+	/*!
+	 * main loop of the thread loading images
+	 */
+	static void loaderLoop(BatchState* state)
+	{
+		for (unsigned int i = 0; i < state->fileList.size(); ++i)
+		{
+			{
+				boost::mutex::scoped_lock lock(state->mutex);
+				while ((state->loaded.size() >= state->capacity)
+						&& !state->abort)
+					state->changed.wait(lock);
+				if (state->abort)
+					break;
+			}
+
+			Img* image;
+			try
+			{
+				image = ImageIO::load(state->fileList[i], state->loadMode);
+			} catch (std::exception &e)
+			{
+				state->fail(e.what());
+				break;
+			}
+
+			boost::mutex::scoped_lock lock(state->mutex);
+			state->loaded.push_back(std::make_pair(i, image));
+			state->changed.notify_all();
+		}
+
+		boost::mutex::scoped_lock lock(state->mutex);
+		state->loadingFinished = true;
+		state->changed.notify_all();
+	}
+
+	/*!
+	 * main loop of a worker thread
+	 */
+	static void workerLoop(FeatureExtractor<featureType>* worker,
+			BatchState* state)
+	{
+		for (;;)
+		{
+			/* Take the next loaded image */
+			std::pair<unsigned int, Img*> item;
+			{
+				boost::mutex::scoped_lock lock(state->mutex);
+				while (state->loaded.empty() && !state->loadingFinished
+						&& !state->abort)
+					state->changed.wait(lock);
+				if (state->abort || state->loaded.empty())
+					return;
+				item = state->loaded.front();
+				state->loaded.pop_front();
+				state->changed.notify_all();
+			}
+
+			featureType* feature;
+			try
+			{
+				feature = worker->processImage(item.second);
+			} catch (std::exception &e)
+			{
+				delete item.second;
+				state->fail(e.what());
+				return;
+			}
+			delete item.second;
+
+			/* Wait for a free place in the reorder buffer */
+			boost::mutex::scoped_lock lock(state->mutex);
+			while ((item.first >= state->nextToWrite + state->capacity)
+					&& !state->abort)
+				state->changed.wait(lock);
+			if (state->abort)
+			{
+				delete feature;
+				return;
+			}
+			state->results[item.first] = feature;
+			state->changed.notify_all();
+		}
 	}
 
 };
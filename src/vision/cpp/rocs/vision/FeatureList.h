@@ -36,22 +36,213 @@
 #include <rocs/core/debug.h>
 // std includes
 #include <sstream>
-#include <map>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <stdio.h>
 
 namespace rocs {
 namespace cv {
 
+/*!
+ * a bin of a FeatureList seen through an iterator,
+ * with the key in first and a reference to the value in second
+ */
+template<typename keyType, typename valueType>
+struct FeatureListEntry
+{
+	FeatureListEntry(const keyType &key, valueType &value) :
+		first(key), second(value)
+	{
+	}
+
+	/*! allows it->first and it->second on the iterators */
+	const FeatureListEntry *operator->() const
+	{
+		return this;
+	}
+
+	const keyType &first;
+	valueType &second;
+};
+
+/*!
+ * iterator over the bins of a FeatureList, valueType is const
+ * for the const_iterator
+ */
+template<typename keyType, typename valueType>
+class FeatureListIterator
+{
+public:
+
+	typedef std::random_access_iterator_tag iterator_category;
+	typedef std::pair<keyType, valueType> value_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef FeatureListEntry<keyType, valueType> reference;
+	typedef FeatureListEntry<keyType, valueType> pointer;
+
+	FeatureListIterator() :
+		_key(0), _value(0)
+	{
+	}
+
+	FeatureListIterator(const keyType *key, valueType *value) :
+		_key(key), _value(value)
+	{
+	}
+
+	/*! conversion from the iterator to the const_iterator */
+	template<typename otherValueType>
+	FeatureListIterator(
+			const FeatureListIterator<keyType, otherValueType> &other) :
+		_key(other.key()), _value(other.value())
+	{
+	}
+
+	reference operator*() const
+	{
+		return reference(*_key, *_value);
+	}
+
+	pointer operator->() const
+	{
+		return pointer(*_key, *_value);
+	}
+
+	FeatureListIterator &operator++()
+	{
+		++_key;
+		++_value;
+		return *this;
+	}
+
+	FeatureListIterator operator++(int)
+	{
+		FeatureListIterator old = *this;
+		++*this;
+		return old;
+	}
+
+	FeatureListIterator &operator--()
+	{
+		--_key;
+		--_value;
+		return *this;
+	}
+
+	FeatureListIterator operator--(int)
+	{
+		FeatureListIterator old = *this;
+		--*this;
+		return old;
+	}
+
+	FeatureListIterator &operator+=(difference_type n)
+	{
+		_key += n;
+		_value += n;
+		return *this;
+	}
 
+	FeatureListIterator operator+(difference_type n) const
+	{
+		return FeatureListIterator(_key + n, _value + n);
+	}
+
+	friend FeatureListIterator operator+(difference_type n,
+			const FeatureListIterator &i)
+	{
+		return i + n;
+	}
+
+	FeatureListIterator &operator-=(difference_type n)
+	{
+		_key -= n;
+		_value -= n;
+		return *this;
+	}
+
+	FeatureListIterator operator-(difference_type n) const
+	{
+		return FeatureListIterator(_key - n, _value - n);
+	}
+
+	difference_type operator-(const FeatureListIterator &other) const
+	{
+		return _key - other._key;
+	}
+
+	reference operator[](difference_type n) const
+	{
+		return reference(_key[n], _value[n]);
+	}
+
+	bool operator==(const FeatureListIterator &other) const
+	{
+		return _key == other._key;
+	}
+
+	bool operator!=(const FeatureListIterator &other) const
+	{
+		return _key != other._key;
+	}
+
+	bool operator<(const FeatureListIterator &other) const
+	{
+		return _key < other._key;
+	}
+
+	bool operator>(const FeatureListIterator &other) const
+	{
+		return _key > other._key;
+	}
+
+	bool operator<=(const FeatureListIterator &other) const
+	{
+		return _key <= other._key;
+	}
+
+	bool operator>=(const FeatureListIterator &other) const
+	{
+		return _key >= other._key;
+	}
+
+	/*! pointer to the key */
+	const keyType *key() const
+	{
+		return _key;
+	}
+
+	/*! pointer to the value */
+	valueType *value() const
+	{
+		return _value;
+	}
+
+private:
+	const keyType *_key;
+	valueType *_value;
+};
+
+/*!
+ * a sparse histogram: bins with non-zero values sorted by the keys,
+ * stored as two flat arrays of keys and values
+ */
 template<typename keyType, class valueType>
-class FeatureList: public std::map<keyType, valueType>
+class FeatureList
 {
 public:
 
-	typedef typename std::map<keyType, valueType> Type;
-	typedef typename std::map<keyType, valueType>::iterator Feature;
+	typedef FeatureList<keyType, valueType> Type;
+	typedef std::pair<keyType, valueType> value_type;
+	typedef FeatureListIterator<keyType, valueType> iterator;
+	typedef FeatureListIterator<keyType, const valueType> const_iterator;
+	/*! element of the libSVM vector */
+	typedef std::pair<keyType, valueType> Feature;
 
-	FeatureList() :
-		Type()
+	FeatureList()
 	{
 		_sum = 0;
 		_max = -1;
@@ -60,27 +251,206 @@ public:
 	{
 	}
 
+	/*! number of bins */
+	size_t size() const
+	{
+		return _keys.size();
+	}
+
+	/*! true if there are no bins */
+	bool empty() const
+	{
+		return _keys.empty();
+	}
+
+	/*! removes all the bins, _sum and _max are not changed */
+	void clear()
+	{
+		_keys.clear();
+		_values.clear();
+	}
+
+	/*! reserves the memory for a given number of bins */
+	void reserve(size_t size)
+	{
+		_keys.reserve(size);
+		_values.reserve(size);
+	}
+
+	iterator begin()
+	{
+		return iterator(keys(), values());
+	}
+	iterator end()
+	{
+		return begin() + size();
+	}
+	const_iterator begin() const
+	{
+		return const_iterator(keys(), values());
+	}
+	const_iterator end() const
+	{
+		return begin() + size();
+	}
+
+	/*! the keys, sorted in the increasing order (null if empty) */
+	const keyType *keys() const
+	{
+		return (_keys.empty()) ? 0 : &_keys[0];
+	}
+
+	/*! the values of the bins (null if empty) */
+	valueType *values()
+	{
+		return (_values.empty()) ? 0 : &_values[0];
+	}
+	const valueType *values() const
+	{
+		return (_values.empty()) ? 0 : &_values[0];
+	}
+
+	/*! the first bin with a key not smaller than index */
+	iterator lower_bound(keyType index)
+	{
+		return begin() + lowerBoundPosition(index);
+	}
+	const_iterator lower_bound(keyType index) const
+	{
+		return begin() + lowerBoundPosition(index);
+	}
+
+	/*! the bin with a given key or end() */
+	iterator find(keyType index)
+	{
+		size_t pos = lowerBoundPosition(index);
+		return ((pos < size()) && (_keys[pos] == index)) ? begin() + pos
+				: end();
+	}
+	const_iterator find(keyType index) const
+	{
+		size_t pos = lowerBoundPosition(index);
+		return ((pos < size()) && (_keys[pos] == index)) ? begin() + pos
+				: end();
+	}
+
+	/*! 1 if there is a bin with a given key, 0 otherwise */
+	size_t count(keyType index) const
+	{
+		return (find(index) != end()) ? 1 : 0;
+	}
+
+	/*! the value of the bin with a given key,
+	 throws std::out_of_range if there is none */
+	valueType &at(keyType index)
+	{
+		iterator i = find(index);
+		if (i == end())
+			throw std::out_of_range("FeatureList::at");
+		return i->second;
+	}
+	const valueType &at(keyType index) const
+	{
+		const_iterator i = find(index);
+		if (i == end())
+			throw std::out_of_range("FeatureList::at");
+		return i->second;
+	}
+
+	/*! the value of the bin with a given key, the bin is created
+	 if necessary, _sum and _max are not changed */
+	valueType &operator[](keyType index)
+	{
+		return insert(end(), value_type(index, valueType()))->second;
+	}
+
+	/*!
+	 * inserts a bin if there is no bin with the same key,
+	 * _sum and _max are not changed
+	 * @param hint ignored, kept for the compatibility with std::map
+	 * @param value the new bin
+	 * @return the bin with the key
+	 */
+	iterator insert(iterator hint, const value_type &value)
+	{
+		(void) hint;
+		size_t pos = lowerBoundPosition(value.first);
+		if ((pos == size()) || (_keys[pos] != value.first))
+		{
+			_keys.insert(_keys.begin() + pos, value.first);
+			_values.insert(_values.begin() + pos, value.second);
+		}
+		return begin() + pos;
+	}
+
+	/*!
+	 * appends a bin, used to build the list in bulk in the increasing
+	 * order of keys, _sum and _max are updated as by insert_()
+	 * @param index should be larger than all the keys in the list,
+	 * otherwise the bin is inserted with insert_()
+	 * @param value the value of the bin
+	 */
+	void append(keyType index, valueType value)
+	{
+		if (!_keys.empty() && !(_keys.back() < index))
+		{
+			insert_(index, value);
+			return;
+		}
+		_keys.push_back(index);
+		_values.push_back(value);
+		_sum += value; // update _sum
+		if (_max < value)
+			_max = value;
+	}
+
+	/*! removes a bin, returns the following one */
+	iterator erase(iterator i)
+	{
+		size_t pos = i - begin();
+		_keys.erase(_keys.begin() + pos);
+		_values.erase(_values.begin() + pos);
+		return begin() + pos;
+	}
+
+	/*! exchanges the bins, _sum and _max with another list */
+	void swap(FeatureList &other)
+	{
+		_keys.swap(other._keys);
+		_values.swap(other._values);
+		std::swap(_sum, other._sum);
+		std::swap(_max, other._max);
+	}
+
+	/*! true if both lists have the same bins */
+	bool operator==(const FeatureList &other) const
+	{
+		return (_keys == other._keys) && (_values == other._values);
+	}
+	bool operator!=(const FeatureList &other) const
+	{
+		return !(*this == other);
+	}
+
 	/*!
 	 * insert the new element (index, value)
-	 * from http://stackoverflow.com/questions/97050/stdmap-insert-or-stdmap-find
 	 * @param index the index where to insert
 	 * @param value the new value
 	 */
 	void insert_(keyType index, valueType value)
 	{
-		typename Type::iterator lb = lower_bound(index);
-		//if (lb != this->end() && !(typename Type::key_comp()(index, lb->first)))
-		if (lb != this->end() && index == lb->first)
+		size_t pos = lowerBoundPosition(index);
+		if ((pos < size()) && (_keys[pos] == index))
 		{
-			// key already exists -> update lb->second
-			_sum -= lb->second; // update _sum
-			lb->second = value;
+			// key already exists -> update the value
+			_sum -= _values[pos]; // update _sum
+			_values[pos] = value;
 		}
 		else
 		{
-			// the key does not exist in the map ->  add it to the map
-			// Use lb as a hint to insert, so it can avoid another lookup
-			insert(lb, typename Type::value_type(index, value));
+			// the key does not exist -> add it
+			_keys.insert(_keys.begin() + pos, index);
+			_values.insert(_values.begin() + pos, value);
 		}
 		_sum += value; // update _sum
 		if (_max < value)
@@ -96,19 +466,18 @@ public:
 		//		rocsDebug3("increase_if_found(%i)", index);
 		double value;
 
-		typename Type::iterator lb = lower_bound(index);
-		//if (lb != this->end() && !(typename Type::key_comp()(index, lb->first)))
-		if (lb != this->end() && index == lb->first)
+		size_t pos = lowerBoundPosition(index);
+		if ((pos < size()) && (_keys[pos] == index))
 		{
-			// key already exists -> update lb->second
-			++(lb->second);
-			value = lb->second;
+			// key already exists -> increase the value
+			++_values[pos];
+			value = _values[pos];
 		}
 		else
 		{
-			// the key does not exist in the map ->  add it to the map
-			// Use lb as a hint to insert, so it can avoid another lookup
-			insert(lb, typename Type::value_type(index, 1));
+			// the key does not exist -> add it
+			_keys.insert(_keys.begin() + pos, index);
+			_values.insert(_values.begin() + pos, 1);
 			value = 1;
 		}
 		_sum += 1; // update _sum
@@ -116,7 +485,7 @@ public:
 			_max = value;
 	}
 
-	const char* iterToString(typename Type::iterator& i)
+	const char* iterToString(const_iterator i) const
 	{
 		char formatString[20];
 		char* ans = new char[100];
@@ -138,29 +507,25 @@ public:
 		//double thres = min_val * _sum;
 		double thres = min_val * _max;
 		rocsDebug3("filter(%f) - removing values < %f", min_val, thres);
-		//		rocsDebug3("max:%f", _max);
 
-		typename Type::iterator i = this->begin();
-		while (i != this->end())
+		// keep the bins above the threshold in place
+		size_t kept = 0;
+		for (size_t i = 0; i < size(); ++i)
 		{
-			//rocsDebug3("i->second:%f", i->second);
-			//if (i.value() < thres) {
-			if (i->second < thres)
+			if (_values[i] < thres)
 			{
-				rocsDebug3("erasing the iterator: %s", iterToString(i));
 				//_sum -= i.value(); // Decreses the classification performance. We should not do it.
-				_sum -= i->second;
-				//i = erase(i);
-				erase(i);
-				--i;
-				++i;// TODO check pointer arithmetic
+				_sum -= _values[i];
 			}
 			else
 			{
-				//				rocsDebug3("keeping the iterator");
-				++i;
+				_keys[kept] = _keys[i];
+				_values[kept] = _values[i];
+				++kept;
 			}
-		} // end loop i
+		}
+		_keys.resize(kept);
+		_values.resize(kept);
 	} // end filter
 
 	/*!
@@ -169,12 +534,8 @@ public:
 	void normalize()
 	{
 		rocsDebug3("normalize() - sum:%f", _sum);
-		for (typename Type::iterator i = this->begin(); i != this->end(); ++i)
-		{
-			//i.value() /= _sum; TODO check this
-			//debugPrintf_lvl3("Elem:%f", i->second);
-			i->second /= _sum;
-		}
+		for (size_t i = 0; i < _values.size(); ++i)
+			_values[i] /= _sum;
 		_sum = 1;
 	}
 
@@ -185,43 +546,54 @@ public:
 	 * \param addEndl
 	 *          add std::endl at the end of
 	 */
-	void serialize(std::ostream &stream, bool addEndl = false)
+	void serialize(std::ostream &stream, bool addEndl = false) const
 	{
 		rocsDebug3("serialize()");
 
-		for (typename Type::const_iterator i = this->begin(); i != this->end(); ++i)
-		{
-			stream << i->first << ":" << i->second << " ";// << endl;
-		}
+		for (size_t i = 0; i < size(); ++i)
+			stream << _keys[i] << ":" << _values[i] << " ";// << endl;
 
 		if (addEndl)
 			stream << std::endl;
 	}
 
 	/*!
-	 * \return a libSVM compatible sparse vector containing the histogram.
+	 * \return a libSVM compatible sparse vector containing the histogram,
+	 * terminated by the index -1.
 	 */
-	Feature *getLibSvmVector()
+	Feature *getLibSvmVector() const
 	{
 		rocsDebug3("getLibSvmVector()");
 
-		//Feature *vector = aMalloc<Feature> (size() + 1);
-		Feature *vector = new Feature[this->size() + 1];
-
-		int nr = 0;
-		for (typename Type::const_iterator i = this->begin(); i != this->end(); ++i, ++nr)
+		Feature *vector = new Feature[size() + 1];
+		for (size_t nr = 0; nr < size(); ++nr)
 		{
-			vector[nr].first = i->first;//key();
-			vector[nr].second = i->second;//.value();
+			vector[nr].first = _keys[nr];
+			vector[nr].second = _values[nr];
 		}
 
-		vector[this->size()].first = -1;
-		vector[this->size()].second = 0.0;
+		vector[size()].first = -1;
+		vector[size()].second = 0.0;
 
 		return vector;
 	}
 
-	//private:
+private:
+
+	/*! position of the first key not smaller than index */
+	size_t lowerBoundPosition(keyType index) const
+	{
+		return std::lower_bound(_keys.begin(), _keys.end(), index)
+				- _keys.begin();
+	}
+
+	/*! keys of the bins, sorted */
+	std::vector<keyType> _keys;
+
+	/*! values of the bins */
+	std::vector<valueType> _values;
+
+public:
 
 	/*! Sum of all values before normalization. */
 	valueType _sum;
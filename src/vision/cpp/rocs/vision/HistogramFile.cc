@@ -0,0 +1,290 @@
+// ==================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (C) 2010  Arnaud Ramey, Andrzej Pronobis
+//
+// This file is part of ROCS.
+//
+// ROCS is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation, either version 3
+// of the License, or (at your option) any later version.
+//
+// ROCS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ROCS. If not, see <http://www.gnu.org/licenses/>.
+// ==================================================================
+
+
+/*!
+ * \file HistogramFile.cc
+ *
+ * Contains implementation of the HistogramFile and HistogramFileWriter classes.
+ *
+ * \author Andrzej Pronobis
+ */
+
+#include "rocs/cv/HistogramFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string.h>
+#include <climits>
+#include <fstream>
+#include <sstream>
+
+namespace rocs {
+namespace cv {
+
+/*! Current version of the format. */
+#define HISTOGRAM_FILE_VERSION 1
+
+/*! Header of a histogram file. */
+struct HistogramFileHeader {
+	char magic[4];
+	int version;
+	int valueType;
+	int reserved;
+	long long size;
+	long long tableOffset;
+};
+
+/*! Returns a length rounded up to a multiple of 8. */
+static inline long long align8(long long length) {
+	return (length + 7) & ~7LL;
+}
+
+// -----------------------------------------
+void HistogramView::toFeatureList(FeatureList<int, double> &list) const {
+	list.reserve(list.size() + size);
+	for (int k = 0; k < size; ++k)
+		list.append(keys[k], value(k));
+}
+
+// -----------------------------------------
+HistogramFile::HistogramFile(const std::string &fileName) :
+	_data(0), _length(0), _size(0), _valueType(HVT_DOUBLE), _offsets(0) {
+	rocsDebug3("HistogramFile('%s')", fileName.c_str());
+
+	int fd = open(fileName.c_str(), O_RDONLY);
+	if (fd < 0)
+		rocsIOException("Cannot open the histogram file '%s'.", fileName.c_str());
+	struct stat st;
+	if ((fstat(fd, &st) != 0) || (st.st_size < (off_t) sizeof(HistogramFileHeader))) {
+		::close(fd);
+		rocsIOException("'%s' is not a histogram file.", fileName.c_str());
+	}
+	_length = st.st_size;
+	void *data = mmap(0, _length, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (data == MAP_FAILED)
+		rocsIOException("Cannot map the histogram file '%s'.", fileName.c_str());
+	_data = static_cast<const char *> (data);
+
+	// Validate the header and the offset table
+	const HistogramFileHeader *header =
+			reinterpret_cast<const HistogramFileHeader *> (_data);
+	if ((memcmp(header->magic, "RCHF", 4) != 0) || (header->version
+			!= HISTOGRAM_FILE_VERSION) || ((header->valueType != HVT_FLOAT)
+			&& (header->valueType != HVT_DOUBLE)) || (header->size < 0)
+			|| (header->tableOffset < (long long) sizeof(HistogramFileHeader))
+			|| (header->tableOffset % sizeof(long long) != 0)
+			|| (header->size > (long long) _length)
+			|| (header->tableOffset + header->size
+					* (long long) sizeof(long long) > (long long) _length)) {
+		munmap(const_cast<char *> (_data), _length);
+		rocsIOException("'%s' is not a valid histogram file.", fileName.c_str());
+	}
+	_size = header->size;
+	_valueType = static_cast<HistogramValueType> (header->valueType);
+	_offsets = reinterpret_cast<const long long *> (_data
+			+ header->tableOffset);
+
+	// Validate the histograms once, operator[] does not check them
+	for (long i = 0; i < _size; ++i)
+		if (!isValidRecord(_offsets[i])) {
+			munmap(const_cast<char *> (_data), _length);
+			rocsIOException("The histogram %li of '%s' lies outside of the file.", i, fileName.c_str());
+		}
+}
+
+// -----------------------------------------
+bool HistogramFile::isValidRecord(long long offset) const {
+	// Number of bins
+	long long length = _length;
+	if ((offset < (long long) sizeof(HistogramFileHeader)) || (offset
+			% sizeof(long long) != 0) || (offset > length
+			- (long long) sizeof(long long)))
+		return false;
+	long long size = *reinterpret_cast<const long long *> (_data + offset);
+
+	// Keys and values, the size is bounded first to avoid overflows
+	long long available = length - offset - sizeof(long long);
+	if ((size < 0) || (size > INT_MAX) || (size > available
+			/ (long long) sizeof(int)))
+		return false;
+	return align8(size * sizeof(int)) + size * _valueType <= available;
+}
+
+// -----------------------------------------
+HistogramFile::~HistogramFile() {
+	if (_data)
+		munmap(const_cast<char *> (_data), _length);
+}
+
+// -----------------------------------------
+HistogramView HistogramFile::operator[](long i) const {
+	const char *record = _data + _offsets[i];
+	long long size = *reinterpret_cast<const long long *> (record);
+
+	HistogramView view;
+	view.size = static_cast<int> (size);
+	view.keys = reinterpret_cast<const int *> (record + sizeof(long long));
+	const char *values = record + sizeof(long long) + align8(size
+			* sizeof(int));
+	view.floatValues = (_valueType == HVT_FLOAT) ? reinterpret_cast<
+			const float *> (values) : 0;
+	view.doubleValues = (_valueType == HVT_DOUBLE) ? reinterpret_cast<
+			const double *> (values) : 0;
+	return view;
+}
+
+// -----------------------------------------
+void HistogramFile::convertFromText(const std::string &textFileName,
+		const std::string &binaryFileName, HistogramValueType valueType) {
+	std::ifstream input(textFileName.c_str());
+	if (!input.is_open())
+		rocsIOException("Cannot open the text file '%s'.", textFileName.c_str());
+
+	HistogramFileWriter writer(binaryFileName, valueType);
+	std::string line;
+	std::string token;
+	while (std::getline(input, line)) {
+		FeatureList<int, double> list;
+		std::istringstream tokens(line);
+		while (tokens >> token) {
+			std::string::size_type colon = token.find(':');
+			if (colon == std::string::npos)
+				continue;
+			list.append(atoi(token.substr(0, colon).c_str()), atof(
+					token.substr(colon + 1).c_str()));
+		}
+		writer.write(list);
+	}
+	writer.close();
+}
+
+// -----------------------------------------
+void HistogramFile::convertToText(const std::string &binaryFileName,
+		const std::string &textFileName) {
+	HistogramFile file(binaryFileName);
+	std::ofstream output(textFileName.c_str());
+	if (!output.is_open())
+		rocsIOException("Cannot create the text file '%s'.", textFileName.c_str());
+
+	// Enough digits to read the same doubles back
+	output.precision(17);
+	for (long i = 0; i < file.size(); ++i) {
+		HistogramView view = file[i];
+		for (int k = 0; k < view.size; ++k)
+			output << view.keys[k] << ":" << view.value(k) << " ";
+		output << std::endl;
+	}
+}
+
+// -----------------------------------------
+HistogramFileWriter::HistogramFileWriter(const std::string &fileName,
+		HistogramValueType valueType) :
+	_file(0), _valueType(valueType), _position(0) {
+	rocsDebug3("HistogramFileWriter('%s', %i)", fileName.c_str(), valueType);
+
+	_file = fopen(fileName.c_str(), "wb");
+	if (!_file)
+		rocsIOException("Cannot create the histogram file '%s'.", fileName.c_str());
+
+	// Placeholder for the header, completed by close()
+	HistogramFileHeader header;
+	memset(&header, 0, sizeof(header));
+	if (fwrite(&header, sizeof(header), 1, _file) != 1) {
+		fclose(_file);
+		rocsIOException("Cannot write the histogram file '%s'.", fileName.c_str());
+	}
+	_position = sizeof(header);
+}
+
+// -----------------------------------------
+HistogramFileWriter::~HistogramFileWriter() {
+	if (_file) {
+		try {
+			close();
+		} catch (core::IOException &e) {
+			rocsDebug1("%s", e.what());
+		}
+	}
+}
+
+// -----------------------------------------
+void HistogramFileWriter::write(const FeatureList<int, double> &list) {
+	write(list.size(), list.keys(), list.values());
+}
+
+// -----------------------------------------
+void HistogramFileWriter::write(int size, const int *keys,
+		const double *values) {
+	static const char padding[8] = { 0 };
+
+	_offsets.push_back(_position);
+	long long count = size;
+	writeData(&count, sizeof(count));
+	writeData(keys, size * sizeof(int));
+	writeData(padding, align8(size * sizeof(int)) - size * sizeof(int));
+	if (_valueType == HVT_FLOAT) {
+		_floatValues.assign(values, values + size);
+		writeData((size) ? &_floatValues[0] : 0, size * sizeof(float));
+		writeData(padding, align8(size * sizeof(float)) - size
+				* sizeof(float));
+	} else
+		writeData(values, size * sizeof(double));
+}
+
+// -----------------------------------------
+void HistogramFileWriter::close() {
+	if (!_file)
+		return;
+
+	// Offset table
+	HistogramFileHeader header;
+	memcpy(header.magic, "RCHF", 4);
+	header.version = HISTOGRAM_FILE_VERSION;
+	header.valueType = _valueType;
+	header.reserved = 0;
+	header.size = _offsets.size();
+	header.tableOffset = _position;
+	writeData((_offsets.empty()) ? 0 : &_offsets[0], _offsets.size()
+			* sizeof(long long));
+
+	// Header
+	bool ok = (fseek(_file, 0, SEEK_SET) == 0) && (fwrite(&header,
+			sizeof(header), 1, _file) == 1);
+	ok = (fclose(_file) == 0) && ok;
+	_file = 0;
+	if (!ok)
+		rocsIOException("Cannot write the histogram file.");
+}
+
+// -----------------------------------------
+void HistogramFileWriter::writeData(const void *data, size_t length) {
+	if (!length)
+		return;
+	if (fwrite(data, 1, length, _file) != length)
+		rocsIOException("Cannot write the histogram file.");
+	_position += length;
+}
+
+} // end namespace cv
+} // end namespace rocs
@@ -0,0 +1,209 @@
+// ==================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (C) 2010  Arnaud Ramey, Andrzej Pronobis
+//
+// This file is part of ROCS.
+//
+// ROCS is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation, either version 3
+// of the License, or (at your option) any later version.
+//
+// ROCS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ROCS. If not, see <http://www.gnu.org/licenses/>.
+// ==================================================================
+
+
+/*!
+ * \file HistogramFile.h
+ *
+ * \author Andrzej Pronobis
+ *
+ * Contains declaration of the HistogramFile and HistogramFileWriter classes.
+ */
+
+#ifndef HISTOGRAMFILE_H_
+#define HISTOGRAMFILE_H_
+
+#include "rocs/cv/FeatureList.h"
+#include "rocs/core/error.h"
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace rocs {
+namespace cv {
+
+/*! Type of the values stored in a histogram file. */
+enum HistogramValueType {
+	HVT_FLOAT = 4, HVT_DOUBLE = 8
+};
+
+/*!
+ * Read-only view of a histogram stored in a HistogramFile. The keys
+ * and values point directly into the mapped file and are valid as long
+ * as the file is open. The keys are sorted in the increasing order.
+ */
+struct HistogramView {
+
+	/*! Number of non-zero bins. */
+	int size;
+
+	/*! Keys of the bins. */
+	const int *keys;
+
+	/*! Values of the bins, only one of the pointers is not null
+	 depending on the type of the values in the file. */
+	const float *floatValues;
+	const double *doubleValues;
+
+	/*! Returns the value of the k-th bin. */
+	inline double value(int k) const {
+		return (floatValues) ? floatValues[k] : doubleValues[k];
+	}
+
+	/*! Copies the histogram to a FeatureList. */
+	void toFeatureList(FeatureList<int, double> &list) const;
+};
+
+/*!
+ * Collection of sparse histograms stored in a binary file and
+ * accessed through a memory mapping.
+ *
+ * Layout of the file (native byte order, all the sections aligned
+ * to 8 bytes):
+ *  - header: magic "RCHF", version, value type (HistogramValueType),
+ *    reserved, number of histograms, offset of the offset table,
+ *  - histograms: for each, the number of bins (int64), the keys
+ *    (int32) padded to 8 bytes and the values (float32 or float64),
+ *  - offset table: offset of each histogram (int64).
+ */
+class HistogramFile {
+
+public:
+
+	/*! Maps a file. Throws core::IOException if the file cannot
+	 be opened or is not a valid histogram file, including when
+	 any of the histograms does not lie entirely inside the file. */
+	HistogramFile(const std::string &fileName);
+
+	/*! Unmaps the file. */
+	~HistogramFile();
+
+public:
+
+	/*! Returns the number of histograms. */
+	inline long size() const {
+		return _size;
+	}
+
+	/*! Returns the type of the values. */
+	inline HistogramValueType getValueType() const {
+		return _valueType;
+	}
+
+	/*! Returns the view of the i-th histogram. */
+	HistogramView operator[](long i) const;
+
+	/*! Converts a text file containing one histogram per line in
+	 the libSVM format (see FeatureList::serialize()) to a binary file.
+	 Tokens without a colon (labels) are ignored. */
+	static void convertFromText(const std::string &textFileName,
+			const std::string &binaryFileName, HistogramValueType valueType =
+					HVT_DOUBLE);
+
+	/*! Converts a binary file to a text file containing one histogram
+	 per line in the libSVM format. */
+	static void convertToText(const std::string &binaryFileName,
+			const std::string &textFileName);
+
+private:
+
+	/*! Returns true if the histogram at a given offset lies
+	 entirely inside the mapped file. */
+	bool isValidRecord(long long offset) const;
+
+	/*! Disabled copying. */
+	HistogramFile(const HistogramFile &);
+	HistogramFile &operator=(const HistogramFile &);
+
+private:
+
+	/*! Mapped file and its length. */
+	const char *_data;
+	size_t _length;
+
+	/*! Number of histograms. */
+	long _size;
+
+	/*! Type of the values. */
+	HistogramValueType _valueType;
+
+	/*! Offset table inside the mapped file. */
+	const long long *_offsets;
+};
+
+/*!
+ * Writes histograms to a binary file read by HistogramFile.
+ * The histograms are appended one by one, the offset table and
+ * the header are completed by close().
+ */
+class HistogramFileWriter {
+
+public:
+
+	/*! Creates a file. Throws core::IOException on failure. */
+	HistogramFileWriter(const std::string &fileName,
+			HistogramValueType valueType = HVT_DOUBLE);
+
+	/*! Closes the file if not closed. */
+	~HistogramFileWriter();
+
+public:
+
+	/*! Appends a histogram. */
+	void write(const FeatureList<int, double> &list);
+
+	/*! Appends a histogram given as sorted keys and values. */
+	void write(int size, const int *keys, const double *values);
+
+	/*! Writes the offset table and the header and closes the file. */
+	void close();
+
+private:
+
+	/*! Writes data, throws core::IOException on failure. */
+	void writeData(const void *data, size_t length);
+
+	/*! Disabled copying. */
+	HistogramFileWriter(const HistogramFileWriter &);
+	HistogramFileWriter &operator=(const HistogramFileWriter &);
+
+private:
+
+	/*! Written file or null once closed. */
+	FILE *_file;
+
+	/*! Type of the values. */
+	HistogramValueType _valueType;
+
+	/*! Offsets of the written histograms. */
+	std::vector<long long> _offsets;
+
+	/*! Current position in the file. */
+	long long _position;
+
+	/*! Buffer for the values of a histogram converted to floats. */
+	std::vector<float> _floatValues;
+};
+
+} // end namespace cv
+} // end namespace rocs
+
+#endif /* HISTOGRAMFILE_H_ */
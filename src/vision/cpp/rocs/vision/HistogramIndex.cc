@@ -0,0 +1,263 @@
+// ==================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (C) 2010  Arnaud Ramey, Andrzej Pronobis
+//
+// This file is part of ROCS.
+//
+// ROCS is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation, either version 3
+// of the License, or (at your option) any later version.
+//
+// ROCS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ROCS. If not, see <http://www.gnu.org/licenses/>.
+// ==================================================================
+
+
+/*!
+ * \file HistogramIndex.cc
+ *
+ * Contains implementation of the HistogramIndex class.
+ *
+ * \author Andrzej Pronobis
+ */
+
+#include "rocs/cv/HistogramIndex.h"
+
+#include <algorithm>
+#include <cmath>
+
+/*! Relative difference of masses or measures considered as rounding. */
+#define ROUNDING_TOLERANCE 1e-9
+
+namespace rocs {
+namespace cv {
+
+/*! Orders the matches from the best, ties by the identifier. */
+struct MatchOrder {
+	bool similarity;
+	MatchOrder(bool similarity) :
+		similarity(similarity) {
+	}
+	inline bool operator()(const HistogramIndex::Match &a,
+			const HistogramIndex::Match &b) const {
+		if (a.value != b.value)
+			return (similarity) ? (a.value > b.value) : (a.value < b.value);
+		return a.id < b.id;
+	}
+};
+
+/*! Orders the identifiers of histograms by increasing mass. */
+struct MassOrder {
+	const std::vector<SparseHistogram> *histograms;
+	MassOrder(const std::vector<SparseHistogram> *histograms) :
+		histograms(histograms) {
+	}
+	inline bool operator()(int a, int b) const {
+		double massA = (*histograms)[a].getSum();
+		double massB = (*histograms)[b].getSum();
+		if (massA != massB)
+			return massA < massB;
+		return a < b;
+	}
+};
+
+/*! Orders the bins of the query from the largest value. */
+struct BinValueOrder {
+	const double *values;
+	BinValueOrder(const double *values) :
+		values(values) {
+	}
+	inline bool operator()(int a, int b) const {
+		if (values[a] != values[b])
+			return values[a] > values[b];
+		return a < b;
+	}
+};
+
+// -----------------------------------------
+HistogramIndex::HistogramIndex(HistogramMeasure measure) :
+	_measure(measure), _maxQueryBins(0), _rerankSize(100) {
+	if ((_measure != HM_INTERSECTION) && (_measure != HM_CHI2)) {
+		rocsDebug1("ERROR: HistogramIndex supports only the intersection and chi2, using chi2.");
+		_measure = HM_CHI2;
+	}
+}
+
+// -----------------------------------------
+int HistogramIndex::add(const SparseHistogram &histogram) {
+	int id = _histograms.size();
+	_histograms.push_back(histogram);
+
+	const int *keys = histogram.keys();
+	const double *values = histogram.values();
+	for (int k = 0; k < (int) histogram.size(); ++k) {
+		Posting posting;
+		posting.id = id;
+		posting.value = values[k];
+		_postings[keys[k]].push_back(posting);
+	}
+
+	_massOrder.insert(std::upper_bound(_massOrder.begin(), _massOrder.end(),
+			id, MassOrder(&_histograms)), id);
+	_sums.push_back(0);
+	_seen.push_back(0);
+	return id;
+}
+
+// -----------------------------------------
+double HistogramIndex::measureFromSum(const SparseHistogram &query, int id,
+		double sum) const {
+	// The postings give only the common bins, the chi2 distance is
+	// expanded as (a-b)^2/(a+b) = a+b-4ab/(a+b)
+	if (_measure == HM_INTERSECTION)
+		return sum;
+	return std::max(0.0, query.getSum() + _histograms[id].getSum() - 4 * sum);
+}
+
+// -----------------------------------------
+void HistogramIndex::addUntouched(const SparseHistogram &query, int k,
+		std::vector<Match> &matches) const {
+	// The intersection is 0 for all of them, the first identifiers
+	// are the best. The chi2 distance a+b grows with the mass. Computed
+	// directly it is rounded differently, so the histograms whose mass
+	// equals the last one up to rounding are taken as well.
+	int added = 0;
+	double lastMass = 0;
+	for (unsigned int i = 0; i < _histograms.size(); ++i) {
+		const int id = (_measure == HM_INTERSECTION) ? i : _massOrder[i];
+		double mass = _histograms[id].getSum();
+		if ((added >= k) && ((_measure == HM_INTERSECTION) || (mass
+				> lastMass + ROUNDING_TOLERANCE * (1 + lastMass))))
+			break;
+		if (_seen[id])
+			continue;
+		Match match;
+		match.id = id;
+		match.value = measureFromSum(query, id, 0);
+		matches.push_back(match);
+		lastMass = mass;
+		++added;
+	}
+}
+
+// -----------------------------------------
+void HistogramIndex::selectCandidates(std::vector<Match> &matches, int k) const {
+	if (k <= 0) {
+		matches.clear();
+		return;
+	}
+	std::sort(matches.begin(), matches.end(), MatchOrder(_measure
+			== HM_INTERSECTION));
+	if (k >= (int) matches.size())
+		return;
+
+	// The measures obtained from the sums are rounded differently from
+	// those computed directly, the candidates equal to the last one up
+	// to rounding are kept too
+	double last = matches[k - 1].value;
+	unsigned int end = k;
+	while ((end < matches.size()) && (fabs(matches[end].value - last)
+			<= ROUNDING_TOLERANCE * (1 + fabs(last))))
+		++end;
+	matches.resize(end);
+}
+
+// -----------------------------------------
+void HistogramIndex::selectBest(std::vector<Match> &matches, int k) const {
+	MatchOrder order(_measure == HM_INTERSECTION);
+	if (k < (int) matches.size()) {
+		std::partial_sort(matches.begin(), matches.begin() + k, matches.end(),
+				order);
+		matches.resize(k);
+	} else
+		std::sort(matches.begin(), matches.end(), order);
+}
+
+// -----------------------------------------
+void HistogramIndex::query(const SparseHistogram &query, int k,
+		std::vector<Match> &matches) const {
+	matches.clear();
+	const int *keys = query.keys();
+	const double *values = query.values();
+
+	// Bins of the query visited in the increasing order of keys,
+	// the largest ones if approximating
+	_queryBins.resize(query.size());
+	for (int b = 0; b < (int) query.size(); ++b)
+		_queryBins[b] = b;
+	bool approximate = (_maxQueryBins > 0) && (_maxQueryBins < (int) query.size());
+	if (approximate) {
+		std::nth_element(_queryBins.begin(), _queryBins.begin()
+				+ _maxQueryBins, _queryBins.end(), BinValueOrder(values));
+		_queryBins.resize(_maxQueryBins);
+		std::sort(_queryBins.begin(), _queryBins.end());
+	}
+
+	// Accumulate the sums over the common bins
+	_touched.clear();
+	for (unsigned int b = 0; b < _queryBins.size(); ++b) {
+		std::map<int, std::vector<Posting> >::const_iterator list =
+				_postings.find(keys[_queryBins[b]]);
+		if (list == _postings.end())
+			continue;
+		const double q = values[_queryBins[b]];
+		const std::vector<Posting> &postings = list->second;
+		for (unsigned int p = 0; p < postings.size(); ++p) {
+			const int id = postings[p].id;
+			const double v = postings[p].value;
+			if (!_seen[id]) {
+				_seen[id] = 1;
+				_touched.push_back(id);
+			}
+			if (_measure == HM_INTERSECTION)
+				_sums[id] += std::min(q, v);
+			else if (q + v > 0)
+				_sums[id] += q * v / (q + v);
+		}
+	}
+
+	// Measures of the candidates, the histograms without common bins
+	// included, resetting the buffers
+	int candidates = (approximate) ? std::max(k, _rerankSize) : k;
+	for (unsigned int t = 0; t < _touched.size(); ++t) {
+		const int id = _touched[t];
+		Match match;
+		match.id = id;
+		match.value = measureFromSum(query, id, _sums[id]);
+		matches.push_back(match);
+	}
+	addUntouched(query, candidates, matches);
+	for (unsigned int t = 0; t < _touched.size(); ++t) {
+		_sums[_touched[t]] = 0;
+		_seen[_touched[t]] = 0;
+	}
+
+	// Re-rank the best candidates with the measure computed directly,
+	// more of them if the sums were approximated
+	selectCandidates(matches, candidates);
+	for (unsigned int m = 0; m < matches.size(); ++m)
+		matches[m].value = HistogramSimilarity::compare(_measure, query,
+				_histograms[matches[m].id]);
+	selectBest(matches, k);
+}
+
+// -----------------------------------------
+void HistogramIndex::queryLinear(const SparseHistogram &query, int k,
+		std::vector<Match> &matches) const {
+	matches.resize(_histograms.size());
+	for (unsigned int id = 0; id < _histograms.size(); ++id) {
+		matches[id].id = id;
+		matches[id].value = HistogramSimilarity::compare(_measure, query,
+				_histograms[id]);
+	}
+	selectBest(matches, k);
+}
+
+} // end namespace cv
+} // end namespace rocs
@@ -0,0 +1,177 @@
+// ==================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (C) 2010  Arnaud Ramey, Andrzej Pronobis
+//
+// This file is part of ROCS.
+//
+// ROCS is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation, either version 3
+// of the License, or (at your option) any later version.
+//
+// ROCS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ROCS. If not, see <http://www.gnu.org/licenses/>.
+// ==================================================================
+
+
+/*!
+ * \file HistogramIndex.h
+ *
+ * \author Andrzej Pronobis
+ *
+ * Contains declaration of the HistogramIndex class.
+ */
+
+#ifndef HISTOGRAMINDEX_H_
+#define HISTOGRAMINDEX_H_
+
+#include "rocs/cv/HistogramSimilarity.h"
+
+#include <map>
+#include <vector>
+
+namespace rocs {
+namespace cv {
+
+/*!
+ * Index of sparse histograms answering top-k queries under the
+ * intersection (HM_INTERSECTION) or chi2 (HM_CHI2) measure.
+ *
+ * The index is an inverted file: for each bin, the list of the
+ * histograms having the bin non-zero, with the values. A query visits
+ * only the lists of its own bins and accumulates the sums over the
+ * common bins from which the candidates are ranked, so the cost depends
+ * on the number of histograms sharing bins with the query, not on the
+ * size of the index. The histograms sharing no bin with the query
+ * are scored from their masses alone (the intersection is 0, the chi2
+ * distance the sum of both masses), only the k best of them are
+ * considered, taken from a list ordered by mass. The measures of the
+ * best candidates are then computed directly (see HistogramSimilarity).
+ *
+ * With all the bins of the query visited, the results are exact
+ * for any histograms, normalized or not.
+ * The search can be approximated by visiting only the largest bins of
+ * the query (setMaxQueryBins()). The candidates are then ranked by the
+ * partial sums and the best ones are re-ranked with the exact measure
+ * (setRerankSize()).
+ *
+ * Histograms can be added at any time. Queries reuse internal buffers
+ * and must not be run concurrently on the same index.
+ */
+class HistogramIndex {
+
+public:
+
+	/*! Result of a query. */
+	struct Match {
+		/*! Identifier of the histogram (order of insertion). */
+		int id;
+
+		/*! Value of the measure. */
+		double value;
+	};
+
+public:
+
+	/*! Creates an empty index for a given measure, HM_INTERSECTION
+	 or HM_CHI2. */
+	HistogramIndex(HistogramMeasure measure = HM_CHI2);
+
+public:
+
+	/*! Adds a histogram and returns its identifier. */
+	int add(const SparseHistogram &histogram);
+
+	/*! Returns the number of histograms. */
+	inline int size() const {
+		return _histograms.size();
+	}
+
+	/*! Returns the histogram with a given identifier. */
+	inline const SparseHistogram &getHistogram(int id) const {
+		return _histograms[id];
+	}
+
+	/*! Sets the maximal number of bins of the query, the largest ones,
+	 used to select the candidates. 0 (default) uses all the bins
+	 and gives exact results. */
+	inline void setMaxQueryBins(int maxQueryBins) {
+		_maxQueryBins = maxQueryBins;
+	}
+
+	/*! Sets the minimal number of candidates re-ranked with the exact
+	 measure when the query is approximated (default 100). */
+	inline void setRerankSize(int rerankSize) {
+		_rerankSize = rerankSize;
+	}
+
+	/*! Finds k histograms most similar to the query, the best first. */
+	void query(const SparseHistogram &query, int k,
+			std::vector<Match> &matches) const;
+
+	/*! Finds k histograms most similar to the query by comparing it
+	 with all the histograms (reference for query()). */
+	void queryLinear(const SparseHistogram &query, int k,
+			std::vector<Match> &matches) const;
+
+private:
+
+	/*! A histogram in the list of a bin. */
+	struct Posting {
+		int id;
+		double value;
+	};
+
+	/*! Computes the measure from the sum over the common bins. */
+	double measureFromSum(const SparseHistogram &query, int id,
+			double sum) const;
+
+	/*! Appends to the matches the k best histograms sharing no bin
+	 with the query, which must be flagged in _seen. */
+	void addUntouched(const SparseHistogram &query, int k,
+			std::vector<Match> &matches) const;
+
+	/*! Sorts the matches from the best and keeps k of them and those
+	 equal to the k-th one up to rounding. */
+	void selectCandidates(std::vector<Match> &matches, int k) const;
+
+	/*! Sorts the matches from the best and keeps k of them. */
+	void selectBest(std::vector<Match> &matches, int k) const;
+
+private:
+
+	/*! Measure. */
+	HistogramMeasure _measure;
+
+	/*! Stored histograms. */
+	std::vector<SparseHistogram> _histograms;
+
+	/*! Identifiers of the histograms ordered by increasing mass,
+	 then by identifier. */
+	std::vector<int> _massOrder;
+
+	/*! Lists of the histograms of each bin, ordered by identifiers. */
+	std::map<int, std::vector<Posting> > _postings;
+
+	/*! Approximation parameters. */
+	int _maxQueryBins;
+	int _rerankSize;
+
+	/*! Buffers of the queries: sums over the common bins per histogram,
+	 flags and list of the histograms sharing a bin with the query,
+	 and the selected query bins. */
+	mutable std::vector<double> _sums;
+	mutable std::vector<char> _seen;
+	mutable std::vector<int> _touched;
+	mutable std::vector<int> _queryBins;
+};
+
+} // end namespace cv
+} // end namespace rocs
+
+#endif /* HISTOGRAMINDEX_H_ */
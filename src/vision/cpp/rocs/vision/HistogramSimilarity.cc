@@ -0,0 +1,318 @@
+// ==================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (C) 2010  Arnaud Ramey, Andrzej Pronobis
+//
+// This file is part of ROCS.
+//
+// ROCS is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation, either version 3
+// of the License, or (at your option) any later version.
+//
+// ROCS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ROCS. If not, see <http://www.gnu.org/licenses/>.
+// ==================================================================
+
+
+/*!
+ * \file HistogramSimilarity.cc
+ *
+ * Contains implementation of the HistogramSimilarity class.
+ *
+ * \author Andrzej Pronobis
+ */
+
+#include <algorithm>
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <boost/bind.hpp>
+
+#include "rocs/math/Matrix_.h"
+#include "rocs/core/ThreadPool.h"
+
+#include "rocs/cv/HistogramSimilarity.h"
+
+namespace rocs {
+namespace cv {
+
+/*! Sum of min(a,b) over the common bins. */
+struct MinSum {
+	double sum;
+	MinSum() : sum(0) {
+	}
+	inline void operator()(double a, double b) {
+		sum += std::min(a, b);
+	}
+};
+
+/*! Sum of (a-b)^2/(a+b) over all the bins. */
+struct Chi2Sum {
+	double sum;
+	Chi2Sum() : sum(0) {
+	}
+	inline void operator()(double a, double b) {
+		double d = a - b;
+		if (a + b > 0)
+			sum += d * d / (a + b);
+	}
+};
+
+/*! Sum of |a-b| over all the bins. */
+struct AbsDiffSum {
+	double sum;
+	AbsDiffSum() : sum(0) {
+	}
+	inline void operator()(double a, double b) {
+		sum += fabs(a - b);
+	}
+};
+
+/*! Sum of (a-b)^2 over all the bins. */
+struct SquaredDiffSum {
+	double sum;
+	SquaredDiffSum() : sum(0) {
+	}
+	inline void operator()(double a, double b) {
+		double d = a - b;
+		sum += d * d;
+	}
+};
+
+/*! Sum of sqrt(a*b) over the common bins. */
+struct SqrtProductSum {
+	double sum;
+	SqrtProductSum() : sum(0) {
+	}
+	inline void operator()(double a, double b) {
+		sum += sqrt(a * b);
+	}
+};
+
+/*! Calls the accumulator for the values of all the keys present
+ in both histograms, in the increasing order of keys. */
+template<typename _Acc>
+static void mergeCommon(const SparseHistogram &a, const SparseHistogram &b,
+		_Acc &acc) {
+	const int *ka = a.keys();
+	const int *kb = b.keys();
+	const double *va = a.values();
+	const double *vb = b.values();
+	const int na = a.size();
+	const int nb = b.size();
+	int i = 0;
+	int j = 0;
+
+#if defined(__SSE2__)
+	// Compare blocks of 4 keys of each histogram. Lane p of the
+	// rotation r compares ka[i+p] with kb[j+((p+r)&3)]. The block
+	// with the smaller last key is skipped.
+	while ((i + 4 <= na) && (j + 4 <= nb)) {
+		__m128i blockA = _mm_loadu_si128(reinterpret_cast<const __m128i *> (ka
+				+ i));
+		__m128i blockB = _mm_loadu_si128(reinterpret_cast<const __m128i *> (kb
+				+ j));
+		int masks[4];
+		masks[0] = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(blockA,
+				blockB)));
+		masks[1] = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(blockA,
+				_mm_shuffle_epi32(blockB, _MM_SHUFFLE(0, 3, 2, 1)))));
+		masks[2] = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(blockA,
+				_mm_shuffle_epi32(blockB, _MM_SHUFFLE(1, 0, 3, 2)))));
+		masks[3] = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(blockA,
+				_mm_shuffle_epi32(blockB, _MM_SHUFFLE(2, 1, 0, 3)))));
+		if (masks[0] | masks[1] | masks[2] | masks[3])
+			for (int p = 0; p < 4; ++p)
+				for (int r = 0; r < 4; ++r)
+					if (masks[r] & (1 << p))
+						acc(va[i + p], vb[j + ((p + r) & 3)]);
+
+		const int lastA = ka[i + 3];
+		const int lastB = kb[j + 3];
+		if (lastA <= lastB)
+			i += 4;
+		if (lastB <= lastA)
+			j += 4;
+	}
+#endif
+
+	while ((i < na) && (j < nb)) {
+		if (ka[i] < kb[j])
+			++i;
+		else if (kb[j] < ka[i])
+			++j;
+		else {
+			acc(va[i], vb[j]);
+			++i;
+			++j;
+		}
+	}
+}
+
+/*! Calls the accumulator for the values of all the keys present
+ in any of the histograms, in the increasing order of keys. A bin
+ missing in one of the histograms is passed as 0. */
+template<typename _Acc>
+static void mergeUnion(const SparseHistogram &a, const SparseHistogram &b,
+		_Acc &acc) {
+	const int *ka = a.keys();
+	const int *kb = b.keys();
+	const double *va = a.values();
+	const double *vb = b.values();
+	const int na = a.size();
+	const int nb = b.size();
+	int i = 0;
+	int j = 0;
+
+	while ((i < na) && (j < nb)) {
+		if (ka[i] < kb[j])
+			acc(va[i++], 0);
+		else if (kb[j] < ka[i])
+			acc(0, vb[j++]);
+		else
+			acc(va[i++], vb[j++]);
+	}
+	for (; i < na; ++i)
+		acc(va[i], 0);
+	for (; j < nb; ++j)
+		acc(0, vb[j]);
+}
+
+// -----------------------------------------
+double HistogramSimilarity::compare(HistogramMeasure measure,
+		const SparseHistogram &a, const SparseHistogram &b) {
+	switch (measure) {
+	case HM_INTERSECTION: {
+		MinSum acc;
+		mergeCommon(a, b, acc);
+		return acc.sum;
+	}
+	case HM_CHI2: {
+		Chi2Sum acc;
+		mergeUnion(a, b, acc);
+		return acc.sum;
+	}
+	case HM_L1: {
+		AbsDiffSum acc;
+		mergeUnion(a, b, acc);
+		return acc.sum;
+	}
+	case HM_L2: {
+		SquaredDiffSum acc;
+		mergeUnion(a, b, acc);
+		return sqrt(acc.sum);
+	}
+	case HM_BHATTACHARYYA: {
+		SqrtProductSum acc;
+		mergeCommon(a, b, acc);
+		return acc.sum;
+	}
+	}
+
+	rocsDebug1("ERROR: Unknown histogram measure %i!", measure);
+	return 0;
+}
+
+// -----------------------------------------
+void HistogramSimilarity::compareRange(HistogramMeasure measure,
+		const SparseHistogram *query,
+		const std::vector<SparseHistogram> *histograms, int begin, int end,
+		double *results) {
+	for (int i = begin; i < end; ++i)
+		results[i] = compare(measure, *query, (*histograms)[i]);
+}
+
+// -----------------------------------------
+void HistogramSimilarity::compare(HistogramMeasure measure,
+		const SparseHistogram &query,
+		const std::vector<SparseHistogram> &histograms,
+		std::vector<double> &results, core::ThreadPool *threadPool) {
+	int size = histograms.size();
+	results.resize(size);
+	if (!size)
+		return;
+	if (!threadPool) {
+		compareRange(measure, &query, &histograms, 0, size, &results[0]);
+		return;
+	}
+
+	// Several blocks per thread to balance the load
+	int blocks = 4 * threadPool->getNbThreads();
+	int blockSize = (size + blocks - 1) / blocks;
+	for (int begin = 0; begin < size; begin += blockSize)
+		threadPool->schedule(boost::bind(&HistogramSimilarity::compareRange,
+				measure, &query, &histograms, begin, std::min(begin
+						+ blockSize, size), &results[0]));
+	threadPool->wait();
+}
+
+// -----------------------------------------
+void HistogramSimilarity::computeGramRows(HistogramMeasure measure,
+		const std::vector<SparseHistogram> *rows,
+		const std::vector<SparseHistogram> *cols, bool symmetric, int begin,
+		int end, math::Matrix_<double> *result) {
+	opencv::Mat &out = *result->asOpenCvMat();
+	int nbCols = cols->size();
+	for (int i = begin; i < end; ++i) {
+		double *row = out.ptr<double> (i);
+		for (int j = (symmetric) ? i : 0; j < nbCols; ++j) {
+			row[j] = compare(measure, (*rows)[i], (*cols)[j]);
+			if (symmetric)
+				out.ptr<double> (j)[i] = row[j];
+		}
+	}
+}
+
+// -----------------------------------------
+void HistogramSimilarity::computeGramMatrix(HistogramMeasure measure,
+		const std::vector<SparseHistogram> &rows,
+		const std::vector<SparseHistogram> &cols,
+		math::Matrix_<double> &result, core::ThreadPool *threadPool) {
+	rocsDebug3("computeGramMatrix(%i, %i, %i)", measure, (int) rows.size(), (int) cols.size());
+	int nbRows = rows.size();
+	result.resize(nbRows, cols.size());
+	for (int begin = 0; begin < nbRows; begin
+			+= HISTOGRAM_SIMILARITY_BLOCK_ROWS) {
+		int end = std::min(begin + HISTOGRAM_SIMILARITY_BLOCK_ROWS, nbRows);
+		if (threadPool)
+			threadPool->schedule(boost::bind(
+					&HistogramSimilarity::computeGramRows, measure, &rows,
+					&cols, false, begin, end, &result));
+		else
+			computeGramRows(measure, &rows, &cols, false, begin, end, &result);
+	}
+	if (threadPool)
+		threadPool->wait();
+}
+
+// -----------------------------------------
+void HistogramSimilarity::computeGramMatrix(HistogramMeasure measure,
+		const std::vector<SparseHistogram> &histograms,
+		math::Matrix_<double> &result, core::ThreadPool *threadPool) {
+	rocsDebug3("computeGramMatrix(%i, %i)", measure, (int) histograms.size());
+	int size = histograms.size();
+	result.resize(size, size);
+	for (int begin = 0; begin < size; begin += HISTOGRAM_SIMILARITY_BLOCK_ROWS) {
+		int end = std::min(begin + HISTOGRAM_SIMILARITY_BLOCK_ROWS, size);
+		if (threadPool)
+			threadPool->schedule(boost::bind(
+					&HistogramSimilarity::computeGramRows, measure,
+					&histograms, &histograms, true, begin, end, &result));
+		else
+			computeGramRows(measure, &histograms, &histograms, true, begin,
+					end, &result);
+	}
+	if (threadPool)
+		threadPool->wait();
+}
+
+} // end namespace cv
+} // end namespace rocs
@@ -0,0 +1,129 @@
+// ==================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (C) 2010  Arnaud Ramey, Andrzej Pronobis
+//
+// This file is part of ROCS.
+//
+// ROCS is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation, either version 3
+// of the License, or (at your option) any later version.
+//
+// ROCS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ROCS. If not, see <http://www.gnu.org/licenses/>.
+// ==================================================================
+
+
+/*!
+ * \file HistogramSimilarity.h
+ *
+ * \author Andrzej Pronobis
+ *
+ * Contains declaration of the HistogramSimilarity class.
+ */
+
+#ifndef HISTOGRAMSIMILARITY_H_
+#define HISTOGRAMSIMILARITY_H_
+
+#include "rocs/cv/SparseHistogram.h"
+
+#include <vector>
+
+namespace rocs {
+
+namespace math {
+template<typename _T> class Matrix_;
+}
+
+namespace core {
+class ThreadPool;
+}
+
+namespace cv {
+
+/*! Number of rows of a Gram matrix computed by a single task. */
+#define HISTOGRAM_SIMILARITY_BLOCK_ROWS 8
+
+/*!
+ * Measures comparing two histograms. As for the comparison of
+ * histograms in OpenCV, some of them are similarities and some
+ * distances. All the measures assume non-negative values.
+ */
+enum HistogramMeasure {
+	/*! Similarity, sum of min(a,b). */
+	HM_INTERSECTION = 0,
+
+	/*! Distance, sum of (a-b)^2/(a+b). */
+	HM_CHI2,
+
+	/*! Distance, sum of |a-b|. */
+	HM_L1,
+
+	/*! Distance, sqrt of the sum of (a-b)^2. */
+	HM_L2,
+
+	/*! Similarity, Bhattacharyya coefficient, sum of sqrt(a*b). */
+	HM_BHATTACHARYYA
+};
+
+/*!
+ * Computes similarities and distances between sparse histograms.
+ * The similarities are sums over the bins present in both histograms,
+ * so only the common keys are visited. They are found by a merge of
+ * the sorted keys, comparing blocks of 4 keys at a time with SSE2.
+ * The distances are computed from their definitions in a single merge
+ * over the union of the keys.
+ */
+class HistogramSimilarity {
+
+public:
+
+	/*! Compares two histograms. */
+	static double compare(HistogramMeasure measure, const SparseHistogram &a,
+			const SparseHistogram &b);
+
+	/*! Compares a histogram with each histogram of a set. If a thread pool
+	 is given, the comparisons are distributed among its threads. */
+	static void compare(HistogramMeasure measure,
+			const SparseHistogram &query,
+			const std::vector<SparseHistogram> &histograms,
+			std::vector<double> &results, core::ThreadPool *threadPool = 0);
+
+	/*! Computes the matrix of the measures between each histogram of
+	 the first set (rows) and of the second set (columns). */
+	static void computeGramMatrix(HistogramMeasure measure,
+			const std::vector<SparseHistogram> &rows,
+			const std::vector<SparseHistogram> &cols,
+			math::Matrix_<double> &result, core::ThreadPool *threadPool = 0);
+
+	/*! Computes the symmetric matrix of the measures between all
+	 pairs of histograms of a set. Each pair is compared once. */
+	static void computeGramMatrix(HistogramMeasure measure,
+			const std::vector<SparseHistogram> &histograms,
+			math::Matrix_<double> &result, core::ThreadPool *threadPool = 0);
+
+private:
+
+	/*! Compares a histogram with the histograms [begin, end) of a set. */
+	static void compareRange(HistogramMeasure measure,
+			const SparseHistogram *query,
+			const std::vector<SparseHistogram> *histograms, int begin,
+			int end, double *results);
+
+	/*! Computes the rows [begin, end) of a Gram matrix. If symmetric,
+	 only the columns from the diagonal on are computed and mirrored. */
+	static void computeGramRows(HistogramMeasure measure,
+			const std::vector<SparseHistogram> *rows,
+			const std::vector<SparseHistogram> *cols, bool symmetric,
+			int begin, int end, math::Matrix_<double> *result);
+};
+
+} // end namespace cv
+} // end namespace rocs
+
+#endif /* HISTOGRAMSIMILARITY_H_ */
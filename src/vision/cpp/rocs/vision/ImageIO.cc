@@ -42,9 +42,10 @@ using namespace rocs::cv;
 #include "CImg.h"
 #endif
 
-Img* ImageIO::load(const std::string filename_in) throw (core::IOException)
+Img* ImageIO::load(const std::string filename_in, ImageLoadMode mode)
+		throw (core::IOException)
 {
-	rocsDebug3("load(%s)", filename_in.c_str());
+	rocsDebug3("load(%s, %i)", filename_in.c_str(), mode);
 
 	/*
 	 * check that the file exists
@@ -59,6 +60,10 @@ Img* ImageIO::load(const std::string filename_in) throw (core::IOException)
 		opencv::Mat opencv_img = opencv::imread(filename_in.c_str());
 		//	debugPrintf_lvl3("channels;%i, depth:%i", opencv_img.channels(), opencv_img.depth());
 
+		/* compute the lightness directly from the decoded pixels */
+		if (mode == ILM_LIGHTNESS)
+			return Img::getLightness(opencv_img);
+
 		/* create our Img object - its reallocation is done if needed during the copy */
 		Img* ans = new Img(0, 0, MAT_8SC1);
 		opencv_img.copyTo(*ans->asOpenCvMat());
@@ -77,6 +82,8 @@ Img* ImageIO::load(const std::string filename_in) throw (core::IOException)
 	cimg_library::CImg<unsigned char> cimg(filename_in.c_str());
 	int nChannels = cimg.spectrum();
 	rocsDebug3("nChannels:%i", nChannels);
+	if (mode == ILM_LIGHTNESS)
+		rocsError("ImageIO::load() lightness mode not implemented with CImg");
 
 	/* create our Img object */
 	Img* ans = new Img(cimg.width(), cimg.height(), MAT_8UC(nChannels));
@@ -35,6 +35,16 @@
 namespace rocs {
 namespace cv {
 
+/*! Content of the loaded images. */
+enum ImageLoadMode {
+	/*! Color image, BGR. */
+	ILM_COLOR = 0,
+
+	/*! Single channel image containing the lightness L=(max+min)/2
+	 of the colors, identical to the L channel of Img::getL(). */
+	ILM_LIGHTNESS
+};
+
 /*!
  * some functions to load / write images
  */
@@ -43,9 +53,11 @@ public:
 	/*!
 	 *
 	 * \param filename_in
+	 * \param mode content of the loaded image
 	 * \return the loaded image. For color images, the OpenCV convention is BGR
 	 */
-	static Img* load(const std::string filename_in) throw (core::IOException);
+	static Img* load(const std::string filename_in, ImageLoadMode mode =
+			ILM_COLOR) throw (core::IOException);
 	static int write(const Img& img, const std::string filename_out) throw (core::IOException);
 };
 
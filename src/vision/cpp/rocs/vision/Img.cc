@@ -26,6 +26,8 @@
  */
 
 #include "rocs/cv/Img.h"
+
+#include <cstring>
 //#include "highgui.h"
 
 namespace rocs {
@@ -38,54 +40,104 @@ Img::Img(int rows, int cols, int type) :
 Img::~Img() {
 }
 
+/*!
+ * Table of the lightness of the pixels indexed by max*256+min of
+ * the color components. The values are computed exactly as the 8-bit
+ * conversion to HLS does it, that is in single precision on values
+ * scaled to [0, 1], with the result rounded to the nearest integer.
+ */
+class LightnessTable {
+public:
+	LightnessTable() {
+		for (int max = 0; max < 256; ++max)
+			for (int min = 0; min <= max; ++min) {
+				float vmax = max * (1.f / 255.f);
+				float vmin = min * (1.f / 255.f);
+				float l = (vmax + vmin) * 0.5f;
+				_table[(max << 8) + min] = static_cast<uchar> (cvRound(l
+						* 255.f));
+			}
+	}
+
+	/*! Returns the lightness of a pixel with given components. */
+	inline uchar operator()(uchar c0, uchar c1, uchar c2) const {
+		uchar max = c0 > c1 ? c0 : c1;
+		uchar min = c0 < c1 ? c0 : c1;
+		max = max > c2 ? max : c2;
+		min = min < c2 ? min : c2;
+		return _table[(max << 8) + min];
+	}
+
+private:
+	uchar _table[256 * 256];
+};
+
+/*! Returns the table, built on the first call. */
+static const LightnessTable &lightnessTable() {
+	static const LightnessTable table;
+	return table;
+}
+
+/*! Computes the lightness of a row of pixels with a given number
+ of interleaved channels (3 or more, only the first 3 are used). */
+template<typename _T>
+static inline void lightnessRow(const uchar *src, int channels, int cols,
+		_T *dst) {
+	const LightnessTable &table = lightnessTable();
+	for (int j = 0; j < cols; ++j, src += channels)
+		dst[j] = table(src[0], src[1], src[2]);
+}
+
 /*! Returns the intensity channel L as a matrix of doubles. */
 math::Matrix_<double> *Img::getL(math::Matrix_<double> *L /*= 0*/) const {
 	rocsDebug3("getL()");
+	return getLImpl(L);
+}
 
-	/* convert to HLS */
-	// void cvtColor(const Mat& src, Mat& dst, int code, int dstCn=0)
-	opencv::Mat thisAsHls(nbRows(), nbCols(), CV_8U);
-	opencv::cvtColor(this->asConstOpenCvMat(), thisAsHls, CV_RGB2HLS);
-	//	debugPrintf_lvl3("thisAsHls after convert:depth=%i", thisAsHls.depth());
-	//	opencv::imshow("image_hls", thisAsHls);
-	//	opencv::waitKey();
-
-	/* get the wanted channel as uchar */
-	IplImage thisAsHlsAsIpl = thisAsHls;
-	math::Matrix_<uchar> channel(nbRows(), nbCols());
-	IplImage channelAsIpl = channel.asConstOpenCvMat();
-	cvSplit(&thisAsHlsAsIpl, 0, &channelAsIpl, 0, 0);
-	//	debugPrintf_lvl3("channel before return:%s, (1,1):%f", channel.infoCString(), (double) channel.get(1,1));
-	//	debugPrintf_lvl3("channel before return:%s", channel.toString().c_str());
-	//	opencv::imshow("test", channel.asConstOpenCvMat());
-	//	opencv::waitKey();
-
-	//	opencv::Mat thisAs32bits(nbRows(), nbCols(), CV_32SC3);
-	//	this->asConstOpenCvMat().convertTo(thisAs32bits, CV_32S);
-	//	debugPrintf_lvl3("thisAs32bits after convert:depth=%i", thisAs32bits.depth());
-	//	opencv::Mat thisAsHls(nbRows(), nbCols(), CV_32SC3);
-	//	opencv::cvtColor(thisAs32bits, thisAsHls, CV_RGB2HLS);
-	//	debugPrintf_lvl3("thisAsHls after convert:depth=%i", thisAsHls.depth());
-	//	opencv::imshow("image_hls", thisAsHls);
-	//	opencv::waitKey();
-	//
-	//	IplImage foo = thisAsHls;
-	//	math::Matrix_<uchar> test_m(nbRows(), nbCols());
-	//	IplImage test = test_m.asConstOpenCvMat();
-	//	cvSplit(&foo, &test, 0, 0, 0);
-	//	opencv::imshow("test", test_m.asConstOpenCvMat());
-	//	opencv::waitKey();
+/*! Returns the intensity channel L as a matrix of floats. */
+math::Matrix_<float> *Img::getL(math::Matrix_<float> *L) const {
+	rocsDebug3("getL(float)");
+	return getLImpl(L);
+}
 
+/*! Returns a single channel image containing the lightness. */
+Img *Img::getLightness(const opencv::Mat &image) {
+	Img *lightness = new Img(image.rows, image.cols, MAT_8UC1);
+	opencv::Mat &out = *lightness->asOpenCvMat();
+	int channels = image.channels();
+	for (int i = 0; i < image.rows; ++i) {
+		if (channels == 1)
+			memcpy(out.ptr<uchar> (i), image.ptr<uchar> (i), image.cols);
+		else
+			lightnessRow(image.ptr<uchar> (i), channels, image.cols,
+					out.ptr<uchar> (i));
+	}
+	return lightness;
+}
+
+/*! Implementation of getL() for both precisions. */
+template<typename _T>
+math::Matrix_<_T> *Img::getLImpl(math::Matrix_<_T> *L) const {
 	/* create the channel */
 	if (L == 0) {
 		rocsDebug3("Creating the L matrix.");
-		L = new math::Matrix_<double>(nbRows(), nbCols());
-	}
+		L = new math::Matrix_<_T>(nbRows(), nbCols());
+	} else if ((L->nbRows() != nbRows()) || (L->nbCols() != nbCols()))
+		L->resize(nbRows(), nbCols());
 
-	/* convert to double */
-	channel.copyTo_<uchar, double> (*L);
-	//	debugPrintf_lvl3("L before return:%s, (1,1):%f", L->infoCString(), L->get(1,1));
-	//	debugPrintf_lvl3("L before return:%s", L->toString().c_str());
+	/* compute the channel in the wanted precision, row by row */
+	const opencv::Mat &in = asConstOpenCvMat();
+	opencv::Mat &out = *L->asOpenCvMat();
+	int channels = in.channels();
+	for (int i = 0; i < in.rows; ++i) {
+		const uchar *src = in.ptr<uchar> (i);
+		_T *dst = out.ptr<_T> (i);
+		if (channels == 1) {
+			for (int j = 0; j < in.cols; ++j)
+				dst[j] = src[j];
+		} else
+			lightnessRow(src, channels, in.cols, dst);
+	}
 
 	rocsDebug3("getL() finished.");
 
@@ -44,6 +44,22 @@ public:
 	/*! Returns the intensity channel L as a matrix of doubles. */
 	math::Matrix_<double> *getL(math::Matrix_<double> *L = 0) const;
 
+	/*! Returns the intensity channel L as a matrix of floats. */
+	math::Matrix_<float> *getL(math::Matrix_<float> *L) const;
+
+	/*! Returns a single channel image containing the lightness
+	 L=(max+min)/2 of a color image, rounded as by the conversion
+	 to HLS. A single channel image is copied. */
+	static Img *getLightness(const opencv::Mat &image);
+
+private:
+
+	/*! Implementation of getL() for both precisions. L is computed
+	 directly from the pixels of the image, without intermediate
+	 buffers. An image of a single channel is assumed to contain L. */
+	template<typename _T>
+	math::Matrix_<_T> *getLImpl(math::Matrix_<_T> *L) const;
+
 };
 
 } // end namespace cv
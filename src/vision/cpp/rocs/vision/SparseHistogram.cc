@@ -0,0 +1,64 @@
+// ==================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (C) 2010  Arnaud Ramey, Andrzej Pronobis
+//
+// This file is part of ROCS.
+//
+// ROCS is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation, either version 3
+// of the License, or (at your option) any later version.
+//
+// ROCS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ROCS. If not, see <http://www.gnu.org/licenses/>.
+// ==================================================================
+
+
+/*!
+ * \file SparseHistogram.cc
+ *
+ * Contains implementation of the SparseHistogram class.
+ *
+ * \author Andrzej Pronobis
+ */
+
+#include "rocs/cv/HistogramFile.h"
+
+#include "rocs/cv/SparseHistogram.h"
+
+namespace rocs {
+namespace cv {
+
+// -----------------------------------------
+SparseHistogram::SparseHistogram() {
+}
+
+// -----------------------------------------
+SparseHistogram::SparseHistogram(const FeatureList<int, double> &list) {
+	assign(list.size(), list.keys(), list.values());
+}
+
+// -----------------------------------------
+SparseHistogram::SparseHistogram(const HistogramView &view) {
+	reserve(view.size);
+	for (int k = 0; k < view.size; ++k)
+		append(view.keys[k], view.value(k));
+}
+
+// -----------------------------------------
+void SparseHistogram::assign(int size, const int *keys, const double *values) {
+	clear();
+	_sum = 0;
+	_max = -1;
+	reserve(size);
+	for (int k = 0; k < size; ++k)
+		append(keys[k], values[k]);
+}
+
+} // end namespace cv
+} // end namespace rocs
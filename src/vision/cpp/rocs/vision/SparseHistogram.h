@@ -0,0 +1,74 @@
+// ==================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (C) 2010  Arnaud Ramey, Andrzej Pronobis
+//
+// This file is part of ROCS.
+//
+// ROCS is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation, either version 3
+// of the License, or (at your option) any later version.
+//
+// ROCS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ROCS. If not, see <http://www.gnu.org/licenses/>.
+// ==================================================================
+
+
+/*!
+ * \file SparseHistogram.h
+ *
+ * \author Andrzej Pronobis
+ *
+ * Contains declaration of the SparseHistogram class.
+ */
+
+#ifndef SPARSEHISTOGRAM_H_
+#define SPARSEHISTOGRAM_H_
+
+#include "rocs/cv/FeatureList.h"
+
+#include <vector>
+
+namespace rocs {
+namespace cv {
+
+struct HistogramView;
+
+/*!
+ * Sparse histogram compared by HistogramSimilarity and HistogramIndex.
+ * It is a FeatureList whose sum is always the sum of its values,
+ * whatever the histogram it was created from.
+ */
+class SparseHistogram: public FeatureList<int, double> {
+
+public:
+
+	/*! Creates an empty histogram. */
+	SparseHistogram();
+
+	/*! Copies a FeatureList (e.g. Crfh). */
+	explicit SparseHistogram(const FeatureList<int, double> &list);
+
+	/*! Copies a histogram stored in a HistogramFile. */
+	explicit SparseHistogram(const HistogramView &view);
+
+public:
+
+	/*! Replaces the content with given sorted keys and values. */
+	void assign(int size, const int *keys, const double *values);
+
+	/*! Returns the sum of the values. */
+	inline double getSum() const {
+		return _sum;
+	}
+};
+
+} // end namespace cv
+} // end namespace rocs
+
+#endif /* SPARSEHISTOGRAM_H_ */
@@ -26,13 +26,67 @@
  */
 
 #include "rocs/cv/Surf/SurfExtractor.h"
+#include "rocs/core/ThreadPool.h"
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
 
 using namespace rocs::cv;
 
-SurfExtractor::SurfExtractor() {
+SurfExtractor::SurfExtractor() :
+	display_mode(DISPLAY_WAIT), visualizer(0), frame_index(0),
+			matcher_indexed(false), matcher_report_accuracy(false),
+			matcher_precision(1), matcher_recall(1), matcher_pool(0),
+			matcher_pipeline(0), pipeline_busy(false),
+			planar_object_located(false) {
+	pipeline_frame.image = 0;
 }
 
 SurfExtractor::~SurfExtractor() {
+	delete matcher_pipeline;
+	delete matcher_pool;
+	delete visualizer;
+	if (pipeline_frame.image)
+		cvReleaseImage(&pipeline_frame.image);
+}
+
+/*!
+ * sets the function receiving the result of each frame
+ */
+void SurfExtractor::setResultSink(const ResultSink &sink) {
+	result_sink = sink;
+}
+
+/*!
+ * sets the number of threads matching the descriptors of a frame,
+ * 1 matches them in the calling thread
+ */
+void SurfExtractor::setNumThreads(int nbThreads) {
+	surf_waitPipeline();
+	delete matcher_pool;
+	matcher_pool = 0;
+	if (nbThreads > 1)
+		matcher_pool = new core::ThreadPool(nbThreads);
+}
+
+/*!
+ * matches each frame in a thread of its own while the next frame is
+ * extracted, requires matcher_indexed and is ignored with DISPLAY_WAIT.
+ * The results then come one frame late: process() and surf_process()
+ * return planar_object_located of the previous frame (false for the
+ * first one) and the matching fields hold the previous frame. The sink
+ * and the visualizer still receive each frame with its own result, the
+ * last one when end() is called
+ */
+void SurfExtractor::setPipelined(bool pipelined) {
+	surf_waitPipeline();
+	delete matcher_pipeline;
+	matcher_pipeline = 0;
+	if (pipelined)
+		matcher_pipeline = new core::ThreadPool(1);
 }
 
 void SurfExtractor::start() {
@@ -44,8 +98,6 @@ void SurfExtractor::start() {
 	image_input = "../images/group.jpg";
 	video_input = "../images/walk.avi";
 
-	DISPLAY = true;
-
 	/* creating the frames */
 	frame = NULL;
 	frameBW = NULL;
@@ -53,11 +105,16 @@ void SurfExtractor::start() {
 	object_BW_image = NULL;
 	object_color_image = NULL;
 	correspondances_image = NULL;
+	frame_index = 0;
 
 	/* creating the windows */
-	if (DISPLAY) {
+	if (display_mode == DISPLAY_WAIT) {
 		opencv::namedWindow(window1Name, 1);
 		opencv::namedWindow(window2Name, 1);
+	} else if (display_mode == DISPLAY_ASYNC) {
+		if (!visualizer)
+			visualizer = new SurfVisualizer(window2Name);
+		visualizer->start();
 	}
 
 	/* init the other things */
@@ -70,13 +127,17 @@ void SurfExtractor::start() {
  */
 void SurfExtractor::end() {
 	rocsDebug3("end()");
-	sleep(1); // wait a little bit...
+
+	/* the last frame */
+	surf_waitPipeline();
 
 	// stopping the capture
 	// TODO
 
 	// killing the windows
-	if (DISPLAY)
+	if (visualizer)
+		visualizer->stop();
+	if (display_mode == DISPLAY_WAIT)
 		cvDestroyAllWindows();
 
 	// killing the frames
@@ -87,6 +148,7 @@ void SurfExtractor::end() {
 
 void SurfExtractor::defineObjectImage(Img* object_frame) {
 	rocsDebug3("define_object_image() : img:%s", object_frame->infoString().c_str());
+	surf_waitPipeline();
 
 	/* load the object images */
 	//	object_BW_image = cvLoadImage(object_filename.c_str(),
@@ -117,6 +179,10 @@ void SurfExtractor::defineObjectImage(Img* object_frame) {
 			storage, surf_params);
 	rocsDebug3("Object Descriptors:%i", object_descriptors->total);
 
+	/* pack and index them once for all the frames */
+	object_features.assign(object_keypoints, object_descriptors);
+	object_matcher.build(object_features);
+
 	/* init the corners of the object */
 	src_corners[0] = cvPoint(0, 0);
 	src_corners[1] = cvPoint(object_BW_image->width, 0);
@@ -124,6 +190,39 @@ void SurfExtractor::defineObjectImage(Img* object_frame) {
 	src_corners[3] = cvPoint(0, object_BW_image->height);
 }
 
+/*!
+ * adds an object to the database of the objects recognized in
+ * each frame
+ *
+ * \param   object_frame the image of the object
+ * \param   name the name of the object
+ * \return  the index of the object in object_database
+ */
+int SurfExtractor::addObjectImage(Img* object_frame, const std::string &name) {
+	rocsDebug3("addObjectImage() : %s, img:%s", name.c_str(), object_frame->infoString().c_str());
+	surf_waitPipeline();
+
+	IplImage object_frame_as_ipl = *(object_frame->asOpenCvMat());
+	IplImage* BW_image = cvCreateImage(cvGetSize(&object_frame_as_ipl),
+			object_frame_as_ipl.depth, 1);
+	cvCvtColor(&object_frame_as_ipl, BW_image, CV_RGB2GRAY);
+
+	/* extract the SURF points and copy them out of the storage */
+	CvMemStorage* object_storage = cvCreateMemStorage(0);
+	CvSeq *keypoints = 0, *descriptors = 0;
+	cvExtractSURF(BW_image, 0, &keypoints, &descriptors, object_storage,
+			surf_params);
+	SurfFeature features;
+	features.assign(keypoints, descriptors);
+	int object = object_database.addObject(name, features, BW_image->width,
+			BW_image->height);
+	rocsDebug3("Object %s - descriptors:%i", name.c_str(), features.size());
+
+	cvReleaseMemStorage(&object_storage);
+	cvReleaseImage(&BW_image);
+	return object;
+}
+
 /*!
  * main loop of the SurfExtractor mode
  */
@@ -147,15 +246,26 @@ void SurfExtractor::process(Img* frame_img) {
 	}
 
 	/* algorithms */
-	cvCopy(frame, frameOut);
+	if (display_mode == DISPLAY_WAIT)
+		cvCopy(frame, frameOut);
 	surf_process();
 
+	/* hand the frame and its result over to the visualizer, dropped if
+	 it is busy, and display the last frame it has drawn. If pipelined,
+	 the frames are posted with their results by surf_waitPipeline() */
+	if (visualizer && (display_mode == DISPLAY_ASYNC)) {
+		if (!surf_isPipelined())
+			visualizer->post(frame, surf_result);
+		visualizer->show();
+	}
+
 	/* display in the 2 windows */
-	if (DISPLAY) {
+	if (display_mode == DISPLAY_WAIT) {
 		//		cvShowImage(window1Name, frame);
 		//		cvShowImage(window1Name, frameBW);
 		//		cvShowImage(window2Name, frameOut);
-		cvShowImage(window2Name, correspondances_image);
+		cvShowImage(window2Name, (correspondances_image) ? correspondances_image
+				: frameOut);
 
 		/* key listener */
 		cvWaitKey();
@@ -196,18 +306,8 @@ void SurfExtractor::surf_init() {
  */
 double SurfExtractor::surf_compareSURFDescriptors(const float* d1,
 		const float* d2, double best, int length) {
-	double total_cost = 0;
 	assert(length % 4 == 0);
-	for (int i = 0; i < length; i += 4) {
-		double t0 = d1[i] - d2[i];
-		double t1 = d1[i + 1] - d2[i + 1];
-		double t2 = d1[i + 2] - d2[i + 2];
-		double t3 = d1[i + 3] - d2[i + 3];
-		total_cost += t0 * t0 + t1 * t1 + t2 * t2 + t3 * t3;
-		if (total_cost > best)
-			break;
-	}
-	return total_cost;
+	return SurfMatcher::compareDescriptors(d1, d2, best, length);
 }
 
 /*!
@@ -285,6 +385,56 @@ void SurfExtractor::surf_findPairs(const CvSeq* objectKeypoints,
 	}
 }
 
+/*!
+ * find corresponding pairs of points with the index of the object
+ * descriptors: for each image descriptor, the nearest object descriptor
+ *
+ * \param   imageKeypoints
+ * \param   imageDescriptors
+ * \param   ptpairs the vector which will contain the result
+ */
+void SurfExtractor::surf_findPairsIndexed(const CvSeq* imageKeypoints,
+		const CvSeq* imageDescriptors, std::vector<int>& ptpairs) {
+	rocsDebug3("surf_findPairsIndexed()");
+	if (imageDescriptors != image_descriptors)
+		image_features.assign(imageKeypoints, imageDescriptors);
+	object_matcher.findPairs(image_features, ptpairs, matcher_pool, &ptratios);
+}
+
+/*!
+ * compares the pairs of ptpairs with those of the exhaustive scan of
+ * object_matcher, which matches in the same direction (nearest object
+ * descriptor of each image descriptor), and updates matcher_precision
+ * and matcher_recall
+ */
+void SurfExtractor::surf_measureMatchingAccuracy() {
+	std::vector<int> exhaustive_ptpairs;
+	int maxChecks = object_matcher.getMaxChecks();
+	object_matcher.setMaxChecks(0);
+	object_matcher.findPairs(image_features, exhaustive_ptpairs, matcher_pool);
+	object_matcher.setMaxChecks(maxChecks);
+
+	/* sort the pairs of both searches and count the common ones */
+	std::vector<std::pair<int, int> > exhaustive, indexed;
+	for (unsigned int i = 0; i < exhaustive_ptpairs.size(); i += 2)
+		exhaustive.push_back(std::make_pair(exhaustive_ptpairs[i],
+				exhaustive_ptpairs[i + 1]));
+	for (unsigned int i = 0; i < ptpairs.size(); i += 2)
+		indexed.push_back(std::make_pair(ptpairs[i], ptpairs[i + 1]));
+	std::sort(exhaustive.begin(), exhaustive.end());
+	std::sort(indexed.begin(), indexed.end());
+	std::vector<std::pair<int, int> > common;
+	std::set_intersection(exhaustive.begin(), exhaustive.end(),
+			indexed.begin(), indexed.end(), std::back_inserter(common));
+
+	matcher_precision = (indexed.empty()) ? 1 : (double) common.size()
+			/ indexed.size();
+	matcher_recall = (exhaustive.empty()) ? 1 : (double) common.size()
+			/ exhaustive.size();
+	rocsDebug1("matching - exhaustive pairs:%i, indexed pairs:%i, precision:%f, recall:%f",
+			(int) exhaustive.size(), (int) indexed.size(), matcher_precision, matcher_recall);
+}
+
 /*!
  * a rough implementation for object_BW_image location
  *
@@ -302,6 +452,17 @@ bool SurfExtractor::surf_locatePlanarObject(const CvSeq* objectKeypoints,
 		CvPoint dst_corners[4]) {
 	rocsDebug3( "surf_locatePlanarObject()");
 
+	/* indexed matching of the packed keypoints */
+	if (matcher_indexed && (objectDescriptors == object_descriptors)) {
+		if (imageDescriptors != image_descriptors)
+			image_features.assign(imageKeypoints, imageDescriptors);
+		bool located = surf_locateIndexed(image_features, ptpairs, ptratios,
+				pt1, pt2, src_corners, dst_corners);
+		if (matcher_report_accuracy)
+			surf_measureMatchingAccuracy();
+		return located;
+	}
+
 	/* find pairs */
 	ptpairs.clear();
 	surf_findPairs(objectKeypoints, objectDescriptors, imageKeypoints,
@@ -311,47 +472,100 @@ bool SurfExtractor::surf_locatePlanarObject(const CvSeq* objectKeypoints,
 		return 0; // not enough points
 
 	/* copy points in CvPoint2D32f */
-	std::vector<CvPoint2D32f> pt1, pt2;
 	pt1.resize(n);
 	pt2.resize(n);
 	for (int i = 0; i < n; i++) {
-		pt1[i]
-				= ((CvSURFPoint*) cvGetSeqElem(objectKeypoints, ptpairs[i * 2]))->pt;
+		pt1[i] = ((CvSURFPoint*) cvGetSeqElem(objectKeypoints,
+				ptpairs[i * 2]))->pt;
 		pt2[i] = ((CvSURFPoint*) cvGetSeqElem(imageKeypoints,
 				ptpairs[i * 2 + 1]))->pt;
 	}
+	return surf_findHomography(pt1, pt2, 0, src_corners, dst_corners);
+}
+
+/*!
+ * locates the object in an image with object_matcher, reading only
+ * the packed keypoints
+ *
+ * \param   imageFeatures
+ * \param   pairs the pairs found, as in ptpairs
+ * \param   ratios the distance ratio of each pair
+ * \param   points1 the paired object points
+ * \param   points2 the paired image points
+ * \param   src_corners
+ * \param   dst_corners
+ * \return  true if the object was located
+ */
+bool SurfExtractor::surf_locateIndexed(const SurfFeature &imageFeatures,
+		std::vector<int>& pairs, std::vector<float>& ratios,
+		std::vector<CvPoint2D32f>& points1, std::vector<CvPoint2D32f>& points2,
+		const CvPoint src_corners[4], CvPoint dst_corners[4]) {
+	/* find pairs */
+	pairs.clear();
+	object_matcher.findPairs(imageFeatures, pairs, matcher_pool, &ratios);
+	int n = pairs.size() / 2;
+	if (n < SURF_LOCATING_MIN_PAIRS)
+		return 0; // not enough points
 
-	/* copy points in matrix */
-	CvMat _pt1, _pt2;
-	_pt1 = cvMat(1, n, CV_32FC2, &pt1[0]);
-	_pt2 = cvMat(1, n, CV_32FC2, &pt2[0]);
+	/* copy points in CvPoint2D32f */
+	points1.resize(n);
+	points2.resize(n);
+	for (int i = 0; i < n; i++) {
+		points1[i] = object_features.getKeypoint(pairs[i * 2]).pt;
+		points2[i] = imageFeatures.getKeypoint(pairs[i * 2 + 1]).pt;
+	}
+	return surf_findHomography(points1, points2, &ratios, src_corners,
+			dst_corners);
+}
 
-	/* search the homography */
+/*!
+ * searches the homography between the paired points and projects the
+ * corners with it
+ *
+ * \param   points1 the paired object points
+ * \param   points2 the paired image points
+ * \param   ratios the distance ratios of the pairs, 0 if unknown
+ * \param   src_corners
+ * \param   dst_corners
+ * \return  true if the homography was found
+ */
+bool SurfExtractor::surf_findHomography(
+		const std::vector<CvPoint2D32f>& points1,
+		const std::vector<CvPoint2D32f>& points2,
+		const std::vector<float>* ratios, const CvPoint src_corners[4],
+		CvPoint dst_corners[4]) {
+	/* search the homography, the most distinctive pairs first */
 	double h[9];
-	CvMat _h = cvMat(3, 3, CV_64F, h);
-	/* default */
-	//bool homoFind = cvFindHomography( &_pt1, &_pt2, &_h);
-	/* ransac */
-	//bool homoFind = cvFindHomography( &_pt1, &_pt2, &_h, CV_RANSAC, 5);
-	/* least med squares */
-	bool homoFind = cvFindHomography(&_pt1, &_pt2, &_h, CV_LMEDS);
-	if (!homoFind)
+	if (!homography.find(points1, points2, ratios, h))
 		return 0; // impossible to find the homography
 
 	/* compute the image of the corners with it */
-	for (int i = 0; i < 4; i++) {
-		double x = src_corners[i].x, y = src_corners[i].y;
-		double Z = 1. / (h[6] * x + h[7] * y + h[8]);
-		double X = (h[0] * x + h[1] * y + h[2]) * Z;
-		double Y = (h[3] * x + h[4] * y + h[5]) * Z;
-		dst_corners[i] = cvPoint(cvRound(X), cvRound(Y));
-	}
-
+	SurfHomography::projectCorners(h, src_corners, dst_corners);
 	return 1;
 }
 
 /*!
- * returns true if it manages to compute the homography
+ * matches a frame once against all the objects of object_database
+ * and locates those with enough pairs
+ *
+ * \param   imageFeatures
+ * \param   detections the objects recognized
+ * \param   pairs the pairs found, as in database_ptpairs
+ */
+void SurfExtractor::surf_recognizeObjects(const SurfFeature &imageFeatures,
+		std::vector<SurfObjectDatabase::Detection>& detections,
+		std::vector<int>& pairs) {
+	rocsDebug3( "surf_recognizeObjects()");
+	object_database.recognize(imageFeatures, detections, pairs, matcher_pool);
+	for (unsigned int i = 0; i < detections.size(); ++i)
+		rocsDebug3("object %s - pairs:%i, located:%i",
+				object_database.getName(detections[i].object).c_str(),
+				detections[i].nbPairs, detections[i].located);
+}
+
+/*!
+ * returns true if it manages to compute the homography, of the previous
+ * frame if pipelined
  */
 bool SurfExtractor::surf_process() {
 	rocsDebug3( "surf_process()");
@@ -365,22 +579,175 @@ bool SurfExtractor::surf_process() {
 	cvClearMemStorage(storage2);
 	cvExtractSURF(frameBW, 0, &image_keypoints, &image_descriptors, storage2,
 			surf_params);
+	pending_features.assign(image_keypoints, image_descriptors);
+	surf_matchExtracted();
+
+	/* display */
+	if (display_mode == DISPLAY_WAIT)
+		surf_draw();
+
+	return planar_object_located;
+}
+
+/*!
+ * returns true if the frames are matched by the matching thread
+ */
+bool SurfExtractor::surf_isPipelined() const {
+	return matcher_pipeline && matcher_indexed && (display_mode
+			!= DISPLAY_WAIT);
+}
+
+/*!
+ * matches the keypoints extracted from the next frame, pending_features,
+ * by the matching thread if pipelined, otherwise at once
+ *
+ * \return  true if the object was located in the frame, in the previous
+ *          frame if pipelined
+ */
+bool SurfExtractor::surf_matchExtracted() {
+	int index = frame_index++;
+
+	/* hand the packed keypoints and a copy of the frame for the
+	 * visualizer over to the matching thread once it is done with the
+	 * previous frame */
+	if (surf_isPipelined()) {
+		surf_waitPipeline();
+		pipeline_frame.frame = index;
+		pipeline_frame.features.swap(pending_features);
+		if (visualizer && (display_mode == DISPLAY_ASYNC)) {
+			IplImage *&image = pipeline_frame.image;
+			if ((image) && ((image->width != frame->width) || (image->height
+					!= frame->height) || (image->depth != frame->depth)
+					|| (image->nChannels != frame->nChannels)))
+				cvReleaseImage(&image);
+			if (!image)
+				image = cvCreateImage(cvGetSize(frame), frame->depth,
+						frame->nChannels);
+			cvCopy(frame, image);
+		}
+		pipeline_busy = true;
+		matcher_pipeline->schedule(boost::bind(
+				&SurfExtractor::surf_matchPipelined, this));
+		return planar_object_located;
+	}
+
+	surf_waitPipeline();
+	image_features.swap(pending_features);
+	surf_match(index);
+	return planar_object_located;
+}
+
+/*!
+ * recognizes the objects of the database and locates the object in
+ * image_features, then passes the result to the sink
+ *
+ * \param   frame the index of the frame
+ */
+void SurfExtractor::surf_match(int frame) {
+	/* recognize the objects of the database */
+	object_detections.clear();
+	if (object_database.getNbObjects() > 0)
+		surf_recognizeObjects(image_features, object_detections,
+				database_ptpairs);
 
 	/* locate the object_BW_image */
-	planar_object_located = surf_locatePlanarObject(object_keypoints,
-			object_descriptors, image_keypoints, image_descriptors,
-			src_corners, dst_corners);
+	planar_object_located = false;
+	ptpairs.clear();
+	if (object_BW_image != NULL)
+		planar_object_located = surf_locatePlanarObject(object_keypoints,
+				object_descriptors, image_keypoints, image_descriptors,
+				src_corners, dst_corners);
 
 	rocsDebug3( "image descriptors: %i- nb pairs:%i- matching:%i",
-			image_descriptors->total,
+			image_features.size(),
 			numberCorrespondances(),
 			planar_object_located );
 
-	/* display */
-	if (DISPLAY)
-		surf_draw();
+	surf_emitResult(frame, image_features.size());
+}
 
-	return planar_object_located;
+/*!
+ * the task of the matching thread, matches pipeline_frame reading only
+ * the object fields, which are not modified while it runs
+ */
+void SurfExtractor::surf_matchPipelined() {
+	PipelineFrame &f = pipeline_frame;
+
+	/* recognize the objects of the database */
+	f.detections.clear();
+	if (object_database.getNbObjects() > 0)
+		surf_recognizeObjects(f.features, f.detections, f.database_ptpairs);
+
+	/* locate the object_BW_image */
+	f.located = false;
+	f.ptpairs.clear();
+	if (object_BW_image != NULL)
+		f.located = surf_locateIndexed(f.features, f.ptpairs, f.ptratios,
+				f.pt1, f.pt2, src_corners, f.dst_corners);
+}
+
+/*!
+ * waits for the matching thread, then moves the frame it matched into
+ * the matching fields and passes its result to the sink and, with the
+ * copy of the frame, to the visualizer
+ */
+void SurfExtractor::surf_waitPipeline() {
+	if (!matcher_pipeline)
+		return;
+	matcher_pipeline->wait();
+	if (!pipeline_busy)
+		return;
+	pipeline_busy = false;
+
+	PipelineFrame &f = pipeline_frame;
+	image_features.swap(f.features);
+	ptpairs.swap(f.ptpairs);
+	ptratios.swap(f.ptratios);
+	pt1.swap(f.pt1);
+	pt2.swap(f.pt2);
+	planar_object_located = f.located;
+	std::copy(f.dst_corners, f.dst_corners + 4, dst_corners);
+	object_detections.swap(f.detections);
+	database_ptpairs.swap(f.database_ptpairs);
+
+	rocsDebug3( "image descriptors: %i- nb pairs:%i- matching:%i",
+			image_features.size(),
+			numberCorrespondances(),
+			planar_object_located );
+
+	surf_emitResult(f.frame, image_features.size());
+	if (visualizer && (display_mode == DISPLAY_ASYNC) && f.image)
+		visualizer->post(f.image, surf_result);
+}
+
+/*!
+ * fills surf_result with the result of a frame and passes it to the
+ * sink. The buffers of surf_result are reused, so that once they are
+ * large enough no memory is allocated
+ *
+ * \param   frame the index of the frame
+ * \param   nbKeypoints the number of keypoints of the frame
+ */
+void SurfExtractor::surf_emitResult(int frame, int nbKeypoints) {
+	if ((!result_sink) && (!visualizer))
+		return;
+
+	surf_result.frame = frame;
+	surf_result.nbKeypoints = nbKeypoints;
+	surf_result.objectLocated = planar_object_located;
+	std::copy(dst_corners, dst_corners + 4, surf_result.objectCorners);
+	int n = (numberCorrespondances() >= SURF_LOCATING_MIN_PAIRS)
+			? numberCorrespondances() : 0; // pt1 and pt2 are filled
+	surf_result.objectPoints.assign(pt1.begin(), pt1.begin() + n);
+	surf_result.imagePoints.assign(pt2.begin(), pt2.begin() + n);
+	surf_result.homography = homography.getStatistics();
+	if (n == 0) // no homography searched for this frame
+		surf_result.homography.nbPoints = surf_result.homography.nbIterations
+				= surf_result.homography.nbInliers = 0;
+	surf_result.detections = object_detections;
+
+	if (result_sink)
+		result_sink(surf_result);
 }
 
 /*!
@@ -404,6 +771,18 @@ void SurfExtractor::surf_draw() {
 		cvCircle(frameOut, center, radius, CV_RGB(255,0,0), 1, 8, 0);
 	}
 
+	/* draw the objects of the database located in frameOut */
+	for (unsigned int d = 0; d < object_detections.size(); ++d) {
+		if (!object_detections[d].located)
+			continue;
+		const CvPoint* corners = object_detections[d].corners;
+		for (int i = 0; i < 4; i++)
+			cvLine(frameOut, corners[i], corners[(i + 1) % 4],
+					CV_RGB(255, 255, 0), 2);
+	}
+	if (object_BW_image == NULL)
+		return; // no object to put beside
+
 	/* copy the two objects in a new image */
 	int obj_width = object_BW_image->width;
 	int obj_height = object_BW_image->height;
@@ -28,17 +28,23 @@
 #ifndef SURFEXTRACTOR_H_
 #define SURFEXTRACTOR_H_
 
-#define SURF_MATCHING_MAX_DIST_1ST   0.2
-#define SURF_MATCHING_MAX_RATIO_1_2  0.7 // between 0 and 1, 0 = the most exigent
-#define SURF_LOCATING_MIN_PAIRS      10
-
 /* ROCS includes */
 #include "rocs/cv/FeatureExtractor.h"
+#include "rocs/cv/Surf/SurfMatcher.h"
+#include "rocs/cv/Surf/SurfFeature.h"
+#include "rocs/cv/Surf/SurfObjectDatabase.h"
+#include "rocs/cv/Surf/SurfResult.h"
+#include "rocs/cv/Surf/SurfVisualizer.h"
+
+#include <boost/function.hpp>
 
 /* opencv includes */
 #include "opencv/highgui.h"
 
 namespace rocs {
+namespace core {
+class ThreadPool;
+}
 namespace cv {
 
 class SurfExtractor : public FeatureExtractor<int>{
@@ -51,8 +57,23 @@ public:
 	void process(Img* frame_img);
 
 	void defineObjectImage(Img* object_frame);
-
-	bool 						DISPLAY;			//!< display windows
+	int addObjectImage(Img* object_frame, const std::string &name);
+
+	/* what is displayed, set before start() */
+	enum DisplayMode {
+		DISPLAY_NONE,	//!< headless, the results only go to the result sink
+		DISPLAY_WAIT,	//!< draw the correspondances and wait for a key after each frame
+		DISPLAY_ASYNC	//!< draw the frames in a SurfVisualizer thread, never waiting for it
+	};
+	DisplayMode 				display_mode;		//!< DISPLAY_WAIT by default
+	SurfVisualizer* 			visualizer;			//!< created by start() with DISPLAY_ASYNC
+
+	/* receives the result of each frame */
+	typedef boost::function<void (const SurfResult &)> ResultSink;
+	void setResultSink			(const ResultSink &sink);
+	ResultSink 					result_sink;		//!< called after each frame, empty by default
+	SurfResult 					surf_result;		//!< the result of the last frame, reused between the frames
+	int 						frame_index;		//!< index of the next frame since start()
 	std::string						video_input;		//!< the file showed if INPUT_MODE = video
 	std::string						image_input;		//!< the file showed if INPUT_MODE = image
 
@@ -69,18 +90,72 @@ public:
 	//////
 	////// finder
 	//////
-	double surf_compareSURFDescriptors
+	static double surf_compareSURFDescriptors
 	(const float* d1, const float* d2, double best, int length);
-	int surf_naiveNearestNeighbor
+	static int surf_naiveNearestNeighbor
 	(const float* vec, int laplacian,  const CvSeq* model_keypoints, const CvSeq* model_descriptors);
-	void surf_findPairs
+	static void surf_findPairs
 	(const CvSeq* objectKeypoints, const CvSeq* objectDescriptors,
 			const CvSeq* imageKeypoints, const CvSeq* imageDescriptors, std::vector<int>& ptpairs);
 	std::vector<int> 				ptpairs;
+	std::vector<float> 			ptratios;			//!< distance ratio of each pair of the indexed matcher
+	std::vector<CvPoint2D32f> 	pt1, pt2;			//!< the paired points, reused between the frames
+	SurfHomography 				homography;			//!< estimator of the homography of the object
+
+	/* indexed matching of the image descriptors against the object ones */
+	void surf_findPairsIndexed
+	(const CvSeq* imageKeypoints, const CvSeq* imageDescriptors, std::vector<int>& ptpairs);
+	void surf_measureMatchingAccuracy();
+	SurfMatcher 				object_matcher;		//!< index of the object descriptors, built by defineObjectImage()
+	bool 						matcher_indexed;	//!< use object_matcher instead of surf_findPairs() (nearest object descriptor of each image descriptor, not the reverse), false by default
+	bool 						matcher_report_accuracy; //!< compare the indexed pairs with the exhaustive scan of object_matcher
+	double 						matcher_precision;	//!< part of the indexed pairs found by the exhaustive scan
+	double 						matcher_recall;		//!< part of the exhaustive pairs found by the indexed search
+
+	/* splits the indexed matching of each frame over several threads */
+	void setNumThreads			(int nbThreads);
+	core::ThreadPool* 			matcher_pool;		//!< 0 to match in the calling thread
+
+	/* matches frame N in another thread while frame N+1 is extracted.
+	 * This adds one frame of latency: once frame N+1 is processed,
+	 * planar_object_located (returned by process() and surf_process())
+	 * and the matching fields hold frame N. The sink and the visualizer
+	 * receive each frame with its own result, end() flushes the last one */
+	void setPipelined			(bool pipelined);
+	core::ThreadPool* 			matcher_pipeline;	//!< the matching thread, 0 if not pipelined
+
+	/* the state of the frame matched by the matching thread, only
+	 * touched by this thread until surf_waitPipeline() */
+	struct PipelineFrame {
+		int 						frame;				//!< index of the frame
+		SurfFeature 				features;			//!< its packed keypoints
+		IplImage* 					image;				//!< a copy of it for the visualizer, reused between the frames
+		std::vector<int> 			ptpairs;
+		std::vector<float> 			ptratios;
+		std::vector<CvPoint2D32f> 	pt1, pt2;
+		bool 						located;
+		CvPoint 					dst_corners[4];
+		std::vector<SurfObjectDatabase::Detection> detections;
+		std::vector<int> 			database_ptpairs;
+	};
+	PipelineFrame 				pipeline_frame;		//!< the frame being matched
+	bool 						pipeline_busy;		//!< true if pipeline_frame is being matched
+	SurfFeature 				pending_features;	//!< the keypoints extracted from the next frame
+	bool surf_isPipelined		() const;
+	bool surf_matchExtracted	();
+	void surf_matchPipelined	();
+	void surf_waitPipeline		();
 
 	bool surf_locatePlanarObject
 	(const CvSeq* objectKeypoints,  const CvSeq* objectDescriptors, const CvSeq* imageKeypoints,
 			const CvSeq* imageDescriptors, const CvPoint src_corners[4], CvPoint dst_corners[4]);
+	bool surf_locateIndexed
+	(const SurfFeature &imageFeatures, std::vector<int>& pairs, std::vector<float>& ratios,
+			std::vector<CvPoint2D32f>& points1, std::vector<CvPoint2D32f>& points2,
+			const CvPoint src_corners[4], CvPoint dst_corners[4]);
+	bool surf_findHomography
+	(const std::vector<CvPoint2D32f>& points1, const std::vector<CvPoint2D32f>& points2,
+			const std::vector<float>* ratios, const CvPoint src_corners[4], CvPoint dst_corners[4]);
 	bool 						planar_object_located;
 	CvPoint 					src_corners[4];
 	CvPoint 					dst_corners[4];
@@ -91,13 +166,25 @@ public:
 	IplImage* 					object_BW_image;
 	CvSeq *						object_keypoints;
 	CvSeq *						object_descriptors;
+	SurfFeature 				object_features;	//!< object_keypoints and object_descriptors, packed
 	CvMemStorage* 				storage;
 
 	bool surf_process			();
+	void surf_match				(int frame);
+	void surf_emitResult		(int frame, int nbKeypoints);
 	CvSeq *						image_keypoints;
 	CvSeq *						image_descriptors;
+	SurfFeature 				image_features;		//!< image_keypoints and image_descriptors, packed
 	CvMemStorage* 				storage2;
 
+	/* objects recognized in each frame besides object_BW_image */
+	void surf_recognizeObjects
+	(const SurfFeature &imageFeatures, std::vector<SurfObjectDatabase::Detection>& detections,
+			std::vector<int>& pairs);
+	SurfObjectDatabase 			object_database;	//!< filled by addObjectImage()
+	std::vector<SurfObjectDatabase::Detection> object_detections; //!< the objects recognized in the frame
+	std::vector<int> 			database_ptpairs;	//!< pairs (database descriptor, image keypoint)
+
 	/* draw the surf points of the object_BW_image */
 	void surf_draw				();
 	IplImage* 					correspondances_image;
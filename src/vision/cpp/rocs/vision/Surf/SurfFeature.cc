@@ -0,0 +1,233 @@
+// ==================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (C) 2010  Arnaud Ramey, Andrzej Pronobis
+//
+// This file is part of ROCS.
+//
+// ROCS is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation, either version 3
+// of the License, or (at your option) any later version.
+//
+// ROCS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ROCS. If not, see <http://www.gnu.org/licenses/>.
+// ==================================================================
+
+
+/*!
+ * \file SurfFeature.cc
+ *
+ * Contains implementation of the SurfDescriptors and SurfFeature classes.
+ *
+ * \author Andrzej Pronobis
+ */
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// The AVX2 kernel is compiled for its own target and chosen at runtime
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+	&& ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9)))
+#define SURF_AVX2_DISPATCH
+#include <immintrin.h>
+#endif
+
+#include "rocs/cv/Surf/SurfFeature.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <new>
+
+namespace rocs {
+namespace cv {
+
+/*! Computes the squared distances of a query to a block of descriptors. */
+typedef void (*DistancesFunction)(const float *query, const float *block,
+		int count, int stride, float *distances);
+
+/*! Portable kernel. */
+static void distancesScalar(const float *query, const float *block,
+		int count, int stride, float *distances) {
+	for (int r = 0; r < count; ++r, block += stride) {
+		float s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+		for (int i = 0; i < stride; i += 4) {
+			float t0 = query[i] - block[i];
+			float t1 = query[i + 1] - block[i + 1];
+			float t2 = query[i + 2] - block[i + 2];
+			float t3 = query[i + 3] - block[i + 3];
+			s0 += t0 * t0;
+			s1 += t1 * t1;
+			s2 += t2 * t2;
+			s3 += t3 * t3;
+		}
+		distances[r] = (s0 + s1) + (s2 + s3);
+	}
+}
+
+#if defined(__SSE2__)
+/*! SSE2 kernel, 8 floats per iteration in two accumulators. */
+static void distancesSse2(const float *query, const float *block,
+		int count, int stride, float *distances) {
+	for (int r = 0; r < count; ++r, block += stride) {
+		__m128 s0 = _mm_setzero_ps();
+		__m128 s1 = _mm_setzero_ps();
+		for (int i = 0; i < stride; i += 8) {
+			__m128 t0 = _mm_sub_ps(_mm_load_ps(query + i), _mm_load_ps(block
+					+ i));
+			__m128 t1 = _mm_sub_ps(_mm_load_ps(query + i + 4), _mm_load_ps(
+					block + i + 4));
+			s0 = _mm_add_ps(s0, _mm_mul_ps(t0, t0));
+			s1 = _mm_add_ps(s1, _mm_mul_ps(t1, t1));
+		}
+		s0 = _mm_add_ps(s0, s1);
+		s0 = _mm_add_ps(s0, _mm_movehl_ps(s0, s0));
+		s0 = _mm_add_ss(s0, _mm_shuffle_ps(s0, s0, 1));
+		distances[r] = _mm_cvtss_f32(s0);
+	}
+}
+#endif
+
+#if defined(SURF_AVX2_DISPATCH)
+/*! AVX2 kernel, 8 floats per iteration with fused multiply-add. */
+__attribute__((target("avx2,fma")))
+static void distancesAvx2(const float *query, const float *block,
+		int count, int stride, float *distances) {
+	for (int r = 0; r < count; ++r, block += stride) {
+		__m256 s = _mm256_setzero_ps();
+		for (int i = 0; i < stride; i += 8) {
+			__m256 t = _mm256_sub_ps(_mm256_load_ps(query + i),
+					_mm256_load_ps(block + i));
+			s = _mm256_fmadd_ps(t, t, s);
+		}
+		__m128 h = _mm_add_ps(_mm256_castps256_ps128(s), _mm256_extractf128_ps(
+				s, 1));
+		h = _mm_add_ps(h, _mm_movehl_ps(h, h));
+		h = _mm_add_ss(h, _mm_shuffle_ps(h, h, 1));
+		distances[r] = _mm_cvtss_f32(h);
+	}
+}
+#endif
+
+/*! Returns the fastest kernel supported by the processor. */
+static DistancesFunction selectDistances() {
+#if defined(SURF_AVX2_DISPATCH)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		return distancesAvx2;
+#endif
+#if defined(__SSE2__)
+	return distancesSse2;
+#else
+	return distancesScalar;
+#endif
+}
+
+/*! Returns the kernel selected on the first call. */
+static DistancesFunction distancesKernel() {
+	static const DistancesFunction kernel = selectDistances();
+	return kernel;
+}
+
+// -----------------------------------------
+SurfDescriptors::SurfDescriptors() :
+	_count(0), _length(0), _stride(0), _capacity(0), _data(0) {
+}
+
+// -----------------------------------------
+SurfDescriptors::SurfDescriptors(const SurfDescriptors &other) :
+	_count(0), _length(0), _stride(0), _capacity(0), _data(0) {
+	*this = other;
+}
+
+// -----------------------------------------
+SurfDescriptors::~SurfDescriptors() {
+	free(_data);
+}
+
+// -----------------------------------------
+SurfDescriptors &SurfDescriptors::operator=(const SurfDescriptors &other) {
+	if (this != &other) {
+		resize(other._count, other._length);
+		if (_count)
+			memcpy(_data, other._data, (size_t) _count * _stride
+					* sizeof(float));
+	}
+	return *this;
+}
+
+// -----------------------------------------
+void SurfDescriptors::swap(SurfDescriptors &other) {
+	std::swap(_count, other._count);
+	std::swap(_length, other._length);
+	std::swap(_stride, other._stride);
+	std::swap(_capacity, other._capacity);
+	std::swap(_data, other._data);
+}
+
+// -----------------------------------------
+void SurfDescriptors::resize(int count, int length) {
+	int stride = (length + 7) & ~7;
+	size_t size = (size_t) count * stride;
+	if (size > _capacity) {
+		void *data = 0;
+		if (posix_memalign(&data, SURF_DESCRIPTOR_ALIGNMENT, size
+				* sizeof(float)))
+			throw std::bad_alloc();
+		free(_data);
+		_data = static_cast<float *> (data);
+		_capacity = size;
+	}
+	_count = count;
+	_length = length;
+	_stride = stride;
+
+	// Zero the padding once, set() writes only the descriptors
+	if (stride > length)
+		for (int i = 0; i < count; ++i)
+			memset(_data + (size_t) i * stride + length, 0, (stride - length)
+					* sizeof(float));
+}
+
+// -----------------------------------------
+void SurfDescriptors::set(int i, const float *descriptor) {
+	memcpy((*this)[i], descriptor, _length * sizeof(float));
+}
+
+// -----------------------------------------
+float SurfDescriptors::distance(const float *a, const float *b, int stride) {
+	float d;
+	distancesKernel()(a, b, 1, stride, &d);
+	return d;
+}
+
+// -----------------------------------------
+void SurfDescriptors::distances(const float *query, const float *block,
+		int count, int stride, float *distances) {
+	distancesKernel()(query, block, count, stride, distances);
+}
+
+// -----------------------------------------
+void SurfFeature::assign(const CvSeq *keypoints, const CvSeq *descriptors) {
+	int length = (int) (descriptors->elem_size / sizeof(float));
+	resize(descriptors->total, length);
+
+	CvSeqReader reader, kreader;
+	cvStartReadSeq(keypoints, &kreader, 0);
+	cvStartReadSeq(descriptors, &reader, 0);
+	for (int i = 0; i < descriptors->total; i++) {
+		_keypoints[i] = *(const CvSURFPoint*) kreader.ptr;
+		_descriptors.set(i, (const float*) reader.ptr);
+		CV_NEXT_SEQ_ELEM( kreader.seq->elem_size, kreader );
+		CV_NEXT_SEQ_ELEM( reader.seq->elem_size, reader );
+	}
+}
+
+} // end namespace cv
+} // end namespace rocs
@@ -0,0 +1,194 @@
+// ==================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (C) 2010  Arnaud Ramey, Andrzej Pronobis
+//
+// This file is part of ROCS.
+//
+// ROCS is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation, either version 3
+// of the License, or (at your option) any later version.
+//
+// ROCS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ROCS. If not, see <http://www.gnu.org/licenses/>.
+// ==================================================================
+
+
+/*!
+ * \file SurfFeature.h
+ *
+ * \author Andrzej Pronobis
+ *
+ * Contains declaration of the SurfDescriptors and SurfFeature classes.
+ */
+
+#ifndef SURFFEATURE_H_
+#define SURFFEATURE_H_
+
+/* opencv includes */
+#include "opencv/cv.h"
+
+#include <vector>
+
+namespace rocs {
+namespace cv {
+
+/*! Alignment in bytes of the rows of packed descriptors. */
+#define SURF_DESCRIPTOR_ALIGNMENT 32
+
+/*!
+ * Matrix of SURF descriptors packed one after another, each row
+ * aligned to SURF_DESCRIPTOR_ALIGNMENT bytes and padded with zeros to
+ * a multiple of 8 floats, so that the distances can be computed with
+ * aligned vector loads. The memory is kept when the matrix shrinks.
+ */
+class SurfDescriptors {
+
+public:
+
+	/*! Constructor. Creates an empty matrix. */
+	SurfDescriptors();
+
+	/*! Copy constructor. */
+	SurfDescriptors(const SurfDescriptors &other);
+
+	/*! Destructor. */
+	~SurfDescriptors();
+
+	/*! Assignment. */
+	SurfDescriptors &operator=(const SurfDescriptors &other);
+
+public:
+
+	/*! Sets the number and the length of the descriptors. The content
+	 is undefined, the padding is zeroed. */
+	void resize(int count, int length);
+
+	/*! Returns the number of descriptors. */
+	int size() const {
+		return _count;
+	}
+
+	/*! Returns the length of the descriptors. */
+	int getLength() const {
+		return _length;
+	}
+
+	/*! Returns the number of floats between consecutive descriptors. */
+	int getStride() const {
+		return _stride;
+	}
+
+	/*! Returns the i-th descriptor. */
+	float *operator[](int i) {
+		return _data + (size_t) i * _stride;
+	}
+
+	/*! Returns the i-th descriptor. */
+	const float *operator[](int i) const {
+		return _data + (size_t) i * _stride;
+	}
+
+	/*! Copies a descriptor of the length of the matrix to the i-th row. */
+	void set(int i, const float *descriptor);
+
+	/*! Exchanges the content with another matrix without copying. */
+	void swap(SurfDescriptors &other);
+
+public:
+
+	/*! Squared Euclidean distance of two aligned and padded descriptors
+	 with a given stride. */
+	static float distance(const float *a, const float *b, int stride);
+
+	/*! Squared Euclidean distances of an aligned and padded query to
+	 count consecutive descriptors of a matrix with a given stride. */
+	static void distances(const float *query, const float *block, int count,
+			int stride, float *distances);
+
+private:
+
+	/*! Number of descriptors. */
+	int _count;
+
+	/*! Length of the descriptors. */
+	int _length;
+
+	/*! Floats per row. */
+	int _stride;
+
+	/*! Allocated floats. */
+	size_t _capacity;
+
+	/*! Aligned memory. */
+	float *_data;
+};
+
+/*!
+ * Keypoints and descriptors extracted from an image by cvExtractSURF(),
+ * copied out of the CvSeq blocks into contiguous buffers reused for
+ * the following images.
+ */
+class SurfFeature {
+
+public:
+
+	/*! Copies the keypoints and descriptors of sequences. */
+	void assign(const CvSeq *keypoints, const CvSeq *descriptors);
+
+	/*! Sets the number of keypoints and the length of the descriptors.
+	 The content is undefined. */
+	void resize(int count, int length) {
+		_keypoints.resize(count);
+		_descriptors.resize(count, length);
+	}
+
+	/*! Returns the number of keypoints. */
+	int size() const {
+		return _keypoints.size();
+	}
+
+	/*! Exchanges the content with another feature without copying. */
+	void swap(SurfFeature &other) {
+		_keypoints.swap(other._keypoints);
+		_descriptors.swap(other._descriptors);
+	}
+
+	/*! Returns the i-th keypoint. */
+	CvSURFPoint &getKeypoint(int i) {
+		return _keypoints[i];
+	}
+
+	/*! Returns the i-th keypoint. */
+	const CvSURFPoint &getKeypoint(int i) const {
+		return _keypoints[i];
+	}
+
+	/*! Returns the descriptors. */
+	SurfDescriptors &getDescriptors() {
+		return _descriptors;
+	}
+
+	/*! Returns the descriptors. */
+	const SurfDescriptors &getDescriptors() const {
+		return _descriptors;
+	}
+
+private:
+
+	/*! Keypoints. */
+	std::vector<CvSURFPoint> _keypoints;
+
+	/*! Descriptors, in the order of the keypoints. */
+	SurfDescriptors _descriptors;
+};
+
+} // end namespace cv
+} // end namespace rocs
+
+#endif /* SURFFEATURE_H_ */
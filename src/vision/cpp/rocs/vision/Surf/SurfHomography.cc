@@ -0,0 +1,452 @@
+// ==================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (C) 2010  Arnaud Ramey, Andrzej Pronobis
+//
+// This file is part of ROCS.
+//
+// ROCS is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation, either version 3
+// of the License, or (at your option) any later version.
+//
+// ROCS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ROCS. If not, see <http://www.gnu.org/licenses/>.
+// ==================================================================
+
+
+/*!
+ * \file SurfHomography.cc
+ *
+ * \author Andrzej Pronobis
+ */
+
+#include "rocs/cv/Surf/SurfHomography.h"
+#include "rocs/core/debug.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// The AVX kernel is compiled for its own target and chosen at runtime
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+	&& ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9)))
+#define SURF_HOMOGRAPHY_AVX_DISPATCH
+#include <immintrin.h>
+#endif
+
+#include <sys/time.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace rocs {
+namespace cv {
+
+/*! Number of pairs scored between two checks of the remaining pairs. */
+#define SURF_HOMOGRAPHY_SCORE_BLOCK 64
+
+/*! Minimal area of a triangle of points of a sample. */
+#define SURF_HOMOGRAPHY_MIN_AREA 1e-2
+
+/*! Minimal homogeneous coordinate w of a mapped object point. The points
+ mapped on or behind the line at infinity are never inliers. */
+#define SURF_HOMOGRAPHY_MIN_W 1e-6
+
+// -----------------------------------------
+// Kernels counting the inliers among the pairs [begin, end). A pair is
+// an inlier if |(p - u w, q - v w)|^2 <= t^2 w^2 and w > SURF_HOMOGRAPHY_MIN_W,
+// with (p, q, w) the object point (x, y) mapped by the homography f.
+
+/*! Kernel counting inliers. */
+typedef int (*ScoreKernel)(const float f[9], float tt, const float *x,
+		const float *y, const float *u, const float *v, int begin, int end);
+
+/*! Scalar kernel. */
+static int scoreScalar(const float f[9], float tt, const float *x,
+		const float *y, const float *u, const float *v, int begin, int end) {
+	int count = 0;
+	for (int i = begin; i < end; ++i) {
+		float w = f[6] * x[i] + f[7] * y[i] + f[8];
+		float dp = f[0] * x[i] + f[1] * y[i] + f[2] - u[i] * w;
+		float dq = f[3] * x[i] + f[4] * y[i] + f[5] - v[i] * w;
+		if ((w > (float) SURF_HOMOGRAPHY_MIN_W) && (dp * dp + dq * dq <= tt
+				* w * w))
+			++count;
+	}
+	return count;
+}
+
+#if defined(__SSE2__)
+/*! SSE2 kernel, 4 pairs per iteration. */
+static int scoreSse2(const float f[9], float tt, const float *x,
+		const float *y, const float *u, const float *v, int begin, int end) {
+	int count = 0;
+	int i = begin;
+	for (; i + 4 <= end; i += 4) {
+		__m128 xs = _mm_loadu_ps(x + i);
+		__m128 ys = _mm_loadu_ps(y + i);
+		__m128 w = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(f[6]), xs),
+				_mm_mul_ps(_mm_set1_ps(f[7]), ys)), _mm_set1_ps(f[8]));
+		__m128 p = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(f[0]), xs),
+				_mm_mul_ps(_mm_set1_ps(f[1]), ys)), _mm_set1_ps(f[2]));
+		__m128 q = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(f[3]), xs),
+				_mm_mul_ps(_mm_set1_ps(f[4]), ys)), _mm_set1_ps(f[5]));
+		__m128 dp = _mm_sub_ps(p, _mm_mul_ps(_mm_loadu_ps(u + i), w));
+		__m128 dq = _mm_sub_ps(q, _mm_mul_ps(_mm_loadu_ps(v + i), w));
+		__m128 e = _mm_add_ps(_mm_mul_ps(dp, dp), _mm_mul_ps(dq, dq));
+		__m128 limit = _mm_mul_ps(_mm_set1_ps(tt), _mm_mul_ps(w, w));
+		__m128 inlier = _mm_and_ps(_mm_cmple_ps(e, limit), _mm_cmpgt_ps(w,
+				_mm_set1_ps((float) SURF_HOMOGRAPHY_MIN_W)));
+		count += __builtin_popcount(_mm_movemask_ps(inlier));
+	}
+	return count + scoreScalar(f, tt, x, y, u, v, i, end);
+}
+#endif
+
+#if defined(SURF_HOMOGRAPHY_AVX_DISPATCH)
+/*! AVX kernel, 8 pairs per iteration. */
+__attribute__((target("avx")))
+static int scoreAvx(const float f[9], float tt, const float *x,
+		const float *y, const float *u, const float *v, int begin, int end) {
+	int count = 0;
+	int i = begin;
+	for (; i + 8 <= end; i += 8) {
+		__m256 xs = _mm256_loadu_ps(x + i);
+		__m256 ys = _mm256_loadu_ps(y + i);
+		__m256 w = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(
+				f[6]), xs), _mm256_mul_ps(_mm256_set1_ps(f[7]), ys)),
+				_mm256_set1_ps(f[8]));
+		__m256 p = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(
+				f[0]), xs), _mm256_mul_ps(_mm256_set1_ps(f[1]), ys)),
+				_mm256_set1_ps(f[2]));
+		__m256 q = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(
+				f[3]), xs), _mm256_mul_ps(_mm256_set1_ps(f[4]), ys)),
+				_mm256_set1_ps(f[5]));
+		__m256 dp = _mm256_sub_ps(p, _mm256_mul_ps(_mm256_loadu_ps(u + i), w));
+		__m256 dq = _mm256_sub_ps(q, _mm256_mul_ps(_mm256_loadu_ps(v + i), w));
+		__m256 e = _mm256_add_ps(_mm256_mul_ps(dp, dp), _mm256_mul_ps(dq, dq));
+		__m256 limit = _mm256_mul_ps(_mm256_set1_ps(tt), _mm256_mul_ps(w, w));
+		__m256 inlier = _mm256_and_ps(_mm256_cmp_ps(e, limit, _CMP_LE_OQ),
+				_mm256_cmp_ps(w, _mm256_set1_ps((float) SURF_HOMOGRAPHY_MIN_W),
+						_CMP_GT_OQ));
+		count += __builtin_popcount(_mm256_movemask_ps(inlier));
+	}
+	return count + scoreScalar(f, tt, x, y, u, v, i, end);
+}
+#endif
+
+/*! Returns the fastest kernel supported by the processor. */
+static ScoreKernel selectScoreKernel() {
+#if defined(SURF_HOMOGRAPHY_AVX_DISPATCH)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx"))
+		return scoreAvx;
+#endif
+#if defined(__SSE2__)
+	return scoreSse2;
+#else
+	return scoreScalar;
+#endif
+}
+
+/*! Returns the kernel selected on the first call. */
+static ScoreKernel scoreKernel() {
+	static const ScoreKernel kernel = selectScoreKernel();
+	return kernel;
+}
+
+// -----------------------------------------
+/*! True if three points of a sample of 4 are nearly collinear. */
+static bool collinear(const float *x, const float *y, const int sample[4]) {
+	for (int i = 0; i < 4; ++i) {
+		int a = sample[(i + 1) % 4], b = sample[(i + 2) % 4], c = sample[(i
+				+ 3) % 4];
+		double area = (x[b] - x[a]) * (y[c] - y[a]) - (y[b] - y[a]) * (x[c]
+				- x[a]);
+		if (fabs(area) < SURF_HOMOGRAPHY_MIN_AREA)
+			return true;
+	}
+	return false;
+}
+
+// -----------------------------------------
+/*! Solves the n x n system a x = b by Gaussian elimination with partial
+ pivoting. The solution replaces b. Returns false if a is singular. */
+static bool solve(double *a, double *b, int n) {
+	for (int c = 0; c < n; ++c) {
+		int pivot = c;
+		for (int r = c + 1; r < n; ++r)
+			if (fabs(a[r * n + c]) > fabs(a[pivot * n + c]))
+				pivot = r;
+		if (fabs(a[pivot * n + c]) < 1e-12)
+			return false;
+		if (pivot != c) {
+			for (int k = 0; k < n; ++k)
+				std::swap(a[c * n + k], a[pivot * n + k]);
+			std::swap(b[c], b[pivot]);
+		}
+		for (int r = c + 1; r < n; ++r) {
+			double f = a[r * n + c] / a[c * n + c];
+			for (int k = c; k < n; ++k)
+				a[r * n + k] -= f * a[c * n + k];
+			b[r] -= f * b[c];
+		}
+	}
+	for (int c = n - 1; c >= 0; --c) {
+		for (int k = c + 1; k < n; ++k)
+			b[c] -= a[c * n + k] * b[k];
+		b[c] /= a[c * n + c];
+	}
+	return true;
+}
+
+// -----------------------------------------
+SurfHomography::SurfHomography() :
+	_threshold(SURF_HOMOGRAPHY_THRESHOLD), _confidence(
+			SURF_HOMOGRAPHY_CONFIDENCE), _maxIterations(
+			SURF_HOMOGRAPHY_MAX_ITERATIONS) {
+	_statistics.nbPoints = 0;
+	_statistics.nbIterations = 0;
+	_statistics.nbInliers = 0;
+	_statistics.time = 0;
+}
+
+// -----------------------------------------
+bool SurfHomography::find(const std::vector<CvPoint2D32f> &objectPoints,
+		const std::vector<CvPoint2D32f> &imagePoints,
+		const std::vector<float> *scores, double h[9]) {
+	timeval start, end;
+	gettimeofday(&start, NULL);
+	int n = objectPoints.size();
+	_statistics.nbPoints = n;
+	_statistics.nbIterations = 0;
+	_statistics.nbInliers = 0;
+	_statistics.time = 0;
+	bool found = false;
+
+	if ((n >= 4) && (imagePoints.size() == objectPoints.size())) {
+		// Copy the pairs, the best first
+		_order.resize(n);
+		for (int i = 0; i < n; ++i)
+			_order[i] = i;
+		if (scores) {
+			ByScore byScore;
+			byScore.scores = scores;
+			std::stable_sort(_order.begin(), _order.end(), byScore);
+		}
+		_x.resize(n);
+		_y.resize(n);
+		_u.resize(n);
+		_v.resize(n);
+		for (int i = 0; i < n; ++i) {
+			_x[i] = objectPoints[_order[i]].x;
+			_y[i] = objectPoints[_order[i]].y;
+			_u[i] = imagePoints[_order[i]].x;
+			_v[i] = imagePoints[_order[i]].y;
+		}
+
+		// PROSAC: the samples are drawn among the first subset pairs,
+		// the subset grows to all the pairs after _maxIterations samples
+		_random.reset();
+		const int m = 4;
+		int subset = m;
+		double tn = _maxIterations;
+		for (int i = 0; i < m; ++i)
+			tn *= (double) (subset - i) / (n - i);
+		double tnPrime = 1;
+		int maxIterations = _maxIterations;
+		int bestInliers = 0;
+		double model[9];
+		int it = 0;
+		for (; it < maxIterations; ++it) {
+			int t = it + 1;
+			if ((t > tnPrime) && (subset < n)) {
+				double tnNext = tn * (subset + 1) / (subset + 1 - m);
+				++subset;
+				tnPrime += ceil(tnNext - tn);
+				tn = tnNext;
+			}
+
+			// The newest pair of the subset and others drawn before it
+			int sample[m];
+			int k = 0, pool = subset;
+			if (tnPrime >= t) {
+				sample[k++] = subset - 1;
+				pool = subset - 1;
+			}
+			while (k < m) {
+				int c = _random.next() % pool;
+				int j = 0;
+				while ((j < k) && (sample[j] != c))
+					++j;
+				if (j == k)
+					sample[k++] = c;
+			}
+			if (collinear(&_x[0], &_y[0], sample) || collinear(&_u[0],
+					&_v[0], sample))
+				continue;
+			if (!fit(sample, m, model))
+				continue;
+
+			int inliers = score(model, bestInliers);
+			if (inliers > bestInliers) {
+				bestInliers = inliers;
+				std::copy(model, model + 9, h);
+				found = true;
+
+				// Samples needed to draw only inliers with the confidence
+				double p = pow((double) inliers / n, m);
+				if (p >= 1)
+					maxIterations = t;
+				else {
+					double needed = log(1 - _confidence) / log(1 - p);
+					if (needed < maxIterations)
+						maxIterations = std::max(t, (int) ceil(needed));
+				}
+			}
+		}
+		_statistics.nbIterations = it;
+
+		// Refine the best model on its inliers
+		for (int r = 0; found && (r < SURF_HOMOGRAPHY_REFINEMENTS); ++r) {
+			collectInliers(h);
+			if ((_inliers.size() < 4) || (!fit(&_inliers[0], _inliers.size(),
+					model)))
+				break;
+			int inliers = score(model, -1);
+			if (inliers < bestInliers)
+				break;
+			bestInliers = inliers;
+			std::copy(model, model + 9, h);
+		}
+		_statistics.nbInliers = bestInliers;
+	}
+
+	gettimeofday(&end, NULL);
+	_statistics.time = (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_usec
+			- start.tv_usec) / 1000.0;
+	rocsDebug3("SurfHomography::find() - pairs:%i, iterations:%i, inliers:%i, time:%fms",
+			_statistics.nbPoints, _statistics.nbIterations, _statistics.nbInliers,
+			_statistics.time);
+	return found;
+}
+
+// -----------------------------------------
+bool SurfHomography::fit(const int *pairs, int count, double h[9]) const {
+	// Normalize both sets of points: centroid at the origin,
+	// mean distance sqrt(2)
+	double cx = 0, cy = 0, cu = 0, cv = 0;
+	for (int i = 0; i < count; ++i) {
+		cx += _x[pairs[i]];
+		cy += _y[pairs[i]];
+		cu += _u[pairs[i]];
+		cv += _v[pairs[i]];
+	}
+	cx /= count;
+	cy /= count;
+	cu /= count;
+	cv /= count;
+	double d1 = 0, d2 = 0;
+	for (int i = 0; i < count; ++i) {
+		d1 += sqrt((_x[pairs[i]] - cx) * (_x[pairs[i]] - cx) + (_y[pairs[i]]
+				- cy) * (_y[pairs[i]] - cy));
+		d2 += sqrt((_u[pairs[i]] - cu) * (_u[pairs[i]] - cu) + (_v[pairs[i]]
+				- cv) * (_v[pairs[i]] - cv));
+	}
+	if ((d1 < 1e-9) || (d2 < 1e-9))
+		return false;
+	double s1 = sqrt(2.0) * count / d1, s2 = sqrt(2.0) * count / d2;
+
+	// Normal equations of the 8 unknowns, h[8] = 1
+	double a[64], b[8];
+	std::fill(a, a + 64, 0.0);
+	std::fill(b, b + 8, 0.0);
+	for (int i = 0; i < count; ++i) {
+		double x = (_x[pairs[i]] - cx) * s1, y = (_y[pairs[i]] - cy) * s1;
+		double u = (_u[pairs[i]] - cu) * s2, v = (_v[pairs[i]] - cv) * s2;
+		double r1[8] = { x, y, 1, 0, 0, 0, -x * u, -y * u };
+		double r2[8] = { 0, 0, 0, x, y, 1, -x * v, -y * v };
+		for (int j = 0; j < 8; ++j) {
+			for (int k = 0; k < 8; ++k)
+				a[j * 8 + k] += r1[j] * r1[k] + r2[j] * r2[k];
+			b[j] += r1[j] * u + r2[j] * v;
+		}
+	}
+	if (!solve(a, b, 8))
+		return false;
+
+	// Denormalize: h = T2^-1 hn T1
+	double hn[9] = { b[0], b[1], b[2], b[3], b[4], b[5], b[6], b[7], 1 };
+	double t1[9] = { s1, 0, -s1 * cx, 0, s1, -s1 * cy, 0, 0, 1 };
+	double t2[9] = { 1 / s2, 0, cu, 0, 1 / s2, cv, 0, 0, 1 };
+	double tmp[9];
+	for (int r = 0; r < 3; ++r)
+		for (int c = 0; c < 3; ++c)
+			tmp[r * 3 + c] = hn[r * 3] * t1[c] + hn[r * 3 + 1] * t1[3 + c]
+					+ hn[r * 3 + 2] * t1[6 + c];
+	for (int r = 0; r < 3; ++r)
+		for (int c = 0; c < 3; ++c)
+			h[r * 3 + c] = t2[r * 3] * tmp[c] + t2[r * 3 + 1] * tmp[3 + c]
+					+ t2[r * 3 + 2] * tmp[6 + c];
+	if (fabs(h[8]) < 1e-12)
+		return false;
+	for (int k = 0; k < 9; ++k)
+		h[k] /= h[8];
+	return true;
+}
+
+// -----------------------------------------
+int SurfHomography::score(const double h[9], int best) const {
+	int n = _x.size();
+	float f[9];
+	for (int k = 0; k < 9; ++k)
+		f[k] = (float) h[k];
+	float tt = (float) (_threshold * _threshold);
+	ScoreKernel kernel = scoreKernel();
+	int count = 0;
+	int i = 0;
+	while (i < n) {
+		int blockEnd = std::min(n, i + SURF_HOMOGRAPHY_SCORE_BLOCK);
+		count += kernel(f, tt, &_x[0], &_y[0], &_u[0], &_v[0], i, blockEnd);
+		i = blockEnd;
+
+		// The remaining pairs cannot make it better than best
+		if (count + (n - i) <= best)
+			break;
+	}
+	return count;
+}
+
+// -----------------------------------------
+void SurfHomography::collectInliers(const double h[9]) {
+	int n = _x.size();
+	_inliers.clear();
+	double tt = _threshold * _threshold;
+	for (int i = 0; i < n; ++i) {
+		double w = h[6] * _x[i] + h[7] * _y[i] + h[8];
+		double dp = h[0] * _x[i] + h[1] * _y[i] + h[2] - _u[i] * w;
+		double dq = h[3] * _x[i] + h[4] * _y[i] + h[5] - _v[i] * w;
+		if ((w > SURF_HOMOGRAPHY_MIN_W) && (dp * dp + dq * dq <= tt * w * w))
+			_inliers.push_back(i);
+	}
+}
+
+// -----------------------------------------
+void SurfHomography::projectCorners(const double h[9],
+		const CvPoint srcCorners[4], CvPoint dstCorners[4]) {
+	for (int i = 0; i < 4; i++) {
+		double x = srcCorners[i].x, y = srcCorners[i].y;
+		double Z = 1. / (h[6] * x + h[7] * y + h[8]);
+		double X = (h[0] * x + h[1] * y + h[2]) * Z;
+		double Y = (h[3] * x + h[4] * y + h[5]) * Z;
+		dstCorners[i] = cvPoint(cvRound(X), cvRound(Y));
+	}
+}
+
+} // end namespace cv
+} // end namespace rocs
@@ -0,0 +1,184 @@
+// ==================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (C) 2010  Arnaud Ramey, Andrzej Pronobis
+//
+// This file is part of ROCS.
+//
+// ROCS is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation, either version 3
+// of the License, or (at your option) any later version.
+//
+// ROCS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ROCS. If not, see <http://www.gnu.org/licenses/>.
+// ==================================================================
+
+
+/*!
+ * \file SurfHomography.h
+ *
+ * \author Andrzej Pronobis
+ *
+ * Contains declaration of the SurfHomography class.
+ */
+
+#ifndef SURFHOMOGRAPHY_H_
+#define SURFHOMOGRAPHY_H_
+
+/* opencv includes */
+#include "opencv/cv.h"
+
+#include "rocs/cv/Surf/SurfRandom.h"
+
+#include <vector>
+
+namespace rocs {
+namespace cv {
+
+/*! Default maximal reprojection error in pixels of an inlier. */
+#define SURF_HOMOGRAPHY_THRESHOLD 3.0
+
+/*! Default probability of drawing at least one sample of inliers
+ before stopping. */
+#define SURF_HOMOGRAPHY_CONFIDENCE 0.995
+
+/*! Default maximal number of samples. */
+#define SURF_HOMOGRAPHY_MAX_ITERATIONS 2000
+
+/*! Number of least-squares refinements of the best model on its
+ inliers. */
+#define SURF_HOMOGRAPHY_REFINEMENTS 2
+
+/*!
+ * Robust estimator of the homography between the points of an object
+ * and the points of an image paired by the matcher.
+ *
+ * The minimal samples of 4 pairs are drawn as in PROSAC: the pairs are
+ * ordered by a quality score (e.g. the ratio of the distances to the
+ * two nearest descriptors) and the samples are first drawn among the
+ * best pairs, the set growing until it contains all of them. The
+ * number of samples adapts to the inlier ratio of the best model so
+ * far, the search stops once a sample of inliers was drawn with the
+ * requested confidence. Each model is scored by counting the pairs
+ * reprojected within the threshold, several pairs at once with SSE or
+ * AVX, and the scoring stops as soon as the model cannot beat the best
+ * one. The best model is refined by least squares on its inliers.
+ *
+ * The pairs are copied in arrays reused between the calls.
+ */
+class SurfHomography {
+
+public:
+
+	/*! Work done by the last call to find(). */
+	struct Statistics {
+		/*! Number of pairs. */
+		int nbPoints;
+		/*! Number of samples drawn. */
+		int nbIterations;
+		/*! Number of inliers of the homography. */
+		int nbInliers;
+		/*! Time spent in milliseconds. */
+		double time;
+	};
+
+public:
+
+	/*! Constructor. */
+	SurfHomography();
+
+public:
+
+	/*! Sets the maximal reprojection error in pixels of an inlier. */
+	void setThreshold(double threshold) {
+		_threshold = threshold;
+	}
+
+	/*! Sets the probability of having drawn a sample of inliers
+	 when the search stops. */
+	void setConfidence(double confidence) {
+		_confidence = confidence;
+	}
+
+	/*! Sets the maximal number of samples. */
+	void setMaxIterations(int maxIterations) {
+		_maxIterations = (maxIterations > 0) ? maxIterations : 1;
+	}
+
+	/*! Searches the homography h (3x3, row-major) mapping the object
+	 points onto the image points. If scores are given, the pairs of
+	 lower score are sampled first. Returns false if there are less than
+	 4 pairs or no sample gave a homography. */
+	bool find(const std::vector<CvPoint2D32f> &objectPoints,
+			const std::vector<CvPoint2D32f> &imagePoints,
+			const std::vector<float> *scores, double h[9]);
+
+	/*! Returns the work done by the last call to find(). */
+	const Statistics &getStatistics() const {
+		return _statistics;
+	}
+
+	/*! Projects the corners of an object with a homography. */
+	static void projectCorners(const double h[9], const CvPoint srcCorners[4],
+			CvPoint dstCorners[4]);
+
+private:
+
+	/*! Orders the pairs by increasing score. */
+	struct ByScore {
+		const std::vector<float> *scores;
+		bool operator()(int a, int b) const {
+			return (*scores)[a] < (*scores)[b];
+		}
+	};
+
+private:
+
+	/*! Computes the homography fitting count pairs given by their
+	 indices, by least squares on normalized coordinates. Returns false
+	 if the pairs are degenerate. */
+	bool fit(const int *pairs, int count, double h[9]) const;
+
+	/*! Returns the number of pairs reprojected within the threshold in
+	 front of the line at infinity, or a number not above best if the
+	 model cannot have more than best inliers. The kernel is chosen at
+	 runtime for the processor. */
+	int score(const double h[9], int best) const;
+
+	/*! Stores the indices of the inliers of a model in _inliers. */
+	void collectInliers(const double h[9]);
+
+private:
+
+	/*! Maximal reprojection error of an inlier. */
+	double _threshold;
+
+	/*! Probability of having drawn a sample of inliers. */
+	double _confidence;
+
+	/*! Maximal number of samples. */
+	int _maxIterations;
+
+	/*! Random generator, reset by find(). */
+	SurfRandom _random;
+
+	/*! Coordinates of the pairs in the order of the scores. */
+	std::vector<float> _x, _y, _u, _v;
+
+	/*! Order of the pairs and indices of the inliers. */
+	std::vector<int> _order;
+	std::vector<int> _inliers;
+
+	/*! Work done by the last call to find(). */
+	Statistics _statistics;
+};
+
+} // end namespace cv
+} // end namespace rocs
+
+#endif /* SURFHOMOGRAPHY_H_ */
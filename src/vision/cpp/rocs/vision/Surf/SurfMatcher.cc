@@ -0,0 +1,436 @@
+// ==================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (C) 2010  Arnaud Ramey, Andrzej Pronobis
+//
+// This file is part of ROCS.
+//
+// ROCS is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation, either version 3
+// of the License, or (at your option) any later version.
+//
+// ROCS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ROCS. If not, see <http://www.gnu.org/licenses/>.
+// ==================================================================
+
+
+/*!
+ * \file SurfMatcher.cc
+ *
+ * Contains implementation of the SurfMatcher class.
+ *
+ * \author Andrzej Pronobis
+ */
+
+#include "rocs/cv/Surf/SurfMatcher.h"
+#include "rocs/core/debug.h"
+#include "rocs/core/ThreadPool.h"
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+namespace rocs {
+namespace cv {
+
+/*! True for the descriptors below a value in a given dimension. */
+struct BelowSplit {
+	const SurfDescriptors *descriptors;
+	int dim;
+	float value;
+	bool operator()(int row) const {
+		return (*descriptors)[row][dim] < value;
+	}
+};
+
+/*! Orders the descriptors by the value in a given dimension. */
+struct ByDimension {
+	const SurfDescriptors *descriptors;
+	int dim;
+	bool operator()(int a, int b) const {
+		return (*descriptors)[a][dim] < (*descriptors)[b][dim];
+	}
+};
+
+/*! Rows of descriptors stored one after another. */
+struct ContiguousRows {
+	const float *descriptors;
+	int length;
+	const float *operator[](int row) const {
+		return descriptors + (size_t) row * length;
+	}
+};
+
+/*! Laplacians of the keypoints of a feature. */
+struct KeypointLaplacians {
+	const SurfFeature *feature;
+	int operator[](int i) const {
+		return feature->getKeypoint(i).laplacian;
+	}
+};
+
+// -----------------------------------------
+SurfMatcher::SurfMatcher() :
+	_nbTrees(SURF_MATCHER_NB_TREES), _maxChecks(SURF_MATCHER_MAX_CHECKS) {
+}
+
+// -----------------------------------------
+template<typename _Rows, typename _Laplacians>
+void SurfMatcher::buildFrom(const _Rows &descriptors,
+		const _Laplacians &laplacians, int count, int length) {
+	rocsDebug3("SurfMatcher::build(%i descriptors of length %i)", count, length);
+	_partitions.clear();
+	_ids.clear();
+	_random.reset();
+
+	// Partition the descriptors by the sign of the Laplacian
+	std::vector<std::vector<int> > members;
+	for (int i = 0; i < count; ++i) {
+		unsigned int p = 0;
+		while ((p < _partitions.size()) && (_partitions[p].laplacian
+				!= laplacians[i]))
+			++p;
+		if (p == _partitions.size()) {
+			_partitions.push_back(Partition());
+			_partitions.back().laplacian = laplacians[i];
+			members.push_back(std::vector<int>());
+		}
+		members[p].push_back(i);
+	}
+
+	// Pack the descriptors of each partition contiguously,
+	// in the original order
+	_packed.resize(count, length);
+	for (unsigned int p = 0; p < _partitions.size(); ++p) {
+		_partitions[p].begin = _ids.size();
+		for (unsigned int k = 0; k < members[p].size(); ++k) {
+			_packed.set(_ids.size(), descriptors[members[p][k]]);
+			_ids.push_back(members[p][k]);
+		}
+		_partitions[p].end = _ids.size();
+	}
+
+	// Index each partition
+	for (unsigned int p = 0; p < _partitions.size(); ++p) {
+		_partitions[p].trees.resize(_nbTrees);
+		for (int t = 0; t < _nbTrees; ++t)
+			buildTree(_partitions[p].trees[t], _partitions[p]);
+	}
+}
+
+// -----------------------------------------
+void SurfMatcher::build(const float *descriptors, const int *laplacians,
+		int count, int length) {
+	ContiguousRows rows;
+	rows.descriptors = descriptors;
+	rows.length = length;
+	buildFrom(rows, laplacians, count, length);
+}
+
+// -----------------------------------------
+void SurfMatcher::build(const SurfFeature &feature) {
+	KeypointLaplacians laplacians;
+	laplacians.feature = &feature;
+	buildFrom(feature.getDescriptors(), laplacians, feature.size(),
+			feature.getDescriptors().getLength());
+}
+
+// -----------------------------------------
+void SurfMatcher::build(const CvSeq *keypoints, const CvSeq *descriptors) {
+	SurfFeature feature;
+	feature.assign(keypoints, descriptors);
+	build(feature);
+}
+
+// -----------------------------------------
+void SurfMatcher::buildTree(Tree &tree, const Partition &partition) {
+	tree.nodes.clear();
+	tree.order.clear();
+	for (int row = partition.begin; row < partition.end; ++row)
+		tree.order.push_back(row);
+	if (!tree.order.empty())
+		buildNode(tree, 0, tree.order.size());
+}
+
+// -----------------------------------------
+int SurfMatcher::buildNode(Tree &tree, int begin, int end) {
+	int index = tree.nodes.size();
+	tree.nodes.push_back(Node());
+	if (end - begin <= SURF_MATCHER_LEAF_SIZE) {
+		tree.nodes[index].dim = -1;
+		tree.nodes[index].child[0] = begin;
+		tree.nodes[index].child[1] = end;
+		return index;
+	}
+
+	// Mean and variance of each dimension on a sample of the descriptors
+	int length = _packed.getLength();
+	int step = std::max(1, (end - begin) / SURF_MATCHER_VARIANCE_SAMPLES);
+	std::vector<double> mean(length, 0);
+	std::vector<double> variance(length, 0);
+	int samples = 0;
+	for (int k = begin; k < end; k += step, ++samples) {
+		const float *vec = _packed[tree.order[k]];
+		for (int d = 0; d < length; ++d) {
+			mean[d] += vec[d];
+			variance[d] += (double) vec[d] * vec[d];
+		}
+	}
+	std::vector<std::pair<double, int> > spread(length);
+	for (int d = 0; d < length; ++d) {
+		mean[d] /= samples;
+		spread[d] = std::make_pair(variance[d] / samples - mean[d] * mean[d],
+				d);
+	}
+
+	// Split at the mean of one of the dimensions of largest variance
+	int candidates = std::min(length, SURF_MATCHER_SPLIT_CANDIDATES);
+	std::partial_sort(spread.begin(), spread.begin() + candidates,
+			spread.end(), std::greater<std::pair<double, int> >());
+	BelowSplit below;
+	below.descriptors = &_packed;
+	below.dim = spread[_random.next() % candidates].second;
+	below.value = mean[below.dim];
+	int middle = std::partition(tree.order.begin() + begin,
+			tree.order.begin() + end, below) - tree.order.begin();
+
+	// All the values on one side, split at the median
+	if ((middle == begin) || (middle == end)) {
+		ByDimension byDimension;
+		byDimension.descriptors = &_packed;
+		byDimension.dim = below.dim;
+		middle = (begin + end) / 2;
+		std::nth_element(tree.order.begin() + begin, tree.order.begin()
+				+ middle, tree.order.begin() + end, byDimension);
+		below.value = _packed[tree.order[middle]][below.dim];
+	}
+
+	int left = buildNode(tree, begin, middle);
+	int right = buildNode(tree, middle, end);
+	Node &node = tree.nodes[index];
+	node.dim = below.dim;
+	node.value = below.value;
+	node.child[0] = left;
+	node.child[1] = right;
+	return index;
+}
+
+// -----------------------------------------
+int SurfMatcher::findNearest(const float *descriptor, int laplacian) const {
+	const Partition *partition = findPartition(laplacian);
+	if (!partition)
+		return -1;
+
+	// Align and pad the query as the packed descriptors
+	SurfDescriptors query;
+	query.resize(1, _packed.getLength());
+	query.set(0, descriptor);
+
+	SearchState state;
+	state.visited.assign(size(), 0);
+	state.stamp = 0;
+	search(*partition, query[0], state);
+	return acceptMatch(state);
+}
+
+// -----------------------------------------
+void SurfMatcher::findPairs(const SurfFeature &feature,
+		std::vector<int> &ptpairs, core::ThreadPool *threadPool,
+		std::vector<float> *ratios) const {
+	rocsDebug3("SurfMatcher::findPairs(%i)", feature.size());
+	ptpairs.clear();
+	if (ratios)
+		ratios->clear();
+	if (feature.getDescriptors().getLength() != _packed.getLength()) {
+		rocsDebug1("The descriptors have a different length than the indexed ones.");
+		return;
+	}
+
+	int nbTasks = (threadPool) ? 4 * threadPool->getNbThreads() : 1;
+	nbTasks = std::max(1, std::min(nbTasks, feature.size()));
+	if (nbTasks == 1) {
+		findPairsRange(&feature, 0, feature.size(), &ptpairs, ratios);
+		return;
+	}
+
+	// Consecutive ranges of queries, concatenated in order
+	std::vector<std::vector<int> > results(nbTasks);
+	std::vector<std::vector<float> > resultRatios(nbTasks);
+	for (int t = 0; t < nbTasks; ++t)
+		threadPool->schedule(boost::bind(&SurfMatcher::findPairsRange, this,
+				&feature, (long) feature.size() * t / nbTasks,
+				(long) feature.size() * (t + 1) / nbTasks, &results[t],
+				(ratios) ? &resultRatios[t] : 0));
+	threadPool->wait();
+	for (int t = 0; t < nbTasks; ++t) {
+		ptpairs.insert(ptpairs.end(), results[t].begin(), results[t].end());
+		if (ratios)
+			ratios->insert(ratios->end(), resultRatios[t].begin(),
+					resultRatios[t].end());
+	}
+}
+
+// -----------------------------------------
+void SurfMatcher::findPairs(const CvSeq *keypoints, const CvSeq *descriptors,
+		std::vector<int> &ptpairs) const {
+	SurfFeature feature;
+	feature.assign(keypoints, descriptors);
+	findPairs(feature, ptpairs);
+}
+
+// -----------------------------------------
+void SurfMatcher::findPairsRange(const SurfFeature *feature, int begin,
+		int end, std::vector<int> *ptpairs, std::vector<float> *ratios) const {
+	SearchState state;
+	state.visited.assign(size(), 0);
+	state.stamp = 0;
+	for (int i = begin; i < end; ++i) {
+		const Partition *partition = findPartition(
+				feature->getKeypoint(i).laplacian);
+		if (!partition)
+			continue;
+		search(*partition, feature->getDescriptors()[i], state);
+		int nearest = acceptMatch(state);
+		if (nearest >= 0) {
+			ptpairs->push_back(nearest);
+			ptpairs->push_back(i);
+			if (ratios)
+				ratios->push_back((state.distance[1] > 0) ? (float) (state.distance[0]
+						/ state.distance[1]) : 1);
+		}
+	}
+}
+
+// -----------------------------------------
+double SurfMatcher::compareDescriptors(const float *d1, const float *d2,
+		double best, int length) {
+	double total_cost = 0;
+	for (int i = 0; i < length; i += 4) {
+		double t0 = d1[i] - d2[i];
+		double t1 = d1[i + 1] - d2[i + 1];
+		double t2 = d1[i + 2] - d2[i + 2];
+		double t3 = d1[i + 3] - d2[i + 3];
+		total_cost += t0 * t0 + t1 * t1 + t2 * t2 + t3 * t3;
+		if (total_cost > best)
+			break;
+	}
+	return total_cost;
+}
+
+// -----------------------------------------
+void SurfMatcher::search(const Partition &partition,
+		const float *descriptor, SearchState &state) const {
+	++state.stamp;
+	state.checks = 0;
+	state.best[0] = state.best[1] = -1;
+	state.distance[0] = state.distance[1] = 1e6;
+
+	// Small partition or exact search, compare everything in the
+	// order of the linear scan, as one block
+	int count = partition.end - partition.begin;
+	if ((_maxChecks <= 0) || (count <= _maxChecks)) {
+		state.distances.resize(count);
+		if (count > 0)
+			SurfDescriptors::distances(descriptor, _packed[partition.begin],
+					count, _packed.getStride(), &state.distances[0]);
+		for (int k = 0; k < count; ++k)
+			keepNearest(partition.begin + k, state.distances[k], state);
+		state.checks = count;
+		return;
+	}
+
+	// Descend all the trees, then explore the closest branches
+	state.heap.clear();
+	for (unsigned int t = 0; t < partition.trees.size(); ++t)
+		descend(partition, t, 0, 0, descriptor, state);
+	while ((!state.heap.empty()) && (state.checks < _maxChecks)) {
+		std::pop_heap(state.heap.begin(), state.heap.end());
+		Branch branch = state.heap.back();
+		state.heap.pop_back();
+		if (branch.distance >= state.distance[1])
+			break;
+		descend(partition, branch.tree, branch.node, branch.distance,
+				descriptor, state);
+	}
+}
+
+// -----------------------------------------
+void SurfMatcher::descend(const Partition &partition, int tree, int node,
+		float distance, const float *descriptor, SearchState &state) const {
+	const Tree &t = partition.trees[tree];
+	while (t.nodes[node].dim >= 0) {
+		const Node &n = t.nodes[node];
+		float diff = descriptor[n.dim] - n.value;
+		int nearer = n.child[(diff < 0) ? 0 : 1];
+		int farther = n.child[(diff < 0) ? 1 : 0];
+
+		// The other side is at least as far as the splitting plane
+		Branch branch;
+		branch.distance = distance + diff * diff;
+		branch.tree = tree;
+		branch.node = farther;
+		if (branch.distance < state.distance[1]) {
+			state.heap.push_back(branch);
+			std::push_heap(state.heap.begin(), state.heap.end());
+		}
+		node = nearer;
+	}
+
+	const Node &leaf = t.nodes[node];
+	for (int k = leaf.child[0]; k < leaf.child[1]; ++k)
+		check(t.order[k], descriptor, state);
+}
+
+// -----------------------------------------
+void SurfMatcher::check(int point, const float *descriptor,
+		SearchState &state) const {
+	if (state.visited[point] == state.stamp)
+		return;
+	state.visited[point] = state.stamp;
+	++state.checks;
+
+	keepNearest(point, SurfDescriptors::distance(descriptor, _packed[point],
+			_packed.getStride()), state);
+}
+
+// -----------------------------------------
+void SurfMatcher::keepNearest(int point, double d, SearchState &state) {
+	if (d < state.distance[0]) {
+		state.distance[1] = state.distance[0];
+		state.best[1] = state.best[0];
+		state.distance[0] = d;
+		state.best[0] = point;
+	} else if (d < state.distance[1]) {
+		state.distance[1] = d;
+		state.best[1] = point;
+	}
+}
+
+// -----------------------------------------
+int SurfMatcher::acceptMatch(const SearchState &state) const {
+	if (state.best[0] < 0)
+		return -1;
+	if (state.distance[0] > SURF_MATCHING_MAX_DIST_1ST) // not close enough
+		return -1;
+	if (state.distance[0] > SURF_MATCHING_MAX_RATIO_1_2 * state.distance[1]) // two firsts too close
+		return -1;
+	return _ids[state.best[0]];
+}
+
+// -----------------------------------------
+const SurfMatcher::Partition *SurfMatcher::findPartition(int laplacian) const {
+	for (unsigned int p = 0; p < _partitions.size(); ++p)
+		if (_partitions[p].laplacian == laplacian)
+			return &_partitions[p];
+	return 0;
+}
+
+} // end namespace cv
+} // end namespace rocs
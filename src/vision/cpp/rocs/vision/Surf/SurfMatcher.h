@@ -0,0 +1,272 @@
+// ==================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (C) 2010  Arnaud Ramey, Andrzej Pronobis
+//
+// This file is part of ROCS.
+//
+// ROCS is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation, either version 3
+// of the License, or (at your option) any later version.
+//
+// ROCS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ROCS. If not, see <http://www.gnu.org/licenses/>.
+// ==================================================================
+
+
+/*!
+ * \file SurfMatcher.h
+ *
+ * \author Andrzej Pronobis
+ *
+ * Contains declaration of the SurfMatcher class.
+ */
+
+#ifndef SURFMATCHER_H_
+#define SURFMATCHER_H_
+
+#include "rocs/cv/Surf/SurfFeature.h"
+#include "rocs/cv/Surf/SurfRandom.h"
+
+#include <vector>
+
+namespace rocs {
+
+namespace core {
+class ThreadPool;
+}
+
+namespace cv {
+
+#define SURF_MATCHING_MAX_DIST_1ST   0.2
+#define SURF_MATCHING_MAX_RATIO_1_2  0.7 // between 0 and 1, 0 = the most exigent
+
+/*! Default number of randomized kd-trees. */
+#define SURF_MATCHER_NB_TREES 4
+
+/*! Default number of descriptors compared per query. */
+#define SURF_MATCHER_MAX_CHECKS 128
+
+/*! Maximal number of descriptors in a leaf of a kd-tree. */
+#define SURF_MATCHER_LEAF_SIZE 4
+
+/*! Number of dimensions of largest variance among which the
+ split dimension of a node is drawn. */
+#define SURF_MATCHER_SPLIT_CANDIDATES 5
+
+/*! Number of descriptors used to estimate the variances at a node. */
+#define SURF_MATCHER_VARIANCE_SAMPLES 100
+
+/*!
+ * Nearest neighbour matcher of SURF descriptors built once over the
+ * descriptors of a model (e.g. an object) and queried with the
+ * descriptors of each frame.
+ *
+ * The descriptors are partitioned by the sign of the Laplacian, only
+ * descriptors of the same sign are compared. Each partition is indexed
+ * by a forest of randomized kd-trees: the split dimension of a node is
+ * drawn among those of largest variance, so the trees partition the
+ * space differently. A query descends all the trees and then explores
+ * the closest unexplored branches of any tree (best bin first) until
+ * a given number of descriptors was compared.
+ *
+ * A match is accepted by the same tests as
+ * SurfExtractor::surf_naiveNearestNeighbor(): the squared distance to
+ * the nearest descriptor must be below SURF_MATCHING_MAX_DIST_1ST and
+ * SURF_MATCHING_MAX_RATIO_1_2 times the distance to the second nearest.
+ * With setMaxChecks(0) all the descriptors are compared and the
+ * results are those of the linear scan.
+ *
+ * The descriptors are stored packed and aligned (SurfDescriptors),
+ * those of a partition contiguously, and compared in single precision
+ * by a vectorized kernel. Queries do not modify the matcher and can
+ * run concurrently.
+ */
+class SurfMatcher {
+
+public:
+
+	/*! Constructor. Creates an empty matcher. */
+	SurfMatcher();
+
+public:
+
+	/*! Sets the number of kd-trees of each partition. Used by the
+	 next build(). */
+	void setNbTrees(int nbTrees) {
+		_nbTrees = (nbTrees > 0) ? nbTrees : 1;
+	}
+
+	/*! Sets the number of descriptors compared per query,
+	 0 - all (exact linear scan). */
+	void setMaxChecks(int maxChecks) {
+		_maxChecks = maxChecks;
+	}
+
+	/*! Returns the number of descriptors compared per query. */
+	int getMaxChecks() const {
+		return _maxChecks;
+	}
+
+	/*! Indexes count descriptors of a given length stored one after
+	 another, with their Laplacians. The descriptors are copied. */
+	void build(const float *descriptors, const int *laplacians, int count,
+			int length);
+
+	/*! Indexes the descriptors of SURF keypoints, copied row by row
+	 from their aligned storage. */
+	void build(const SurfFeature &feature);
+
+	/*! Indexes the descriptors of SURF keypoints extracted by
+	 cvExtractSURF(). */
+	void build(const CvSeq *keypoints, const CvSeq *descriptors);
+
+	/*! Returns the number of indexed descriptors. */
+	int size() const {
+		return _ids.size();
+	}
+
+	/*! Returns the length of the descriptors. */
+	int getLength() const {
+		return _packed.getLength();
+	}
+
+	/*! Returns the index of the descriptor matching a query descriptor
+	 or -1 if the match is rejected. */
+	int findNearest(const float *descriptor, int laplacian) const;
+
+	/*! Matches the descriptors of keypoints and fills ptpairs with the
+	 pairs (index of the model descriptor, index of the query descriptor)
+	 ordered by the query. If a thread pool is given, the queries are
+	 split between its threads. If ratios is given, it is filled with
+	 the ratio of the distances to the nearest and second nearest
+	 descriptors of each pair, the lower the more distinctive. */
+	void findPairs(const SurfFeature &feature, std::vector<int> &ptpairs,
+			core::ThreadPool *threadPool = 0, std::vector<float> *ratios = 0) const;
+
+	/*! Matches the descriptors of keypoints extracted by cvExtractSURF(). */
+	void findPairs(const CvSeq *keypoints, const CvSeq *descriptors,
+			std::vector<int> &ptpairs) const;
+
+	/*! Squared Euclidean distance of two descriptors. The computation
+	 stops once the distance exceeds best. */
+	static double compareDescriptors(const float *d1, const float *d2,
+			double best, int length);
+
+private:
+
+	/*! Node of a kd-tree. The children of an inner node are nodes,
+	 those of a leaf (dim < 0) delimit its descriptors (rows of the
+	 packed matrix) in the order of the tree. */
+	struct Node {
+		int dim;
+		float value;
+		int child[2];
+	};
+
+	/*! Randomized kd-tree. */
+	struct Tree {
+		std::vector<Node> nodes;
+		std::vector<int> order;
+	};
+
+	/*! Descriptors sharing the sign of the Laplacian, the rows
+	 [begin, end) of the packed matrix. */
+	struct Partition {
+		int laplacian;
+		int begin;
+		int end;
+		std::vector<Tree> trees;
+	};
+
+	/*! Branch waiting to be explored, ordered by the distance. */
+	struct Branch {
+		float distance;
+		int tree;
+		int node;
+		bool operator<(const Branch &other) const {
+			return distance > other.distance;
+		}
+	};
+
+	/*! Buffers of a query. */
+	struct SearchState {
+		std::vector<Branch> heap;
+		std::vector<int> visited;
+		std::vector<float> distances;
+		int stamp;
+		int checks;
+		int best[2];
+		double distance[2];
+	};
+
+	/*! Partitions and indexes count descriptors of a given length.
+	 descriptors[i] must return the i-th descriptor and laplacians[i]
+	 its Laplacian. */
+	template<typename _Rows, typename _Laplacians>
+	void buildFrom(const _Rows &descriptors, const _Laplacians &laplacians,
+			int count, int length);
+
+	/*! Builds a tree over the descriptors of a partition. */
+	void buildTree(Tree &tree, const Partition &partition);
+
+	/*! Matches the keypoints [begin, end) of a feature. */
+	void findPairsRange(const SurfFeature *feature, int begin, int end,
+			std::vector<int> *ptpairs, std::vector<float> *ratios) const;
+
+	/*! Creates the subtree over the descriptors order[begin, end)
+	 and returns its index. */
+	int buildNode(Tree &tree, int begin, int end);
+
+	/*! Searches the two nearest descriptors of a partition. The query
+	 must be aligned and padded as the rows of the packed matrix. */
+	void search(const Partition &partition, const float *descriptor,
+			SearchState &state) const;
+
+	/*! Descends from a node to a leaf, queuing the other branches. */
+	void descend(const Partition &partition, int tree, int node,
+			float distance, const float *descriptor, SearchState &state) const;
+
+	/*! Compares the query with a descriptor and keeps the two nearest. */
+	void check(int point, const float *descriptor, SearchState &state) const;
+
+	/*! Keeps a descriptor if it is one of the two nearest. */
+	static void keepNearest(int point, double d, SearchState &state);
+
+	/*! Returns the match (index of the descriptor given to build())
+	 or -1 after the tests on the distances. */
+	int acceptMatch(const SearchState &state) const;
+
+	/*! Returns the partition of a given Laplacian or null. */
+	const Partition *findPartition(int laplacian) const;
+
+private:
+
+	/*! Number of trees per partition. */
+	int _nbTrees;
+
+	/*! Number of descriptors compared per query. */
+	int _maxChecks;
+
+	/*! Descriptors ordered by partition. */
+	SurfDescriptors _packed;
+
+	/*! Index given to build() of each row of the packed matrix. */
+	std::vector<int> _ids;
+
+	/*! Partitions by the sign of the Laplacian. */
+	std::vector<Partition> _partitions;
+
+	/*! Random generator, reset by build(). */
+	SurfRandom _random;
+};
+
+} // end namespace cv
+} // end namespace rocs
+
+#endif /* SURFMATCHER_H_ */
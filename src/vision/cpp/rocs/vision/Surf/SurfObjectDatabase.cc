@@ -0,0 +1,157 @@
+// ==================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (C) 2010  Arnaud Ramey, Andrzej Pronobis
+//
+// This file is part of ROCS.
+//
+// ROCS is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation, either version 3
+// of the License, or (at your option) any later version.
+//
+// ROCS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ROCS. If not, see <http://www.gnu.org/licenses/>.
+// ==================================================================
+
+
+/*!
+ * \file SurfObjectDatabase.cc
+ *
+ * \author Andrzej Pronobis
+ */
+
+#include "rocs/cv/Surf/SurfObjectDatabase.h"
+#include "rocs/core/debug.h"
+#include "rocs/core/error.h"
+
+#include <algorithm>
+
+namespace rocs {
+namespace cv {
+
+// -----------------------------------------
+SurfObjectDatabase::SurfObjectDatabase() :
+	_built(true) {
+}
+
+// -----------------------------------------
+int SurfObjectDatabase::addObject(const std::string &name,
+		const SurfFeature &features, int width, int height) {
+	rocsDebug3("SurfObjectDatabase::addObject(%s, %i descriptors)", name.c_str(), features.size());
+	if ((!_objects.empty()) && (features.getDescriptors().getLength()
+			!= _objects[0].features.getDescriptors().getLength()))
+		rocsError("The descriptors of the object %s have a different length than those of the database.", name.c_str());
+
+	_objects.push_back(Object());
+	Object &object = _objects.back();
+	object.name = name;
+	object.width = width;
+	object.height = height;
+	object.features = features;
+	_built = false;
+	return _objects.size() - 1;
+}
+
+// -----------------------------------------
+void SurfObjectDatabase::clear() {
+	_objects.clear();
+	_pooled.resize(0, 0);
+	_owners.clear();
+	_matcher = SurfMatcher();
+	_built = true;
+}
+
+// -----------------------------------------
+int SurfObjectDatabase::getNbDescriptors() const {
+	int count = 0;
+	for (unsigned int o = 0; o < _objects.size(); ++o)
+		count += _objects[o].features.size();
+	return count;
+}
+
+// -----------------------------------------
+void SurfObjectDatabase::build() {
+	rocsDebug3("SurfObjectDatabase::build(%i objects)", getNbObjects());
+	int length = (_objects.empty()) ? 0
+			: _objects[0].features.getDescriptors().getLength();
+	_pooled.resize(getNbDescriptors(), length);
+	_owners.resize(_pooled.size());
+	int row = 0;
+	for (unsigned int o = 0; o < _objects.size(); ++o) {
+		const SurfFeature &features = _objects[o].features;
+		for (int i = 0; i < features.size(); ++i, ++row) {
+			_pooled.getKeypoint(row) = features.getKeypoint(i);
+			_pooled.getDescriptors().set(row, features.getDescriptors()[i]);
+			_owners[row] = o;
+		}
+	}
+	_matcher.build(_pooled);
+	_built = true;
+}
+
+// -----------------------------------------
+void SurfObjectDatabase::recognize(const SurfFeature &image,
+		std::vector<Detection> &detections, std::vector<int> &ptpairs,
+		core::ThreadPool *threadPool) {
+	rocsDebug3("SurfObjectDatabase::recognize(%i descriptors)", image.size());
+	if (!_built)
+		build();
+	detections.clear();
+	_matcher.findPairs(image, ptpairs, threadPool, &_ratios);
+
+	// Votes of the pairs for the objects
+	int nbObjects = _objects.size();
+	_votes.assign(nbObjects, 0);
+	for (unsigned int i = 0; i < ptpairs.size(); i += 2)
+		++_votes[_owners[ptpairs[i]]];
+
+	// Group the pairs of each object
+	_first.resize(nbObjects + 1);
+	_first[0] = 0;
+	for (int o = 0; o < nbObjects; ++o)
+		_first[o + 1] = _first[o] + _votes[o];
+	_sorted.resize(ptpairs.size() / 2);
+	for (unsigned int i = 0; i < ptpairs.size(); i += 2)
+		_sorted[_first[_owners[ptpairs[i]]]++] = i;
+	for (int o = nbObjects; o > 0; --o)
+		_first[o] = _first[o - 1];
+	_first[0] = 0;
+
+	// Verify the candidates
+	for (int o = 0; o < nbObjects; ++o) {
+		if (_votes[o] < SURF_LOCATING_MIN_PAIRS)
+			continue;
+		_objectPoints.resize(_votes[o]);
+		_imagePoints.resize(_votes[o]);
+		_scores.resize(_votes[o]);
+		for (int k = 0; k < _votes[o]; ++k) {
+			int pair = _sorted[_first[o] + k];
+			_objectPoints[k] = _pooled.getKeypoint(ptpairs[pair]).pt;
+			_imagePoints[k] = image.getKeypoint(ptpairs[pair + 1]).pt;
+			_scores[k] = _ratios[pair / 2];
+		}
+
+		const Object &object = _objects[o];
+		CvPoint srcCorners[4] = { cvPoint(0, 0), cvPoint(object.width, 0),
+				cvPoint(object.width, object.height), cvPoint(0, object.height) };
+		Detection detection;
+		detection.object = o;
+		detection.nbPairs = _votes[o];
+		double h[9];
+		detection.located = _homography.find(_objectPoints, _imagePoints,
+				&_scores, h);
+		if (detection.located)
+			SurfHomography::projectCorners(h, srcCorners, detection.corners);
+		detection.homography = _homography.getStatistics();
+		detections.push_back(detection);
+	}
+	std::sort(detections.begin(), detections.end(), MoreVoted());
+}
+
+} // end namespace cv
+} // end namespace rocs
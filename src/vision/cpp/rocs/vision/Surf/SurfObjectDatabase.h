@@ -0,0 +1,194 @@
+// ==================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (C) 2010  Arnaud Ramey, Andrzej Pronobis
+//
+// This file is part of ROCS.
+//
+// ROCS is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation, either version 3
+// of the License, or (at your option) any later version.
+//
+// ROCS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ROCS. If not, see <http://www.gnu.org/licenses/>.
+// ==================================================================
+
+
+/*!
+ * \file SurfObjectDatabase.h
+ *
+ * \author Andrzej Pronobis
+ *
+ * Contains declaration of the SurfObjectDatabase class.
+ */
+
+#ifndef SURFOBJECTDATABASE_H_
+#define SURFOBJECTDATABASE_H_
+
+#include "rocs/cv/Surf/SurfMatcher.h"
+#include "rocs/cv/Surf/SurfHomography.h"
+
+#include <string>
+#include <vector>
+
+namespace rocs {
+namespace cv {
+
+/*! Minimal number of pairs for which the homography of an object
+ is searched. */
+#define SURF_LOCATING_MIN_PAIRS      10
+
+/*!
+ * Database of known objects recognized by their SURF keypoints.
+ *
+ * The descriptors of all the objects are pooled in one SurfMatcher,
+ * so each frame is matched once against all the objects and the cost
+ * of a query grows with the logarithm of the number of descriptors
+ * rather than with the number of objects. Each accepted pair votes for
+ * the object owning the matched descriptor. Only the objects with at
+ * least SURF_LOCATING_MIN_PAIRS votes are verified by searching the
+ * homography between their keypoints and those of the frame, the
+ * pairs of lowest distance ratio sampled first (SurfHomography).
+ *
+ * Since the ratio test is done against the nearest descriptor of any
+ * object, descriptors shared by several objects do not vote.
+ */
+class SurfObjectDatabase {
+
+public:
+
+	/*! Object recognized in a frame. */
+	struct Detection {
+		/*! Index of the object. */
+		int object;
+		/*! Number of pairs voting for the object. */
+		int nbPairs;
+		/*! True if the homography was found. */
+		bool located;
+		/*! Corners of the object in the frame, if located. */
+		CvPoint corners[4];
+		/*! Work done to search the homography. */
+		SurfHomography::Statistics homography;
+	};
+
+public:
+
+	/*! Constructor. Creates an empty database. */
+	SurfObjectDatabase();
+
+public:
+
+	/*! Adds an object of a given size described by the SURF keypoints
+	 extracted from its image. The keypoints are copied. Returns the
+	 index of the object. */
+	int addObject(const std::string &name, const SurfFeature &features,
+			int width, int height);
+
+	/*! Removes all the objects. */
+	void clear();
+
+	/*! Returns the number of objects. */
+	int getNbObjects() const {
+		return _objects.size();
+	}
+
+	/*! Returns the name of an object. */
+	const std::string &getName(int object) const {
+		return _objects[object].name;
+	}
+
+	/*! Returns the number of descriptors of all the objects. */
+	int getNbDescriptors() const;
+
+	/*! Returns the matcher of the pooled descriptors, e.g. to set the
+	 number of checks. */
+	SurfMatcher &getMatcher() {
+		return _matcher;
+	}
+
+	/*! Returns the estimator of the homographies, e.g. to set the
+	 threshold. */
+	SurfHomography &getHomography() {
+		return _homography;
+	}
+
+	/*! Indexes the descriptors of all the objects. Called by recognize()
+	 after objects were added. */
+	void build();
+
+	/*! Matches the keypoints of a frame against all the objects and
+	 returns the objects with at least SURF_LOCATING_MIN_PAIRS votes,
+	 most voted first. The pairs (descriptor in the database, keypoint
+	 of the frame) are stored in ptpairs. */
+	void recognize(const SurfFeature &image, std::vector<Detection> &detections,
+			std::vector<int> &ptpairs, core::ThreadPool *threadPool = 0);
+
+	/*! Returns the object owning a descriptor of the database. */
+	int getOwner(int descriptor) const {
+		return _owners[descriptor];
+	}
+
+	/*! Returns a keypoint of the database, in the coordinates of the
+	 image of its object. */
+	const CvSURFPoint &getKeypoint(int descriptor) const {
+		return _pooled.getKeypoint(descriptor);
+	}
+
+private:
+
+	/*! Object of the database. */
+	struct Object {
+		std::string name;
+		int width;
+		int height;
+		/*! Keypoints of the object. */
+		SurfFeature features;
+	};
+
+	/*! Orders the detections by decreasing number of pairs. */
+	struct MoreVoted {
+		bool operator()(const Detection &a, const Detection &b) const {
+			return (a.nbPairs > b.nbPairs) || ((a.nbPairs == b.nbPairs)
+					&& (a.object < b.object));
+		}
+	};
+
+private:
+
+	/*! Objects. */
+	std::vector<Object> _objects;
+
+	/*! Keypoints of all the objects, one after another. */
+	SurfFeature _pooled;
+
+	/*! Object owning each pooled keypoint. */
+	std::vector<int> _owners;
+
+	/*! Index of the pooled descriptors. */
+	SurfMatcher _matcher;
+
+	/*! True if _matcher indexes all the objects. */
+	bool _built;
+
+	/*! Estimator of the homographies. */
+	SurfHomography _homography;
+
+	/*! Votes and pairs of each object, reused between the frames. */
+	std::vector<int> _votes;
+	std::vector<int> _first;
+	std::vector<int> _sorted;
+	std::vector<CvPoint2D32f> _objectPoints;
+	std::vector<CvPoint2D32f> _imagePoints;
+	std::vector<float> _ratios;
+	std::vector<float> _scores;
+};
+
+} // end namespace cv
+} // end namespace rocs
+
+#endif /* SURFOBJECTDATABASE_H_ */
@@ -0,0 +1,70 @@
+// ==================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (C) 2010  Arnaud Ramey, Andrzej Pronobis
+//
+// This file is part of ROCS.
+//
+// ROCS is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation, either version 3
+// of the License, or (at your option) any later version.
+//
+// ROCS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ROCS. If not, see <http://www.gnu.org/licenses/>.
+// ==================================================================
+
+
+/*!
+ * \file SurfRandom.h
+ *
+ * \author Andrzej Pronobis
+ *
+ * Contains declaration of the SurfRandom class.
+ */
+
+#ifndef SURFRANDOM_H_
+#define SURFRANDOM_H_
+
+namespace rocs {
+namespace cv {
+
+/*!
+ * Pseudo-random generator shared by SurfMatcher and SurfHomography.
+ * It is the linear congruential generator given as an example by the
+ * C standard, so that the results do not depend on the platform.
+ */
+class SurfRandom {
+
+public:
+
+	/*! Starts the sequence. */
+	inline SurfRandom() :
+		_seed(1) {
+	}
+
+	/*! Restarts the sequence from the beginning. */
+	inline void reset() {
+		_seed = 1;
+	}
+
+	/*! Returns the next number, between 0 and 32767. */
+	inline unsigned int next() {
+		_seed = _seed * 1103515245u + 12345u;
+		return (_seed >> 16) & 0x7fff;
+	}
+
+private:
+
+	/*! State of the generator. */
+	unsigned int _seed;
+};
+
+} // end namespace cv
+} // end namespace rocs
+
+#endif /* SURFRANDOM_H_ */
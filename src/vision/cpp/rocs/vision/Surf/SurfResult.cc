@@ -0,0 +1,109 @@
+// ==================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (C) 2010  Arnaud Ramey, Andrzej Pronobis
+//
+// This file is part of ROCS.
+//
+// ROCS is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation, either version 3
+// of the License, or (at your option) any later version.
+//
+// ROCS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ROCS. If not, see <http://www.gnu.org/licenses/>.
+// ==================================================================
+
+
+/*!
+ * \file SurfResult.cc
+ *
+ * \author Andrzej Pronobis
+ */
+
+#include "rocs/cv/Surf/SurfResult.h"
+
+#include <algorithm>
+
+namespace rocs {
+namespace cv {
+
+// -----------------------------------------
+SurfResult::SurfResult() :
+	frame(-1), nbKeypoints(0), objectLocated(false) {
+	for (int i = 0; i < 4; ++i)
+		objectCorners[i] = cvPoint(0, 0);
+	homography.nbPoints = homography.nbIterations = homography.nbInliers = 0;
+	homography.time = 0;
+}
+
+// -----------------------------------------
+void SurfResult::swap(SurfResult &other) {
+	std::swap(frame, other.frame);
+	std::swap(nbKeypoints, other.nbKeypoints);
+	std::swap(objectLocated, other.objectLocated);
+	for (int i = 0; i < 4; ++i)
+		std::swap(objectCorners[i], other.objectCorners[i]);
+	objectPoints.swap(other.objectPoints);
+	imagePoints.swap(other.imagePoints);
+	std::swap(homography, other.homography);
+	detections.swap(other.detections);
+}
+
+// -----------------------------------------
+SurfResultQueue::SurfResultQueue(int capacity) :
+	_results((capacity > 0) ? capacity : 1), _first(0), _size(0),
+			_dropped(0), _closed(false) {
+}
+
+// -----------------------------------------
+void SurfResultQueue::push(const SurfResult &result) {
+	boost::mutex::scoped_lock lock(_mutex);
+	if (_size == _results.size()) {
+		_first = (_first + 1) % _results.size();
+		--_size;
+		++_dropped;
+	}
+	_results[(_first + _size) % _results.size()] = result;
+	++_size;
+	_pushed.notify_one();
+}
+
+// -----------------------------------------
+bool SurfResultQueue::pop(SurfResult &result, bool wait) {
+	boost::mutex::scoped_lock lock(_mutex);
+	while (wait && (_size == 0) && !_closed)
+		_pushed.wait(lock);
+	if (_size == 0)
+		return false;
+	result.swap(_results[_first]);
+	_first = (_first + 1) % _results.size();
+	--_size;
+	return true;
+}
+
+// -----------------------------------------
+void SurfResultQueue::close() {
+	boost::mutex::scoped_lock lock(_mutex);
+	_closed = true;
+	_pushed.notify_all();
+}
+
+// -----------------------------------------
+int SurfResultQueue::size() const {
+	boost::mutex::scoped_lock lock(_mutex);
+	return _size;
+}
+
+// -----------------------------------------
+int SurfResultQueue::getNbDropped() const {
+	boost::mutex::scoped_lock lock(_mutex);
+	return _dropped;
+}
+
+} // end namespace cv
+} // end namespace rocs
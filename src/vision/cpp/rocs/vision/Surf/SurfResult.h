@@ -0,0 +1,140 @@
+// ==================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (C) 2010  Arnaud Ramey, Andrzej Pronobis
+//
+// This file is part of ROCS.
+//
+// ROCS is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation, either version 3
+// of the License, or (at your option) any later version.
+//
+// ROCS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ROCS. If not, see <http://www.gnu.org/licenses/>.
+// ==================================================================
+
+
+/*!
+ * \file SurfResult.h
+ *
+ * \author Andrzej Pronobis
+ *
+ * Contains declaration of the SurfResult structure and the
+ * SurfResultQueue class.
+ */
+
+#ifndef SURFRESULT_H_
+#define SURFRESULT_H_
+
+#include "rocs/cv/Surf/SurfObjectDatabase.h"
+
+#include <boost/thread.hpp>
+
+#include <vector>
+
+namespace rocs {
+namespace cv {
+
+/*! Default number of results kept by a SurfResultQueue. */
+#define SURF_RESULT_QUEUE_CAPACITY 8
+
+/*!
+ * Result of the processing of a frame by SurfExtractor, passed to its
+ * result sink. Assigning a result to another one with enough capacity
+ * and swapping two results do not allocate memory.
+ */
+struct SurfResult {
+	/*! Constructor. Creates the empty result of no frame. */
+	SurfResult();
+
+	/*! Exchanges the contents of two results. */
+	void swap(SurfResult &other);
+
+	/*! Index of the frame since SurfExtractor::start(). */
+	int frame;
+	/*! Number of keypoints extracted from the frame. */
+	int nbKeypoints;
+	/*! True if the object of SurfExtractor::defineObjectImage() was
+	 located. */
+	bool objectLocated;
+	/*! Corners of the object in the frame, if located. */
+	CvPoint objectCorners[4];
+	/*! Paired points of the object and of the frame. */
+	std::vector<CvPoint2D32f> objectPoints;
+	std::vector<CvPoint2D32f> imagePoints;
+	/*! Work done to search the homography of the object. */
+	SurfHomography::Statistics homography;
+	/*! Objects of the database recognized in the frame. */
+	std::vector<SurfObjectDatabase::Detection> detections;
+};
+
+/*!
+ * Bounded queue of results filled by the extraction and emptied by
+ * another thread. The producer never waits: when the queue is full the
+ * oldest result is dropped. Usable as a result sink with
+ * boost::bind(&SurfResultQueue::push, &queue, _1).
+ *
+ * The results are stored in a ring of slots created once. push() copies
+ * into a slot and pop() swaps the slot with the result of the caller, so
+ * that the slots and the results of the consumer keep their buffers and
+ * a steady stream of results does not allocate memory.
+ */
+class SurfResultQueue {
+
+public:
+
+	/*! Constructor. */
+	SurfResultQueue(int capacity = SURF_RESULT_QUEUE_CAPACITY);
+
+public:
+
+	/*! Appends a copy of a result, dropping the oldest one if the queue
+	 is full. */
+	void push(const SurfResult &result);
+
+	/*! Removes the oldest result and swaps it into result. If wait is
+	 true, blocks until a result is available or close() is called.
+	 Returns false if there is no result. */
+	bool pop(SurfResult &result, bool wait = true);
+
+	/*! Wakes up the threads waiting in pop(). */
+	void close();
+
+	/*! Returns the number of results in the queue. */
+	int size() const;
+
+	/*! Returns the number of results dropped because the queue was
+	 full. */
+	int getNbDropped() const;
+
+private:
+
+	/*! Slots of the results, used as a ring. */
+	std::vector<SurfResult> _results;
+
+	/*! Slot of the oldest result and number of results. */
+	unsigned int _first;
+	unsigned int _size;
+
+	/*! Number of dropped results. */
+	int _dropped;
+
+	/*! True once close() was called. */
+	bool _closed;
+
+	/*! Protects the fields above. */
+	mutable boost::mutex _mutex;
+
+	/*! Signaled when a result is pushed or the queue is closed. */
+	boost::condition_variable _pushed;
+};
+
+} // end namespace cv
+} // end namespace rocs
+
+#endif /* SURFRESULT_H_ */
@@ -0,0 +1,170 @@
+// ==================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (C) 2010  Arnaud Ramey, Andrzej Pronobis
+//
+// This file is part of ROCS.
+//
+// ROCS is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation, either version 3
+// of the License, or (at your option) any later version.
+//
+// ROCS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ROCS. If not, see <http://www.gnu.org/licenses/>.
+// ==================================================================
+
+
+/*!
+ * \file SurfVisualizer.cc
+ *
+ * \author Andrzej Pronobis
+ */
+
+#include "rocs/cv/Surf/SurfVisualizer.h"
+#include "rocs/core/debug.h"
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+
+namespace rocs {
+namespace cv {
+
+// -----------------------------------------
+SurfVisualizer::SurfVisualizer(const std::string &windowName) :
+	_windowName(windowName), _posted(0), _drawing(0), _drawn(0), _shown(0),
+			_pending(false), _ready(false), _stop(false), _dropped(0) {
+}
+
+// -----------------------------------------
+SurfVisualizer::~SurfVisualizer() {
+	stop();
+	IplImage **images[4] = { &_posted, &_drawing, &_drawn, &_shown };
+	for (int i = 0; i < 4; ++i)
+		if (*images[i])
+			cvReleaseImage(images[i]);
+}
+
+// -----------------------------------------
+void SurfVisualizer::start() {
+	if (_thread.joinable())
+		return;
+	cvNamedWindow(_windowName.c_str(), 1);
+	_stop = false;
+	_thread = boost::thread(boost::bind(&SurfVisualizer::loop, this));
+}
+
+// -----------------------------------------
+void SurfVisualizer::stop() {
+	if (!_thread.joinable())
+		return;
+	{
+		boost::mutex::scoped_lock lock(_mutex);
+		_stop = true;
+		_changed.notify_all();
+	}
+	_thread.join();
+	cvDestroyWindow(_windowName.c_str());
+}
+
+// -----------------------------------------
+bool SurfVisualizer::post(const IplImage *frame, const SurfResult &result) {
+	boost::mutex::scoped_try_lock lock(_mutex);
+	if ((!lock.owns_lock()) || _pending) {
+		if (lock.owns_lock())
+			++_dropped;
+		return false;
+	}
+	fit(_posted, frame);
+	cvCopy(frame, _posted);
+	_postedResult = result;
+	_pending = true;
+	_changed.notify_one();
+	return true;
+}
+
+// -----------------------------------------
+bool SurfVisualizer::show() {
+	{
+		boost::mutex::scoped_try_lock lock(_mutex);
+		if ((!lock.owns_lock()) || (!_ready))
+			return false;
+		std::swap(_drawn, _shown);
+		_ready = false;
+	}
+	cvShowImage(_windowName.c_str(), _shown);
+	cvWaitKey(1);
+	return true;
+}
+
+// -----------------------------------------
+int SurfVisualizer::getNbDropped() const {
+	boost::mutex::scoped_lock lock(_mutex);
+	return _dropped;
+}
+
+// -----------------------------------------
+void SurfVisualizer::loop() {
+	rocsDebug3("SurfVisualizer::loop() - %s", _windowName.c_str());
+	for (;;) {
+		{
+			boost::mutex::scoped_lock lock(_mutex);
+			while ((!_pending) && (!_stop))
+				_changed.wait(lock);
+			if (_stop)
+				break;
+			std::swap(_posted, _drawing);
+			_postedResult.swap(_drawingResult);
+			_pending = false;
+		}
+		draw(_drawing, _drawingResult);
+		{
+			boost::mutex::scoped_lock lock(_mutex);
+			std::swap(_drawing, _drawn);
+			_ready = true;
+		}
+	}
+}
+
+// -----------------------------------------
+void SurfVisualizer::fit(IplImage *&image, const IplImage *frame) {
+	if ((image) && ((image->width != frame->width) || (image->height
+			!= frame->height) || (image->depth != frame->depth)
+			|| (image->nChannels != frame->nChannels)))
+		cvReleaseImage(&image);
+	if (!image)
+		image = cvCreateImage(cvGetSize(frame), frame->depth,
+				frame->nChannels);
+}
+
+// -----------------------------------------
+void SurfVisualizer::draw(IplImage *image, const SurfResult &result) {
+	/* the paired points of the frame */
+	for (unsigned int i = 0; i < result.imagePoints.size(); ++i)
+		cvCircle(image, cvPointFrom32f(result.imagePoints[i]), 3, CV_RGB(0,0,255),
+				1, 8, 0);
+
+	/* the object */
+	if (result.objectLocated)
+		for (int i = 0; i < 4; i++)
+			cvLine(image, result.objectCorners[i],
+					result.objectCorners[(i + 1) % 4], CV_RGB(0, 255, 0), 2);
+
+	/* the objects of the database */
+	for (unsigned int d = 0; d < result.detections.size(); ++d) {
+		if (!result.detections[d].located)
+			continue;
+		const CvPoint* corners = result.detections[d].corners;
+		for (int i = 0; i < 4; i++)
+			cvLine(image, corners[i], corners[(i + 1) % 4],
+					CV_RGB(255, 255, 0), 2);
+	}
+}
+
+} // end namespace cv
+} // end namespace rocs
@@ -0,0 +1,142 @@
+// ==================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (C) 2010  Arnaud Ramey, Andrzej Pronobis
+//
+// This file is part of ROCS.
+//
+// ROCS is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation, either version 3
+// of the License, or (at your option) any later version.
+//
+// ROCS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ROCS. If not, see <http://www.gnu.org/licenses/>.
+// ==================================================================
+
+
+/*!
+ * \file SurfVisualizer.h
+ *
+ * \author Andrzej Pronobis
+ *
+ * Contains declaration of the SurfVisualizer class.
+ */
+
+#ifndef SURFVISUALIZER_H_
+#define SURFVISUALIZER_H_
+
+#include "rocs/cv/Surf/SurfResult.h"
+
+/* opencv includes */
+#include "opencv/highgui.h"
+
+#include <boost/thread.hpp>
+
+#include <string>
+
+namespace rocs {
+namespace cv {
+
+/*!
+ * Draws the frames processed by SurfExtractor with their results in
+ * a thread of its own and displays them in a window.
+ *
+ * The extraction hands over each frame together with its result with
+ * post(), which never waits: if the visualizer is still busy with the
+ * previous frame, the new one is dropped. HighGUI is not thread-safe,
+ * so the window is only used from the thread calling start(), show()
+ * and stop(): show() displays the last frame drawn, if any. The buffers
+ * of the frames and of the results are swapped between the threads and
+ * reused, a stream of frames of the same size does not allocate memory.
+ */
+class SurfVisualizer {
+
+public:
+
+	/*! Constructor. */
+	SurfVisualizer(const std::string &windowName);
+
+	/*! Destructor. Stops the thread. */
+	~SurfVisualizer();
+
+public:
+
+	/*! Opens the window and starts the thread. */
+	void start();
+
+	/*! Stops the thread and closes the window. */
+	void stop();
+
+	/*! Hands a copy of a frame and of its result over to the thread.
+	 Returns false if they were dropped. */
+	bool post(const IplImage *frame, const SurfResult &result);
+
+	/*! Displays the last frame drawn by the thread and processes the
+	 events of the window. Never waits for the thread. Returns false if
+	 no new frame was drawn since the previous call. */
+	bool show();
+
+	/*! Returns the number of frames dropped. */
+	int getNbDropped() const;
+
+private:
+
+	/*! Main loop of the thread. */
+	void loop();
+
+	/*! Draws a result onto a frame. */
+	static void draw(IplImage *image, const SurfResult &result);
+
+	/*! Reallocates an image if it does not have the size and format
+	 of a frame. */
+	static void fit(IplImage *&image, const IplImage *frame);
+
+private:
+
+	/*! Name of the window. */
+	std::string _windowName;
+
+	/*! Thread drawing the frames. */
+	boost::thread _thread;
+
+	/*! Last frame posted and its result. */
+	IplImage *_posted;
+	SurfResult _postedResult;
+
+	/*! Frame being drawn by the thread and its result. */
+	IplImage *_drawing;
+	SurfResult _drawingResult;
+
+	/*! Last frame drawn and the frame displayed by show(). */
+	IplImage *_drawn;
+	IplImage *_shown;
+
+	/*! True if _posted was not drawn yet. */
+	bool _pending;
+
+	/*! True if _drawn was not displayed yet. */
+	bool _ready;
+
+	/*! True if the thread should finish. */
+	bool _stop;
+
+	/*! Number of frames dropped. */
+	int _dropped;
+
+	/*! Protects the fields above, except _drawing and _drawingResult
+	 owned by the thread and _shown owned by the caller of show(). */
+	mutable boost::mutex _mutex;
+
+	/*! Signaled when a frame is posted or the thread should stop. */
+	boost::condition_variable _changed;
+};
+
+} // end namespace cv
+} // end namespace rocs
+
+#endif /* SURFVISUALIZER_H_ */
@@ -30,13 +30,120 @@
 #include <boost/test/unit_test.hpp>
 // ROCS
 #include "rocs/cv/Crfh/CrfhInterface.h"
+#include "rocs/cv/Crfh/DescriptorList.h"
+#include "rocs/cv/Crfh/Quantizer.h"
+#include "rocs/cv/HistogramFile.h"
+#include "rocs/cv/HistogramIndex.h"
+#include "rocs/core/ThreadPool.h"
+// boost
+#include <boost/thread/thread.hpp>
 // stl
 #include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <new>
+#include <algorithm>
 using namespace std;
 
+/*!
+ * counts the calls to operator new made by the thread which created it,
+ * from its creation to its destruction
+ */
+class HeapAllocationCounter
+{
+public:
+	HeapAllocationCounter() :
+		_thread(boost::this_thread::get_id()), _count(0)
+	{
+		_active = this;
+	}
+
+	~HeapAllocationCounter()
+	{
+		_active = 0;
+	}
+
+	long get() const
+	{
+		return _count;
+	}
+
+	static void count()
+	{
+		if ((_active) && (boost::this_thread::get_id() == _active->_thread))
+			++_active->_count;
+	}
+
+private:
+	boost::thread::id _thread;
+	long _count;
+	static HeapAllocationCounter *_active;
+};
+
+HeapAllocationCounter *HeapAllocationCounter::_active = 0;
+
+/*!
+ * operator new counting the allocations of the tests
+ */
+void *operator new(size_t size)
+{
+	HeapAllocationCounter::count();
+	void *p = malloc(size ? size : 1);
+	if (!p)
+		throw bad_alloc();
+	return p;
+}
+
+void operator delete(void *p) throw ()
+{
+	free(p);
+}
+
 #define ROCSDIR "../../"
 #define IMGDIR ROCSDIR "data/images/"
 
+/*! Maximal L1 distance between the normalized histograms
+ computed in double and single precision. */
+#define CRFH_FLOAT_TOLERANCE 0.01
+
+/*! Maximal L1 distance between the normalized histograms
+ computed with the FIR and recursive Gaussian filters. The measured
+ distance is about 0.09, mostly due to the truncation of the FIR
+ kernels at GAUSSIAN_SIGMAS. */
+#define CRFH_RECURSIVE_TOLERANCE 0.1
+
+/*! Maximal L1 distance between the normalized histograms
+ computed with the incremental and direct scale-space. The measured
+ distance is about 0.13, the truncated Gaussian kernels do not
+ compose exactly. */
+#define CRFH_INCREMENTAL_TOLERANCE 0.15
+
+/*! Maximal L1 distance between the normalized histograms computed
+ with the fused and separate derivatives (rounding at bin edges). */
+#define CRFH_FUSED_TOLERANCE 0.001
+
+/*! Maximal L1 distance between the normalized histograms computed
+ from the whole filtered image and only around a region. */
+#define CRFH_REGION_TOLERANCE 0.000001
+
+/*! Maximal difference between the histogram measures computed
+ from the common bins and directly from the definitions. */
+#define CRFH_MEASURE_TOLERANCE 0.000000001
+
+/*!
+ * compares the key of a bin with a key
+ */
+struct KeyLess
+{
+	template<typename _Entry>
+	bool operator()(const _Entry &entry, int key) const
+	{
+		return entry.first < key;
+	}
+};
+
 /*!
  * a test case for a simple image
  */
@@ -58,25 +165,144 @@ BOOST_AUTO_TEST_CASE( caseFeatureList )
 	BOOST_CHECK( testFeatureList.size() == 2);
 	BOOST_CHECK( testFeatureList.at(1) == 2);
 	BOOST_CHECK( testFeatureList.at(3) == 10);
+
+	// the bins are sorted and can be modified through the iterators
+	rocs::cv::FeatureList<int, double> bulkList;
+	bulkList.append(1, 4);
+	bulkList.append(3, 20);
+	for (rocs::cv::FeatureList<int, double>::iterator it =
+			testFeatureList.begin(); it != testFeatureList.end(); ++it)
+		it->second *= 2;
+	BOOST_CHECK( testFeatureList == bulkList );
+
+	// removing the first bins
+	bulkList.insert_(0, 1);
+	bulkList.filter(0.5);
+	BOOST_CHECK( bulkList.size() == 1);
+	BOOST_CHECK( bulkList.begin()->first == 3);
+
+	// random access through the iterators
+	typedef rocs::cv::FeatureList<int, double>::const_iterator Iterator;
+	const rocs::cv::FeatureList<int, double> &constList = testFeatureList;
+	Iterator first = constList.begin();
+	Iterator last = constList.end();
+	BOOST_CHECK( last - first == 2 );
+	BOOST_CHECK( first[1].first == 3 );
+	BOOST_CHECK( (1 + first) == (last - 1) );
+	Iterator it = last;
+	it -= 2;
+	BOOST_CHECK( it == first );
+	BOOST_CHECK( (first < last) && (last > first) );
+	BOOST_CHECK( (first <= it) && (it >= first) && !(last <= first) );
+	BOOST_CHECK( std::lower_bound(first, last, 3, KeyLess())->second == 20 );
+}
+
+/*!
+ * a test case comparing the accumulators with the direct map insertion
+ */
+BOOST_AUTO_TEST_CASE( caseHistogramAccumulator )
+{
+	using namespace rocs::cv;
+	const long binSpace = 28 * 28;
+	// indices inside and outside of the bin space
+	vector<long> indices;
+	for (long i = 0; i < 20000; ++i)
+		indices.push_back(((i * 7919) % (binSpace + 200)) - 100);
+
+	FeatureList<int, double> reference;
+	for (unsigned int i = 0; i < indices.size(); ++i)
+		reference.increase_if_found(indices[i]);
+
+	for (int type = AT_MAP; type <= AT_AUTO; ++type)
+	{
+		HistogramAccumulator accumulator((AccumulatorType) type, binSpace,
+				indices.size());
+		// the accumulator must be reusable after flushing
+		for (int pass = 0; pass < 2; ++pass)
+		{
+			for (unsigned int i = 0; i < indices.size(); ++i)
+				accumulator.increase(indices[i]);
+			FeatureList<int, double> result;
+			accumulator.flushTo(result);
+			BOOST_CHECK( result == reference );
+			BOOST_CHECK( result._sum == reference._sum );
+			BOOST_CHECK( result._max == reference._max );
+		}
+	}
+}
+
+/*!
+ * a test case comparing the vectorized and portable quantization kernels
+ */
+BOOST_AUTO_TEST_CASE( caseQuantizer )
+{
+	using namespace rocs::cv;
+	DescriptorList descrList;
+	descrList.addDescriptor("Lxx", 8, 28);
+	descrList.addDescriptor("Lyy", 4, 16);
+	descrList.addDescriptor("L", 2, 8);
+	Quantizer quantizer(descrList);
+
+	// random values covering the range of each descriptor, an odd
+	// number of columns so that the remainder loops are used too
+	const int cols = 1001;
+	const int begin = 3;
+	srand(7);
+	vector<vector<double> > values(descrList.size(), vector<double> (cols));
+	vector<vector<float> > valuesFloat(descrList.size(),
+			vector<float> (cols));
+	vector<const double *> rows;
+	vector<const float *> rowsFloat;
+	for (unsigned int k = 0; k < descrList.size(); ++k)
+	{
+		double min = descrList[k]->getMin();
+		double max = descrList[k]->getMax();
+		for (int j = 0; j < cols; ++j)
+		{
+			values[k][j] = min + (max - min) * rand() / RAND_MAX;
+			valuesFloat[k][j] = (float) values[k][j];
+		}
+		rows.push_back(&values[k][0]);
+		rowsFloat.push_back(&valuesFloat[k][0]);
+	}
+
+	vector<int> binRow(cols);
+	vector<long> indices(cols), reference(cols);
+	quantizer.quantizeRow(&rows[0], begin, cols, &binRow[0], &indices[0]);
+	quantizer.quantizeRowScalar(&rows[0], begin, cols, &binRow[0],
+			&reference[0]);
+	BOOST_CHECK( equal(indices.begin() + begin, indices.end(),
+			reference.begin() + begin) );
+
+	quantizer.quantizeRow(&rowsFloat[0], begin, cols, &binRow[0],
+			&indices[0]);
+	quantizer.quantizeRowScalar(&rowsFloat[0], begin, cols, &binRow[0],
+			&reference[0]);
+	BOOST_CHECK( equal(indices.begin() + begin, indices.end(),
+			reference.begin() + begin) );
 }
 
 /*!
  * a test case for a given image
  * @param filenamePpm the input image
  * @param filenameCrfh the correct result file
+ * @param accumulatorType the accumulator used for counting the bins
  */
-void testCrfh(const char* filenamePpm, const char* filenameCrfh)
+void testCrfh(const char* filenamePpm, const char* filenameCrfh,
+		rocs::cv::AccumulatorType accumulatorType = rocs::cv::AT_AUTO)
 {
 	using namespace rocs::cv;
 	CrfhInterface crfhInterface;
 	crfhInterface.defineSystem("Lxx(8,28)");
+	crfhInterface.setAccumulatorType(accumulatorType);
 	crfhInterface.start();
 
 	/*
 	 * method 1 : load the Img separately and pass it
 	 * method 2 : directly give the filename to the feature extractor
+	 * method 3 : same as 2, with the batch mode using several threads
 	 */
-	for (int imgLoadMethod = 1; imgLoadMethod <= 2; ++imgLoadMethod)
+	for (int imgLoadMethod = 1; imgLoadMethod <= 3; ++imgLoadMethod)
 	{
 		Crfh* featureList;
 		string result;
@@ -104,7 +330,8 @@ void testCrfh(const char* filenamePpm, const char* filenameCrfh)
 		{
 			string fileIn = filenamePpm;
 			string fileOut = "out.txt";
-			crfhInterface.process(fileIn, fileOut);
+			crfhInterface.process(fileIn, fileOut, (imgLoadMethod == 3) ? 3
+					: 1);
 			result = rocs::core::readFile(fileOut.c_str());
 		}
 
@@ -124,7 +351,873 @@ void testCrfh(const char* filenamePpm, const char* filenameCrfh)
 
 BOOST_AUTO_TEST_CASE( caseCrfh )
 {
-	testCrfh(IMGDIR "Coffee_nb.ppm", IMGDIR "Coffee_nb_Lxx(8,28).crfh");
-	testCrfh(IMGDIR "box.ppm", IMGDIR "box_Lxx(8,28).crfh");
+	// all the accumulators must give exactly the same results
+	for (int type = rocs::cv::AT_MAP; type <= rocs::cv::AT_AUTO; ++type)
+	{
+		rocs::cv::AccumulatorType accumulatorType =
+				(rocs::cv::AccumulatorType) type;
+		testCrfh(IMGDIR "Coffee_nb.ppm", IMGDIR "Coffee_nb_Lxx(8,28).crfh",
+				accumulatorType);
+		testCrfh(IMGDIR "box.ppm", IMGDIR "box_Lxx(8,28).crfh",
+				accumulatorType);
+	}
+}
+
+
+/*!
+ * L1 distance between two histograms
+ */
+double histogramDistance(const rocs::cv::Crfh& a, const rocs::cv::Crfh& b)
+{
+	double distance = 0;
+	rocs::cv::Crfh::const_iterator itA = a.begin();
+	rocs::cv::Crfh::const_iterator itB = b.begin();
+	while ((itA != a.end()) || (itB != b.end()))
+	{
+		if ((itB == b.end()) || ((itA != a.end()) && (itA->first < itB->first)))
+			distance += (itA++)->second;
+		else if ((itA == a.end()) || (itB->first < itA->first))
+			distance += (itB++)->second;
+		else
+			distance += fabs((itA++)->second - (itB++)->second);
+	}
+	return distance;
+}
+
+/*!
+ * a test case comparing the single and double precision pipelines
+ */
+BOOST_AUTO_TEST_CASE( caseCrfhFloat )
+{
+	using namespace rocs::cv;
+	System system("Lxx(4,28)+Lyy(4,28)+Lxy(2,28)+L(2,8)");
+	Img* img = ImageIO::load(IMGDIR "Coffee_nb.ppm");
+
+	system.setPrecision(PT_DOUBLE);
+	Crfh* crfhDouble = system.computeHistogram(*img, 15);
+	system.setPrecision(PT_FLOAT);
+	Crfh* crfhFloat = system.computeHistogram(*img, 15);
+	BOOST_CHECK( crfhDouble->_sum == crfhFloat->_sum );
+
+	crfhDouble->normalize();
+	crfhFloat->normalize();
+
+	double distance = histogramDistance(*crfhDouble, *crfhFloat);
+	cout << "L1 distance between double and float histograms:" << distance
+			<< endl;
+	BOOST_CHECK( distance <= CRFH_FLOAT_TOLERANCE );
+
+	delete crfhDouble;
+	delete crfhFloat;
+	delete img;
+}
+
+/*!
+ * a test case comparing the FIR and recursive Gaussian filters
+ */
+BOOST_AUTO_TEST_CASE( caseRecursiveGaussian )
+{
+	using namespace rocs::cv;
+	const char* sysDef = "Lxx(32,28)+Lyy(32,28)+Lxy(16,28)";
+	System systemFir;
+	systemFir.setRecursiveGaussianSigma(0);
+	systemFir.build(sysDef);
+	System systemRecursive;
+	systemRecursive.setRecursiveGaussianSigma(3);
+	systemRecursive.build(sysDef);
+	Img* img = ImageIO::load(IMGDIR "Coffee_nb.ppm");
+
+	Crfh* crfhFir = systemFir.computeHistogram(*img, 15);
+	Crfh* crfhRecursive = systemRecursive.computeHistogram(*img, 15);
+	crfhFir->normalize();
+	crfhRecursive->normalize();
+
+	double distance = histogramDistance(*crfhFir, *crfhRecursive);
+	cout << "L1 distance between FIR and recursive histograms:" << distance
+			<< endl;
+	BOOST_CHECK( distance <= CRFH_RECURSIVE_TOLERANCE );
+
+	delete crfhFir;
+	delete crfhRecursive;
+	delete img;
+}
+
+/*!
+ * a test case comparing the incremental and direct scale-space
+ */
+BOOST_AUTO_TEST_CASE( caseIncrementalScaleSpace )
+{
+	using namespace rocs::cv;
+	System system("Lxx(2,28)+Lxy(4,28)+Lyy(8,28)+Lxx(8,28)");
+	Img* img = ImageIO::load(IMGDIR "Coffee_nb.ppm");
+
+	system.setIncrementalScaleSpace(false);
+	Crfh* crfhDirect = system.computeHistogram(*img, 15);
+	system.setIncrementalScaleSpace(true);
+	Crfh* crfhIncremental = system.computeHistogram(*img, 15);
+	crfhDirect->normalize();
+	crfhIncremental->normalize();
+
+	double distance = histogramDistance(*crfhDirect, *crfhIncremental);
+	cout << "L1 distance between direct and incremental histograms:"
+			<< distance << endl;
+	BOOST_CHECK( distance <= CRFH_INCREMENTAL_TOLERANCE );
+
+	delete crfhDirect;
+	delete crfhIncremental;
+	delete img;
+}
+
+/*!
+ * a test case checking that the multi-threaded computation
+ * gives exactly the same results as the sequential one
+ */
+BOOST_AUTO_TEST_CASE( caseCrfhThreads )
+{
+	using namespace rocs::cv;
+	Img* img = ImageIO::load(IMGDIR "Coffee_nb.ppm");
+
+	for (int incremental = 0; incremental <= 1; ++incremental)
+	{
+		System system("Lxx(2,28)+Lxy(2,28)+Lyy(4,28)+Lxx(8,28)+Lxy(8,28)");
+		system.setIncrementalScaleSpace(incremental);
+		Crfh* crfhSequential = system.computeHistogram(*img, 15);
+		system.setNumThreads(4);
+		Crfh* crfhThreads = system.computeHistogram(*img, 15);
+
+		BOOST_CHECK( *crfhSequential == *crfhThreads );
+		BOOST_CHECK( crfhSequential->_sum == crfhThreads->_sum );
+
+		delete crfhSequential;
+		delete crfhThreads;
+	}
+
+	delete img;
+}
+
+/*!
+ * task computing the histogram of an image in a thread of a pool
+ */
+struct ComputeHistogramTask
+{
+	const rocs::cv::System *system;
+	const rocs::cv::Img *img;
+	rocs::cv::Crfh **result;
+
+	void operator()() const
+	{
+		*result = system->computeHistogram(*img, 15);
+	}
+};
+
+/*!
+ * a test case checking that the buffers of the workspace are reused,
+ * that recounting a histogram does not allocate and that the heap
+ * allocations of a frame do not depend on the number of frames
+ * processed before
+ */
+BOOST_AUTO_TEST_CASE( caseCrfhWorkspace )
+{
+	using namespace rocs::cv;
+	Img* img = ImageIO::load(IMGDIR "Coffee_nb.ppm");
+
+	for (int precision = PT_DOUBLE; precision <= PT_FLOAT; ++precision)
+	{
+		System system("Lxx(2,28)+Lxy(2,28)+Lyy(4,28)+Lxx(8,28)+Lxy(8,28)");
+		system.setPrecision(static_cast<PrecisionType> (precision));
+
+		// The first image allocates the buffers
+		long nbFirstHeapAllocations;
+		Crfh* crfhFirst;
+		{
+			HeapAllocationCounter counter;
+			crfhFirst = system.computeHistogram(*img, 15);
+			nbFirstHeapAllocations = counter.get();
+		}
+		long nbAllocations = system.getWorkspace().getNbAllocations();
+		BOOST_CHECK( nbAllocations > 0 );
+
+		// The following ones reuse them. Recomputed into the same
+		// histogram, only the temporaries of the convolutions are
+		// still allocated for each frame, always the same number of times.
+		Crfh crfh;
+		long nbFrameHeapAllocations = -1;
+		for (int i = 0; i < 3; ++i)
+		{
+			HeapAllocationCounter counter;
+			system.computeHistogram(*img, 15, crfh);
+			if (i == 1)
+				nbFrameHeapAllocations = counter.get();
+			else if (i > 1)
+				BOOST_CHECK_EQUAL( counter.get(), nbFrameHeapAllocations );
+			BOOST_CHECK( crfh == *crfhFirst );
+			BOOST_CHECK( crfh._sum == crfhFirst->_sum );
+		}
+		cout << "Heap allocations of the first frame:" << nbFirstHeapAllocations
+				<< ", of the following ones:" << nbFrameHeapAllocations << endl;
+		BOOST_CHECK( nbFrameHeapAllocations < nbFirstHeapAllocations );
+		BOOST_CHECK_EQUAL( system.getWorkspace().getNbAllocations(), nbAllocations );
+
+		// An external workspace gives the same result
+		CrfhWorkspace workspace;
+		Crfh* crfhExternal = system.computeHistogram(*img, 15, workspace);
+		BOOST_CHECK( *crfhExternal == *crfhFirst );
+		BOOST_CHECK_EQUAL( workspace.getNbAllocations(), nbAllocations );
+
+		delete crfhFirst;
+		delete crfhExternal;
+	}
+
+	// Counting the same outputs again into the same histogram
+	// with a workspace does not allocate at all
+	{
+		System system("Lxx(2,28)+Lxy(2,28)+Lyy(4,28)+Lxx(8,28)+Lxy(8,28)");
+		DescriptorList descrList;
+		descrList.addDescriptor("Lxx", 2, 28);
+		descrList.addDescriptor("Lxy", 2, 28);
+		descrList.addDescriptor("Lyy", 4, 28);
+		descrList.addDescriptor("Lxx", 8, 28);
+		descrList.addDescriptor("Lxy", 8, 28);
+		vector<rocs::math::Matrix_<double> *> outputs =
+				system.computeDescriptorOutputs(*img);
+		Crfh* crfhReference = system.computeHistogram(*img, 15);
+
+		CrfhWorkspace workspace;
+		Crfh crfh;
+		crfh.assign(outputs, descrList, 15, AT_AUTO, &workspace);
+		{
+			HeapAllocationCounter counter;
+			crfh.assign(outputs, descrList, 15, AT_AUTO, &workspace);
+			BOOST_CHECK_EQUAL( counter.get(), 0 );
+		}
+		BOOST_CHECK( crfh == *crfhReference );
+		BOOST_CHECK( crfh._sum == crfhReference->_sum );
+
+		// A grid takes the quantizer and the accumulators of its cells
+		// from the workspace as well, the same grid again creates no new ones
+		opencv::Rect region(15, 15, outputs[0]->nbCols() - 30,
+				outputs[0]->nbRows() - 30);
+		vector<Crfh*> cells;
+		Crfh::createGrid(outputs, descrList, region, 2, 2, cells, AT_AUTO,
+				&workspace);
+		long nbAllocations = workspace.getNbAllocations();
+		vector<Crfh*> cellsAgain;
+		Crfh::createGrid(outputs, descrList, region, 2, 2, cellsAgain,
+				AT_AUTO, &workspace);
+		BOOST_CHECK_EQUAL( workspace.getNbAllocations(), nbAllocations );
+		vector<Crfh*> cellsOwn;
+		Crfh::createGrid(outputs, descrList, region, 2, 2, cellsOwn);
+		BOOST_REQUIRE_EQUAL( cellsAgain.size(), 4u );
+		BOOST_REQUIRE_EQUAL( cellsOwn.size(), 4u );
+		for (unsigned int k = 0; k < cells.size(); ++k)
+		{
+			BOOST_CHECK( *cellsAgain[k] == *cells[k] );
+			BOOST_CHECK( *cellsOwn[k] == *cells[k] );
+			delete cells[k];
+			delete cellsAgain[k];
+			delete cellsOwn[k];
+		}
+
+		for (unsigned int i = 0; i < outputs.size(); ++i)
+			delete outputs[i];
+		delete crfhReference;
+	}
+
+	// Concurrent calls on the same system use one workspace per thread
+	System system("Lxx(2,28)+Lxy(2,28)+Lyy(4,28)+Lxx(8,28)+Lxy(8,28)");
+	Crfh* crfhReference = system.computeHistogram(*img, 15);
+	vector<Crfh *> crfhConcurrent(8);
+	{
+		rocs::core::ThreadPool pool(4);
+		for (unsigned int i = 0; i < crfhConcurrent.size(); ++i)
+		{
+			ComputeHistogramTask task = { &system, img, &crfhConcurrent[i] };
+			pool.schedule(task);
+		}
+		pool.wait();
+	}
+	for (unsigned int i = 0; i < crfhConcurrent.size(); ++i)
+	{
+		BOOST_CHECK( *crfhConcurrent[i] == *crfhReference );
+		delete crfhConcurrent[i];
+	}
+	delete crfhReference;
+
+	delete img;
+}
+
+/*!
+ * task computing a histogram in a thread of a pool and recording the
+ * number of allocations of the workspace of that thread
+ */
+struct WorkspaceAllocationsTask
+{
+	const rocs::cv::System *system;
+	const rocs::cv::Img *img;
+	long *nbAllocations;
+
+	void operator()() const
+	{
+		delete system->computeHistogram(*img, 15);
+		*nbAllocations = system->getWorkspace().getNbAllocations();
+	}
+};
+
+/*!
+ * a test case checking that a system created at the address of
+ * a destroyed one does not reuse the workspaces left by the destroyed
+ * one in other threads
+ */
+BOOST_AUTO_TEST_CASE( caseCrfhWorkspaceRecreated )
+{
+	using namespace rocs::cv;
+	Img* img = ImageIO::load(IMGDIR "Coffee_nb.ppm");
+	const char *sysDef = "Lxx(2,28)+Lxy(2,28)+Lyy(4,28)+Lxx(8,28)+Lxy(8,28)";
+
+	// Allocations of a new workspace for one image
+	long nbReferenceAllocations;
+	{
+		System system(sysDef);
+		delete system.computeHistogram(*img, 15);
+		nbReferenceAllocations = system.getWorkspace().getNbAllocations();
+	}
+
+	// The first system leaves its workspace in the thread of the pool
+	rocs::core::ThreadPool pool(1);
+	void *storage = operator new(sizeof(System));
+	System *first = new (storage) System("Lxx(2,28)+Lyy(4,28)");
+	long nbFirstAllocations = 0;
+	WorkspaceAllocationsTask firstTask = { first, img, &nbFirstAllocations };
+	pool.schedule(firstTask);
+	pool.wait();
+	first->~System();
+
+	// The second one, at the same address, starts from a new workspace
+	System *second = new (storage) System(sysDef);
+	long nbSecondAllocations = 0;
+	WorkspaceAllocationsTask secondTask = { second, img, &nbSecondAllocations };
+	pool.schedule(secondTask);
+	pool.wait();
+	BOOST_CHECK( nbFirstAllocations > 0 );
+	BOOST_CHECK_EQUAL( nbSecondAllocations, nbReferenceAllocations );
+
+	second->~System();
+	operator delete(storage);
+	delete img;
+}
+
+/*!
+ * a test case comparing the handles resolved by one and several builds
+ */
+BOOST_AUTO_TEST_CASE( caseCrfhHandles )
+{
+	using namespace rocs::cv;
+	Img* img = ImageIO::load(IMGDIR "Coffee_nb.ppm");
+
+	// Handles resolved by consecutive builds, including repeated
+	// descriptors, must point to the same filters and samples
+	System system("Lxx(2,28)+Lxy(2,28)+Lyy(4,28)+Lxx(8,28)+Lxy(8,28)");
+	System systemParts("Lxx(2,28)+Lxy(2,28)");
+	systemParts.build("Lyy(4,28)+Lxx(8,28)+Lxy(8,28)");
+	Crfh* crfh = system.computeHistogram(*img, 15);
+	Crfh* crfhParts = systemParts.computeHistogram(*img, 15);
+
+	BOOST_CHECK( *crfh == *crfhParts );
+
+	delete crfh;
+	delete crfhParts;
+	delete img;
+}
+
+/*!
+ * a test case comparing the fused and separate derivative filters
+ */
+BOOST_AUTO_TEST_CASE( caseFusedDerivatives )
+{
+	using namespace rocs::cv;
+	Img* img = ImageIO::load(IMGDIR "Coffee_nb.ppm");
+
+	for (int precision = PT_DOUBLE; precision <= PT_FLOAT; ++precision)
+	{
+		System system("Lx(4,16)+Ly(4,16)+Lxx(4,16)+Lxy(4,16)+Lyy(2,16)+L(2,8)");
+		system.setPrecision(static_cast<PrecisionType> (precision));
+		system.setFusedDerivatives(false);
+		Crfh* crfhSeparate = system.computeHistogram(*img, 15);
+		system.setFusedDerivatives(true);
+		Crfh* crfhFused = system.computeHistogram(*img, 15);
+		crfhSeparate->normalize();
+		crfhFused->normalize();
+
+		double distance = histogramDistance(*crfhSeparate, *crfhFused);
+		cout << "L1 distance between separate and fused histograms:"
+				<< distance << endl;
+		BOOST_CHECK( distance <= CRFH_FUSED_TOLERANCE );
+
+		delete crfhSeparate;
+		delete crfhFused;
+	}
+
+	delete img;
+}
+
+/*!
+ * a test case comparing the histograms filtered in the whole image and
+ * only around the region, and checking the clipping of the regions
+ */
+BOOST_AUTO_TEST_CASE( caseRestrictToRegion )
+{
+	using namespace rocs::cv;
+	Img* img = ImageIO::load(IMGDIR "Coffee_nb.ppm");
+
+	for (int precision = PT_DOUBLE; precision <= PT_FLOAT; ++precision)
+	{
+		System system("Lx(4,16)+Ly(4,16)+Lxx(8,16)+Lxy(8,16)+Lyy(2,16)+L(2,8)");
+		system.setPrecision(static_cast<PrecisionType> (precision));
+		system.setRestrictToRegion(false);
+		Crfh* crfhWhole = system.computeHistogram(*img, 15);
+		system.setRestrictToRegion(true);
+		Crfh* crfhRegion = system.computeHistogram(*img, 15);
+		crfhWhole->normalize();
+		crfhRegion->normalize();
+
+		double distance = histogramDistance(*crfhWhole, *crfhRegion);
+		cout << "L1 distance between whole image and region histograms:"
+				<< distance << endl;
+		BOOST_CHECK( distance <= CRFH_REGION_TOLERANCE );
+
+		delete crfhWhole;
+		delete crfhRegion;
+
+		// Regions crossing the border are clipped to the image,
+		// regions outside of it give empty histograms
+		int rows = img->nbRows();
+		int cols = img->nbCols();
+		vector<opencv::Rect> regions;
+		regions.push_back(opencv::Rect(cols / 2, rows / 2, cols, rows));
+		regions.push_back(opencv::Rect(cols / 2, rows / 2, cols - cols / 2,
+				rows - rows / 2));
+		regions.push_back(opencv::Rect(-20, -20, 10, 10));
+		vector<Crfh*> crfhRegions;
+		system.computeHistograms(*img, regions, crfhRegions);
+		BOOST_REQUIRE_EQUAL( crfhRegions.size(), 3u );
+		BOOST_CHECK( *crfhRegions[0] == *crfhRegions[1] );
+		BOOST_CHECK_EQUAL( crfhRegions[0]->_sum, crfhRegions[1]->_sum );
+		BOOST_CHECK_EQUAL( crfhRegions[2]->size(), 0u );
+		BOOST_CHECK_EQUAL( crfhRegions[2]->_sum, 0 );
+		for (unsigned int i = 0; i < crfhRegions.size(); ++i)
+			delete crfhRegions[i];
+	}
+
+	delete img;
+}
+
+/*!
+ * a test case comparing the temporal and from scratch histograms of frames
+ */
+BOOST_AUTO_TEST_CASE( caseTemporalCrfh )
+{
+	using namespace rocs::cv;
+	Img* img = ImageIO::load(IMGDIR "Coffee_nb.ppm");
+
+	// Second frame: a copy with a small block of changed pixels
+	Img* changed = new Img(img->nbRows(), img->nbCols(), img->type());
+	const opencv::Mat &src = img->asConstOpenCvMat();
+	opencv::Mat &dst = *changed->asOpenCvMat();
+	int channels = src.channels();
+	for (int i = 0; i < src.rows; ++i)
+	{
+		memcpy(dst.ptr<uchar> (i), src.ptr<uchar> (i), src.cols * channels);
+		if ((i >= 40) && (i < 50))
+			for (int j = 40 * channels; j < 50 * channels; ++j)
+				dst.ptr<uchar> (i)[j] = 255 - dst.ptr<uchar> (i)[j];
+	}
+
+	System system("Lx(4,16)+Ly(4,16)+Lxx(8,16)+Lxy(8,16)+Lyy(2,16)+L(2,8)");
+	TemporalCrfh temporal;
+	temporal.setTileSize(32);
+	Img* frames[3] = { img, changed, changed };
+	for (int f = 0; f < 3; ++f)
+	{
+		Crfh* crfhScratch = system.computeHistogram(*frames[f], 15);
+		Crfh* crfhTemporal = temporal.computeHistogram(system, *frames[f], 15);
+		BOOST_CHECK_EQUAL( crfhTemporal->_sum, crfhScratch->_sum );
+		crfhScratch->normalize();
+		crfhTemporal->normalize();
+
+		double distance = histogramDistance(*crfhScratch, *crfhTemporal);
+		cout << "Frame " << f << ": " << temporal.getNbTilesRecomputed()
+				<< " of " << temporal.getNbTiles()
+				<< " tiles recomputed, L1 distance:" << distance << endl;
+		BOOST_CHECK( distance <= CRFH_REGION_TOLERANCE );
+		if (f == 1)
+			BOOST_CHECK( (temporal.getNbTilesRecomputed() > 0)
+					&& (temporal.getNbTilesRecomputed() < temporal.getNbTiles()) );
+
+		delete crfhScratch;
+		delete crfhTemporal;
+	}
+
+	// The first frame is computed entirely, the second only around
+	// the changed block and the third is skipped
+	BOOST_CHECK_EQUAL( temporal.getNbFrames(), 3 );
+	BOOST_CHECK_EQUAL( temporal.getNbFramesSkipped(), 1 );
+	BOOST_CHECK_EQUAL( temporal.getNbTilesRecomputed(), 0 );
+
+	delete img;
+	delete changed;
+}
+
+/*!
+ * a test case checking the levels of a spatial pyramid
+ */
+BOOST_AUTO_TEST_CASE( caseSpatialPyramid )
+{
+	using namespace rocs::cv;
+	Img* img = ImageIO::load(IMGDIR "Coffee_nb.ppm");
+
+	System system("Lx(4,16)+Ly(4,16)+Lxx(8,16)+Lxy(8,16)+Lyy(2,16)+L(2,8)");
+	vector<Crfh*> pyramid;
+	system.computeSpatialPyramid(*img, 15, 3, pyramid);
+	BOOST_REQUIRE_EQUAL( pyramid.size(), 1u + 4u + 16u );
+
+	// Level 0 is the histogram of the whole image
+	Crfh* crfh = system.computeHistogram(*img, 15);
+	BOOST_CHECK( *pyramid[0] == *crfh );
+	BOOST_CHECK_EQUAL( pyramid[0]->_sum, crfh->_sum );
+
+	// Each level covers all the pixels once
+	for (int first = 1, n = 2; n <= 4; first += n * n, n *= 2)
+	{
+		double sum = 0;
+		for (int i = 0; i < n * n; ++i)
+			sum += pyramid[first + i]->_sum;
+		BOOST_CHECK_EQUAL( sum, crfh->_sum );
+	}
+
+	// A cell of the finest level equals the histogram of its region
+	int rows = img->nbRows() - 30;
+	int cols = img->nbCols() - 30;
+	vector<opencv::Rect> regions(1, opencv::Rect(15 + cols / 4, 15 + rows
+			/ 4, cols / 2 - cols / 4, rows / 2 - rows / 4));
+	vector<Crfh*> cell;
+	system.computeHistograms(*img, regions, cell);
+	BOOST_REQUIRE_EQUAL( cell.size(), 1u );
+	BOOST_CHECK_EQUAL( pyramid[1 + 4 + 4 + 1]->_sum, cell[0]->_sum );
+	pyramid[1 + 4 + 4 + 1]->normalize();
+	cell[0]->normalize();
+	BOOST_CHECK( histogramDistance(*pyramid[1 + 4 + 4 + 1], *cell[0])
+			<= CRFH_REGION_TOLERANCE );
+
+	for (unsigned int i = 0; i < pyramid.size(); ++i)
+		delete pyramid[i];
+	delete cell[0];
+	delete crfh;
+	delete img;
+}
+
+/*!
+ * a test case comparing the lightness with the channel L of the
+ * OpenCV conversion to HLS, for color and lightness images
+ */
+BOOST_AUTO_TEST_CASE( caseLightnessLoad )
+{
+	using namespace rocs::cv;
+	Img* img = ImageIO::load(IMGDIR "Coffee_nb.ppm");
+	Img* lightness = ImageIO::load(IMGDIR "Coffee_nb.ppm", ILM_LIGHTNESS);
+	BOOST_CHECK_EQUAL( lightness->nbChannels(), 1 );
+
+	// Reference: the channel L of the conversion of the color image
+	opencv::Mat hls;
+	opencv::cvtColor(img->asConstOpenCvMat(), hls, CV_RGB2HLS);
+
+	// The channel L of both images must be identical to the reference
+	rocs::math::Matrix_<double> *L = img->getL();
+	rocs::math::Matrix_<double> *L1 = lightness->getL();
+	BOOST_REQUIRE_EQUAL( L->nbRows(), hls.rows );
+	BOOST_REQUIRE_EQUAL( L->nbCols(), hls.cols );
+	BOOST_REQUIRE_EQUAL( L1->nbRows(), hls.rows );
+	BOOST_REQUIRE_EQUAL( L1->nbCols(), hls.cols );
+	int differences = 0;
+	int differencesLightness = 0;
+	for (int i = 0; i < hls.rows; ++i)
+		for (int j = 0; j < hls.cols; ++j)
+		{
+			double reference = hls.ptr<uchar> (i)[3 * j + 1];
+			if (L->get(i, j) != reference)
+				++differences;
+			if (L1->get(i, j) != reference)
+				++differencesLightness;
+		}
+	BOOST_CHECK_EQUAL( differences, 0 );
+	BOOST_CHECK_EQUAL( differencesLightness, 0 );
+
+	System system("Lxx(8,28)+Lxy(8,28)+Lyy(8,28)");
+	BOOST_CHECK_EQUAL( system.getImageLoadMode(), ILM_LIGHTNESS );
+
+	delete L;
+	delete L1;
+	delete lightness;
+	delete img;
+}
+
+/*!
+ * a test case writing and reading binary histogram files
+ */
+BOOST_AUTO_TEST_CASE( caseHistogramFile )
+{
+	using namespace rocs::cv;
+	Img* img = ImageIO::load(IMGDIR "Coffee_nb.ppm");
+	System system("Lxx(8,28)+Lxy(8,28)+Lyy(8,28)");
+	Crfh* crfh = system.computeHistogram(*img, 15);
+	crfh->normalize();
+	FeatureList<int, double> empty;
+
+	// Binary round trip
+	{
+		HistogramFileWriter writer("test_crfh.bin");
+		writer.write(*crfh);
+		writer.write(empty);
+		writer.write(*crfh);
+		writer.close();
+	}
+	{
+		HistogramFile file("test_crfh.bin");
+		BOOST_CHECK_EQUAL( file.size(), 3 );
+		BOOST_CHECK_EQUAL( file[1].size, 0 );
+		for (long h = 0; h < file.size(); h += 2)
+		{
+			HistogramView view = file[h];
+			BOOST_CHECK_EQUAL( view.size, (int) crfh->size() );
+			int k = 0;
+			for (Crfh::const_iterator it = crfh->begin(); (it != crfh->end())
+					&& (k < view.size); ++it, ++k)
+			{
+				BOOST_CHECK_EQUAL( view.keys[k], it->first );
+				BOOST_CHECK_EQUAL( view.value(k), it->second );
+			}
+		}
+	}
+
+	// Through the text format
+	HistogramFile::convertToText("test_crfh.bin", "test_crfh.txt");
+	{
+		// One line per histogram, each ended by a newline
+		std::ifstream input("test_crfh.txt");
+		std::ostringstream content;
+		content << input.rdbuf();
+		std::string text = content.str();
+		BOOST_CHECK_EQUAL( count(text.begin(), text.end(), '\n'), 3 );
+		BOOST_REQUIRE( !text.empty() );
+		BOOST_CHECK_EQUAL( text[text.size() - 1], '\n' );
+	}
+	HistogramFile::convertFromText("test_crfh.txt", "test_crfh2.bin",
+			HVT_FLOAT);
+	{
+		HistogramFile file("test_crfh2.bin");
+		BOOST_CHECK_EQUAL( file.size(), 3 );
+		BOOST_CHECK_EQUAL( file.getValueType(), HVT_FLOAT );
+		FeatureList<int, double> list;
+		file[2].toFeatureList(list);
+		BOOST_CHECK_EQUAL( list.size(), crfh->size() );
+	}
+
+	// The text format keeps all the digits of the doubles
+	HistogramFile::convertFromText("test_crfh.txt", "test_crfh3.bin");
+	{
+		HistogramFile file("test_crfh3.bin");
+		HistogramView view = file[0];
+		BOOST_REQUIRE_EQUAL( view.size, (int) crfh->size() );
+		int k = 0;
+		for (Crfh::const_iterator it = crfh->begin(); it != crfh->end(); ++it, ++k)
+			BOOST_CHECK_EQUAL( view.value(k), it->second );
+	}
+
+	BOOST_CHECK_THROW( HistogramFile("test_crfh.txt"), rocs::core::IOException );
+
+	// Histograms pointing or extending outside of the file are rejected
+	std::string valid;
+	{
+		std::ifstream input("test_crfh.bin", std::ios::binary);
+		std::ostringstream content;
+		content << input.rdbuf();
+		valid = content.str();
+	}
+	long long tableOffset;
+	memcpy(&tableOffset, &valid[24], sizeof(tableOffset));
+	long long badOffset = valid.size();
+	long long badSize = valid.size();
+	for (int corruption = 0; corruption < 3; ++corruption)
+	{
+		std::string corrupted = valid;
+		if (corruption == 0)
+			memcpy(&corrupted[tableOffset + 8], &badOffset, sizeof(badOffset));
+		else if (corruption == 1)
+			memcpy(&corrupted[tableOffset + 8], "\xff\xff\xff\xff\xff\xff\xff\xff", 8);
+		else
+		{
+			long long offset;
+			memcpy(&offset, &valid[tableOffset], sizeof(offset));
+			memcpy(&corrupted[offset], &badSize, sizeof(badSize));
+		}
+		std::ofstream output("test_crfh_bad.bin", std::ios::binary);
+		output << corrupted;
+		output.close();
+		BOOST_CHECK_THROW( HistogramFile("test_crfh_bad.bin"), rocs::core::IOException );
+	}
+
+	delete crfh;
+	delete img;
+}
+
+/*! Computes a histogram measure directly from its definition. */
+double referenceMeasure(rocs::cv::HistogramMeasure measure,
+		const rocs::cv::FeatureList<int, double> &a,
+		const rocs::cv::FeatureList<int, double> &b)
+{
+	using namespace rocs::cv;
+	std::map<int, std::pair<double, double> > bins;
+	for (FeatureList<int, double>::const_iterator it = a.begin(); it != a.end(); ++it)
+		bins[it->first].first = it->second;
+	for (FeatureList<int, double>::const_iterator it = b.begin(); it != b.end(); ++it)
+		bins[it->first].second = it->second;
+
+	double sum = 0;
+	for (std::map<int, std::pair<double, double> >::const_iterator it =
+			bins.begin(); it != bins.end(); ++it)
+	{
+		double x = it->second.first;
+		double y = it->second.second;
+		if (measure == HM_INTERSECTION)
+			sum += std::min(x, y);
+		else if (measure == HM_CHI2)
+			sum += (x - y) * (x - y) / (x + y);
+		else if (measure == HM_L1)
+			sum += fabs(x - y);
+		else if (measure == HM_L2)
+			sum += (x - y) * (x - y);
+		else
+			sum += sqrt(x * y);
+	}
+	return (measure == HM_L2) ? sqrt(sum) : sum;
+}
+
+/*!
+ * a test case comparing the histogram measures with their definitions
+ */
+BOOST_AUTO_TEST_CASE( caseHistogramSimilarity )
+{
+	using namespace rocs::cv;
+	const char *images[] = { IMGDIR "Coffee_nb.ppm", IMGDIR "box.ppm" };
+	System system("Lxx(8,28)+Lxy(8,28)+Lyy(8,28)");
+	vector<Crfh *> crfhs;
+	vector<SparseHistogram> histograms;
+	for (int i = 0; i < 2; ++i)
+	{
+		Img* img = ImageIO::load(images[i]);
+		for (int skip = 15; skip <= 45; skip += 30)
+		{
+			crfhs.push_back(system.computeHistogram(*img, skip));
+			crfhs.back()->normalize();
+			histograms.push_back(SparseHistogram(*crfhs.back()));
+		}
+		delete img;
+	}
+
+	rocs::core::ThreadPool pool(3);
+	for (int measure = HM_INTERSECTION; measure <= HM_BHATTACHARYYA; ++measure)
+	{
+		HistogramMeasure m = static_cast<HistogramMeasure> (measure);
+		rocs::math::Matrix_<double> gram;
+		HistogramSimilarity::computeGramMatrix(m, histograms, gram, &pool);
+		rocs::math::Matrix_<double> gramRect;
+		HistogramSimilarity::computeGramMatrix(m, histograms, histograms,
+				gramRect);
+		for (unsigned int i = 0; i < histograms.size(); ++i)
+		{
+			vector<double> results;
+			HistogramSimilarity::compare(m, histograms[i], histograms,
+					results, &pool);
+			for (unsigned int j = 0; j < histograms.size(); ++j)
+			{
+				double reference = referenceMeasure(m, *crfhs[i], *crfhs[j]);
+				BOOST_CHECK( fabs(results[j] - reference) <= CRFH_MEASURE_TOLERANCE );
+				BOOST_CHECK_EQUAL( gram.get(i, j), results[j] );
+				BOOST_CHECK_EQUAL( gramRect.get(i, j), results[j] );
+			}
+
+			// The distances are computed directly, without cancellation
+			if ((m == HM_CHI2) || (m == HM_L1) || (m == HM_L2))
+				BOOST_CHECK_EQUAL( results[i], 0 );
+		}
+	}
+
+	for (unsigned int i = 0; i < crfhs.size(); ++i)
+		delete crfhs[i];
 }
 
+/*!
+ * a test case comparing the queries of the index with a linear scan
+ */
+BOOST_AUTO_TEST_CASE( caseHistogramIndex )
+{
+	using namespace rocs::cv;
+	const char *images[] = { IMGDIR "Coffee_nb.ppm", IMGDIR "box.ppm" };
+	System system("Lxx(4,16)+Lxy(4,16)+Lyy(4,16)");
+	vector<SparseHistogram> histograms;
+	for (int i = 0; i < 2; ++i)
+	{
+		Img* img = ImageIO::load(images[i]);
+		for (int skip = 5; skip <= 50; skip += 5)
+		{
+			Crfh* crfh = system.computeHistogram(*img, skip);
+			crfh->normalize();
+			histograms.push_back(SparseHistogram(*crfh));
+			delete crfh;
+		}
+		delete img;
+	}
+
+	// Histograms sharing no bin with the others, lighter and heavier
+	// than the normalized ones, are scored from their masses
+	Crfh light;
+	light.append(-2, 0.05);
+	light.append(-1, 0.05);
+	Crfh heavy;
+	heavy.append(-1, 3);
+	histograms.push_back(SparseHistogram(light));
+	histograms.push_back(SparseHistogram(heavy));
+
+	for (int measure = HM_INTERSECTION; measure <= HM_CHI2; ++measure)
+	{
+		HistogramIndex index(static_cast<HistogramMeasure> (measure));
+		for (unsigned int i = 0; i < histograms.size(); ++i)
+			BOOST_CHECK_EQUAL( index.add(histograms[i]), (int) i );
+
+		for (unsigned int q = 0; q < histograms.size(); ++q)
+		{
+			// All bins: identical to the linear scan
+			vector<HistogramIndex::Match> matches, reference;
+			index.setMaxQueryBins(0);
+			for (int k = 5; k <= (int) histograms.size(); k
+					+= histograms.size() - 5)
+			{
+				index.query(histograms[q], k, matches);
+				index.queryLinear(histograms[q], k, reference);
+				BOOST_CHECK_EQUAL( matches.size(), reference.size() );
+				for (unsigned int m = 0; (m < matches.size()) && (m
+						< reference.size()); ++m)
+				{
+					BOOST_CHECK_EQUAL( matches[m].id, reference[m].id );
+					BOOST_CHECK_EQUAL( matches[m].value, reference[m].value );
+				}
+			}
+
+			// Approximated, all the candidates re-ranked: the query
+			// itself is still the best match
+			index.setMaxQueryBins(20);
+			index.setRerankSize(histograms.size());
+			index.query(histograms[q], 1, matches);
+			BOOST_CHECK( !matches.empty() && (matches[0].id == (int) q) );
+		}
+	}
+}
@@ -0,0 +1,682 @@
+// ==================================================================
+// ROCS - Toolkit for Robots Comprehending Space
+// Copyright (C) 2010  Arnaud Ramey, Andrzej Pronobis
+//
+// This file is part of ROCS.
+//
+// ROCS is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation, either version 3
+// of the License, or (at your option) any later version.
+//
+// ROCS is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ROCS. If not, see <http://www.gnu.org/licenses/>.
+// ==================================================================
+
+
+/*!
+ * Test suite of the SURF matching.
+ * \author Andrzej Pronobis
+ * \file test_surf.cc
+ */
+
+// Boost
+#include <boost/test/unit_test.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+// ROCS
+#include "rocs/cv/Surf/SurfExtractor.h"
+#include "rocs/cv/Surf/SurfMatcher.h"
+#include "rocs/cv/Surf/SurfObjectDatabase.h"
+#include "rocs/cv/Surf/SurfHomography.h"
+#include "rocs/cv/Surf/SurfResult.h"
+#include "rocs/core/ThreadPool.h"
+// stl
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <vector>
+using namespace std;
+
+/*!
+ * counts the calls to operator new made by the thread which created it,
+ * from its creation to its destruction
+ */
+class HeapAllocationCounter
+{
+public:
+	HeapAllocationCounter() :
+		_thread(boost::this_thread::get_id()), _count(0)
+	{
+		_active = this;
+	}
+
+	~HeapAllocationCounter()
+	{
+		_active = 0;
+	}
+
+	long get() const
+	{
+		return _count;
+	}
+
+	static void count()
+	{
+		if ((_active) && (boost::this_thread::get_id() == _active->_thread))
+			++_active->_count;
+	}
+
+private:
+	boost::thread::id _thread;
+	long _count;
+	static HeapAllocationCounter *_active;
+};
+
+HeapAllocationCounter *HeapAllocationCounter::_active = 0;
+
+/*!
+ * operator new counting the allocations of the tests
+ */
+void *operator new(size_t size)
+{
+	HeapAllocationCounter::count();
+	void *p = malloc(size ? size : 1);
+	if (!p)
+		throw bad_alloc();
+	return p;
+}
+
+void operator delete(void *p) throw ()
+{
+	free(p);
+}
+
+/*!
+ * SurfExtractor without images, the tests set its fields directly
+ */
+class HeadlessSurfExtractor : public rocs::cv::SurfExtractor
+{
+public:
+	void setDefaultParams()
+	{
+	}
+
+	int* processImage(const rocs::cv::Img*)
+	{
+		return 0;
+	}
+};
+
+/*! Minimal part of the matches of the approximate search equal
+ to those of the linear scan. */
+#define SURF_MATCHER_MIN_AGREEMENT 0.95
+
+/*! Length of the extended SURF descriptors. */
+#define SURF_LENGTH 128
+
+/*!
+ * Creates count random descriptors of unit length with random
+ * Laplacians.
+ */
+void randomDescriptors(int count, vector<float> &descriptors,
+		vector<int> &laplacians)
+{
+	descriptors.resize(count * SURF_LENGTH);
+	laplacians.resize(count);
+	for (int i = 0; i < count; ++i)
+	{
+		float *vec = &descriptors[i * SURF_LENGTH];
+		double norm = 0;
+		for (int k = 0; k < SURF_LENGTH; ++k)
+		{
+			float v = (float) rand() / RAND_MAX;
+			vec[k] = v * v * v;
+			norm += vec[k] * vec[k];
+		}
+		for (int k = 0; k < SURF_LENGTH; ++k)
+			vec[k] /= sqrt(norm);
+		laplacians[i] = (rand() % 2) ? 1 : -1;
+	}
+}
+
+/*!
+ * The nearest neighbour accepted by the tests of
+ * SurfExtractor::surf_naiveNearestNeighbor().
+ */
+int naiveNearest(const float *vec, int laplacian,
+		const vector<float> &descriptors, const vector<int> &laplacians)
+{
+	int neighbor = -1;
+	double dist1 = 1e6, dist2 = 1e6;
+	for (unsigned int i = 0; i < laplacians.size(); ++i)
+	{
+		if (laplacians[i] != laplacian)
+			continue;
+		double d = rocs::cv::SurfMatcher::compareDescriptors(vec,
+				&descriptors[i * SURF_LENGTH], dist2, SURF_LENGTH);
+		if (d < dist1)
+		{
+			dist2 = dist1;
+			dist1 = d;
+			neighbor = i;
+		}
+		else if (d < dist2)
+			dist2 = d;
+	}
+	if ((dist1 > SURF_MATCHING_MAX_DIST_1ST) || (dist1
+			> SURF_MATCHING_MAX_RATIO_1_2 * dist2))
+		return -1;
+	return neighbor;
+}
+
+BOOST_AUTO_TEST_CASE( caseSurfMatcher )
+{
+	using namespace rocs::cv;
+	srand(1);
+	vector<float> model;
+	vector<int> modelLaplacians;
+	randomDescriptors(1000, model, modelLaplacians);
+
+	// Queries: noisy copies of some model descriptors and random ones
+	vector<float> queries;
+	vector<int> queryLaplacians;
+	randomDescriptors(400, queries, queryLaplacians);
+	for (int q = 0; q < 200; ++q)
+	{
+		int source = rand() % 1000;
+		queryLaplacians[q] = modelLaplacians[source];
+		for (int k = 0; k < SURF_LENGTH; ++k)
+			queries[q * SURF_LENGTH + k] = model[source * SURF_LENGTH + k]
+					+ 0.01 * ((float) rand() / RAND_MAX - 0.5);
+	}
+
+	SurfMatcher matcher;
+	matcher.build(&model[0], &modelLaplacians[0], 1000, SURF_LENGTH);
+	BOOST_CHECK_EQUAL( matcher.size(), 1000 );
+
+	int matches = 0, equalExact = 0, equalApproximate = 0;
+	for (int q = 0; q < 400; ++q)
+	{
+		const float *vec = &queries[q * SURF_LENGTH];
+		int naive = naiveNearest(vec, queryLaplacians[q], model,
+				modelLaplacians);
+		if (naive >= 0)
+			++matches;
+
+		matcher.setMaxChecks(0);
+		if (matcher.findNearest(vec, queryLaplacians[q]) == naive)
+			++equalExact;
+		matcher.setMaxChecks(SURF_MATCHER_MAX_CHECKS);
+		if (matcher.findNearest(vec, queryLaplacians[q]) == naive)
+			++equalApproximate;
+	}
+	cout << "Matches:" << matches << " equal to the linear scan - exact:"
+			<< equalExact << " approximate:" << equalApproximate << endl;
+
+	// The noisy copies match, the exact search is the linear scan
+	BOOST_CHECK( matches >= 200 );
+	BOOST_CHECK_EQUAL( equalExact, 400 );
+	BOOST_CHECK( equalApproximate >= SURF_MATCHER_MIN_AGREEMENT * 400 );
+}
+
+BOOST_AUTO_TEST_CASE( caseSurfDescriptors )
+{
+	using namespace rocs::cv;
+	srand(2);
+	vector<float> model;
+	vector<int> modelLaplacians;
+	randomDescriptors(37, model, modelLaplacians);
+
+	// Lengths of the basic and extended descriptors, and an unpadded one
+	int lengths[] = { 64, SURF_LENGTH, 61 };
+	for (int l = 0; l < 3; ++l)
+	{
+		SurfDescriptors descriptors;
+		descriptors.resize(37, lengths[l]);
+		BOOST_CHECK_EQUAL( descriptors.getStride() % 8, 0 );
+		BOOST_CHECK_EQUAL( (size_t) descriptors[1] % SURF_DESCRIPTOR_ALIGNMENT, 0u );
+		for (int i = 0; i < 37; ++i)
+			descriptors.set(i, &model[i * SURF_LENGTH]);
+
+		// The block kernel is the distance to each descriptor
+		vector<float> distances(37);
+		SurfDescriptors::distances(descriptors[0], descriptors[0], 37,
+				descriptors.getStride(), &distances[0]);
+		for (int i = 0; i < 37; ++i)
+		{
+			double d = 0;
+			for (int k = 0; k < lengths[l]; ++k)
+				d += (model[k] - model[i * SURF_LENGTH + k]) * (model[k]
+						- model[i * SURF_LENGTH + k]);
+			BOOST_CHECK( fabs(distances[i] - d) < 1e-5 );
+			BOOST_CHECK( fabs(SurfDescriptors::distance(descriptors[0],
+					descriptors[i], descriptors.getStride()) - d) < 1e-5 );
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( caseSurfMatcherThreads )
+{
+	using namespace rocs::cv;
+	srand(3);
+	vector<float> model, queries;
+	vector<int> modelLaplacians, queryLaplacians;
+	randomDescriptors(500, model, modelLaplacians);
+	randomDescriptors(300, queries, queryLaplacians);
+	for (int q = 0; q < 300; q += 2)
+	{
+		int source = rand() % 500;
+		queryLaplacians[q] = modelLaplacians[source];
+		for (int k = 0; k < SURF_LENGTH; ++k)
+			queries[q * SURF_LENGTH + k] = model[source * SURF_LENGTH + k]
+					+ 0.01 * ((float) rand() / RAND_MAX - 0.5);
+	}
+
+	SurfFeature feature;
+	feature.resize(300, SURF_LENGTH);
+	for (int q = 0; q < 300; ++q)
+	{
+		feature.getKeypoint(q).laplacian = queryLaplacians[q];
+		feature.getDescriptors().set(q, &queries[q * SURF_LENGTH]);
+	}
+
+	SurfMatcher matcher;
+	matcher.build(&model[0], &modelLaplacians[0], 500, SURF_LENGTH);
+	vector<int> sequential, parallel;
+	matcher.findPairs(feature, sequential);
+	rocs::core::ThreadPool threadPool(4);
+	matcher.findPairs(feature, parallel, &threadPool);
+
+	// Same pairs, in the order of the queries
+	BOOST_CHECK( sequential.size() >= 300 );
+	BOOST_CHECK( sequential == parallel );
+	for (unsigned int i = 0; i < sequential.size(); i += 2)
+		BOOST_CHECK_EQUAL( matcher.findNearest(&queries[sequential[i + 1]
+				* SURF_LENGTH], queryLaplacians[sequential[i + 1]]),
+				sequential[i] );
+}
+
+/*!
+ * Creates the keypoints of an object or a frame from descriptors,
+ * at random positions in a width x height image.
+ */
+void randomFeature(int count, const float *descriptors, const int *laplacians,
+		int width, int height, rocs::cv::SurfFeature &feature)
+{
+	feature.resize(count, SURF_LENGTH);
+	for (int i = 0; i < count; ++i)
+	{
+		feature.getKeypoint(i).pt.x = rand() % width;
+		feature.getKeypoint(i).pt.y = rand() % height;
+		feature.getKeypoint(i).laplacian = laplacians[i];
+		feature.getDescriptors().set(i, descriptors + i * SURF_LENGTH);
+	}
+}
+
+BOOST_AUTO_TEST_CASE( caseSurfObjectDatabase )
+{
+	using namespace rocs::cv;
+	srand(4);
+	SurfObjectDatabase database;
+	vector<float> descriptors;
+	vector<int> laplacians;
+	vector<SurfFeature> objects(20);
+	for (int o = 0; o < 20; ++o)
+	{
+		randomDescriptors(60, descriptors, laplacians);
+		randomFeature(60, &descriptors[0], &laplacians[0], 200, 100,
+				objects[o]);
+		database.addObject("object", objects[o], 200, 100);
+	}
+	BOOST_CHECK_EQUAL( database.getNbObjects(), 20 );
+	BOOST_CHECK_EQUAL( database.getNbDescriptors(), 1200 );
+
+	// Frame: the object 7 translated by (50, 30) and random keypoints
+	randomDescriptors(140, descriptors, laplacians);
+	SurfFeature frame;
+	randomFeature(140, &descriptors[0], &laplacians[0], 320, 240, frame);
+	const SurfFeature &object = objects[7];
+	for (int i = 0; i < 40; ++i)
+	{
+		frame.getKeypoint(i) = object.getKeypoint(i);
+		frame.getKeypoint(i).pt.x += 50;
+		frame.getKeypoint(i).pt.y += 30;
+		for (int k = 0; k < SURF_LENGTH; ++k)
+			descriptors[i * SURF_LENGTH + k] = object.getDescriptors()[i][k]
+					+ 0.01 * ((float) rand() / RAND_MAX - 0.5);
+		frame.getDescriptors().set(i, &descriptors[i * SURF_LENGTH]);
+	}
+
+	vector<SurfObjectDatabase::Detection> detections;
+	vector<int> ptpairs;
+	database.recognize(frame, detections, ptpairs);
+
+	// Only the object 7 has enough votes and it is located
+	BOOST_CHECK_EQUAL( detections.size(), 1u );
+	if (detections.empty())
+		return;
+	BOOST_CHECK_EQUAL( detections[0].object, 7 );
+	BOOST_CHECK( detections[0].nbPairs >= 38 );
+	BOOST_CHECK( detections[0].located );
+	BOOST_CHECK( abs(detections[0].corners[0].x - 50) <= 1 );
+	BOOST_CHECK( abs(detections[0].corners[2].y - 130) <= 1 );
+	for (unsigned int i = 0; i < ptpairs.size(); i += 2)
+		if (ptpairs[i + 1] < 40)
+			BOOST_CHECK_EQUAL( database.getOwner(ptpairs[i]), 7 );
+}
+
+BOOST_AUTO_TEST_CASE( caseSurfHomography )
+{
+	using namespace rocs::cv;
+	srand(5);
+	const double h[9] = { 0.9, 0.1, 40, -0.05, 1.1, 20, 0.0002, -0.0001, 1 };
+
+	// 60 noisy inliers and 40 outliers, the inliers of lower score
+	vector<CvPoint2D32f> objectPoints(100), imagePoints(100);
+	vector<float> scores(100);
+	for (int i = 0; i < 100; ++i)
+	{
+		double x = rand() % 300, y = rand() % 200;
+		objectPoints[i].x = x;
+		objectPoints[i].y = y;
+		if (i % 5 < 3)
+		{
+			double w = h[6] * x + h[7] * y + h[8];
+			imagePoints[i].x = (h[0] * x + h[1] * y + h[2]) / w
+					+ ((double) rand() / RAND_MAX - 0.5);
+			imagePoints[i].y = (h[3] * x + h[4] * y + h[5]) / w
+					+ ((double) rand() / RAND_MAX - 0.5);
+			scores[i] = 0.3 + 0.4 * rand() / RAND_MAX;
+		}
+		else
+		{
+			imagePoints[i].x = rand() % 400;
+			imagePoints[i].y = rand() % 300;
+			scores[i] = 0.5 + 0.2 * rand() / RAND_MAX;
+		}
+	}
+
+	CvPoint src[4] = { cvPoint(0, 0), cvPoint(300, 0), cvPoint(300, 200),
+			cvPoint(0, 200) };
+	CvPoint expected[4], dst[4];
+	SurfHomography::projectCorners(h, src, expected);
+
+	// With and without the scores
+	SurfHomography homography;
+	for (int s = 0; s < 2; ++s)
+	{
+		double found[9];
+		BOOST_CHECK( homography.find(objectPoints, imagePoints,
+				(s == 0) ? &scores : 0, found) );
+		const SurfHomography::Statistics &statistics =
+				homography.getStatistics();
+		cout << "Homography - iterations:" << statistics.nbIterations
+				<< " inliers:" << statistics.nbInliers << endl;
+		BOOST_CHECK_EQUAL( statistics.nbPoints, 100 );
+		BOOST_CHECK( statistics.nbInliers >= 58 );
+		BOOST_CHECK( statistics.nbInliers <= 64 );
+		BOOST_CHECK( statistics.nbIterations < SURF_HOMOGRAPHY_MAX_ITERATIONS );
+		SurfHomography::projectCorners(found, src, dst);
+		for (int c = 0; c < 4; ++c)
+		{
+			BOOST_CHECK( abs(dst[c].x - expected[c].x) <= 2 );
+			BOOST_CHECK( abs(dst[c].y - expected[c].y) <= 2 );
+		}
+	}
+
+	// The pairs mapped behind the line at infinity (w < 0) reproject
+	// exactly as well but are not inliers
+	const double hBehind[9] = { 1, 0, 0, 0, 1, 0, -0.01, 0, 1 };
+	int nbInFront = 0;
+	for (int i = 0; i < 100; ++i)
+	{
+		double x = rand() % 300 + 0.5, y = rand() % 200;
+		double w = hBehind[6] * x + hBehind[7] * y + hBehind[8];
+		objectPoints[i].x = x;
+		objectPoints[i].y = y;
+		imagePoints[i].x = (hBehind[0] * x + hBehind[1] * y + hBehind[2]) / w;
+		imagePoints[i].y = (hBehind[3] * x + hBehind[4] * y + hBehind[5]) / w;
+		if (w > 0)
+			++nbInFront;
+	}
+	{
+		double found[9];
+		BOOST_CHECK( homography.find(objectPoints, imagePoints, 0, found) );
+		BOOST_CHECK_EQUAL( homography.getStatistics().nbInliers, nbInFront );
+	}
+
+	// Not enough pairs
+	objectPoints.resize(3);
+	imagePoints.resize(3);
+	double found[9];
+	BOOST_CHECK( !homography.find(objectPoints, imagePoints, 0, found) );
+}
+
+BOOST_AUTO_TEST_CASE( caseSurfResultQueue )
+{
+	using namespace rocs::cv;
+	SurfResultQueue queue(3);
+	SurfResult result;
+	result.nbKeypoints = 0;
+	result.objectLocated = false;
+
+	// The producer never waits, the oldest results are dropped
+	for (int i = 0; i < 5; ++i)
+	{
+		result.frame = i;
+		queue.push(result);
+	}
+	BOOST_CHECK_EQUAL( queue.size(), 3 );
+	BOOST_CHECK_EQUAL( queue.getNbDropped(), 2 );
+	for (int i = 2; i < 5; ++i)
+	{
+		BOOST_CHECK( queue.pop(result, false) );
+		BOOST_CHECK_EQUAL( result.frame, i );
+	}
+	BOOST_CHECK( !queue.pop(result, false) );
+
+	// Results pushed by another thread, then the queue is closed
+	boost::thread producer(boost::bind(&SurfResultQueue::push, &queue,
+			boost::cref(result)));
+	BOOST_CHECK( queue.pop(result) );
+	producer.join();
+	queue.close();
+	BOOST_CHECK( !queue.pop(result) );
+}
+
+/*!
+ * a test case checking the results delivered by a headless extractor
+ * to its sink, without allocations once the buffers are large enough
+ */
+BOOST_AUTO_TEST_CASE( caseSurfResultSink )
+{
+	using namespace rocs::cv;
+	HeadlessSurfExtractor extractor;
+	extractor.display_mode = SurfExtractor::DISPLAY_NONE;
+	SurfResultQueue queue(2);
+	extractor.setResultSink(boost::bind(&SurfResultQueue::push, &queue, _1));
+
+	// A located object with its pairs and an object of the database
+	extractor.planar_object_located = true;
+	for (int i = 0; i < 4; ++i)
+		extractor.dst_corners[i] = cvPoint(10 * i, 20 * i);
+	int nbPairs = SURF_LOCATING_MIN_PAIRS + 5;
+	extractor.ptpairs.assign(2 * nbPairs, 0);
+	extractor.pt1.resize(nbPairs);
+	extractor.pt2.resize(nbPairs);
+	for (int i = 0; i < nbPairs; ++i)
+	{
+		extractor.pt1[i] = cvPoint2D32f(i, 2 * i);
+		extractor.pt2[i] = cvPoint2D32f(3 * i, 4 * i);
+	}
+	SurfObjectDatabase::Detection detection;
+	detection.object = 7;
+	detection.nbPairs = 12;
+	detection.located = false;
+	extractor.object_detections.assign(1, detection);
+
+	SurfResult result;
+	extractor.surf_emitResult(0, 42);
+	BOOST_REQUIRE( queue.pop(result, false) );
+	BOOST_CHECK_EQUAL( result.frame, 0 );
+	BOOST_CHECK_EQUAL( result.nbKeypoints, 42 );
+	BOOST_CHECK( result.objectLocated );
+	BOOST_CHECK_EQUAL( result.objectCorners[3].x, 30 );
+	BOOST_CHECK_EQUAL( result.objectCorners[3].y, 60 );
+	BOOST_REQUIRE_EQUAL( (int) result.objectPoints.size(), nbPairs );
+	BOOST_REQUIRE_EQUAL( (int) result.imagePoints.size(), nbPairs );
+	BOOST_CHECK_EQUAL( result.objectPoints[nbPairs - 1].y, 2 * (nbPairs - 1) );
+	BOOST_CHECK_EQUAL( result.imagePoints[nbPairs - 1].x, 3 * (nbPairs - 1) );
+	BOOST_REQUIRE_EQUAL( result.detections.size(), 1u );
+	BOOST_CHECK_EQUAL( result.detections[0].object, 7 );
+	BOOST_CHECK_EQUAL( result.detections[0].nbPairs, 12 );
+
+	// Each slot of the queue is filled once, then the results of the
+	// following frames go through without allocating memory
+	for (int frame = 1; frame < 3; ++frame)
+	{
+		extractor.surf_emitResult(frame, 42);
+		BOOST_REQUIRE( queue.pop(result, false) );
+	}
+	{
+		HeapAllocationCounter counter;
+		for (int frame = 3; frame < 10; ++frame)
+		{
+			extractor.surf_emitResult(frame, 42);
+			BOOST_REQUIRE( queue.pop(result, false) );
+			BOOST_CHECK_EQUAL( result.frame, frame );
+			BOOST_CHECK_EQUAL( (int) result.imagePoints.size(), nbPairs );
+		}
+		BOOST_CHECK_EQUAL( counter.get(), 0 );
+	}
+
+	// Too few pairs to search the homography, no paired points
+	extractor.planar_object_located = false;
+	extractor.ptpairs.resize(2 * (SURF_LOCATING_MIN_PAIRS - 1));
+	extractor.surf_emitResult(10, 42);
+	BOOST_REQUIRE( queue.pop(result, false) );
+	BOOST_CHECK( !result.objectLocated );
+	BOOST_CHECK( result.imagePoints.empty() );
+	BOOST_CHECK_EQUAL( result.homography.nbIterations, 0 );
+	BOOST_CHECK_EQUAL( queue.getNbDropped(), 0 );
+}
+
+/*!
+ * collects the results passed to a sink
+ */
+struct ResultCollector
+{
+	vector<rocs::cv::SurfResult> *results;
+
+	void operator()(const rocs::cv::SurfResult &result) const
+	{
+		results->push_back(result);
+	}
+};
+
+/*!
+ * a test case checking that the pipelined matching passes the same
+ * results to the sink as the matching of each frame at once
+ */
+BOOST_AUTO_TEST_CASE( caseSurfPipeline )
+{
+	using namespace rocs::cv;
+	srand(6);
+	vector<float> descriptors;
+	vector<int> laplacians;
+
+	// Objects of the database
+	vector<SurfFeature> objects(4);
+	for (unsigned int o = 0; o < objects.size(); ++o)
+	{
+		randomDescriptors(60, descriptors, laplacians);
+		randomFeature(60, &descriptors[0], &laplacians[0], 200, 100,
+				objects[o]);
+	}
+
+	// Frames showing one of the objects or none, translated
+	const int nbFrames = 12;
+	vector<SurfFeature> frames(nbFrames);
+	for (int f = 0; f < nbFrames; ++f)
+	{
+		randomDescriptors(100, descriptors, laplacians);
+		randomFeature(100, &descriptors[0], &laplacians[0], 320, 240,
+				frames[f]);
+		if (f % 5 == 4)
+			continue;
+		const SurfFeature &object = objects[f % objects.size()];
+		for (int i = 0; i < 40; ++i)
+		{
+			frames[f].getKeypoint(i) = object.getKeypoint(i);
+			frames[f].getKeypoint(i).pt.x += 5 * f;
+			frames[f].getKeypoint(i).pt.y += 30;
+			frames[f].getDescriptors().set(i, object.getDescriptors()[i]);
+		}
+	}
+
+	// The same frames without and with pipelining
+	vector<SurfResult> results[2];
+	for (int pipelined = 0; pipelined < 2; ++pipelined)
+	{
+		HeadlessSurfExtractor extractor;
+		extractor.display_mode = SurfExtractor::DISPLAY_NONE;
+		extractor.matcher_indexed = true;
+		extractor.object_BW_image = 0;
+		for (unsigned int o = 0; o < objects.size(); ++o)
+			extractor.object_database.addObject("object", objects[o], 200, 100);
+		ResultCollector collector;
+		collector.results = &results[pipelined];
+		extractor.setResultSink(collector);
+		extractor.setPipelined(pipelined == 1);
+		for (int f = 0; f < nbFrames; ++f)
+		{
+			extractor.pending_features = frames[f];
+			extractor.surf_matchExtracted();
+
+			// Pipelined, the results come one frame late
+			BOOST_CHECK_EQUAL( (int) results[pipelined].size(), f + 1
+					- pipelined );
+		}
+		extractor.end();
+	}
+
+	// Every frame exactly once, in order, with the same detections
+	for (int pipelined = 0; pipelined < 2; ++pipelined)
+	{
+		BOOST_REQUIRE_EQUAL( (int) results[pipelined].size(), nbFrames );
+		for (int f = 0; f < nbFrames; ++f)
+			BOOST_CHECK_EQUAL( results[pipelined][f].frame, f );
+	}
+	for (int f = 0; f < nbFrames; ++f)
+	{
+		const SurfResult &direct = results[0][f];
+		const SurfResult &pipelined = results[1][f];
+		BOOST_CHECK_EQUAL( pipelined.nbKeypoints, direct.nbKeypoints );
+		BOOST_REQUIRE_EQUAL( pipelined.detections.size(),
+				direct.detections.size() );
+		BOOST_CHECK_EQUAL( direct.detections.size(), (f % 5 == 4) ? 0u : 1u );
+		for (unsigned int d = 0; d < direct.detections.size(); ++d)
+		{
+			BOOST_CHECK_EQUAL( pipelined.detections[d].object,
+					direct.detections[d].object );
+			BOOST_CHECK_EQUAL( pipelined.detections[d].nbPairs,
+					direct.detections[d].nbPairs );
+			BOOST_CHECK_EQUAL( pipelined.detections[d].located,
+					direct.detections[d].located );
+			for (int c = 0; c < 4; ++c)
+			{
+				BOOST_CHECK_EQUAL( pipelined.detections[d].corners[c].x,
+						direct.detections[d].corners[c].x );
+				BOOST_CHECK_EQUAL( pipelined.detections[d].corners[c].y,
+						direct.detections[d].corners[c].y );
+			}
+		}
+	}
+}